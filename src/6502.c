@@ -6,10 +6,12 @@
 #include "b-em.h"
 
 #include "6502.h"
+#include "6502jit.h"
 #include "adc.h"
 #include "disc.h"
 #include "i8271.h"
 #include "ide.h"
+#include "inputlog.h"
 #include "mem.h"
 #include "model.h"
 #include "mouse.h"
@@ -19,6 +21,7 @@
 #include "scsi.h"
 #include "sid_b-em.h"
 #include "sound.h"
+#include "speedmeter.h"
 #include "sysacia.h"
 #include "tape.h"
 #include "tube.h"
@@ -37,16 +40,80 @@ static int dbg_debug_enable(int newvalue) {
     return oldvalue;
 };
 
-static uint8_t a, x, y, s;
-static uint16_t pc;
-static PREG p;
+static MACHINE_LOCAL uint8_t a, x, y, s;
+static MACHINE_LOCAL uint16_t pc;
+static MACHINE_LOCAL PREG p;
 
-uint8_t opcode;
+#ifdef USE_6502_LAZY_NZ
+/*
+ * N and Z are kept as the value they were last set from, which is all
+ * most instructions need to store: Z is set while the low byte of nz is
+ * zero and N while bit 7 or 8 is.  BIT, which takes N from the operand
+ * but Z from the AND, uses bit 8.  The n and z members of p are unused.
+ */
+static MACHINE_LOCAL uint16_t nz;
+
+static inline bool flag_n(void)
+{
+    return nz & 0x180;
+}
+
+static inline bool flag_z(void)
+{
+    return !(nz & 0xff);
+}
+
+static inline void set_flags_nz(bool n, bool z)
+{
+    nz = (n ? 0x100 : 0) | (z ? 0 : 1);
+}
+
+static inline void setzn(uint8_t v)
+{
+    nz = v;
+}
+
+// BIT takes Z from the AND of A and the operand but N from the operand.
+static inline void setzn_bit(uint8_t and, uint8_t operand)
+{
+    nz = and | ((operand & 0x80) << 1);
+}
+#else
+static inline bool flag_n(void)
+{
+    return p.n;
+}
+
+static inline bool flag_z(void)
+{
+    return p.z;
+}
+
+static inline void set_flags_nz(bool n, bool z)
+{
+    p.n = n;
+    p.z = z;
+}
+
+static inline void setzn(uint8_t v)
+{
+    p.z = !v;
+    p.n = (v) & 0x80;
+}
+
+static inline void setzn_bit(uint8_t and, uint8_t operand)
+{
+    p.z = !and;
+    p.n = operand & 0x80;
+}
+#endif
+
+MACHINE_LOCAL uint8_t opcode;
 
 static inline uint8_t pack_flags(uint8_t flags) {
     if (p.c)
         flags |= 1;
-    if (p.z)
+    if (flag_z())
         flags |= 2;
     if (p.i)
         flags |= 4;
@@ -54,18 +121,17 @@ static inline uint8_t pack_flags(uint8_t flags) {
         flags |= 8;
     if (p.v)
         flags |= 0x40;
-    if (p.n)
+    if (flag_n())
         flags |= 0x80;
     return flags;
 }
 
 static inline void unpack_flags(uint8_t flags) {
     p.c = flags & 1;
-    p.z = flags & 2;
     p.i = flags & 4;
     p.d = flags & 8;
     p.v = flags & 0x40;
-    p.n = flags & 0x80;
+    set_flags_nz(flags & 0x80, flags & 2);
 }
 
 #ifndef NO_USE_DEBUGGER
@@ -118,9 +184,12 @@ static void dbg_reg_set(int which, uint32_t value) {
 static size_t dbg_reg_print(int which, char *buf, size_t bufsize) {
     switch (which)
     {
-    case REG_P:
-        return dbg6502_print_flags(&p, buf, bufsize);
-        break;
+    case REG_P: {
+        PREG flags = p;
+        flags.n = flag_n();
+        flags.z = flag_z();
+        return dbg6502_print_flags(&flags, buf, bufsize);
+    }
     case REG_PC:
         return snprintf(buf, bufsize, "%04X", pc);
         break;
@@ -168,16 +237,113 @@ static uint32_t dbg_disassemble(uint32_t addr, char *buf, size_t bufsize) {
 }
 #endif
 
-int tubecycle;
+MACHINE_LOCAL int tubecycle;
+
+MACHINE_LOCAL int output = 0;
+static MACHINE_LOCAL int timetolive = 0;
+
+static MACHINE_LOCAL int cycles;
+static MACHINE_LOCAL int otherstuffcount = 0;
+
+MACHINE_LOCAL int32_t m6502_exit_pc = -1;
+MACHINE_LOCAL bool m6502_exit_hit = false;
+static MACHINE_LOCAL int romsel;
+static MACHINE_LOCAL int ram4k, ram8k, ram12k, ram20k;
+
+#ifdef USE_HW_EVENT
+/*
+ * Hardware event queue (see src/pico/TECHNICAL.md).  Devices queue a
+ * struct hw_event for the cycle at which they next need attention and
+ * otherwise catch up lazily when they are accessed, so all polltime has
+ * to do is compare the time against the head of the queue.  This core
+ * clocks the hardware at every bus cycle, so the CPU and hardware
+ * timestamps are always the same.
+ */
+static MACHINE_LOCAL cycle_timestamp_t hw_event_timestamp;
+static MACHINE_LOCAL struct list_element *next_event;
+static MACHINE_LOCAL cycle_timestamp_t next_event_timestamp = 0x6fffffff;
+
+static inline void update_next_event_timestamp(void)
+{
+    if (next_event)
+        next_event_timestamp = ((struct hw_event *)next_event)->target;
+    else
+        next_event_timestamp = hw_event_timestamp + 0x6fffffff; // nothing pending.
+}
+
+void upsert_hw_event(struct hw_event *new_event)
+{
+    struct list_element *prev = NULL;
+
+    list_remove(&next_event, &new_event->e);
+    for (struct list_element *e = next_event; e; e = e->next) {
+        struct hw_event *event = (struct hw_event *)e;
+        if ((event->target - new_event->target) > 0) // wrap safe
+            break;
+        prev = e;
+    }
+    if (prev)
+        list_insert_after(prev, &new_event->e);
+    else {
+        new_event->e.next = next_event;
+        next_event = &new_event->e;
+    }
+    update_next_event_timestamp();
+}
 
-int output = 0;
-static int timetolive = 0;
+void remove_hw_event(struct hw_event *event)
+{
+    list_remove(&next_event, &event->e);
+    update_next_event_timestamp();
+}
 
-static int cycles;
-static int otherstuffcount = 0;
-static int romsel;
-static int ram4k, ram8k, ram12k, ram20k;
+void set_simple_hw_event_counter(struct hw_event *event, int cycles)
+{
+    if (!cycles)
+        remove_hw_event(event);
+    else {
+        event->target = hw_event_timestamp + cycles;
+        upsert_hw_event(event);
+    }
+}
+
+cycle_timestamp_t get_cpu_timestamp()
+{
+    return hw_event_timestamp;
+}
+
+cycle_timestamp_t get_hardware_timestamp()
+{
+    return hw_event_timestamp;
+}
+
+static void run_hw_events(void)
+{
+    while ((next_event_timestamp - hw_event_timestamp) <= 0) {
+        struct hw_event *firing = (struct hw_event *)list_remove_head(&next_event);
+        update_next_event_timestamp();
+        if (firing->invoke(firing))
+            upsert_hw_event(firing);
+    }
+}
+
+void advance_hardware(cycle_timestamp_t target)
+{
+    if ((target - hw_event_timestamp) > 0) {
+        hw_event_timestamp = target;
+        run_hw_events();
+    }
+}
 
+static inline void polltime(int c)
+{
+    cycles -= c;
+    hw_event_timestamp += c;
+    if ((next_event_timestamp - hw_event_timestamp) <= 0)
+        run_hw_events();
+    tubecycle += c;
+}
+#else
 static inline void polltime(int c)
 {
     cycles -= c;
@@ -188,39 +354,68 @@ static inline void polltime(int c)
     if (motoron) {
         if (fdc_time) {
             fdc_time -= c;
-            if (fdc_time <= 0)
+            if (fdc_time <= 0) {
+                speed_enter(SPEED_DISC);
                 fdc_callback();
+                speed_leave(SPEED_CPU);
+            }
         }
         disc_time -= c;
         if (disc_time <= 0) {
             disc_time += 16;
+            speed_enter(SPEED_DISC);
             disc_poll();
+            speed_leave(SPEED_CPU);
         }
     }
     tubecycle += c;
 }
+#endif
 
 static int FEslowdown[8] = { 1, 0, 1, 1, 0, 0, 1, 0 };
-static int RAMbank[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-
-static uint8_t *memlook[2][256];
-static enum {
-    HW = 0,
-    RAM = 1,
-    ROM = 2
-} memstat[2][256];
+static MACHINE_LOCAL int RAMbank[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/*
+ * The memory map, a page at a time, for each of the two views of memory
+ * (vis20k is set while a Master or B+ runs code in its VDU driver area
+ * and so sees shadow RAM).  memlook has the host address of each page
+ * less the page's 6502 address, or NULL for the I/O pages at FC00-FEFF
+ * which are handled by do_readio.  memwrite is the same for the pages
+ * that can be written so ROM and I/O pages are NULL there.  Paging just
+ * swaps entries so RAM and ROM are reached with a single load.
+ */
+static MACHINE_LOCAL uint8_t *memlook[2][256];
+static MACHINE_LOCAL uint8_t *memwrite[2][256];
+
+static MACHINE_LOCAL int vis20k = 0;
+
+static void map_page(int view, int page, uint8_t *base, bool writable)
+{
+    memlook[view][page] = base;
+    memwrite[view][page] = writable ? base : NULL;
+}
 
-static int vis20k = 0;
+static void map_pages(int first, int last, uint8_t *base, bool writable)
+{
+    for (int page = first; page < last; page++) {
+        map_page(0, page, base, writable);
+        map_page(1, page, base, writable);
+    }
+}
 
-static uint8_t acccon;
+static MACHINE_LOCAL uint8_t acccon;
 
-static uint16_t buf_remv = 0xffff;
-static uint16_t buf_cnpv = 0xffff;
-static unsigned char *clip_paste_str, *clip_paste_ptr;
-static int os_paste_ch;
+static MACHINE_LOCAL uint16_t buf_remv = 0xffff;
+static MACHINE_LOCAL uint16_t buf_cnpv = 0xffff;
+static MACHINE_LOCAL unsigned char *clip_paste_str, *clip_paste_ptr;
+static MACHINE_LOCAL int os_paste_ch;
 
 void os_paste_start(char *str)
 {
+    if (str && !inputlog_paste(str)) {
+        free(str);
+        return;
+    }
     if (str) {
         if (clip_paste_str)
             free(clip_paste_str);
@@ -281,48 +476,8 @@ static void os_paste_cnpv(void)
     opcode = readmem(pc);
 }
 
-static inline void fetch_opcode(void)
+static uint32_t do_readio(uint32_t addr)
 {
-#ifndef NO_USE_DEBUGGER
-    pc3 = oldoldpc;
-    oldoldpc = oldpc;
-    oldpc = pc;
-#endif
-    vis20k = RAMbank[pc >> 12];
-
-#ifndef NO_USE_DEBUGGER
-    if (dbg_core6502)
-        debug_preexec(&core6502_cpu_debug, pc);
-#endif
-    if (pc == buf_remv && x == 0 && clip_paste_ptr)
-        os_paste_remv();
-    else if (pc == buf_cnpv && x == 0 && clip_paste_ptr)
-        os_paste_cnpv();
-    else
-        opcode = readmem(pc);
-    pc++;
-}
-
-static inline uint16_t read_zp_indirect(uint16_t zp)
-{
-    return readmem(zp & 0xff) + (readmem((zp + 1) & 0xff) << 8);
-}
-
-static uint32_t do_readmem(uint32_t addr)
-{
-
-        if (addr >= 0x10000)
-            return 0xFF;
-
-#ifndef NO_USE_DEBUGGER
-        if (pc == addr)
-            fetchc[addr] = 31;
-        else
-            readc[addr] = 31;
-#endif
-
-        if (memstat[vis20k][addr >> 8] != HW)
-                return memlook[vis20k][addr >> 8][addr];
         if (MASTER && (acccon & 0x40) && addr >= 0xFC00)
                 return os[addr & 0x3FFF];
         if (addr < 0xFE00 || FEslowdown[(addr >> 5) & 7]) {
@@ -474,51 +629,54 @@ static uint32_t do_readmem(uint32_t addr)
         return addr >> 8;
 }
 
-uint8_t readmem(uint16_t addr)
+static inline uint32_t do_readmem(uint32_t addr)
+{
+        const uint8_t *base;
+
+        if (addr >= 0x10000)
+            return 0xFF;
+        if ((base = memlook[vis20k][addr >> 8]))
+            return base[addr];
+        return do_readio(addr);
+}
+
+/*
+ * Memory access from the cores.  Each core is built both with and without
+ * debug (see m6502_exec) and without it none of the debugger's bookkeeping
+ * is done, not even the access counts for the memory view.
+ */
+static inline __attribute__((always_inline)) uint8_t core_readmem(uint16_t addr, const bool debug)
 {
-    uint32_t value = do_readmem(addr);
+    uint32_t value;
 #ifndef NO_USE_DEBUGGER
-    if (dbg_core6502)
-    debug_memread(&core6502_cpu_debug, addr, value, 1);
+    if (debug) {
+        if (pc == addr)
+            fetchc[addr] = 31;
+        else
+            readc[addr] = 31;
+    }
+#endif
+    value = do_readmem(addr);
+#ifndef NO_USE_DEBUGGER
+    if (debug && dbg_core6502)
+        debug_memread(&core6502_cpu_debug, addr, value, 1);
 #endif
     return value;
 }
 
-static void do_writemem(uint32_t addr, uint32_t val)
+uint8_t readmem(uint16_t addr)
+{
+    return core_readmem(addr, true);
+}
+
+static void do_writeio(uint32_t addr, uint32_t val)
 {
         int c;
 
-        if (addr >= 0x10000)
-            return;
-
-#ifndef NO_USE_DEBUGGER
-        writec[addr] = 31;
-#endif
-
-        c = memstat[vis20k][addr >> 8];
-        if (c == RAM) {
-                memlook[vis20k][addr >> 8][addr] = val;
-                switch(addr) {
-                    case 0x022c:
-                        buf_remv = (buf_remv & 0xff00) | val;
-                        break;
-                    case 0x022d:
-                        buf_remv = (buf_remv & 0xff) | (val << 8);
-                        break;
-                    case 0x022e:
-                        buf_cnpv = (buf_cnpv & 0xff00) | val;
-                        break;
-                    case 0x022f:
-                        buf_cnpv = (buf_cnpv & 0xff) | (val << 8);
-                        break;
-                }
-                return;
-        } else if (c == ROM) {
+        if (memlook[vis20k][addr >> 8]) {
                 log_debug("6502: attempt to write to ROM %x:%04x=%02x\n", vis20k, addr, val);
                 return;
         }
-        if (addr < 0xFC00 || addr >= 0xFF00)
-                return;
         if (addr < 0xFE00 || FEslowdown[(addr >> 5) & 7]) {
                 if (cycles & 1) {
                         polltime(2);
@@ -621,27 +779,15 @@ static void do_writemem(uint32_t addr, uint32_t val)
 
         case 0xFE30:
                 ram_fe30 = val;
-                for (c = 128; c < 192; c++)
-                        memlook[0][c] = memlook[1][c] = rom_slot_ptr(val&15) - 0x8000;
-//                            &rom[(val & 15) << 14] - 0x8000;
-                for (c = 128; c < 192; c++)
-                        memstat[0][c] = memstat[1][c] = rom_slots[val & 15].swram ? RAM : ROM;
+                map_pages(128, 192, rom_slot_ptr(val & 15) - 0x8000, rom_slots[val & 15].swram);
                 romsel = (val & 15) << 14;
                 ram4k = ((val & 0x80) && MASTER);
                 ram12k = ((val & 0x80) && BPLUS);
                 RAMbank[0xA] = ram12k;
-                if (ram4k) {
-                        for (c = 128; c < 144; c++)
-                                memlook[0][c] = memlook[1][c] = ram;
-                        for (c = 128; c < 144; c++)
-                                memstat[0][c] = memstat[1][c] = RAM;
-                }
-                if (ram12k) {
-                        for (c = 128; c < 176; c++)
-                                memlook[0][c] = memlook[1][c] = ram;
-                        for (c = 128; c < 176; c++)
-                                memstat[0][c] = memstat[1][c] = RAM;
-                }
+                if (ram4k)
+                        map_pages(128, 144, ram, true);
+                if (ram12k)
+                        map_pages(128, 176, ram, true);
                 break;
 
         case 0xFE34:
@@ -664,20 +810,11 @@ static void do_writemem(uint32_t addr, uint32_t val)
                         else
                                 RAMbank[0xC] = RAMbank[0xD] = 0;
                         for (c = 48; c < 128; c++)
-                                memlook[0][c] = ram + ((ram20k) ? 32768 : 0);
-                        if (ram8k) {
-                                for (c = 192; c < 224; c++)
-                                        memlook[0][c] = memlook[1][c] =
-                                            ram - 0x3000;
-                                for (c = 192; c < 224; c++)
-                                        memstat[0][c] = memstat[1][c] = RAM;
-                        } else {
-                                for (c = 192; c < 224; c++)
-                                        memlook[0][c] = memlook[1][c] =
-                                            os - 0xC000;
-                                for (c = 192; c < 224; c++)
-                                        memstat[0][c] = memstat[1][c] = ROM;
-                        }
+                                map_page(0, c, ram + ((ram20k) ? 32768 : 0), true);
+                        if (ram8k)
+                                map_pages(192, 224, ram - 0x3000, true);
+                        else
+                                map_pages(192, 224, os - 0xC000, false);
                 }
                 break;
 
@@ -752,47 +889,79 @@ static void do_writemem(uint32_t addr, uint32_t val)
         }
 }
 
-void writemem(uint16_t addr, uint8_t val)
+static inline void do_writemem(uint32_t addr, uint32_t val)
+{
+        uint8_t *base;
+
+        if (addr >= 0x10000)
+            return;
+        if ((base = memwrite[vis20k][addr >> 8])) {
+#ifdef USE_HW_EVENT
+                // let the CRTC reach the beam before the screen changes under it.
+                if (addr >= 0x3000 && addr < 0x8000)
+                        video_cycle_sync();
+#endif
+                base[addr] = val;
+                jit6502_written(&base[addr]);
+                switch(addr) {
+                    case 0x022c:
+                        buf_remv = (buf_remv & 0xff00) | val;
+                        break;
+                    case 0x022d:
+                        buf_remv = (buf_remv & 0xff) | (val << 8);
+                        break;
+                    case 0x022e:
+                        buf_cnpv = (buf_cnpv & 0xff00) | val;
+                        break;
+                    case 0x022f:
+                        buf_cnpv = (buf_cnpv & 0xff) | (val << 8);
+                        break;
+                }
+                return;
+        }
+        do_writeio(addr, val);
+}
+
+static inline __attribute__((always_inline)) void core_writemem(uint16_t addr, uint8_t val, const bool debug)
 {
 #ifndef NO_USE_DEBUGGER
-    if (dbg_core6502)
-    debug_memwrite(&core6502_cpu_debug, addr, val, 1);
+    if (debug) {
+        writec[addr] = 31;
+        if (dbg_core6502)
+            debug_memwrite(&core6502_cpu_debug, addr, val, 1);
+    }
 #endif
     do_writemem(addr, val);
 }
 
-int nmi, oldnmi, takeint;
-static int interrupt;
+void writemem(uint16_t addr, uint8_t val)
+{
+    core_writemem(addr, val, true);
+}
+
+MACHINE_LOCAL int nmi, oldnmi, takeint;
+static MACHINE_LOCAL int interrupt;
 
-uint16_t pc3, oldpc, oldoldpc;
+MACHINE_LOCAL uint16_t pc3, oldpc, oldoldpc;
 
 void m6502_reset()
 {
         int c;
         for (c = 0; c < 16; c++)
                 RAMbank[c] = 0;
-        for (c = 0; c < 128; c++)
-                memstat[0][c] = memstat[1][c] = RAM;
-        for (c = 128; c < 256; c++)
-                memstat[0][c] = memstat[1][c] = ROM;
-        for (c = 0; c < 128; c++)
-                memlook[0][c] = memlook[1][c] = ram;
-        if (MODELA) {
-                for (c = 0; c < 64; c++)
-                        memlook[0][c] = memlook[1][c] = ram + 16384;
-        }
+        map_pages(0, 128, ram, true);
+        if (MODELA)
+                map_pages(0, 64, ram + 16384, true);
         for (c = 48; c < 128; c++)
-                memlook[1][c] = ram + 32768;
-        for (c = 128; c < 192; c++)
-                memlook[0][c] = memlook[1][c] = rom_slot_ptr(0) - 0x8000;
-        for (c = 192; c < 256; c++)
-                memlook[0][c] = memlook[1][c] = os - 0xC000;
-        memstat[0][0xFC] = memstat[0][0xFD] = memstat[0][0xFE] = HW;
-        memstat[1][0xFC] = memstat[1][0xFD] = memstat[1][0xFE] = HW;
+                map_page(1, c, ram + 32768, true);
+        map_pages(128, 192, rom_slot_ptr(0) - 0x8000, false);
+        map_pages(192, 256, os - 0xC000, false);
+        map_pages(0xFC, 0xFF, NULL, false);
 
         cycles = 0;
         ram4k = ram8k = ram12k = ram20k = 0;
 
+        jit6502_flush();
         pc = readmem(0xFFFC) | (readmem(0xFFFD) << 8);
         p.i = 1;
         nmi = oldnmi = 0;
@@ -808,39 +977,38 @@ void dumpregs()
 {
         log_debug("6502 registers :\n");
         log_debug("A=%02X X=%02X Y=%02X S=01%02X PC=%04X\n", a, x, y, s, pc);
-        log_debug("Status : %c%c%c%c%c%c\n", (p.n) ? 'N' : ' ', (p.v) ? 'V' : ' ',
-               (p.d) ? 'D' : ' ', (p.i) ? 'I' : ' ', (p.z) ? 'Z' : ' ',
+        log_debug("Status : %c%c%c%c%c%c\n", flag_n() ? 'N' : ' ', (p.v) ? 'V' : ' ',
+               (p.d) ? 'D' : ' ', (p.i) ? 'I' : ' ', flag_z() ? 'Z' : ' ',
                (p.c) ? 'C' : ' ');
         log_debug("ROMSEL %02X\n", romsel >> 14);
 }
 
-static inline uint16_t getsw()
-{
-        uint16_t temp = readmem(pc);
-        pc++;
-        temp |= (readmem(pc) << 8);
-        pc++;
-        return temp;
-}
-
 static void otherstuff_poll(void) {
+#ifndef USE_HW_EVENT
     otherstuffcount += 128;
     acia_poll(&sysacia);
+#endif
 #ifndef NO_USE_MUSIC5000
     if (sound_music5000)
         music2000_poll();
 #endif
+#ifndef USE_HW_EVENT
+    speed_enter(SPEED_SOUND);
     sound_poll();
+    speed_leave(SPEED_CPU);
+#endif
     if (!tapelcount) {
         tape_poll();
         tapelcount = tapellatch;
     }
     tapelcount--;
+#ifndef USE_HW_EVENT
     if (motorspin) {
         motorspin--;
         if (!motorspin)
             fdc_spindown();
     }
+#endif
 #ifndef NO_USE_IDE
     if (ide_count) {
         ide_count -= 200;
@@ -864,23 +1032,20 @@ static void otherstuff_poll(void) {
 #endif
 }
 
-#define getw() getsw()
-
-static inline void setzn(uint8_t v)
-{
-    p.z = !v;
-    p.n = (v) & 0x80;
-}
-
-static inline void push(uint8_t v)
+#ifdef USE_HW_EVENT
+// the devices that have not been given events of their own are still
+// polled every 128 cycles.
+static bool otherstuff_invoke(struct hw_event *event)
 {
-    writemem(0x100 + s--, v);
+    otherstuff_poll();
+    event->target += 128;
+    return true;
 }
 
-static inline uint8_t pull(void)
-{
-    return readmem(0x100 + ++s);
-}
+static MACHINE_LOCAL struct hw_event otherstuff_event = {
+    .invoke = otherstuff_invoke
+};
+#endif
 
 static inline void adc_nmos(uint8_t temp)
 {
@@ -890,10 +1055,7 @@ static inline void adc_nmos(uint8_t temp)
 
     if (p.d) {
         ah = 0;
-        p.z = p.n = 0;
         tempb = a + temp + (p.c ? 1:0);
-        if (!tempb)
-           p.z = 1;
         al = (a & 0xF) + (temp & 0xF) + (p.c ? 1 : 0);
         if (al > 9) {
             al -= 10;
@@ -901,8 +1063,7 @@ static inline void adc_nmos(uint8_t temp)
             ah = 1;
         }
         ah += ((a >> 4) + (temp >> 4));
-        if (ah & 8)
-            p.n = 1;
+        set_flags_nz(ah & 8, !tempb);
         p.v = (((ah << 4) ^ a) & 128) && !((a ^ temp) & 128);
         p.c = 0;
         if (ah > 9) {
@@ -929,10 +1090,7 @@ static inline void sbc_nmos(uint8_t temp)
 
     if (p.d) {
         hc6 = 0;
-        p.z = p.n = 0;
         tempb = a - temp - ((p.c) ? 0 : 1);
-        if (!(tempb))
-           p.z = 1;
         al = (a & 15) - (temp & 15) - (p.c ? 0 : 1);
         if (al & 16) {
             al -= 6;
@@ -942,8 +1100,7 @@ static inline void sbc_nmos(uint8_t temp)
         ah = (a >> 4) - (temp >> 4);
         if (hc6)
             ah--;                       \
-        if ((a - (temp + (p.c ? 0 : 1))) & 0x80)
-           p.n = 1;
+        set_flags_nz((a - (temp + (p.c ? 0 : 1))) & 0x80, !tempb);
         p.v = ((a ^ temp) & 0x80) && ((a ^ tempb) & 0x80);
         p.c = 1;
         if (ah & 16) {
@@ -1044,14 +1201,171 @@ static void branchcycles(int temp)
 
 void m6502_init()
 {
+#ifdef USE_HW_EVENT
+    otherstuff_event.target = get_hardware_timestamp() + 128;
+    upsert_hw_event(&otherstuff_event);
+#endif
 }
 
+#ifndef USE_HW_EVENT
 int32_t get_cpu_timestamp() {
-    extern int framesrun;
+    extern MACHINE_LOCAL int framesrun;
     return 40000 * (framesrun - 1) + (40000 - cycles);
 }
+#endif
+
+#ifndef NO_USE_JIT6502
+#ifndef USE_HW_EVENT
+/*
+ * The cycles polltime can be given in one go before the first in which
+ * a VIA sets an interrupt flag, the CRTC reaches its horizontal total or
+ * the disc, sound or serial polls are due.
+ */
+static int jit_next_event(void)
+{
+    int next = via_next_event(&sysvia), t;
+
+    if ((t = via_next_event(&uservia)) < next)
+        next = t;
+    if ((t = video_next_event()) < next)
+        next = t;
+    if (otherstuffcount < next)
+        next = otherstuffcount;
+    if (motoron) {
+        if (fdc_time && fdc_time < next)
+            next = fdc_time;
+        if (disc_time < next)
+            next = disc_time;
+    }
+    return next;
+}
+#endif
+
+/*
+ * Run a translated block from pc (see 6502jit.c), returning false if
+ * the interpreter is to run the next instruction instead.  The hardware
+ * is polled once for the whole block, so blocks end at least a cycle
+ * before the next hardware event and the interpreter runs the instruction
+ * in which it happens, taking any interrupt when it would have.  Writes to
+ * screen memory still reach the CRTC when the block ends rather than on
+ * their own cycle, so a write part way along a displayed line can show up
+ * to a block's worth of characters early.
+ */
+static bool jit_exec(void)
+{
+    jit6502_regs_t r;
+    int budget;
+
+    // an interrupt already waiting is taken after the next instruction.
+    if (!jit6502_enabled || p.d || clip_paste_ptr || (interrupt && !p.i))
+        return false;
+#ifndef NO_USE_DEBUGGER
+    if (dbg_core6502)
+        return false;
+#endif
+#ifdef USE_HW_EVENT
+    budget = next_event_timestamp - hw_event_timestamp - 1;
+#else
+    budget = jit_next_event() - 1;
+#endif
+    if (budget > cycles)
+        budget = cycles;
+    vis20k = RAMbank[pc >> 12];
+    r.a = a;
+    r.x = x;
+    r.y = y;
+    r.s = s;
+    r.c = p.c != 0;
+    r.z = flag_z();
+    r.n = flag_n();
+    r.v = p.v != 0;
+    r.i = p.i != 0;
+    r.d = 0;
+    r.pc = pc;
+    r.memlook = memlook[vis20k];
+    if (!jit6502_run(&r, budget))
+        return false;
+    a = r.a;
+    x = r.x;
+    y = r.y;
+    s = r.s;
+    p.c = r.c;
+    set_flags_nz(r.n, r.z);
+    p.v = r.v;
+    pc = r.pc;
+    polltime(r.cycles);
+    takeint = (interrupt && !p.i);
+    return true;
+}
+#endif
 
-    void m6502_exec()
+/*
+ * m6502_exec and m65c02_exec each run one of two variants of their core,
+ * with debug true while the debugger is attached to the 6502 or a headless
+ * run is waiting for it to reach -exitpc, and false otherwise.  Within the
+ * cores memory is only reached through the macros below so with debug
+ * false the previous PCs, the memory view counts, the calls out to the
+ * debugger and the comparison of each PC with the exit address all compile
+ * away.
+ */
+#define readmem(addr)       core_readmem(addr, debug)
+#define writemem(addr, val) core_writemem(addr, val, debug)
+
+static inline __attribute__((always_inline)) void core_fetch_opcode(const bool debug)
+{
+#ifndef NO_USE_DEBUGGER
+    if (debug) {
+        pc3 = oldoldpc;
+        oldoldpc = oldpc;
+        oldpc = pc;
+    }
+#endif
+    vis20k = RAMbank[pc >> 12];
+
+#ifndef NO_USE_DEBUGGER
+    if (debug && dbg_core6502)
+        debug_preexec(&core6502_cpu_debug, pc);
+#endif
+    if (pc == buf_remv && x == 0 && clip_paste_ptr)
+        os_paste_remv();
+    else if (pc == buf_cnpv && x == 0 && clip_paste_ptr)
+        os_paste_cnpv();
+    else
+        opcode = readmem(pc);
+    pc++;
+}
+
+static inline __attribute__((always_inline)) uint16_t core_getw(const bool debug)
+{
+        uint16_t temp = readmem(pc);
+        pc++;
+        temp |= (readmem(pc) << 8);
+        pc++;
+        return temp;
+}
+
+static inline __attribute__((always_inline)) uint16_t core_read_zp_indirect(uint16_t zp, const bool debug)
+{
+    return readmem(zp & 0xff) + (readmem((zp + 1) & 0xff) << 8);
+}
+
+static inline __attribute__((always_inline)) void core_push(uint8_t v, const bool debug)
+{
+    writemem(0x100 + s--, v);
+}
+
+static inline __attribute__((always_inline)) uint8_t core_pull(const bool debug)
+{
+    return readmem(0x100 + ++s);
+}
+
+#define fetch_opcode()       core_fetch_opcode(debug)
+#define getw()               core_getw(debug)
+#define read_zp_indirect(zp) core_read_zp_indirect(zp, debug)
+#define push(v)              core_push(v, debug)
+#define pull()               core_pull(debug)
+
+static inline __attribute__((always_inline)) void m6502_core(const bool debug)
 {
         uint16_t addr;
         uint8_t temp;
@@ -1060,11 +1374,19 @@ int32_t get_cpu_timestamp() {
         cycles += 40000;
 
         while (cycles > 0) {
+            if (debug && pc == m6502_exit_pc) {
+                m6502_exit_hit = true;
+                break;
+            }
+#ifndef NO_USE_JIT6502
+            if (jit6502_enabled && jit_exec())
+                goto jit_done;
+#endif
             fetch_opcode();
                 switch (opcode) {
                 case 0x00:      /* BRK */
 #ifndef NO_USE_DEBUGGER
-                        if (dbg_core6502)
+                        if (debug && dbg_core6502)
                             debug_trap(&core6502_cpu_debug, oldpc, 0);
 #endif
                         pc++;
@@ -1173,7 +1495,7 @@ int32_t get_cpu_timestamp() {
                         a &= readmem(pc);
                         pc++;
                         setzn(a);
-                        p.c = p.n;
+                        p.c = flag_n();
                         polltime(2);
                         takeint = (interrupt && !p.i);
                         break;
@@ -1225,7 +1547,7 @@ int32_t get_cpu_timestamp() {
                         /*BPL*/ offset = (int8_t) readmem(pc);
                         pc++;
                         temp = 2;
-                        if (!p.n) {
+                        if (!flag_n()) {
                                 temp++;
                                 if ((pc & 0xFF00) ^ ((pc + offset) & 0xFF00))
                                         temp++;
@@ -1444,9 +1766,8 @@ int32_t get_cpu_timestamp() {
                         addr = readmem(pc);
                         pc++;
                         temp = readmem(addr);
-                        p.z = !(a & temp);
+                        setzn_bit(a & temp, temp);
                         p.v = temp & 0x40;
-                        p.n = temp & 0x80;
                         polltime(3);
                         takeint = (interrupt && !p.i);
                         break;
@@ -1521,7 +1842,7 @@ int32_t get_cpu_timestamp() {
                         a &= readmem(pc);
                         pc++;
                         setzn(a);
-                        p.c = p.n;
+                        p.c = flag_n();
                         polltime(2);
                         takeint = (interrupt && !p.i);
                         break;
@@ -1531,9 +1852,8 @@ int32_t get_cpu_timestamp() {
                         polltime(4);
                         takeint = (interrupt && !p.i);
                         temp = readmem(addr);
-                        p.z = !(a & temp);
+                        setzn_bit(a & temp, temp);
                         p.v = temp & 0x40;
-                        p.n = temp & 0x80;
                         break;
 
                 case 0x2D:      /*AND abs */
@@ -1582,7 +1902,7 @@ int32_t get_cpu_timestamp() {
                         /*BMI*/ offset = (int8_t) readmem(pc);
                         pc++;
                         temp = 2;
-                        if (p.n) {
+                        if (flag_n()) {
                                 temp++;
                                 if ((pc & 0xFF00) ^ ((pc + offset) & 0xFF00))
                                         temp++;
@@ -3194,7 +3514,7 @@ int32_t get_cpu_timestamp() {
                         /*BNE*/ offset = (int8_t) readmem(pc);
                         pc++;
                         temp = 2;
-                        if (!p.z) {
+                        if (!flag_z()) {
                                 temp++;
                                 if ((pc & 0xFF00) ^ ((pc + offset) & 0xFF00))
                                         temp++;
@@ -3517,7 +3837,7 @@ int32_t get_cpu_timestamp() {
                         /*BEQ*/ offset = (int8_t) readmem(pc);
                         pc++;
                         temp = 2;
-                        if (p.z) {
+                        if (flag_z()) {
                                 temp++;
                                 if ((pc & 0xFF00) ^ ((pc + offset) & 0xFF00))
                                         temp++;
@@ -3786,7 +4106,7 @@ int32_t get_cpu_timestamp() {
 /*                if (output)
                 {
 //                        #undef printf
-                        log_debug("A=%02X X=%02X Y=%02X S=%02X PC=%04X %c%c%c%c%c%c op=%02X %02X%02X\n",a,x,y,s,pc,(p.n)?'N':' ',(p.v)?'V':' ',(p.d)?'D':' ',(p.i)?'I':' ',(p.z)?'Z':' ',(p.c)?'C':' ',opcode,ram[0x29],uservia.ifr);
+                        log_debug("A=%02X X=%02X Y=%02X S=%02X PC=%04X %c%c%c%c%c%c op=%02X %02X%02X\n",a,x,y,s,pc,flag_n()?'N':' ',(p.v)?'V':' ',(p.d)?'D':' ',(p.i)?'I':' ',flag_z()?'Z':' ',(p.c)?'C':' ',opcode,ram[0x29],uservia.ifr);
                 }*/
 //                if (pc==0x400) output=1;
                 if (timetolive) {
@@ -3794,6 +4114,9 @@ int32_t get_cpu_timestamp() {
                         if (!timetolive)
                                 output = 0;
                 }
+#ifndef NO_USE_JIT6502
+jit_done:
+#endif
                 if (takeint) {
 //                        output=1;
                         interrupt &= ~128;
@@ -3810,13 +4133,22 @@ int32_t get_cpu_timestamp() {
                 }
                 interrupt &= ~128;
 
-                if (otherstuffcount <= 0)
+#ifndef USE_HW_EVENT
+                while (otherstuffcount <= 0)
                     otherstuff_poll();
+#endif
 #ifndef NO_USE_TUBE
                 if (tube_exec && tubecycle) {
-                        tubecycles += (tubecycle * tube_multipler) >> 1;
-                        if (tubecycles > 3)
-                                tube_exec();
+                        if (tube_thread_on)
+                                tube_thread_credit((tubecycle * tube_multipler) >> 1);
+                        else {
+                                tubecycles += (tubecycle * tube_multipler) >> 1;
+                                if (tubecycles > 3) {
+                                        speed_enter(SPEED_TUBE);
+                                        tube_exec();
+                                        speed_leave(SPEED_CPU);
+                                }
+                        }
                         tubecycle = 0;
                 }
 #endif
@@ -3834,7 +4166,19 @@ int32_t get_cpu_timestamp() {
         }
 }
 
-void m65c02_exec()
+void m6502_exec(void)
+{
+#ifndef NO_USE_DEBUGGER
+    if (dbg_core6502 || m6502_exit_pc >= 0)
+#else
+    if (m6502_exit_pc >= 0)
+#endif
+        m6502_core(true);
+    else
+        m6502_core(false);
+}
+
+static inline __attribute__((always_inline)) void m65c02_core(const bool debug)
 {
         uint16_t addr;
         uint8_t temp;
@@ -3845,6 +4189,14 @@ void m65c02_exec()
 //        log_debug("PC = %04X\n",pc);
 //        log_debug("Exec cycles %i\n",cycles);
         while (cycles > 0) {
+            if (debug && pc == m6502_exit_pc) {
+                m6502_exit_hit = true;
+                break;
+            }
+#ifndef NO_USE_JIT6502
+            if (jit6502_enabled && jit_exec())
+                goto jit_done;
+#endif
 #ifdef PRINT_INSTRUCTIONS
             print_instructions();
 #endif
@@ -3852,7 +4204,7 @@ void m65c02_exec()
                 switch (opcode) {
                 case 0x00:      /* BRK */
 #ifndef NO_USE_DEBUGGER
-                        if (dbg_core6502)
+                        if (debug && dbg_core6502)
                             debug_trap(&core6502_cpu_debug, oldpc, 0);
 #endif
                         pc++;
@@ -3880,7 +4232,7 @@ void m65c02_exec()
                         addr = readmem(pc);
                         pc++;
                         temp = readmem(addr);
-                        p.z = !(temp & a);
+                        set_flags_nz(flag_n(), !(temp & a));
                         temp |= a;
                         writemem(addr, temp);
                         polltime(5);
@@ -3934,7 +4286,7 @@ void m65c02_exec()
                 case 0x0C:      /*TSB abs */
                         addr = getw();
                         temp = readmem(addr);
-                        p.z = !(temp & a);
+                        set_flags_nz(flag_n(), !(temp & a));
                         temp |= a;
                         writemem(addr, temp);
                         polltime(6);
@@ -3966,7 +4318,7 @@ void m65c02_exec()
                         /*BPL*/ offset = (int8_t) readmem(pc);
                         pc++;
                         temp = 2;
-                        if (!p.n) {
+                        if (!flag_n()) {
                                 temp++;
                                 if ((pc & 0xFF00) ^ ((pc + offset) & 0xFF00))
                                         temp++;
@@ -4000,7 +4352,7 @@ void m65c02_exec()
                         addr = readmem(pc);
                         pc++;
                         temp = readmem(addr);
-                        p.z = !(temp & a);
+                        set_flags_nz(flag_n(), !(temp & a));
                         temp &= ~a;
                         writemem(addr, temp);
                         polltime(5);
@@ -4052,7 +4404,7 @@ void m65c02_exec()
                 case 0x1C:      /*TRB abs */
                         addr = getw();
                         temp = readmem(addr);
-                        p.z = !(temp & a);
+                        set_flags_nz(flag_n(), !(temp & a));
                         temp &= ~a;
                         writemem(addr, temp);
                         polltime(6);
@@ -4110,9 +4462,8 @@ void m65c02_exec()
                         addr = readmem(pc);
                         pc++;
                         temp = readmem(addr);
-                        p.z = !(a & temp);
+                        setzn_bit(a & temp, temp);
                         p.v = temp & 0x40;
-                        p.n = temp & 0x80;
                         polltime(3);
                         takeint = (interrupt && !p.i);
                         break;
@@ -4173,9 +4524,8 @@ void m65c02_exec()
                         takeint = (interrupt && !p.i);
                         polltime(1);
                         temp = readmem(addr);
-                        p.z = !(a & temp);
+                        setzn_bit(a & temp, temp);
                         p.v = temp & 0x40;
-                        p.n = temp & 0x80;
                         break;
 
                 case 0x2D:      /*AND abs */
@@ -4207,7 +4557,7 @@ void m65c02_exec()
                         /*BMI*/ offset = (int8_t) readmem(pc);
                         pc++;
                         temp = 2;
-                        if (p.n) {
+                        if (flag_n()) {
                                 temp++;
                                 if ((pc & 0xFF00) ^ ((pc + offset) & 0xFF00))
                                         temp++;
@@ -4241,9 +4591,8 @@ void m65c02_exec()
                         addr = readmem(pc);
                         pc++;
                         temp = readmem((addr + x) & 0xFF);
-                        p.z = !(a & temp);
+                        setzn_bit(a & temp, temp);
                         p.v = temp & 0x40;
-                        p.n = temp & 0x80;
                         polltime(4);
                         break;
 
@@ -4299,9 +4648,8 @@ void m65c02_exec()
                         addr = getw();
                         addr += x;
                         temp = readmem(addr);
-                        p.z = !(a & temp);
+                        setzn_bit(a & temp, temp);
                         p.v = temp & 0x40;
-                        p.n = temp & 0x80;
                         polltime(4);
                         break;
 
@@ -4822,7 +5170,7 @@ void m65c02_exec()
                 case 0x89:      /*BIT imm */
                         temp = readmem(pc);
                         pc++;
-                        p.z = !(a & temp);
+                        set_flags_nz(flag_n(), !(a & temp));
                         polltime(2);
                         break;
 
@@ -5288,7 +5636,7 @@ void m65c02_exec()
                         /*BNE*/ offset = (int8_t) readmem(pc);
                         pc++;
                         temp = 2;
-                        if (!p.z) {
+                        if (!flag_z()) {
                                 temp++;
                                 if ((pc & 0xFF00) ^ ((pc + offset) & 0xFF00))
                                         temp++;
@@ -5486,7 +5834,7 @@ void m65c02_exec()
                         /*BEQ*/ offset = (int8_t) readmem(pc);
                         pc++;
                         temp = 2;
-                        if (p.z) {
+                        if (flag_z()) {
                                 temp++;
                                 if ((pc & 0xFF00) ^ ((pc + offset) & 0xFF00))
                                         temp++;
@@ -5619,13 +5967,16 @@ void m65c02_exec()
                 }
 /*                if (output | 1)
                 {
-                        log_debug("A=%02X X=%02X Y=%02X S=%02X PC=%04X %c%c%c%c%c%c op=%02X %02X%02X %02X%02X %02X  %08X\n",a,x,y,s,pc,(p.n)?'N':' ',(p.v)?'V':' ',(p.d)?'D':' ',(p.i)?'I':' ',(p.z)?'Z':' ',(p.c)?'C':' ',opcode,ram[0x21],ram[0x20],ram[0x7F],ram[0x7E],ram[0x7D],memlook[pc>>8]);
+                        log_debug("A=%02X X=%02X Y=%02X S=%02X PC=%04X %c%c%c%c%c%c op=%02X %02X%02X %02X%02X %02X  %08X\n",a,x,y,s,pc,flag_n()?'N':' ',(p.v)?'V':' ',(p.d)?'D':' ',(p.i)?'I':' ',flag_z()?'Z':' ',(p.c)?'C':' ',opcode,ram[0x21],ram[0x20],ram[0x7F],ram[0x7E],ram[0x7D],memlook[pc>>8]);
                 }*/
 /*                if (timetolive)
                 {
                         timetolive--;
                         if (!timetolive) output=0;
                 }*/
+#ifndef NO_USE_JIT6502
+jit_done:
+#endif
                 if (takeint) {
                         interrupt &= ~128;
                         takeint = 0;
@@ -5635,7 +5986,7 @@ void m65c02_exec()
                         temp = 0x20;
                         if (p.c)
                                 temp |= 1;
-                        if (p.z)
+                        if (flag_z())
                                 temp |= 2;
                         if (p.i)
                                 temp |= 4;
@@ -5643,7 +5994,7 @@ void m65c02_exec()
                                 temp |= 8;
                         if (p.v)
                                 temp |= 0x40;
-                        if (p.n)
+                        if (flag_n())
                                 temp |= 0x80;
                         push(temp);
                         pc = readmem(0xFFFE) | (readmem(0xFFFF) << 8);
@@ -5658,15 +6009,24 @@ void m65c02_exec()
 #ifndef NO_USE_TUBE
                 if (tube_exec && tubecycle) {
 //                        log_debug("tubeexec %i %i %i\n",tubecycles,tubecycle,tube_shift);
-                        tubecycles += (tubecycle * tube_multipler) >> 1;
-                        if (tubecycles > 3)
-                                tube_exec();
+                        if (tube_thread_on)
+                                tube_thread_credit((tubecycle * tube_multipler) >> 1);
+                        else {
+                                tubecycles += (tubecycle * tube_multipler) >> 1;
+                                if (tubecycles > 3) {
+                                        speed_enter(SPEED_TUBE);
+                                        tube_exec();
+                                        speed_leave(SPEED_CPU);
+                                }
+                        }
                         tubecycle = 0;
                 }
 #endif
 
-                if (otherstuffcount <= 0)
+#ifndef USE_HW_EVENT
+                while (otherstuffcount <= 0)
                     otherstuff_poll();
+#endif
                 if (nmi && !oldnmi) {
                         push(pc >> 8);
                         push(pc & 0xFF);
@@ -5684,6 +6044,26 @@ void m65c02_exec()
         }
 }
 
+void m65c02_exec(void)
+{
+#ifndef NO_USE_DEBUGGER
+    if (dbg_core6502 || m6502_exit_pc >= 0)
+#else
+    if (m6502_exit_pc >= 0)
+#endif
+        m65c02_core(true);
+    else
+        m65c02_core(false);
+}
+
+#undef readmem
+#undef writemem
+#undef fetch_opcode
+#undef getw
+#undef read_zp_indirect
+#undef push
+#undef pull
+
 void m6502_savestate(FILE * f)
 {
         uint8_t temp;
@@ -5720,6 +6100,7 @@ void m6502_loadstate(FILE * f)
         cycles |= (getc(f) << 8);
         cycles |= (getc(f) << 16);
         cycles |= (getc(f) << 24);
+        jit6502_flush();
 }
 
 uint8_t get_a() {
@@ -5755,11 +6136,11 @@ void set_c(int c) {
 }
 
 int get_z() {
-    return p.z;
+    return flag_z();
 }
 
 void set_z(int z) {
-    p.z = z;
+    set_flags_nz(flag_n(), z);
 }
 
 uint16_t get_pc() {
@@ -5772,7 +6153,7 @@ void set_pc(uint16_t _pc) {
 }
 
 int get_n() {
-    return p.n;
+    return flag_n();
 }
 
 int get_v() {
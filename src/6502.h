@@ -5,7 +5,7 @@
 
 //extern uint8_t a,x,y,s;
 #ifndef NO_USE_DEBUGGER
-extern uint16_t oldpc, oldoldpc, pc3;
+extern MACHINE_LOCAL uint16_t oldpc, oldoldpc, pc3;
 #endif
 
 uint8_t get_a();
@@ -29,7 +29,7 @@ int get_i();
 extern cpu_debug_t core6502_cpu_debug;
 #endif
 
-extern int output;
+extern MACHINE_LOCAL int output;
 //extern int interrupt;
 void interrupt_set_mask(uint mask);
 void interrupt_clr_mask(uint mask);
@@ -42,6 +42,10 @@ static inline void nmi_clr_all() {
 
 //extern uint8_t opcode;
 
+/* Headless runs stop when the PC reaches this address (-1 for never). */
+extern MACHINE_LOCAL int32_t m6502_exit_pc;
+extern MACHINE_LOCAL bool m6502_exit_hit;
+
 void m6502_init(void);
 void m6502_reset(void);
 void m6502_exec(void);
@@ -0,0 +1,1260 @@
+/*B-em v2.2 by Tom Walker
+ * Pico version (C) 2021 Graham Sanderson
+ *
+ * 6502/65c02 host CPU block translator for x86-64*/
+
+#include "b-em.h"
+#include "6502jit.h"
+#include "6502.h"
+#include "mem.h"
+#include "model.h"
+#include <errno.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+#ifndef NO_USE_JIT6502
+
+/*
+ * Straight-line runs of 6502 code are translated into x86-64 functions
+ * the first time they are run.  A block ends at a jump, at the end of a
+ * 256 byte page or at any instruction the translator leaves to the
+ * interpreter: those that touch &FC00-&FEFF, change the I or D flags,
+ * BRK and RTI, and the undocumented opcodes.  A conditional branch out
+ * of the block leaves it when taken.  One that goes back to the start of
+ * the block loops in translated code for as long as the cycle budget
+ * given by the caller allows.
+ *
+ * The cycles of each instruction are added up when the block is
+ * translated, with a cycle added at run time for each page an indexed
+ * read crosses, so the caller polls the hardware once for the whole
+ * block.  Addresses worked out at run time are checked against the I/O
+ * pages and, if they are in them, the block returns just before that
+ * instruction with the cycles so far so the interpreter can run it at
+ * the right time.  Blocks are only entered with the D flag clear, so
+ * ADC and SBC can use the host's binary arithmetic.
+ *
+ * Each byte of RAM and sideways RAM that has been translated is marked
+ * in codemap.  A write to a marked byte drops every block from that
+ * host page; if the block that did the write is among them it returns
+ * after the instruction that did it.  A page that keeps being rewritten
+ * is left to the interpreter until the cache is next flushed.
+ */
+#define JIT_CODE_SIZE  (8 << 20)
+#define JIT_BLOCK_ROOM 8192     // more than the code for any one block
+#define JIT_MAX_INSNS  32
+#define JIT_MAX_CYCLES 96       // most cycles one pass through a block can take
+#define JIT_HOT_PAGE   16       // rewrites before a page is left interpreted
+
+#define HOST_BYTES (RAM_SIZE + ROM_SIZE * ROM_NSLOT)
+#define HOST_PAGES (HOST_BYTES / 256)
+
+bool jit6502_enabled = false;
+int jit6502_nblocks = 0;
+
+typedef struct jit_block {
+    struct jit_block *next;         // other mappings of the same address
+    struct jit_block *page_next;    // other blocks from the same host page
+    const uint8_t *host;            // where the first opcode is in host memory
+    void (*code)(jit6502_regs_t *r);    // NULL if nothing could be translated
+    int page;                       // host page, -1 for the OS ROM
+    uint16_t pc;
+    uint8_t len;
+    uint8_t max_cycles;
+} jit_block_t;
+
+static jit_block_t *blocks[0x10000];
+static jit_block_t *page_blocks[HOST_PAGES];
+static uint8_t page_rewrites[HOST_PAGES];
+static uint8_t codemap[HOST_BYTES];
+
+static uint8_t *code_base;
+static size_t code_used;
+static bool code_failed;
+
+static jit6502_regs_t *running;
+static int running_page = -1;
+
+/* Where in codemap a host address is, or -1 if it is not RAM or a
+ * sideways slot.
+ */
+static long host_offset(const uint8_t *host)
+{
+    uintptr_t off = (uintptr_t)host - (uintptr_t)ram;
+
+    if (off < RAM_SIZE)
+        return off;
+    off = (uintptr_t)host - (uintptr_t)rom_slot_ptr(0);
+    if (off < ROM_SIZE * ROM_NSLOT)
+        return RAM_SIZE + off;
+    return -1;
+}
+
+static void drop_page(int page)
+{
+    jit_block_t *b, **bp;
+
+    while ((b = page_blocks[page])) {
+        page_blocks[page] = b->page_next;
+        for (bp = &blocks[b->pc]; *bp != b; bp = &(*bp)->next)
+            ;
+        *bp = b->next;
+        memset(codemap + page * 256 + (b->pc & 0xff), 0, b->len);
+        free(b);
+        jit6502_nblocks--;
+    }
+    if (page_rewrites[page] < JIT_HOT_PAGE)
+        page_rewrites[page]++;
+    if (page == running_page)
+        running->stale = 1;
+}
+
+void jit6502_invalidate(const uint8_t *host)
+{
+    long off = host_offset(host);
+
+    if (off >= 0 && codemap[off])
+        drop_page(off >> 8);
+}
+
+void jit6502_flush(void)
+{
+    jit_block_t *b;
+    int i;
+
+    for (i = 0; i < 0x10000; i++) {
+        while ((b = blocks[i])) {
+            blocks[i] = b->next;
+            free(b);
+        }
+    }
+    memset(page_blocks, 0, sizeof page_blocks);
+    memset(page_rewrites, 0, sizeof page_rewrites);
+    memset(codemap, 0, sizeof codemap);
+    jit6502_nblocks = 0;
+    code_used = 0;
+}
+
+void jit6502_close(void)
+{
+    jit6502_flush();
+    if (code_base) {
+        munmap(code_base, JIT_CODE_SIZE);
+        code_base = NULL;
+    }
+}
+
+static bool code_init(void)
+{
+    void *p;
+
+    if (code_failed)
+        return false;
+    p = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        log_error("6502jit: unable to map memory for translated code: %s, using the interpreter", strerror(errno));
+        code_failed = true;
+        return false;
+    }
+    code_base = p;
+    code_used = 0;
+    return true;
+}
+
+/* 6502 instructions, as far as the translator is concerned. */
+
+typedef enum {
+    J_NONE,
+    J_ORA, J_AND, J_EOR, J_ADC, J_SBC, J_CMP, J_CPX, J_CPY, J_BIT,
+    J_LDA, J_LDX, J_LDY, J_STA, J_STX, J_STY, J_STZ,
+    J_ASL, J_LSR, J_ROL, J_ROR, J_INC, J_DEC,
+    J_INX, J_INY, J_DEX, J_DEY,
+    J_TAX, J_TXA, J_TAY, J_TYA, J_TSX, J_TXS,
+    J_CLC, J_SEC, J_CLV, J_NOP,
+    J_PHA, J_PHP, J_PHX, J_PHY, J_PLA, J_PLX, J_PLY,
+    J_BPL, J_BMI, J_BVC, J_BVS, J_BCC, J_BCS, J_BNE, J_BEQ, J_BRA,
+    J_JMP, J_JSR, J_RTS
+} jit_op_t;
+
+typedef enum {
+    M_IMP, M_ACC, M_IMM, M_ZP, M_ZPX, M_ZPY, M_ABS, M_ABSX, M_ABSY,
+    M_INDX, M_INDY, M_INDZ, M_REL, M_IND, M_INDAX
+} jit_mode_t;
+
+static const uint8_t mode_len[] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 2, 2, 2, 2, 3, 3 };
+
+typedef struct {
+    uint8_t op;
+    uint8_t mode;
+    uint8_t cycles;
+    uint8_t cross;  // an extra cycle when indexing crosses a page
+} jit_opinfo_t;
+
+/* The cycle counts are those the interpreter in 6502.c takes, which for
+ * some zero page,X instructions are a cycle short of the real thing.
+ */
+#define ALU_OPS(base, op, zpx) \
+    [base + 0x09] = { op, M_IMM,  2, 0 }, \
+    [base + 0x05] = { op, M_ZP,   3, 0 }, \
+    [base + 0x15] = { op, M_ZPX,  zpx, 0 }, \
+    [base + 0x0D] = { op, M_ABS,  4, 0 }, \
+    [base + 0x1D] = { op, M_ABSX, 4, 1 }, \
+    [base + 0x19] = { op, M_ABSY, 4, 1 }, \
+    [base + 0x01] = { op, M_INDX, 6, 0 }, \
+    [base + 0x11] = { op, M_INDY, 5, 1 }
+
+#define SHIFT_OPS(base, op) \
+    [base + 0x0A] = { op, M_ACC,  2, 0 }, \
+    [base + 0x06] = { op, M_ZP,   5, 0 }, \
+    [base + 0x16] = { op, M_ZPX,  5, 0 }, \
+    [base + 0x0E] = { op, M_ABS,  6, 0 }, \
+    [base + 0x1E] = { op, M_ABSX, 7, 0 }
+
+#define COMMON_OPS \
+    ALU_OPS(0x00, J_ORA, 3), \
+    ALU_OPS(0x20, J_AND, 3), \
+    ALU_OPS(0x40, J_EOR, 3), \
+    ALU_OPS(0x60, J_ADC, 4), \
+    ALU_OPS(0xA0, J_LDA, 3), \
+    ALU_OPS(0xC0, J_CMP, 3), \
+    ALU_OPS(0xE0, J_SBC, 3), \
+    SHIFT_OPS(0x00, J_ASL), \
+    SHIFT_OPS(0x20, J_ROL), \
+    SHIFT_OPS(0x40, J_LSR), \
+    SHIFT_OPS(0x60, J_ROR), \
+    [0x85] = { J_STA, M_ZP,   3, 0 }, \
+    [0x95] = { J_STA, M_ZPX,  4, 0 }, \
+    [0x8D] = { J_STA, M_ABS,  4, 0 }, \
+    [0x9D] = { J_STA, M_ABSX, 5, 0 }, \
+    [0x99] = { J_STA, M_ABSY, 5, 0 }, \
+    [0x81] = { J_STA, M_INDX, 6, 0 }, \
+    [0x91] = { J_STA, M_INDY, 6, 0 }, \
+    [0x86] = { J_STX, M_ZP,   3, 0 }, \
+    [0x96] = { J_STX, M_ZPY,  4, 0 }, \
+    [0x8E] = { J_STX, M_ABS,  4, 0 }, \
+    [0x84] = { J_STY, M_ZP,   3, 0 }, \
+    [0x94] = { J_STY, M_ZPX,  4, 0 }, \
+    [0x8C] = { J_STY, M_ABS,  4, 0 }, \
+    [0xA2] = { J_LDX, M_IMM,  2, 0 }, \
+    [0xA6] = { J_LDX, M_ZP,   3, 0 }, \
+    [0xB6] = { J_LDX, M_ZPY,  3, 0 }, \
+    [0xAE] = { J_LDX, M_ABS,  4, 0 }, \
+    [0xBE] = { J_LDX, M_ABSY, 4, 1 }, \
+    [0xA0] = { J_LDY, M_IMM,  2, 0 }, \
+    [0xA4] = { J_LDY, M_ZP,   3, 0 }, \
+    [0xB4] = { J_LDY, M_ZPX,  3, 0 }, \
+    [0xAC] = { J_LDY, M_ABS,  4, 0 }, \
+    [0xBC] = { J_LDY, M_ABSX, 4, 1 }, \
+    [0xE0] = { J_CPX, M_IMM,  2, 0 }, \
+    [0xE4] = { J_CPX, M_ZP,   3, 0 }, \
+    [0xEC] = { J_CPX, M_ABS,  4, 0 }, \
+    [0xC0] = { J_CPY, M_IMM,  2, 0 }, \
+    [0xC4] = { J_CPY, M_ZP,   3, 0 }, \
+    [0xCC] = { J_CPY, M_ABS,  4, 0 }, \
+    [0x24] = { J_BIT, M_ZP,   3, 0 }, \
+    [0x2C] = { J_BIT, M_ABS,  4, 0 }, \
+    [0xE6] = { J_INC, M_ZP,   5, 0 }, \
+    [0xF6] = { J_INC, M_ZPX,  5, 0 }, \
+    [0xEE] = { J_INC, M_ABS,  6, 0 }, \
+    [0xFE] = { J_INC, M_ABSX, 7, 0 }, \
+    [0xC6] = { J_DEC, M_ZP,   5, 0 }, \
+    [0xD6] = { J_DEC, M_ZPX,  5, 0 }, \
+    [0xCE] = { J_DEC, M_ABS,  6, 0 }, \
+    [0xDE] = { J_DEC, M_ABSX, 7, 0 }, \
+    [0xE8] = { J_INX, M_IMP,  2, 0 }, \
+    [0xC8] = { J_INY, M_IMP,  2, 0 }, \
+    [0xCA] = { J_DEX, M_IMP,  2, 0 }, \
+    [0x88] = { J_DEY, M_IMP,  2, 0 }, \
+    [0xAA] = { J_TAX, M_IMP,  2, 0 }, \
+    [0x8A] = { J_TXA, M_IMP,  2, 0 }, \
+    [0xA8] = { J_TAY, M_IMP,  2, 0 }, \
+    [0x98] = { J_TYA, M_IMP,  2, 0 }, \
+    [0xBA] = { J_TSX, M_IMP,  2, 0 }, \
+    [0x9A] = { J_TXS, M_IMP,  2, 0 }, \
+    [0x18] = { J_CLC, M_IMP,  2, 0 }, \
+    [0x38] = { J_SEC, M_IMP,  2, 0 }, \
+    [0xB8] = { J_CLV, M_IMP,  2, 0 }, \
+    [0xEA] = { J_NOP, M_IMP,  2, 0 }, \
+    [0x48] = { J_PHA, M_IMP,  3, 0 }, \
+    [0x08] = { J_PHP, M_IMP,  3, 0 }, \
+    [0x68] = { J_PLA, M_IMP,  4, 0 }, \
+    [0x10] = { J_BPL, M_REL,  2, 0 }, \
+    [0x30] = { J_BMI, M_REL,  2, 0 }, \
+    [0x50] = { J_BVC, M_REL,  2, 0 }, \
+    [0x70] = { J_BVS, M_REL,  2, 0 }, \
+    [0x90] = { J_BCC, M_REL,  2, 0 }, \
+    [0xB0] = { J_BCS, M_REL,  2, 0 }, \
+    [0xD0] = { J_BNE, M_REL,  2, 0 }, \
+    [0xF0] = { J_BEQ, M_REL,  2, 0 }, \
+    [0x4C] = { J_JMP, M_ABS,  3, 0 }, \
+    [0x20] = { J_JSR, M_ABS,  6, 0 }, \
+    [0x60] = { J_RTS, M_IMP,  6, 0 }
+
+static const jit_opinfo_t nmos_ops[256] = {
+    COMMON_OPS,
+    [0x89] = { J_NONE },    // not the CMOS BIT #
+    [0x6C] = { J_JMP, M_IND,  5, 0 }
+};
+
+static const jit_opinfo_t cmos_ops[256] = {
+    COMMON_OPS,
+    [0x12] = { J_ORA, M_INDZ, 5, 0 },
+    [0x32] = { J_AND, M_INDZ, 5, 0 },
+    [0x52] = { J_EOR, M_INDZ, 5, 0 },
+    [0x72] = { J_ADC, M_INDZ, 5, 0 },
+    [0x92] = { J_STA, M_INDZ, 5, 0 },
+    [0xB2] = { J_LDA, M_INDZ, 5, 0 },
+    [0xD2] = { J_CMP, M_INDZ, 5, 0 },
+    [0xF2] = { J_SBC, M_INDZ, 5, 0 },
+    [0x1E] = { J_ASL, M_ABSX, 6, 1 },
+    [0x3E] = { J_ROL, M_ABSX, 6, 1 },
+    [0x5E] = { J_LSR, M_ABSX, 6, 1 },
+    [0x7E] = { J_ROR, M_ABSX, 6, 1 },
+    [0x89] = { J_BIT, M_IMM,  2, 0 },
+    [0x34] = { J_BIT, M_ZPX,  4, 0 },
+    [0x3C] = { J_BIT, M_ABSX, 4, 0 },
+    [0x64] = { J_STZ, M_ZP,   3, 0 },
+    [0x74] = { J_STZ, M_ZPX,  4, 0 },
+    [0x9C] = { J_STZ, M_ABS,  4, 0 },
+    [0x9E] = { J_STZ, M_ABSX, 5, 0 },
+    [0x1A] = { J_INC, M_ACC,  2, 0 },
+    [0x3A] = { J_DEC, M_ACC,  2, 0 },
+    [0xDA] = { J_PHX, M_IMP,  3, 0 },
+    [0x5A] = { J_PHY, M_IMP,  3, 0 },
+    [0xFA] = { J_PLX, M_IMP,  4, 0 },
+    [0x7A] = { J_PLY, M_IMP,  4, 0 },
+    [0x80] = { J_BRA, M_REL,  3, 0 },
+    [0x6C] = { J_JMP, M_IND,  6, 0 },
+    [0x7C] = { J_JMP, M_INDAX, 6, 0 }
+};
+
+/* x86-64 code generation. */
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum { CC_O, CC_NO, CC_C, CC_NC, CC_Z, CC_NZ, CC_BE, CC_A, CC_S, CC_NS, CC_L = 12, CC_GE, CC_LE, CC_G };
+enum { ALU_ADD, ALU_OR, ALU_ADC, ALU_SBB, ALU_AND, ALU_SUB, ALU_XOR, ALU_CMP };
+
+#define R_(f) ((int)offsetof(jit6502_regs_t, f))
+
+/*
+ * In the translated code rbx points at the registers, r12 at the memory
+ * map, r13 at main RAM as mapped for page zero, r14d counts the cycles
+ * added at run time and r15 points at the codemap byte for r13.
+ */
+static uint8_t *ep;
+
+static inline void emit8(int v)
+{
+    *ep++ = v;
+}
+
+static inline void emit16(int v)
+{
+    emit8(v);
+    emit8(v >> 8);
+}
+
+static inline void emit32(int32_t v)
+{
+    memcpy(ep, &v, 4);
+    ep += 4;
+}
+
+static inline void emit64(uint64_t v)
+{
+    memcpy(ep, &v, 8);
+    ep += 8;
+}
+
+/* An instruction with operand [base + index + disp]: op is one or two
+ * opcode bytes and reg the register or opcode extension for ModRM.
+ */
+static void emit_mem(int op, bool w, int reg, int base, int index, int32_t disp)
+{
+    int rex = 0x40 | (w << 3) | ((reg & 8) >> 1) | (index >= 0 ? (index & 8) >> 2 : 0) | ((base & 8) >> 3);
+    int mod = (disp == 0 && (base & 7) != RBP) ? 0 : (disp >= -128 && disp < 128) ? 1 : 2;
+
+    if (rex != 0x40)
+        emit8(rex);
+    if (op > 0xff)
+        emit8(op >> 8);
+    emit8(op);
+    if (index >= 0 || (base & 7) == RSP) {
+        emit8(mod << 6 | (reg & 7) << 3 | 4);
+        emit8((index >= 0 ? index & 7 : 4) << 3 | (base & 7));
+    }
+    else
+        emit8(mod << 6 | (reg & 7) << 3 | (base & 7));
+    if (mod == 1)
+        emit8(disp);
+    else if (mod == 2)
+        emit32(disp);
+}
+
+/* An instruction with two registers, reg in ModRM.reg and rm in ModRM.rm. */
+static void emit_rr(int op, bool w, int reg, int rm)
+{
+    int rex = 0x40 | (w << 3) | ((reg & 8) >> 1) | ((rm & 8) >> 3);
+
+    if (rex != 0x40)
+        emit8(rex);
+    if (op > 0xff)
+        emit8(op >> 8);
+    emit8(op);
+    emit8(0xc0 | (reg & 7) << 3 | (rm & 7));
+}
+
+static void emit_ld(int reg, int off)
+{
+    emit_mem(0x0fb6, false, reg, RBX, -1, off);     // movzx reg, byte [rbx+off]
+}
+
+static void emit_st(int reg, int off)
+{
+    emit_mem(0x88, false, reg, RBX, -1, off);       // mov [rbx+off], reg8
+}
+
+static void emit_st_imm(int off, int v)
+{
+    emit_mem(0xc6, false, 0, RBX, -1, off);         // mov byte [rbx+off], imm8
+    emit8(v);
+}
+
+static void emit_set(int cc, int off)
+{
+    emit_mem(0x0f90 | cc, false, 0, RBX, -1, off);  // setcc [rbx+off]
+}
+
+static void emit_mov_imm(int reg, int32_t v)
+{
+    emit8(0xb8 + reg);                              // mov reg, imm32
+    emit32(v);
+}
+
+static void emit_alu8(int alu, int dst, int src)
+{
+    emit_rr(alu << 3, false, src, dst);             // alu dst8, src8
+}
+
+static void emit_test8(int reg)
+{
+    emit_rr(0x84, false, reg, reg);                 // test reg8, reg8
+}
+
+static void emit_nz(int reg)
+{
+    emit_test8(reg);
+    emit_set(CC_S, R_(n));
+    emit_set(CC_Z, R_(z));
+}
+
+static void emit_carry_in(bool invert)
+{
+    emit_mem(0x0fba, false, 4, RBX, -1, R_(c));     // bt dword [rbx+c], 0
+    emit8(0);
+    if (invert)
+        emit8(0xf5);                                // cmc
+}
+
+static void emit_call(void *fn)
+{
+    emit8(0x48);                                    // mov rax, fn
+    emit8(0xb8);
+    emit64((uintptr_t)fn);
+    emit8(0xff);                                    // call rax
+    emit8(0xd0);
+}
+
+static uint8_t *emit_jcc(int cc)
+{
+    emit8(0x0f);
+    emit8(0x80 | cc);
+    emit32(0);
+    return ep - 4;
+}
+
+static uint8_t *emit_jmp(void)
+{
+    emit8(0xe9);
+    emit32(0);
+    return ep - 4;
+}
+
+static void patch(uint8_t *at, const uint8_t *target)
+{
+    int32_t rel = target - (at + 4);
+    memcpy(at, &rel, 4);
+}
+
+/* Translation of one block. */
+
+typedef struct {
+    uint16_t pc;
+    uint8_t opcode;
+    const jit_opinfo_t *info;
+    uint16_t operand;
+    int cycles;     // static cycles before this instruction
+} jit_insn_t;
+
+typedef enum {
+    STUB_BAIL,      // return before the instruction
+    STUB_WRITTEN    // a write to r13 + rsi + disp hit translated code
+} jit_stub_kind_t;
+
+typedef struct {
+    uint8_t *at;
+    uint8_t *resume;
+    jit_stub_kind_t kind;
+    bool use_rsi;
+    int insn;
+    int32_t disp;
+} jit_stub_t;
+
+#define MAX_STUBS (JIT_MAX_INSNS * 4)
+
+static jit_insn_t insns[JIT_MAX_INSNS + 1];
+static jit_stub_t stubs[MAX_STUBS];
+static int nstubs;
+static uint8_t **tr_memlook;
+static uint8_t *epilogue, *loop_head;
+static uint16_t block_pc;
+
+static void add_stub(uint8_t *at, jit_stub_kind_t kind, int insn, bool use_rsi, int32_t disp)
+{
+    jit_stub_t *s = &stubs[nstubs++];
+
+    s->at = at;
+    s->resume = ep;
+    s->kind = kind;
+    s->insn = insn;
+    s->use_rsi = use_rsi;
+    s->disp = disp;
+}
+
+static void emit_exit(int pc, int cycles)
+{
+    if (pc >= 0) {
+        emit8(0x66);                                // mov word [rbx+pc], imm16
+        emit_mem(0xc7, false, 0, RBX, -1, R_(pc));
+        emit16(pc);
+    }
+    emit_mem(0x8d, false, RAX, R14, -1, cycles);    // lea eax, [r14+cycles]
+    emit_mem(0x89, false, RAX, RBX, -1, R_(cycles));
+    patch(emit_jmp(), epilogue);
+}
+
+/* Go round again if there is time for another pass, else return. */
+
+static void emit_loop(int cycles)
+{
+    emit_rr(0x81, false, 0, R14);                   // add r14d, cycles
+    emit32(cycles);
+    emit_mem(0x3b, false, R14, RBX, -1, R_(loop_limit));
+    patch(emit_jcc(CC_LE), loop_head);
+    emit_exit(block_pc, 0);
+}
+
+/* Pages below &3000 are main RAM whatever the paging registers say. */
+
+static bool low_static(uint16_t addr)
+{
+    return addr < 0x3000 && tr_memlook[addr >> 8] == tr_memlook[0];
+}
+
+static inline bool is_io(unsigned addr)
+{
+    return addr >= 0xfc00 && addr < 0xff00;
+}
+
+static void emit_bail_if_io(int insn, int first)
+{
+    emit_mem(0x8d, false, RAX, RSI, -1, -first);    // lea eax, [rsi-first]
+    emit8(0x3d);                                    // cmp eax, 0xff00-first
+    emit32(0xff00 - first);
+    add_stub(emit_jcc(CC_C), STUB_BAIL, insn, false, 0);
+}
+
+typedef enum {
+    L_IMM,      // the operand itself
+    L_ACC,      // the accumulator
+    L_LOW,      // r13 + disp
+    L_LOWDYN,   // r13 + rsi
+    L_MEM,      // 6502 address disp
+    L_MEMDYN    // 6502 address in esi
+} jit_loc_t;
+
+/* Work out where the operand of an instruction is, emitting code for
+ * any part of that done at run time.
+ */
+static jit_loc_t emit_ea(int i, int32_t *disp)
+{
+    const jit_insn_t *in = &insns[i];
+    unsigned op = in->operand;
+
+    *disp = op;
+    switch (in->info->mode) {
+        case M_IMM:
+            return L_IMM;
+        case M_ACC:
+            return L_ACC;
+        case M_ZP:
+            return L_LOW;
+        case M_ZPX:
+        case M_ZPY:
+            emit_ld(RSI, in->info->mode == M_ZPX ? R_(x) : R_(y));
+            emit_rr(0x81, false, 0, RSI);           // add esi, zp
+            emit32(op);
+            emit_rr(0x81, false, 4, RSI);           // and esi, 0xff
+            emit32(0xff);
+            return L_LOWDYN;
+        case M_ABS:
+            return low_static(op) ? L_LOW : L_MEM;
+        case M_ABSX:
+        case M_ABSY:
+            emit_ld(RSI, in->info->mode == M_ABSX ? R_(x) : R_(y));
+            emit_rr(0x81, false, 0, RSI);           // add esi, base
+            emit32(op);
+            emit_rr(0x0fb7, false, RSI, RSI);       // movzx esi, si
+            emit_bail_if_io(i, 0xfc00);
+            if (in->info->cross) {
+                emit_rr(0x89, false, RSI, RAX);     // mov eax, esi
+                emit8(0x3c);                        // cmp al, base & 0xff
+                emit8(op);
+                emit_rr(0x83, false, 2, R14);       // adc r14d, 0
+                emit8(0);
+            }
+            return L_MEMDYN;
+        case M_INDX:
+            emit_ld(RAX, R_(x));
+            emit8(0x04);                            // add al, zp
+            emit8(op);
+            emit_mem(0x0fb6, false, RSI, R13, RAX, 0);  // movzx esi, byte [r13+rax]
+            emit8(0xfe);                            // inc al
+            emit8(0xc0);
+            emit_mem(0x0fb6, false, RAX, R13, RAX, 0);  // movzx eax, byte [r13+rax]
+            emit_rr(0xc1, false, 4, RAX);           // shl eax, 8
+            emit8(8);
+            emit_rr(0x09, false, RAX, RSI);         // or esi, eax
+            emit_bail_if_io(i, 0xfc00);
+            return L_MEMDYN;
+        case M_INDY:
+        case M_INDZ:
+            emit_mem(0x0fb6, false, RSI, R13, -1, op);
+            emit_mem(0x0fb6, false, RAX, R13, -1, (op + 1) & 0xff);
+            emit_rr(0xc1, false, 4, RAX);           // shl eax, 8
+            emit8(8);
+            emit_rr(0x09, false, RAX, RSI);         // or esi, eax
+            if (in->info->mode == M_INDY) {
+                emit_ld(RCX, R_(y));
+                emit_rr(0x01, false, RCX, RSI);     // add esi, ecx
+                emit_rr(0x0fb7, false, RSI, RSI);   // movzx esi, si
+            }
+            emit_bail_if_io(i, 0xfc00);
+            if (in->info->cross) {
+                emit_rr(0x89, false, RSI, RAX);     // mov eax, esi
+                emit_alu8(ALU_CMP, RAX, RCX);       // cmp al, cl
+                emit_rr(0x83, false, 2, R14);       // adc r14d, 0
+                emit8(0);
+            }
+            return L_MEMDYN;
+        default:
+            return L_IMM;
+    }
+}
+
+static void emit_read(int reg, jit_loc_t loc, int32_t disp)
+{
+    switch (loc) {
+        case L_IMM:
+            emit_mov_imm(reg, disp);
+            break;
+        case L_ACC:
+            emit_ld(reg, R_(a));
+            break;
+        case L_LOW:
+            emit_mem(0x0fb6, false, reg, R13, -1, disp);
+            break;
+        case L_LOWDYN:
+            emit_mem(0x0fb6, false, reg, R13, RSI, 0);
+            break;
+        case L_MEM:
+            emit_mem(0x8b, true, RCX, R12, -1, (disp >> 8) * 8);    // mov rcx, [r12+page*8]
+            emit_mem(0x0fb6, false, reg, RCX, -1, disp);
+            break;
+        case L_MEMDYN:
+            emit_rr(0x89, false, RSI, RAX);         // mov eax, esi
+            emit_rr(0xc1, false, 5, RAX);           // shr eax, 8
+            emit8(8);
+            emit8(0x49);                            // mov rcx, [r12+rax*8]
+            emit8(0x8b);
+            emit8(0x0c);
+            emit8(0xc4);
+            emit_mem(0x0fb6, false, reg, RCX, RSI, 0);
+            break;
+    }
+}
+
+/* Write reg8 to the operand.  Writes that could change the paging or
+ * are watched by the paste code go through writemem.
+ */
+static void emit_write(int i, int reg, jit_loc_t loc, int32_t disp)
+{
+    switch (loc) {
+        case L_ACC:
+            emit_st(reg, R_(a));
+            break;
+        case L_LOW:
+            if (disp < 0x22c || disp > 0x22f) {
+                emit_mem(0x88, false, reg, R13, -1, disp);
+                emit_mem(0x80, false, 7, R15, -1, disp);    // cmp byte [r15+disp], 0
+                emit8(0);
+                add_stub(emit_jcc(CC_NZ), STUB_WRITTEN, i, false, disp);
+                break;
+            }
+            // fall through
+        case L_MEM:
+            emit_mov_imm(RDI, disp);
+            emit_rr(0x0fb6, false, RSI, reg);       // movzx esi, reg8
+            emit_call(writemem);
+            break;
+        case L_LOWDYN:
+            emit_mem(0x88, false, reg, R13, RSI, 0);
+            emit_mem(0x80, false, 7, R15, RSI, 0);  // cmp byte [r15+rsi], 0
+            emit8(0);
+            add_stub(emit_jcc(CC_NZ), STUB_WRITTEN, i, true, 0);
+            break;
+        case L_MEMDYN:
+            emit_rr(0x89, false, RSI, RDI);         // mov edi, esi
+            emit_rr(0x0fb6, false, RSI, reg);       // movzx esi, reg8
+            emit_call(writemem);
+            break;
+        default:
+            break;
+    }
+}
+
+static void emit_push(int i, int reg)
+{
+    emit_ld(RSI, R_(s));
+    emit_mem(0x88, false, reg, R13, RSI, 0x100);
+    emit_mem(0xfe, false, 1, RBX, -1, R_(s));       // dec byte [rbx+s]
+    emit_mem(0x80, false, 7, R15, RSI, 0x100);      // cmp byte [r15+rsi+0x100], 0
+    emit8(0);
+    add_stub(emit_jcc(CC_NZ), STUB_WRITTEN, i, true, 0x100);
+}
+
+static void emit_pull(int reg)
+{
+    emit_mem(0xfe, false, 0, RBX, -1, R_(s));       // inc byte [rbx+s]
+    emit_ld(RSI, R_(s));
+    emit_mem(0x0fb6, false, reg, R13, RSI, 0x100);
+}
+
+static void emit_stale_check(int i)
+{
+    uint8_t *skip;
+
+    emit_mem(0x80, false, 7, RBX, -1, R_(stale));   // cmp byte [rbx+stale], 0
+    emit8(0);
+    skip = emit_jcc(CC_Z);
+    emit_exit(insns[i + 1].pc, insns[i + 1].cycles);
+    patch(skip, ep);
+}
+
+/* A static address as read by JMP (). */
+
+static void emit_read_abs(int reg, uint16_t addr)
+{
+    emit_read(reg, low_static(addr) ? L_LOW : L_MEM, addr);
+}
+
+static const struct {
+    int flag;
+    bool set;
+} branch_conds[] = {
+    [J_BPL - J_BPL] = { R_(n), false },
+    [J_BMI - J_BPL] = { R_(n), true },
+    [J_BVC - J_BPL] = { R_(v), false },
+    [J_BVS - J_BPL] = { R_(v), true },
+    [J_BCC - J_BPL] = { R_(c), false },
+    [J_BCS - J_BPL] = { R_(c), true },
+    [J_BNE - J_BPL] = { R_(z), false },
+    [J_BEQ - J_BPL] = { R_(z), true }
+};
+
+/* Leave the block for target, or loop if it is the start. */
+
+static void emit_goto(uint16_t target, int cycles)
+{
+    if (target == block_pc)
+        emit_loop(cycles);
+    else
+        emit_exit(target, cycles);
+}
+
+static void emit_insn(int i)
+{
+    const jit_insn_t *in = &insns[i];
+    int next_pc = insns[i + 1].pc;
+    int end_cycles = insns[i + 1].cycles;
+    jit_loc_t loc;
+    int32_t disp;
+    int reg;
+    uint8_t *skip;
+
+    switch (in->info->op) {
+        case J_ORA:
+        case J_AND:
+        case J_EOR:
+            loc = emit_ea(i, &disp);
+            emit_read(RDX, loc, disp);
+            emit_ld(RAX, R_(a));
+            emit_alu8(in->info->op == J_ORA ? ALU_OR : in->info->op == J_AND ? ALU_AND : ALU_XOR, RAX, RDX);
+            emit_st(RAX, R_(a));
+            emit_set(CC_S, R_(n));
+            emit_set(CC_Z, R_(z));
+            break;
+        case J_ADC:
+        case J_SBC:
+            loc = emit_ea(i, &disp);
+            emit_read(RDX, loc, disp);
+            emit_ld(RAX, R_(a));
+            emit_carry_in(in->info->op == J_SBC);
+            emit_alu8(in->info->op == J_ADC ? ALU_ADC : ALU_SBB, RAX, RDX);
+            emit_st(RAX, R_(a));
+            emit_set(in->info->op == J_ADC ? CC_C : CC_NC, R_(c));
+            emit_set(CC_O, R_(v));
+            emit_set(CC_S, R_(n));
+            emit_set(CC_Z, R_(z));
+            break;
+        case J_CMP:
+        case J_CPX:
+        case J_CPY:
+            loc = emit_ea(i, &disp);
+            emit_read(RDX, loc, disp);
+            emit_ld(RAX, in->info->op == J_CMP ? R_(a) : in->info->op == J_CPX ? R_(x) : R_(y));
+            emit_alu8(ALU_CMP, RAX, RDX);
+            emit_set(CC_NC, R_(c));
+            emit_set(CC_S, R_(n));
+            emit_set(CC_Z, R_(z));
+            break;
+        case J_BIT:
+            loc = emit_ea(i, &disp);
+            emit_read(RDX, loc, disp);
+            emit_ld(RAX, R_(a));
+            emit_rr(0x84, false, RDX, RAX);         // test al, dl
+            emit_set(CC_Z, R_(z));
+            if (loc != L_IMM) {
+                emit_rr(0x89, false, RDX, RAX);     // mov eax, edx
+                emit_rr(0xc0, false, 5, RAX);       // shr al, 7
+                emit8(7);
+                emit_st(RAX, R_(n));
+                emit_rr(0xc0, false, 5, RDX);       // shr dl, 6
+                emit8(6);
+                emit_rr(0x80, false, 4, RDX);       // and dl, 1
+                emit8(1);
+                emit_st(RDX, R_(v));
+            }
+            break;
+        case J_LDA:
+        case J_LDX:
+        case J_LDY:
+            loc = emit_ea(i, &disp);
+            reg = in->info->op == J_LDA ? R_(a) : in->info->op == J_LDX ? R_(x) : R_(y);
+            if (loc == L_IMM) {
+                emit_st_imm(reg, disp);
+                emit_st_imm(R_(n), disp >> 7);
+                emit_st_imm(R_(z), !disp);
+            }
+            else {
+                emit_read(RDX, loc, disp);
+                emit_st(RDX, reg);
+                emit_nz(RDX);
+            }
+            break;
+        case J_STA:
+        case J_STX:
+        case J_STY:
+        case J_STZ:
+            loc = emit_ea(i, &disp);
+            if (in->info->op == J_STZ)
+                emit_rr(0x31, false, RDX, RDX);     // xor edx, edx
+            else
+                emit_ld(RDX, in->info->op == J_STA ? R_(a) : in->info->op == J_STX ? R_(x) : R_(y));
+            emit_write(i, RDX, loc, disp);
+            if (loc != L_ACC)
+                emit_stale_check(i);
+            break;
+        case J_ASL:
+        case J_LSR:
+        case J_ROL:
+        case J_ROR:
+        case J_INC:
+        case J_DEC:
+            loc = emit_ea(i, &disp);
+            emit_read(RAX, loc, disp);
+            switch (in->info->op) {
+                case J_ASL:
+                    emit_rr(0xd0, false, 4, RAX);   // shl al, 1
+                    emit_set(CC_C, R_(c));
+                    emit_set(CC_S, R_(n));
+                    emit_set(CC_Z, R_(z));
+                    break;
+                case J_LSR:
+                    emit_rr(0xd0, false, 5, RAX);   // shr al, 1
+                    emit_set(CC_C, R_(c));
+                    emit_set(CC_S, R_(n));
+                    emit_set(CC_Z, R_(z));
+                    break;
+                case J_ROL:
+                case J_ROR:
+                    emit_carry_in(false);
+                    emit_rr(0xd0, false, in->info->op == J_ROL ? 2 : 3, RAX);   // rcl/rcr al, 1
+                    emit_set(CC_C, R_(c));
+                    emit_nz(RAX);
+                    break;
+                default:
+                    emit_rr(0xfe, false, in->info->op == J_INC ? 0 : 1, RAX);   // inc/dec al
+                    emit_set(CC_S, R_(n));
+                    emit_set(CC_Z, R_(z));
+                    break;
+            }
+            emit_write(i, RAX, loc, disp);
+            if (loc != L_ACC)
+                emit_stale_check(i);
+            break;
+        case J_INX:
+        case J_INY:
+        case J_DEX:
+        case J_DEY:
+            emit_mem(0xfe, false, in->info->op == J_INX || in->info->op == J_INY ? 0 : 1, RBX, -1,
+                     in->info->op == J_INX || in->info->op == J_DEX ? R_(x) : R_(y));
+            emit_set(CC_S, R_(n));
+            emit_set(CC_Z, R_(z));
+            break;
+        case J_TAX:
+        case J_TXA:
+        case J_TAY:
+        case J_TYA:
+        case J_TSX:
+        case J_TXS:
+            {
+                static const uint8_t from[] = { R_(a), R_(x), R_(a), R_(y), R_(s), R_(x) };
+                static const uint8_t to[] = { R_(x), R_(a), R_(y), R_(a), R_(x), R_(s) };
+                int n = in->info->op - J_TAX;
+                emit_ld(RAX, from[n]);
+                emit_st(RAX, to[n]);
+                if (in->info->op != J_TXS)
+                    emit_nz(RAX);
+            }
+            break;
+        case J_CLC:
+        case J_SEC:
+            emit_st_imm(R_(c), in->info->op == J_SEC);
+            break;
+        case J_CLV:
+            emit_st_imm(R_(v), 0);
+            break;
+        case J_NOP:
+            break;
+        case J_PHA:
+        case J_PHX:
+        case J_PHY:
+            emit_ld(RDX, in->info->op == J_PHA ? R_(a) : in->info->op == J_PHX ? R_(x) : R_(y));
+            emit_push(i, RDX);
+            emit_stale_check(i);
+            break;
+        case J_PHP:
+            {
+                static const struct { int off, shift; } bits[] = {
+                    { R_(z), 1 }, { R_(i), 2 }, { R_(d), 3 }, { R_(v), 6 }, { R_(n), 7 }
+                };
+                emit_ld(RDX, R_(c));
+                for (int b = 0; b < 5; b++) {
+                    emit_ld(RCX, bits[b].off);
+                    emit_rr(0xc1, false, 4, RCX);   // shl ecx, shift
+                    emit8(bits[b].shift);
+                    emit_rr(0x09, false, RCX, RDX); // or edx, ecx
+                }
+                emit_rr(0x83, false, 1, RDX);       // or edx, 0x30
+                emit8(0x30);
+                emit_push(i, RDX);
+                emit_stale_check(i);
+            }
+            break;
+        case J_PLA:
+        case J_PLX:
+        case J_PLY:
+            emit_pull(RDX);
+            emit_st(RDX, in->info->op == J_PLA ? R_(a) : in->info->op == J_PLX ? R_(x) : R_(y));
+            emit_nz(RDX);
+            break;
+        case J_BPL:
+        case J_BMI:
+        case J_BVC:
+        case J_BVS:
+        case J_BCC:
+        case J_BCS:
+        case J_BNE:
+        case J_BEQ:
+            {
+                uint16_t target = next_pc + (int8_t)in->operand;
+                int taken = in->cycles + 3 + ((target & 0xff00) != (next_pc & 0xff00));
+                int n = in->info->op - J_BPL;
+                emit_mem(0x80, false, 7, RBX, -1, branch_conds[n].flag);    // cmp byte [rbx+flag], 0
+                emit8(0);
+                skip = emit_jcc(branch_conds[n].set ? CC_Z : CC_NZ);
+                emit_goto(target, taken);
+                patch(skip, ep);
+            }
+            break;
+        case J_BRA:
+            {
+                uint16_t target = next_pc + (int8_t)in->operand;
+                emit_goto(target, in->cycles + 3 + ((target & 0xff00) != (next_pc & 0xff00)));
+            }
+            break;
+        case J_JMP:
+            if (in->info->mode == M_ABS) {
+                emit_goto(in->operand, end_cycles);
+                break;
+            }
+            if (in->info->mode == M_IND) {
+                uint16_t hi = x65c02 ? in->operand + 1 : (in->operand & 0xff00) | ((in->operand + 1) & 0xff);
+                emit_read_abs(RDX, in->operand);
+                emit_read_abs(RAX, hi);
+            }
+            else {
+                emit_ld(RSI, R_(x));
+                emit_rr(0x81, false, 0, RSI);       // add esi, base
+                emit32(in->operand);
+                emit_rr(0x0fb7, false, RSI, RSI);   // movzx esi, si
+                emit_bail_if_io(i, 0xfbff);
+                emit_read(RDX, L_MEMDYN, 0);
+                emit_mem(0x8d, false, RSI, RSI, -1, 1); // lea esi, [rsi+1]
+                emit_rr(0x0fb7, false, RSI, RSI);   // movzx esi, si
+                emit_read(RAX, L_MEMDYN, 0);
+            }
+            emit_rr(0xc1, false, 4, RAX);           // shl eax, 8
+            emit8(8);
+            emit_rr(0x09, false, RDX, RAX);         // or eax, edx
+            emit8(0x66);                            // mov [rbx+pc], ax
+            emit_mem(0x89, false, RAX, RBX, -1, R_(pc));
+            emit_exit(-1, end_cycles);
+            break;
+        case J_JSR:
+            emit_mov_imm(RDX, (in->pc + 2) >> 8);
+            emit_push(i, RDX);
+            emit_mov_imm(RDX, (in->pc + 2) & 0xff);
+            emit_push(i, RDX);
+            emit_stale_check(i);
+            emit_exit(in->operand, end_cycles);
+            break;
+        case J_RTS:
+            emit_pull(RDX);
+            emit_pull(RAX);
+            emit_rr(0xc1, false, 4, RAX);           // shl eax, 8
+            emit8(8);
+            emit_rr(0x09, false, RDX, RAX);         // or eax, edx
+            emit_rr(0xff, false, 0, RAX);           // inc eax
+            emit8(0x66);                            // mov [rbx+pc], ax
+            emit_mem(0x89, false, RAX, RBX, -1, R_(pc));
+            emit_exit(-1, end_cycles);
+            break;
+        default:
+            break;
+    }
+}
+
+static void emit_stubs(void)
+{
+    for (int k = 0; k < nstubs; k++) {
+        jit_stub_t *s = &stubs[k];
+        patch(s->at, ep);
+        if (s->kind == STUB_BAIL)
+            emit_exit(insns[s->insn].pc, insns[s->insn].cycles);
+        else {
+            // the stale flag is checked at the end of the instruction.
+            emit_mem(0x8d, true, RDI, R13, s->use_rsi ? RSI : -1, s->disp);    // lea rdi, [r13+rsi+disp]
+            emit_call(jit6502_invalidate);
+            patch(emit_jmp(), s->resume);
+        }
+    }
+}
+
+static bool ends_block(jit_op_t op)
+{
+    return op == J_JMP || op == J_JSR || op == J_RTS || op == J_BRA;
+}
+
+/* Decode as far as the translator can go from pc, returning the number
+ * of instructions and the most cycles they can take.
+ */
+static int decode(uint16_t pc, const uint8_t *host, int *max_cycles)
+{
+    const jit_opinfo_t *table = x65c02 ? cmos_ops : nmos_ops;
+    unsigned end = (pc | 0xff) + 1;
+    int n = 0, cycles = 0, most = 0;
+
+    while (n < JIT_MAX_INSNS) {
+        const uint8_t *p = host + (pc - block_pc);
+        const jit_opinfo_t *info = &table[*p];
+        unsigned len = mode_len[info->mode];
+        unsigned operand;
+        int worst;
+
+        if (!info->op || pc + len > end || pc == m6502_exit_pc)
+            break;
+        operand = len == 1 ? 0 : len == 2 ? p[1] : p[1] | p[2] << 8;
+        switch (info->mode) {
+            case M_ABS:
+                if (is_io(operand) && info->op != J_JMP && info->op != J_JSR)
+                    goto done;
+                break;
+            case M_ABSX:
+            case M_ABSY:
+            case M_INDAX:
+                // the 65c02 does a dummy read in the base page.
+                if (is_io(operand & 0xff00))
+                    goto done;
+                break;
+            case M_IND:
+                if (is_io(operand) || is_io((operand + 1) & 0xffff))
+                    goto done;
+                break;
+            default:
+                break;
+        }
+        worst = info->cycles + info->cross + (info->mode == M_REL ? 2 : 0);
+        if (n && most + worst > JIT_MAX_CYCLES)
+            break;
+        insns[n].pc = pc;
+        insns[n].opcode = *p;
+        insns[n].info = info;
+        insns[n].operand = operand;
+        insns[n].cycles = cycles;
+        n++;
+        cycles += info->cycles;
+        most += worst;
+        pc += len;
+        if (ends_block(info->op))
+            break;
+    }
+done:
+    insns[n].pc = pc;
+    insns[n].cycles = cycles;
+    *max_cycles = most;
+    return n;
+}
+
+static void *emit_block(int n)
+{
+    uint8_t *entry;
+    int i;
+
+    ep = code_base + code_used;
+    nstubs = 0;
+
+    epilogue = ep;
+    emit8(0x41); emit8(0x5f);                       // pop r15
+    emit8(0x41); emit8(0x5e);                       // pop r14
+    emit8(0x41); emit8(0x5d);                       // pop r13
+    emit8(0x41); emit8(0x5c);                       // pop r12
+    emit8(0x5b);                                    // pop rbx
+    emit8(0xc3);                                    // ret
+
+    entry = ep;
+    emit8(0x53);                                    // push rbx
+    emit8(0x41); emit8(0x54);                       // push r12
+    emit8(0x41); emit8(0x55);                       // push r13
+    emit8(0x41); emit8(0x56);                       // push r14
+    emit8(0x41); emit8(0x57);                       // push r15
+    emit_rr(0x89, true, RDI, RBX);                  // mov rbx, rdi
+    emit_mem(0x8b, true, R12, RBX, -1, R_(memlook));
+    emit_mem(0x8b, true, R13, R12, -1, 0);          // mov r13, [r12]
+    emit8(0x49);                                    // mov r15, codemap - ram
+    emit8(0xbf);
+    emit64((uintptr_t)codemap - (uintptr_t)ram);
+    emit_rr(0x01, true, R13, R15);                  // add r15, r13
+    emit_rr(0x31, false, R14, R14);                 // xor r14d, r14d
+    loop_head = ep;
+
+    for (i = 0; i < n; i++)
+        emit_insn(i);
+    if (!ends_block(insns[n - 1].info->op))
+        emit_exit(insns[n].pc, insns[n].cycles);
+    emit_stubs();
+
+    code_used = ep - code_base;
+    return entry;
+}
+
+static jit_block_t *translate(jit6502_regs_t *r, const uint8_t *host)
+{
+    long off = host_offset(host);
+    int page = off < 0 ? -1 : off >> 8;
+    jit_block_t *b;
+    int n, max_cycles;
+
+    if (page >= 0 && page_rewrites[page] >= JIT_HOT_PAGE)
+        return NULL;
+    if (!code_base && !code_init())
+        return NULL;
+    if (code_used + JIT_BLOCK_ROOM > JIT_CODE_SIZE)
+        jit6502_flush();
+    if (!(b = malloc(sizeof(*b))))
+        return NULL;
+
+    block_pc = r->pc;
+    tr_memlook = r->memlook;
+    n = decode(r->pc, host, &max_cycles);
+    b->code = n ? emit_block(n) : NULL;
+    b->host = host;
+    b->pc = r->pc;
+    b->len = insns[n].pc - r->pc;
+    b->max_cycles = max_cycles;
+    b->page = page;
+    b->next = blocks[r->pc];
+    blocks[r->pc] = b;
+    if (page >= 0) {
+        b->page_next = page_blocks[page];
+        page_blocks[page] = b;
+        memset(codemap + off, 1, b->len ? b->len : 1);
+    }
+    jit6502_nblocks++;
+    return b;
+}
+
+bool jit6502_run(jit6502_regs_t *r, int budget)
+{
+    const uint8_t *host;
+    jit_block_t *b, **bp;
+
+    // code run from the I/O pages is fetched through the devices.
+    if (is_io(r->pc))
+        return false;
+    host = r->memlook[r->pc >> 8] + r->pc;
+    for (bp = &blocks[r->pc]; (b = *bp); bp = &b->next) {
+        if (b->host == host) {
+            if (bp != &blocks[r->pc]) {
+                *bp = b->next;
+                b->next = blocks[r->pc];
+                blocks[r->pc] = b;
+            }
+            break;
+        }
+    }
+    if (!b && !(b = translate(r, host)))
+        return false;
+    if (!b->code || b->max_cycles > budget)
+        return false;
+    r->cycles = 0;
+    r->loop_limit = budget - b->max_cycles;
+    r->stale = 0;
+    running = r;
+    running_page = b->page;
+    b->code(r);
+    running_page = -1;
+    return r->cycles > 0;
+}
+
+#endif
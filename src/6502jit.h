@@ -0,0 +1,48 @@
+#ifndef __INC_6502JIT_H
+#define __INC_6502JIT_H
+
+// the translator emits x86-64 code into mmap(2)ed memory and keeps one
+// cache per process, so machines of a batch cannot share it.
+#if (!defined(__x86_64__) || defined(_WIN32) || defined(PICO_BUILD) || defined(USE_PICO_CPU) || defined(USE_MULTI_MACHINE) || defined(NO_USE_RAM_ROMS)) && !defined(NO_USE_JIT6502)
+#define NO_USE_JIT6502
+#endif
+
+#ifndef NO_USE_JIT6502
+/*
+ * The registers as the translated code sees them.  The flags are each
+ * 0 or 1.  cycles is set to the number of cycles the code has run when
+ * it returns, and the code only goes round a loop again while that
+ * stays within loop_limit.
+ */
+typedef struct {
+    uint8_t a, x, y, s;
+    uint8_t c, z, n, v;
+    uint8_t i, d;
+    uint16_t pc;
+    int32_t cycles;
+    int32_t loop_limit;
+    uint8_t **memlook;  // the memory map for the code's page
+    uint8_t stale;      // the running block has been overwritten
+} jit6502_regs_t;
+
+extern bool jit6502_enabled;
+extern int jit6502_nblocks;
+
+bool jit6502_run(jit6502_regs_t *r, int budget);
+void jit6502_flush(void);
+void jit6502_close(void);
+void jit6502_invalidate(const uint8_t *host);
+
+// called for each write to RAM so code that is overwritten is translated again.
+static inline void jit6502_written(const uint8_t *host)
+{
+    if (jit6502_nblocks)
+        jit6502_invalidate(host);
+}
+#else
+#define jit6502_enabled false
+static inline void jit6502_flush(void) {}
+static inline void jit6502_close(void) {}
+static inline void jit6502_written(const uint8_t *host) {}
+#endif
+#endif
@@ -45,6 +45,47 @@ OperandSizeType OpSize;
 
 const uint32_t IndexLKUP[8] = { 0x0, 0x1, 0x4, 0x5, 0x8, 0x9, 0xC, 0xD };                    // See Page 2-3 of the manual!
 
+// The displacements and immediate value of an operand as they were read from the instruction stream
+typedef struct
+{
+   int32_t  Disp[2];
+   uint64_t Immediate;
+} DecodedOperand;
+
+#ifndef NO_USE_NS32016_DECODE_CACHE
+// Fully decoded instructions, indexed by address. Pandora and Panos go round the same loops
+// time after time so rather than walk the format tables, addressing modes and displacements
+// again the effective addresses are worked out from what was recorded the first time.
+// An entry is only good while the generation of its block of memory is unchanged.
+#define DECODE_CACHE_SIZE 4096
+
+typedef struct
+{
+   uint32_t       Address;
+   uint32_t       Generation;
+   uint32_t       Opcode;
+   uint32_t       Function;
+   uint32_t       OpSize;
+   uint32_t       WriteIndex;
+   RegLKU         Regs[2];
+   uint32_t       NextPC;
+   int32_t        Branch;
+   DecodedOperand Operand[2];
+} DecodedInstruction;
+
+static DecodedInstruction DecodeCache[DECODE_CACHE_SIZE];
+
+static void DecodeFlush(void)
+{
+   uint32_t Index;
+
+   for (Index = 0; Index < DECODE_CACHE_SIZE; Index++)
+   {
+      DecodeCache[Index].Address = 0xFFFFFFFF;
+   }
+}
+#endif
+
 /* A custom warning logger for n32016 that logs the PC */
 
 void n32016_warn(char *fmt, ...)
@@ -117,6 +158,9 @@ void n32016_reset()
 void n32016_reset_addr(uint32_t StartAddress)
 {
    n32016_build_matrix();
+#ifndef NO_USE_NS32016_DECODE_CACHE
+   DecodeFlush();
+#endif
 
    pc = StartAddress;
    psr = 0;
@@ -357,39 +401,45 @@ static void getgen(int gen, int c)
    }
 }
 
-static void GetGenPhase2(RegLKU gen, int c)
+static void GetGenRegister(RegLKU gen, int c)
 {
-   if (gen.Whole < 0xFFFF)                                              // Does this Operand exist ?
+   switch (gen.RegType)
    {
-      if (gen.OpType <= R7)
+      case Integer:
       {
-         switch (gen.RegType)
-         {
-            case Integer:
-            {
-               genreg[c] = &r[gen.OpType];
-            }
-            break;
+         genreg[c] = &r[gen.OpType];
+      }
+      break;
 
-            case SinglePrecision:
-            {
-               genreg[c] = (uint32_t *) &FR.fr32[IndexLKUP[gen.OpType]];
-            }
-            break;
+      case SinglePrecision:
+      {
+         genreg[c] = (uint32_t *) &FR.fr32[IndexLKUP[gen.OpType]];
+      }
+      break;
 
-            case DoublePrecision:
-            {
-               genreg[c] = (uint32_t *) &FR.fr64[gen.OpType];
-            }
-            break;
+      case DoublePrecision:
+      {
+         genreg[c] = (uint32_t *) &FR.fr64[gen.OpType];
+      }
+      break;
 
-            default:
-            {
-               PiWARN("Illegal RegType value: %u", gen.RegType);
-            }
-         }
+      default:
+      {
+         PiWARN("Illegal RegType value: %u", gen.RegType);
+      }
+   }
 
-         gentype[c] = Register;
+   gentype[c] = Register;
+}
+
+// Rec is filled in with the displacements and immediate read so the decode can be replayed by GetGenDecoded()
+static void GetGenPhase2(RegLKU gen, int c, DecodedOperand *Rec)
+{
+   if (gen.Whole < 0xFFFF)                                              // Does this Operand exist ?
+   {
+      if (gen.OpType <= R7)
+      {
+         GetGenRegister(gen, c);
          return;
       }
 
@@ -403,6 +453,7 @@ static void GetGenPhase2(RegLKU gen, int c)
             Immediate64.u64 = (((uint64_t) temp3.u32) << 32);
             temp3.u32 = SWAP32(read_x32(pc + 4));
             Immediate64.u64 |= temp3.u32;
+            Rec->Immediate = Immediate64.u64;
          }
          else
          {
@@ -414,6 +465,7 @@ static void GetGenPhase2(RegLKU gen, int c)
                genaddr[c] = temp3.u16;
             else
                genaddr[c] = temp3.u32;
+            Rec->Immediate = genaddr[c];
          }
 
          pc += OpSize.Op[c];
@@ -425,7 +477,7 @@ static void GetGenPhase2(RegLKU gen, int c)
 
       if (gen.OpType <= R7_Offset)
       {
-         genaddr[c] = r[gen.Whole & 7] + GetDisplacement(&pc);
+         genaddr[c] = r[gen.Whole & 7] + (Rec->Disp[0] = GetDisplacement(&pc));
          return;
       }
 
@@ -436,7 +488,7 @@ static void GetGenPhase2(RegLKU gen, int c)
          uint32_t Shift = gen.Whole & 3;
          RegLKU NewPattern;
          NewPattern.Whole = gen.IdxType;
-         GetGenPhase2(NewPattern, c);
+         GetGenPhase2(NewPattern, c, Rec);
 
          int32_t Offset = ((int32_t) r[gen.IdxReg]) * (1 << Shift);
          if (gentype[c] != Register)
@@ -455,35 +507,35 @@ static void GetGenPhase2(RegLKU gen, int c)
       switch (gen.OpType)
       {
          case FrameRelative:
-            temp = GetDisplacement(&pc);
-            temp2 = GetDisplacement(&pc);
+            temp = Rec->Disp[0] = GetDisplacement(&pc);
+            temp2 = Rec->Disp[1] = GetDisplacement(&pc);
             genaddr[c] = read_x32(fp + temp);
             genaddr[c] += temp2;
             break;
 
          case StackRelative:
-            temp = GetDisplacement(&pc);
-            temp2 = GetDisplacement(&pc);
+            temp = Rec->Disp[0] = GetDisplacement(&pc);
+            temp2 = Rec->Disp[1] = GetDisplacement(&pc);
             genaddr[c] = read_x32(GET_SP() + temp);
             genaddr[c] += temp2;
             break;
 
          case StaticRelative:
-            temp = GetDisplacement(&pc);
-            temp2 = GetDisplacement(&pc);
+            temp = Rec->Disp[0] = GetDisplacement(&pc);
+            temp2 = Rec->Disp[1] = GetDisplacement(&pc);
             genaddr[c] = read_x32(sb + temp);
             genaddr[c] += temp2;
             break;
 
          case Absolute:
-            genaddr[c] = GetDisplacement(&pc);
+            genaddr[c] = Rec->Disp[0] = GetDisplacement(&pc);
             break;
 
          case External:
             temp = read_x32(mod + 4);
-            temp += ((int32_t) GetDisplacement(&pc)) * 4;
+            temp += (Rec->Disp[0] = GetDisplacement(&pc)) * 4;
             temp2 = read_x32(temp);
-            genaddr[c] = temp2 + GetDisplacement(&pc);
+            genaddr[c] = temp2 + (Rec->Disp[1] = GetDisplacement(&pc));
             break;
 
          case TopOfStack:
@@ -492,19 +544,19 @@ static void GetGenPhase2(RegLKU gen, int c)
             break;
 
          case FpRelative:
-            genaddr[c] = GetDisplacement(&pc) + fp;
+            genaddr[c] = (Rec->Disp[0] = GetDisplacement(&pc)) + fp;
             break;
 
          case SpRelative:
-            genaddr[c] = GetDisplacement(&pc) + GET_SP();
+            genaddr[c] = (Rec->Disp[0] = GetDisplacement(&pc)) + GET_SP();
             break;
 
          case SbRelative:
-            genaddr[c] = GetDisplacement(&pc) + sb;
+            genaddr[c] = (Rec->Disp[0] = GetDisplacement(&pc)) + sb;
             break;
 
          case PcRelative:
-            genaddr[c] = GetDisplacement(&pc) + startpc;
+            genaddr[c] = (Rec->Disp[0] = GetDisplacement(&pc)) + startpc;
             break;
 
          default:
@@ -514,6 +566,127 @@ static void GetGenPhase2(RegLKU gen, int c)
    }
 }
 
+#ifndef NO_USE_NS32016_DECODE_CACHE
+// As GetGenPhase2() but taking the displacements and immediate from a cached decode rather than the instruction stream
+static void GetGenDecoded(RegLKU gen, int c, const DecodedOperand *Rec)
+{
+   if (gen.Whole < 0xFFFF)                                              // Does this Operand exist ?
+   {
+      if (gen.OpType <= R7)
+      {
+         GetGenRegister(gen, c);
+         return;
+      }
+
+      if (gen.OpType == Immediate)
+      {
+         if (OpSize.Op[c] == sz64)
+         {
+            Immediate64.u64 = Rec->Immediate;
+         }
+         else
+         {
+            genaddr[c] = (uint32_t) Rec->Immediate;
+         }
+
+         gentype[c] = OpImmediate;
+         return;
+      }
+
+      gentype[c] = Memory;
+
+      if (gen.OpType <= R7_Offset)
+      {
+         genaddr[c] = r[gen.Whole & 7] + Rec->Disp[0];
+         return;
+      }
+
+      uint32_t temp, temp2;
+
+      if (gen.OpType >= EaPlusRn)
+      {
+         uint32_t Shift = gen.Whole & 3;
+         RegLKU NewPattern;
+         NewPattern.Whole = gen.IdxType;
+         GetGenDecoded(NewPattern, c, Rec);
+
+         int32_t Offset = ((int32_t) r[gen.IdxReg]) * (1 << Shift);
+         if (gentype[c] != Register)
+         {
+            genaddr[c] += Offset;
+         }
+         else
+         {
+            genaddr[c] = (*genreg[c]) + Offset;
+         }
+
+         gentype[c] = Memory;                               // Force Memory
+         return;
+      }
+
+      switch (gen.OpType)
+      {
+         case FrameRelative:
+            temp = Rec->Disp[0];
+            temp2 = Rec->Disp[1];
+            genaddr[c] = read_x32(fp + temp);
+            genaddr[c] += temp2;
+            break;
+
+         case StackRelative:
+            temp = Rec->Disp[0];
+            temp2 = Rec->Disp[1];
+            genaddr[c] = read_x32(GET_SP() + temp);
+            genaddr[c] += temp2;
+            break;
+
+         case StaticRelative:
+            temp = Rec->Disp[0];
+            temp2 = Rec->Disp[1];
+            genaddr[c] = read_x32(sb + temp);
+            genaddr[c] += temp2;
+            break;
+
+         case Absolute:
+            genaddr[c] = Rec->Disp[0];
+            break;
+
+         case External:
+            temp = read_x32(mod + 4);
+            temp += Rec->Disp[0] * 4;
+            temp2 = read_x32(temp);
+            genaddr[c] = temp2 + Rec->Disp[1];
+            break;
+
+         case TopOfStack:
+            genaddr[c] = GET_SP();
+            gentype[c] = TOS;
+            break;
+
+         case FpRelative:
+            genaddr[c] = Rec->Disp[0] + fp;
+            break;
+
+         case SpRelative:
+            genaddr[c] = Rec->Disp[0] + GET_SP();
+            break;
+
+         case SbRelative:
+            genaddr[c] = Rec->Disp[0] + sb;
+            break;
+
+         case PcRelative:
+            genaddr[c] = Rec->Disp[0] + startpc;
+            break;
+
+         default:
+            n32016_dumpregs("Bad NS32016 gen mode");
+            break;
+      }
+   }
+}
+#endif
+
 // From: http://homepage.cs.uiowa.edu/~jones/bcd/bcd.html
 static uint32_t bcd_add_16(uint32_t a, uint32_t b, uint32_t *carry)
 {
@@ -992,6 +1165,10 @@ void n32016_exec()
    uint32_t temp, temp2, temp3;
    Temp64Type temp64;
    uint32_t Function;
+   DecodedOperand Operands[2];
+#ifndef NO_USE_NS32016_DECODE_CACHE
+   DecodedInstruction *Decoded;
+#endif
 
    // Avoid a "might be uninitialized" warning
    temp = 0;
@@ -1031,6 +1208,34 @@ void n32016_exec()
       }
 #endif
 
+#ifndef NO_USE_NS32016_DECODE_CACHE
+      Decoded = &DecodeCache[pc % DECODE_CACHE_SIZE];
+      if (Decoded->Address == pc && Decoded->Generation == DECODE_GENERATION(pc) && pc != PR.BPC
+#ifdef INCLUDE_DEBUGGER
+          && !n32016_debug_enabled                                        // The debugger wants to see the instruction fetched
+#endif
+         )
+      {
+         opcode         = Decoded->Opcode;
+         Function       = Decoded->Function;
+         OpSize.Whole   = Decoded->OpSize;
+         WriteIndex     = Decoded->WriteIndex;
+         Regs[0]        = Decoded->Regs[0];
+         Regs[1]        = Decoded->Regs[1];
+
+         GetGenDecoded(Regs[0], 0, &Decoded->Operand[0]);
+         GetGenDecoded(Regs[1], 1, &Decoded->Operand[1]);
+
+         if (Function <= RETT)
+         {
+            temp = Decoded->Branch;
+         }
+
+         pc = Decoded->NextPC;
+         goto Execute;
+      }
+#endif
+
       opcode = read_x32(pc);
 
       if (pc == PR.BPC)
@@ -1296,8 +1501,8 @@ void n32016_exec()
       n32016_show_instruction(startpc, &Temp, opcode, Function, &OpSize);
 #endif
 
-      GetGenPhase2(Regs[0], 0);
-      GetGenPhase2(Regs[1], 1);
+      GetGenPhase2(Regs[0], 0, &Operands[0]);
+      GetGenPhase2(Regs[1], 1, &Operands[1]);
 
       if (Function <= RETT)
       {
@@ -1311,6 +1516,23 @@ void n32016_exec()
          continue;
       }
 
+#ifndef NO_USE_NS32016_DECODE_CACHE
+      Decoded->Address     = startpc;
+      Decoded->Generation  = DECODE_GENERATION(startpc);
+      Decoded->Opcode      = opcode;
+      Decoded->Function    = Function;
+      Decoded->OpSize      = OpSize.Whole;
+      Decoded->WriteIndex  = WriteIndex;
+      Decoded->Regs[0]     = Regs[0];
+      Decoded->Regs[1]     = Regs[1];
+      Decoded->NextPC      = pc;
+      Decoded->Branch      = temp;
+      Decoded->Operand[0]  = Operands[0];
+      Decoded->Operand[1]  = Operands[1];
+
+      Execute:
+#endif
+
 #ifdef INSTRUCTION_PROFILING
       IP[startpc]++;
 #endif
@@ -1941,6 +2163,9 @@ void n32016_exec()
             }
 
             nscfg.lsb = (opcode >> 15);                                  // Only sets the bottom 8 bits of which the lower 4 are used!
+#ifndef NO_USE_NS32016_DECODE_CACHE
+            DecodeFlush();                                               // Format 9, 11 and 12 decode depends on the FPU flag
+#endif
             continue;
          }
          // No break due to continue
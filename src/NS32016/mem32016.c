@@ -47,6 +47,29 @@ static uint8_t * ns32016ram;
 #define PANDORA_VERSION PandoraV2_00
 #endif
 
+#ifndef NO_USE_NS32016_DECODE_CACHE
+uint32_t DecodeGeneration[(MEG16 >> DECODE_BLOCK_SHIFT) + 2];
+
+// Bump the generation of the blocks written and the one before them
+static inline void DecodeWritten(uint32_t addr, uint32_t Size)
+{
+   uint32_t Block = addr >> DECODE_BLOCK_SHIFT;
+   uint32_t Last  = ((addr + Size - 1) >> DECODE_BLOCK_SHIFT) + 1;
+
+   if (Size == 0)
+   {
+      return;
+   }
+
+   while (Block <= Last)
+   {
+      DecodeGeneration[Block++]++;
+   }
+}
+#else
+#define DecodeWritten(addr, Size)
+#endif
+
 void init_ram(void)
 {
 #ifndef BEM
@@ -218,6 +241,7 @@ void write_x8_internal(uint32_t addr, uint8_t val)
 
    if (addr <= (RAM_SIZE - sizeof(uint8_t)))
    {
+      DecodeWritten(addr, sizeof(uint8_t));
 #ifdef USE_MEMORY_POINTER
       ns32016ram[addr] = val;
 #else
@@ -237,6 +261,7 @@ void write_x8_internal(uint32_t addr, uint8_t val)
 #ifdef PANDORA_ROM_PAGE_OUT
       PiTRACE("Pandora ROM no longer occupying the entire memory space!")
       memset(ns32016ram, 0, RAM_SIZE);
+      DecodeWritten(0, RAM_SIZE);
 #else
       PiTRACE("Pandora ROM write to 0xF90000");
 #endif
@@ -264,6 +289,7 @@ void write_x16(uint32_t addr, uint16_t val)
          debug_memwrite(&n32016_cpu_debug, addr, val, 2);
       }
 #endif
+      DecodeWritten(addr, sizeof(uint16_t));
 #ifdef USE_MEMORY_POINTER
       *((uint16_t*) (ns32016ram + addr)) = val;
 #else
@@ -290,6 +316,7 @@ void write_x32(uint32_t addr, uint32_t val)
          debug_memwrite(&n32016_cpu_debug, addr, val, 4);
       }
 #endif
+      DecodeWritten(addr, sizeof(uint32_t));
 #ifdef USE_MEMORY_POINTER
       *((uint32_t*) (ns32016ram + addr)) = val;
 #else
@@ -342,6 +369,7 @@ void write_Arbitary(uint32_t addr, void* pData, uint32_t Size)
    if ((addr + Size) <= RAM_SIZE) 
 #endif
    {
+      DecodeWritten(addr, Size);
       memcpy(ns32016ram + addr, pData, Size);
       return;
    }
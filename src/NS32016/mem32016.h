@@ -13,6 +13,16 @@
 
 void init_ram(void);
 
+#ifndef NO_USE_NS32016_DECODE_CACHE
+// Memory is split into 64 byte blocks each with a generation count which is bumped by every write to the block
+// or the one after it, as an instruction may run on into the next block. 32016.c keeps decoded instructions
+// only while the generation of the block they start in is unchanged.
+#define DECODE_BLOCK_SHIFT    6
+#define DECODE_GENERATION(addr) DecodeGeneration[(((addr) & MEM_MASK) >> DECODE_BLOCK_SHIFT) + 1]
+
+extern uint32_t DecodeGeneration[(MEG16 >> DECODE_BLOCK_SHIFT) + 2];
+#endif
+
 #ifdef INCLUDE_DEBUGGER
 uint8_t  read_x8_internal(uint32_t addr);
 #endif
@@ -29,7 +29,7 @@ bool __time_critical_func(invoke_acia)(struct hw_event *event) {
     return false;
 }
 
-static struct hw_event acia_event = {
+static MACHINE_LOCAL struct hw_event acia_event = {
     .invoke = invoke_acia
 };
 
@@ -0,0 +1,260 @@
+/*
+ * B-em ARM co-processor testing
+ *
+ * This program runs the ARM1 core on its own, with the tube replaced by
+ * stubs, through two loop benchmarks, a loop which changes its own code
+ * at each distance ahead of the instruction making the change, and
+ * images of random words with random registers, interrupts and fast
+ * interrupts, and prints a hash of the whole processor state taken
+ * after every slice of each, and of the RAM at the end.  It is built
+ * twice, once as the emulator has it and once with USE_ARM_DECODE_CACHE,
+ * and utils/core-compare.sh checks the two print the same.
+ *
+ * The core keeps its registers in statics, so it is included here
+ * rather than linked.
+ */
+
+#include "b-em.h"
+#include "tube.h"
+
+#include <stdarg.h>
+
+tubetype tube_type;
+uint8_t (*tube_readmem)(uint32_t addr);
+void (*tube_writemem)(uint32_t addr, uint8_t byte);
+void (*tube_exec)(void);
+int tubecycles;
+int tube_irq;
+
+void log_warn(const char *fmt, ...) {}
+void log_error(const char *fmt, ...) {}
+
+FILE *x_fopen(const char *fn, const char *mode)
+{
+    return NULL;
+}
+
+static uint32_t rng;
+static uint32_t wsum;
+
+static uint32_t rnd(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return (rng >> 8) ^ (rng << 13);
+}
+
+uint8_t tube_parasite_read(uint32_t addr)
+{
+    return rnd();
+}
+
+void tube_parasite_write(uint32_t addr, uint8_t val)
+{
+    wsum = wsum * 31 + val + addr;
+}
+
+#include "arm.c"
+
+#define SLICE   1000    // tubecycles given to each slice of the benchmark.
+#define RANDOM  0x4000  // bytes in each random image, as many as the ROM.
+#define STEPS   2000    // slices each random image is run for.
+
+/*
+ * Fill 16K with a pattern, copy it four words at a time with LDM and STM
+ * and add it up a byte at a time through a subroutine which pushes and
+ * pulls its registers, over and over.
+ */
+static const uint32_t loop_code[] = {
+    0xe3a0d801,     // start: mov r13,#&10000
+    0xe3a00802,     // outer: mov r0,#&20000
+    0xe3a01a01,     // mov r1,#&1000
+    0xe3a0205a,     // mov r2,#&5A
+    0xe02231a0,     // fill: eor r3,r2,r0,lsr #3
+    0xe08223e3,     // add r2,r2,r3,ror #7
+    0xe4803004,     // str r3,[r0],#4
+    0xe2511001,     // subs r1,r1,#1
+    0x1afffffa,     // bne fill
+    0xe3a00802,     // mov r0,#&20000
+    0xe2801901,     // add r1,r0,#&4000
+    0xe3a04b01,     // mov r4,#&400
+    0xe8b001e0,     // copy: ldmia r0!,{r5-r8}
+    0xe8a101e0,     // stmia r1!,{r5-r8}
+    0xe2544001,     // subs r4,r4,#1
+    0x1afffffb,     // bne copy
+    0xe3a00909,     // mov r0,#&24000
+    0xe3a09000,     // mov r9,#0
+    0xe3a04901,     // mov r4,#&4000
+    0xeb000006,     // sum: bl add1
+    0xe2544001,     // subs r4,r4,#1
+    0x1afffffc,     // bne sum
+    0xe1b0a219,     // movs r10,r9,lsl r2
+    0xe0abb009,     // adc r11,r11,r9
+    0xe3590102,     // cmp r9,#&80000000
+    0x238cc001,     // orrcs r12,r12,#1
+    0xeaffffe5,     // b outer
+    0xe4d05001,     // add1: ldrb r5,[r0],#1
+    0xe0999005,     // adds r9,r9,r5
+    0x42699000,     // rsbmi r9,r9,#0
+    0xe92d4200,     // stmfd r13!,{r9,r14}
+    0xe8bd4200,     // ldmfd r13!,{r9,r14}
+    0xe1a0f00e      // mov pc,r14
+};
+
+// Count down from 65536 in a five instruction loop, over and over.
+static const uint32_t count_code[] = {
+    0xe3a01801,     // start: mov r1,#&10000
+    0xe2511001,     // loop: subs r1,r1,#1
+    0xe0822001,     // add r2,r2,r1
+    0xe2833003,     // add r3,r3,#3
+    0xe1a04184,     // mov r4,r4,lsl #3
+    0x1afffffa,     // bne loop
+    0xeafffff8      // b start
+};
+
+/*
+ * Add one to the 8-bit immediates of three ADDs one, two and three words
+ * after the STR which changes each.  The first two have already been
+ * fetched when the STR runs so they only change the next time round.
+ */
+static const uint32_t smc_code[] = {
+    0xe3a02ffa,     // smc: mov r2,#1000
+    0xe59f0020,     // again: ldr r0,t1
+    0xe2800001,     // add r0,r0,#1
+    0xe3c00c01,     // bic r0,r0,#&100
+    0xe59f1020,     // ldr r1,t2
+    0xe2811001,     // add r1,r1,#1
+    0xe3c11c01,     // bic r1,r1,#&100
+    0xe59f3024,     // ldr r3,t3
+    0xe2833001,     // add r3,r3,#1
+    0xe3c33c01,     // bic r3,r3,#&100
+    0xe50f0004,     // str r0,t1
+    0xe2855001,     // t1: add r5,r5,#1
+    0xe58f1000,     // str r1,t2
+    0xe1a00000,     // mov r0,r0
+    0xe2866001,     // t2: add r6,r6,#1
+    0xe58f3004,     // str r3,t3
+    0xe1a00000,     // mov r0,r0
+    0xe1a00000,     // mov r0,r0
+    0xe2877001,     // t3: add r7,r7,#1
+    0xe2522001,     // subs r2,r2,#1
+    0x1affffeb,     // bne again
+    0xeaffffe9      // b smc
+};
+
+static uint32_t hash_regs(uint32_t h, const uint32_t *regs)
+{
+    for (int i = 0; i < 16; i++)
+        h = h * 31 + regs[i];
+    return h;
+}
+
+static uint32_t state(void)
+{
+    uint32_t h = 0;
+
+    h = hash_regs(h, armregs);
+    h = hash_regs(h, userregs);
+    h = hash_regs(h, superregs);
+    h = hash_regs(h, fiqregs);
+    h = hash_regs(h, irqregs);
+    h = h * 31 + opcode2;
+    h = h * 31 + opcode3;
+    h = h * 31 + mode;
+    h = h * 31 + armirq;
+    h = h * 31 + databort;
+    h = h * 31 + (uint32_t)tubecycles;
+    return h;
+}
+
+static void report(const char *name, uint32_t hash)
+{
+    for (int i = 0; i < ARM_RAM_SIZE / 4; i++)
+        hash = hash * 33 + armram[i];
+    printf("%-12s %08x %08x %07x\n", name, hash, wsum, PC);
+}
+
+// Reset into code at address 0, which the reset copies from the ROM.
+static void load(uint32_t *rom, const uint32_t *code, size_t size)
+{
+    memset(rom, 0, ARM_ROM_SIZE);
+    memcpy(rom, code, size);
+    memset(armram, 0, ARM_RAM_SIZE);
+    arm_reset();
+    tubecycles = 0;
+    wsum = 0;
+}
+
+static void run(const char *name, long slices)
+{
+    uint32_t hash = 0;
+
+    for (long i = 0; i < slices; i++) {
+        tubecycles += SLICE;
+        arm_exec();
+        hash = hash * 33 + state();
+    }
+    report(name, hash);
+}
+
+int main(int argc, char **argv)
+{
+    static uint32_t rom[ARM_ROM_SIZE / 4];
+    char name[24];
+    long slices = 20000;
+    int images = 300;
+    uint32_t hash;
+
+    if (argc > 1)
+        slices = atol(argv[1]);
+    if (argc > 2)
+        images = atoi(argv[2]);
+    if (argc > 3 || slices <= 0 || images < 0) {
+        fputs("Usage: arm-test [ <slices> [ <random-images> ] ]\n", stderr);
+        return 1;
+    }
+    if (!arm_init(rom))
+        return 1;
+
+    load(rom, loop_code, sizeof loop_code);
+    run("loop", slices);
+    load(rom, count_code, sizeof count_code);
+    run("count", slices);
+    load(rom, smc_code, sizeof smc_code);
+    run("smc", slices / 4);
+
+    /*
+     * Even images are run an instruction at a time and odd ones in slices
+     * of many.  Each starts in a random mode at a random address past the
+     * vectors with the interrupts randomly masked.  The vectors return at
+     * once, so an exception does not leave the image stuck in a loop of
+     * them.
+     */
+    for (int i = 1; i <= images; i++) {
+        rng = i;
+        for (int j = 0; j < RANDOM / 4; j++)
+            rom[j] = rnd();
+        for (int j = 1; j < 8; j++)
+            rom[j] = 0xe1b0f00e;    // movs pc,r14
+        memset(armram, 0, ARM_RAM_SIZE);
+        arm_reset();
+        for (int r = 0; r < 15; r++)
+            armregs[r] = rnd();
+        armregs[15] = (rnd() & 0xFC000003) | ((0x20 + rnd() % (RANDOM - 0x20)) & 0x3FFC);
+        if ((armregs[15] & 3) != mode)
+            updatemode(armregs[15] & 3);
+        refillpipeline2();
+        tubecycles = 0;
+        hash = wsum = 0;
+        for (int s = 0; s < STEPS; s++) {
+            tube_irq = (rnd() % 16 == 0) | ((rnd() % 64 == 0) << 1);
+            tubecycles += (i & 1) ? 1 + rnd() % 400 : 1;
+            arm_exec();
+            hash = hash * 33 + state();
+        }
+        tube_irq = 0;
+        snprintf(name, sizeof name, "random-%d", i);
+        report(name, hash);
+    }
+    arm_close();
+    return 0;
+}
@@ -43,8 +43,13 @@ static uint8_t *armromb,*armramb;
 #define VFLAG 0x10000000
 #define IFLAG 0x08000000
 
+#ifdef USE_ARM_DECODE_CACHE
+#define RD (de->rd)
+#define RN (de->rn)
+#else
 #define RD ((opcode>>12)&0xF)
 #define RN ((opcode>>16)&0xF)
+#endif
 #define RM (opcode&0xF)
 
 #define MULRD ((opcode>>16)&0xF)
@@ -673,7 +678,7 @@ bool arm_init(void *rom)
         armread[c]=0;
     for (int c = 0;c < 4; c++)
         armread[c]=&armram[c*0x40000];
-    armread[48]=armrom;
+    // the ROM fills only 16K of its megabyte so readarmfl checks the bounds.
     for (int c = 0;c < 64; c++)
         armmask[c]=0xFFFFF;
     armmask[48]=0x3FFF;
@@ -908,7 +913,11 @@ static inline unsigned rotate(unsigned data)
         return rotval;
 }
 
+#ifdef USE_ARM_DECODE_CACHE
+#define rotate2(v) (de->imm)
+#else
 #define rotate2(v) rotatelookup[v&4095]
+#endif
 
 static int ldrlookup[4]={0,8,16,24};
 
@@ -926,10 +935,50 @@ static void refillpipeline2()
         opcode3=readarml(PC-4);
 }
 
+#ifdef USE_ARM_DECODE_CACHE
+/*
+ * The fields arm_exec takes from each instruction, kept for the last
+ * instruction run from each of a range of addresses.  An entry is used
+ * only while it holds the same word as the pipeline, so code that
+ * changes itself is decoded again without writes needing to look here.
+ * It runs loops slower than decoding each time (see arm-test), so it is
+ * left out unless USE_ARM_DECODE_CACHE is defined.
+ */
+typedef struct {
+        uint32_t opcode;
+        uint32_t imm;   /*Rotated 8-bit immediate*/
+        uint8_t op;     /*Bits 20-27, the case to run*/
+        uint8_t rd;
+        uint8_t rn;
+} arm_decoded_t;
+
+#define ARM_DECODE_SLOTS 0x10000
+
+/*An entry of all zeros is opcode 0 decoded, so the table starts valid*/
+static arm_decoded_t arm_decoded[ARM_DECODE_SLOTS];
+
+static inline const arm_decoded_t *arm_decode(uint32_t addr, uint32_t opcode)
+{
+        arm_decoded_t *de = &arm_decoded[(addr >> 2) & (ARM_DECODE_SLOTS - 1)];
+        if (de->opcode != opcode)
+        {
+                de->opcode = opcode;
+                de->imm = rotatelookup[opcode & 4095];
+                de->op = (opcode >> 20) & 0xFF;
+                de->rd = (opcode >> 12) & 0xF;
+                de->rn = (opcode >> 16) & 0xF;
+        }
+        return de;
+}
+#endif
+
 int accc=0;
 void arm_exec()
 {
         uint32_t opcode,templ,templ2,mask,addr,addr2;
+#ifdef USE_ARM_DECODE_CACHE
+        const arm_decoded_t *de;
+#endif
         int c;
         while (tubecycles>0)
         {
@@ -942,7 +991,12 @@ void arm_exec()
 #endif
                 if (flaglookup[opcode>>28][armregs[15]>>28])
                         {
+#ifdef USE_ARM_DECODE_CACHE
+                                de = arm_decode(PC - 8, opcode);
+                                switch (de->op)
+#else
                                 switch ((opcode>>20)&0xFF)
+#endif
                                 {
                                         case 0x00: /*AND reg*/
 //                                        if (((opcode&0xF0)==0x90)) /*MUL*/
@@ -2364,6 +2418,8 @@ void arm_exec()
                                         break;
                                 }
                         }
+                        else
+                                tubecycles--; /*A skipped instruction still takes a cycle*/
                         if (databort|armirq|tube_irq)
                         {
                                 if (databort==1)     /*Data abort*/
@@ -24,6 +24,21 @@
 #define PATH_MAX 512
 #endif
 
+/*
+ * State belonging to one emulated BBC.  When built with USE_MULTI_MACHINE
+ * each thread runs its own machine (see machine.c) so this state is
+ * thread-local; configuration and read-only tables stay shared.
+ */
+#ifdef USE_MULTI_MACHINE
+#ifdef __cplusplus
+#define MACHINE_LOCAL thread_local
+#else
+#define MACHINE_LOCAL _Thread_local
+#endif
+#else
+#define MACHINE_LOCAL
+#endif
+
 #ifdef _MSC_VER
 
 #define inline __inline
@@ -71,7 +86,7 @@ void cataddname(char *s);
 
 #endif
 
-extern int autoboot;
+extern MACHINE_LOCAL int autoboot;
 
 void redefinekeys(void);
 
@@ -9,7 +9,7 @@
 #define pico_const
 #endif
 
-static pico_const uint8_t teletext_characters[96*60]={
+static MACHINE_LOCAL pico_const uint8_t teletext_characters[96*60]={
   // 0x20 ' '
   0,0,0,0,0,0,
   0,0,0,0,0,0,
@@ -1071,7 +1071,7 @@ static pico_const uint8_t teletext_characters[96*60]={
 
 /* Graphics Character Set */
 
-static pico_const uint8_t teletext_graphics[96*60]={
+static MACHINE_LOCAL pico_const uint8_t teletext_graphics[96*60]={
   // 0x20
   0,0,0,0,0,0,
   0,0,0,0,0,0,
@@ -2132,7 +2132,7 @@ static pico_const uint8_t teletext_graphics[96*60]={
 
 /* Separated Graphics Character Set */
 
-static pico_const uint8_t teletext_separated_graphics[96*60]={
+static MACHINE_LOCAL pico_const uint8_t teletext_separated_graphics[96*60]={
   // Character ' ' (32)
   0,0,0,0,0,0,
   0,0,0,0,0,0,
@@ -20,19 +20,20 @@
 #include "model.h"
 #include "cmos.h"
 #include "compactcmos.h"
+#include "inputlog.h"
 #include <time.h>
 #ifdef PICO_BUILD
 #include "cmos.bin.inc"
 static_assert(sizeof(cmos) == 64, "");
 #else
-static uint8_t cmos[64];
+static MACHINE_LOCAL uint8_t cmos[64];
 #endif
 
-static int8_t cmos_old, cmos_addr, cmos_ena, cmos_rw;
-static time_t rtc_epoc_ref, rtc_epoc_adj, rtc_last;
-static struct tm rtc_tm;
+static MACHINE_LOCAL int8_t cmos_old, cmos_addr, cmos_ena, cmos_rw;
+static MACHINE_LOCAL time_t rtc_epoc_ref, rtc_epoc_adj, rtc_last;
+static MACHINE_LOCAL struct tm rtc_tm;
 
-static uint8_t cmos_data;
+static MACHINE_LOCAL uint8_t cmos_data;
 
 static inline uint8_t bcd2bin(uint8_t value) {
     return ((value >> 4) * 10) + (value & 0xf);
@@ -55,7 +56,8 @@ static uint8_t read_cmos_rtc(unsigned addr)
     time_t now;
     struct tm *tp;
 
-    time(&now);
+    if (!inputlog_time(&now))
+        time(&now);
     if (rtc_epoc_ref) {
         // The RTC has been set since it was last read so convert
         // the time components set back to seconds since an epoc.
@@ -162,6 +164,27 @@ uint8_t cmos_read()
     return 0xff;
 }
 
+#ifndef NO_USE_INPUT_LOG
+/* The CMOS RAM with the Epoch in the date/time fields, as it would be
+ * saved, so an input log can start each replay with the same RAM.
+ */
+void cmos_get_ram(uint8_t *ram)
+{
+    memcpy(ram, cmos, sizeof cmos);
+    ram[0] = rtc_epoc_adj & 0xff;
+    ram[2] = (rtc_epoc_adj >> 8) & 0xff;
+    ram[4] = (rtc_epoc_adj >> 16) & 0xff;
+    ram[6] = (rtc_epoc_adj >> 24) & 0xff;
+}
+
+void cmos_set_ram(const uint8_t *ram)
+{
+    memcpy(cmos, ram, sizeof cmos);
+    rtc_epoc_adj = cmos[0] | (cmos[2] << 8) | (cmos[4] << 16) | (cmos[6] << 24);
+    rtc_epoc_ref = rtc_last = 0;
+}
+#endif
+
 void cmos_load(MODEL m) {
 #ifndef PICO_BUILD
     FILE *f;
@@ -6,5 +6,9 @@ void cmos_writeaddr(uint8_t val);
 uint8_t cmos_read(void);
 void cmos_load(MODEL m);
 void cmos_save(MODEL m);
+#ifndef NO_USE_INPUT_LOG
+void cmos_get_ram(uint8_t *ram);
+void cmos_set_ram(const uint8_t *ram);
+#endif
 
 #endif
@@ -5,15 +5,15 @@
 #include "model.h"
 
 #ifndef NO_USE_COMPACT
-int i2c_clock = 1, i2c_data = 1;
+MACHINE_LOCAL int i2c_clock = 1, i2c_data = 1;
 
-static int cmos_state = 0;
-static int i2c_state = 0;
-static uint8_t i2c_byte;
-static int i2c_pos;
-static int i2c_transmit = -1;
+static MACHINE_LOCAL int cmos_state = 0;
+static MACHINE_LOCAL int i2c_state = 0;
+static MACHINE_LOCAL uint8_t i2c_byte;
+static MACHINE_LOCAL int i2c_pos;
+static MACHINE_LOCAL int i2c_transmit = -1;
 
-static int lastdata;
+static MACHINE_LOCAL int lastdata;
 
 #define CMOS 1
 #define ARM -1
@@ -29,10 +29,10 @@ static int lastdata;
 #define CMOS_RECIEVEDATA     2
 #define CMOS_SENDDATA        3
 
-static int cmos_rw;
+static MACHINE_LOCAL int cmos_rw;
 
-static uint8_t cmos_addr = 0;
-static uint8_t cmos_ram[256];
+static MACHINE_LOCAL uint8_t cmos_addr = 0;
+static MACHINE_LOCAL uint8_t cmos_ram[256];
 
 void compactcmos_load(MODEL m) {
     FILE *cmosf;
@@ -5,6 +5,6 @@ void compactcmos_load(MODEL m);
 void compactcmos_save(MODEL m);
 void compactcmos_i2cchange(int nuclock, int nudata);
 
-extern int i2c_clock, i2c_data;
+extern MACHINE_LOCAL int i2c_clock, i2c_data;
 
 #endif
@@ -5,11 +5,13 @@
 
 #include "b-em.h"
 
+#include "6502jit.h"
 #include "config.h"
 #include "ddnoise.h"
 #include "disc.h"
 #include "keyboard.h"
 #include "model.h"
+#include "rewind.h"
 #include "mouse.h"
 #include "ide.h"
 #include "midi.h"
@@ -17,12 +19,13 @@
 #include "sdf.h"
 #include "sn76489.h"
 #include "sound.h"
+#include "speedmeter.h"
 #include "tape.h"
 #include "tube.h"
 #include "vdfs.h"
 #include "video_render.h"
 
-int8_t curmodel;
+MACHINE_LOCAL int8_t curmodel;
 #ifndef NO_USE_TUBE
 int8_t selecttube = -1;
 #endif
@@ -136,11 +139,25 @@ void config_load(void)
 #ifndef NO_USE_DISC_WRITE
     defaultwriteprot = get_config_bool("disc", "defaultwriteprotect", 1);
 #endif
+    fastdisc         = get_config_bool("disc", "fastdisc", 0);
 
     curmodel         = get_config_int(NULL, "model",         3);
 #ifndef NO_USE_TUBE
     selecttube       = get_config_int(NULL, "tube",         -1);
     tube_speed_num   = get_config_int(NULL, "tubespeed",     0);
+#ifndef NO_USE_TUBE_THREAD
+    tube_threaded    = get_config_bool(NULL, "tubethread",   false);
+#endif
+#endif
+#ifndef NO_USE_JIT6502
+    jit6502_enabled  = get_config_bool(NULL, "jit",          false);
+#endif
+#ifndef NO_USE_REWIND
+    rewind_enabled   = get_config_bool(NULL, "rewind",       false);
+    rewind_frames    = get_config_int(NULL, "rewindframes",  10);
+    rewind_mb        = get_config_int(NULL, "rewindmb",      16);
+    if (rewind_frames < 1)
+        rewind_frames = 1;
 #endif
 
     sound_internal   = get_config_bool("sound", "sndinternal",   true);
@@ -179,6 +196,9 @@ void config_load(void)
         vid_pal = 1;
     }
     video_set_disptype(c);
+#ifndef NO_USE_SPEED_METER
+    speed_show       = get_config_bool("video", "showspeed",    0);
+#endif
 
 #ifndef NO_USE_TAPE
     fasttape         = get_config_bool("tape", "fasttape",      0);
@@ -212,6 +232,27 @@ void config_load(void)
 #endif
 }
 
+#ifdef USE_MULTI_MACHINE
+/*
+ * The settings config_load puts in machine-local variables, for a machine
+ * in a multi-machine run.  Discs and tape are left for its command line.
+ */
+void config_load_machine(void)
+{
+    int c;
+
+    curmodel         = get_config_int(NULL, "model",         3);
+    c                = get_config_int("video", "displaymode",   0);
+    if (c >= 4)
+        c -= 4;
+    video_set_disptype(c);
+#ifndef NO_USE_TAPE
+    fasttape         = get_config_bool("tape", "fasttape",      0);
+#endif
+    kbdips           = get_config_int(NULL, "kbdips", 0);
+}
+#endif
+
 #ifndef NO_USE_WRITABLE_CONFIG
 void set_config_int(const char *sect, const char *key, int value)
 {
@@ -268,6 +309,7 @@ void config_save(void)
 #ifndef NO_USE_DISC_WRITE
         set_config_bool("disc", "defaultwriteprotect", defaultwriteprot);
 #endif
+        set_config_bool("disc", "fastdisc", fastdisc);
 
 #ifndef NO_USE_TAPE
         if (tape_loaded)
@@ -280,6 +322,17 @@ void config_save(void)
 #ifndef NO_USE_TUBE
         set_config_int(NULL, "tube", selecttube);
         set_config_int(NULL, "tubespeed", tube_speed_num);
+#ifndef NO_USE_TUBE_THREAD
+        set_config_bool(NULL, "tubethread", tube_threaded);
+#endif
+#endif
+#ifndef NO_USE_JIT6502
+        set_config_bool(NULL, "jit", jit6502_enabled);
+#endif
+#ifndef NO_USE_REWIND
+        set_config_bool(NULL, "rewind", rewind_enabled);
+        set_config_int(NULL, "rewindframes", rewind_frames);
+        set_config_int(NULL, "rewindmb", rewind_mb);
 #endif
 
         set_config_bool("sound", "sndinternal", sound_internal);
@@ -305,6 +358,9 @@ void config_save(void)
         if (vid_pal)
             c += 4;
         set_config_int("video", "displaymode", c);
+#ifndef NO_USE_SPEED_METER
+        set_config_bool("video", "showspeed", speed_show);
+#endif
 
 #ifndef NO_USE_TAPE
         set_config_bool("tape", "fasttape", fasttape);
@@ -4,6 +4,9 @@
 extern ALLEGRO_CONFIG *bem_cfg;
 
 void config_load(void);
+#ifdef USE_MULTI_MACHINE
+void config_load_machine(void);
+#endif
 void config_save(void);
 
 int get_config_int(const char *sect, const char *key, int idefault);
@@ -19,7 +22,7 @@ static inline void set_config_bool(const char *sect, const char *key, bool value
 static inline void set_config_string(const char *sect, const char *key, const char *value) {}
 #endif
 
-extern int8_t curmodel;
+extern MACHINE_LOCAL int8_t curmodel;
 #ifndef NO_USE_TUBE
 extern int8_t selecttube;
 #endif
@@ -151,7 +151,8 @@ void ddnoise_seek(int len)
             // move this below so timing isn't different when sounds not found!
 //            fdc_time = 64000 * len;
         }
-        fdc_time = 64000 * len;
+        if (!fastdisc)
+            fdc_time = 64000 * len;
     }
     set_fdc_time(fdc_time);
     log_debug("ddnoise: begin seek, fdc_time=%d", fdc_time);
@@ -214,6 +214,7 @@ static inline void debug_cons_close(void) {}
 #include "video.h"
 #include "sn76489.h"
 #include "model.h"
+#include "rewind.h"
 
 void debug_kill()
 {
@@ -360,6 +361,9 @@ static const char helptext[] =
     "    r vidproc  - print VIDPROC registers\n"
     "    r sound    - print Sound registers\n"
     "    reset      - reset emulated machine\n"
+#ifndef NO_USE_REWIND
+    "    rewind [n] - step back n rewind snapshots, or list them if no n\n"
+#endif
     "    s [n]      - step n instructions (or 1 if no parameter)\n"
     "    trace fn   - trace disassembly/registers to file, close file if no fn\n"
     "    vrefresh t - extra video refresh on entering debugger.  t=on or off\n"
@@ -619,20 +623,34 @@ void debugger_do(cpu_debug_t *cpu, uint32_t addr)
                 if (!strcasecmp(cmd, "reset")) {
                     main_reset();
                     debug_outf("Emulator reset\n");
-                } else if (*iptr) {
+                }
+#ifndef NO_USE_REWIND
+                else if (!strcasecmp(cmd, "rewind")) {
+                    if (*iptr) {
+                        // the state is restored at the end of the frame.
+                        rewind_request(atoi(iptr));
+                        debug_lastcommand = 'c';
+                        indebug = 0;
+                        main_resume();
+                        return;
+                    }
+                    debug_outf("    %s\n", rewind_text());
+                }
+#endif
+                else if (*iptr) {
                     if (!strncasecmp(iptr, "sysvia", 6)) {
                         debug_outf("    System VIA registers :\n");
                         debug_outf("    ORA  %02X ORB  %02X IRA %02X IRB %02X\n", sysvia.ora, sysvia.orb, sysvia.ira, sysvia.irb);
                         debug_outf("    DDRA %02X DDRB %02X ACR %02X PCR %02X\n", sysvia.ddra, sysvia.ddrb, sysvia.acr, sysvia.pcr);
-                        debug_outf("    Timer 1 latch %04X   count %04X\n", sysvia.t1l / 2, (sysvia.t1c / 2) & 0xFFFF);
-                        debug_outf("    Timer 2 latch %04X   count %04X\n", sysvia.t2l / 2, (sysvia.t2c / 2) & 0xFFFF);
+                        debug_outf("    Timer 1 latch %04X   count %04X\n", sysvia.t1l / 2, (via_get_t1c(&sysvia) / 2) & 0xFFFF);
+                        debug_outf("    Timer 2 latch %04X   count %04X\n", sysvia.t2l / 2, (via_get_t2c(&sysvia) / 2) & 0xFFFF);
                         debug_outf("    IER %02X IFR %02X\n", sysvia.ier, sysvia.ifr);
                     } else if (!strncasecmp(iptr, "uservia", 7)) {
                         debug_outf("    User VIA registers :\n");
                         debug_outf("    ORA  %02X ORB  %02X IRA %02X IRB %02X\n", uservia.ora, uservia.orb, uservia.ira, uservia.irb);
                         debug_outf("    DDRA %02X DDRB %02X ACR %02X PCR %02X\n", uservia.ddra, uservia.ddrb, uservia.acr, uservia.pcr);
-                        debug_outf("    Timer 1 latch %04X   count %04X\n", uservia.t1l / 2, (uservia.t1c / 2) & 0xFFFF);
-                        debug_outf("    Timer 2 latch %04X   count %04X\n", uservia.t2l / 2, (uservia.t2c / 2) & 0xFFFF);
+                        debug_outf("    Timer 1 latch %04X   count %04X\n", uservia.t1l / 2, (via_get_t1c(&uservia) / 2) & 0xFFFF);
+                        debug_outf("    Timer 2 latch %04X   count %04X\n", uservia.t2l / 2, (via_get_t2c(&uservia) / 2) & 0xFFFF);
                         debug_outf("    IER %02X IFR %02X\n", uservia.ier, uservia.ifr);
                     } else if (!strncasecmp(iptr, "crtc", 4)) {
                         debug_outf("    CRTC registers :\n");
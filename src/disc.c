@@ -11,33 +11,41 @@
 
 #include "ddnoise.h"
 
-DRIVE drives[2];
+MACHINE_LOCAL DRIVE drives[2];
 
-int8_t curdrive = 0;
+MACHINE_LOCAL int8_t curdrive = 0;
 
-ALLEGRO_PATH *discfns[2] = { NULL, NULL };
+MACHINE_LOCAL ALLEGRO_PATH *discfns[2] = { NULL, NULL };
 #ifndef NO_USE_DISC_WRITE
 bool defaultwriteprot = false;
-int writeprot[NUM_DRIVES], fwriteprot[NUM_DRIVES];
+MACHINE_LOCAL int writeprot[NUM_DRIVES], fwriteprot[NUM_DRIVES];
 #endif
 
 #ifndef USE_HW_EVENT
-int fdc_time;
-int disc_time;
+MACHINE_LOCAL int fdc_time;
+MACHINE_LOCAL int disc_time;
 #endif
 
-int motorspin;
-bool motoron;
-
-void (*fdc_callback)();
-void (*fdc_data)(uint8_t dat);
-void (*fdc_spindown)();
-void (*fdc_finishread)();
-void (*fdc_notfound)();
-void (*fdc_datacrcerror)();
-void (*fdc_headercrcerror)();
-void (*fdc_writeprotect)();
-int  (*fdc_getdata)(int last);
+MACHINE_LOCAL int motorspin;
+MACHINE_LOCAL bool motoron;
+
+MACHINE_LOCAL void (*fdc_callback)();
+MACHINE_LOCAL void (*fdc_data)(uint8_t dat);
+MACHINE_LOCAL void (*fdc_spindown)();
+MACHINE_LOCAL void (*fdc_finishread)();
+MACHINE_LOCAL void (*fdc_notfound)();
+MACHINE_LOCAL void (*fdc_datacrcerror)();
+MACHINE_LOCAL void (*fdc_headercrcerror)();
+MACHINE_LOCAL void (*fdc_writeprotect)();
+MACHINE_LOCAL int  (*fdc_getdata)(int last);
+MACHINE_LOCAL bool (*fdc_drq)(void);
+
+/*
+ * Fast disc: transfer each byte as soon as the CPU has dealt with the last
+ * one rather than at the rate the disc turns, and don't wait for the head
+ * to move when seeking.
+ */
+MACHINE_LOCAL bool fastdisc = false;
 
 #ifndef USE_SECTOR_READ
 void disc_load(int drive, ALLEGRO_PATH *fn)
@@ -128,7 +136,7 @@ void disc_close(int drive)
 
 
 #ifndef USE_HW_EVENT
-static int disc_notfound=0;
+static MACHINE_LOCAL int disc_notfound=0;
 void set_disc_notfound(int cycles16) { disc_notfound = cycles16; }
 #else
 
@@ -137,7 +145,7 @@ bool invoke_disc_notfound(struct hw_event *event) {
     return false;
 }
 
-static struct hw_event disc_notfound_event = {
+static MACHINE_LOCAL struct hw_event disc_notfound_event = {
         .invoke = invoke_disc_notfound
 };
 
@@ -150,7 +158,7 @@ bool __time_critical_func(invoke_motorspin)(struct hw_event *event) {
     return false;
 }
 
-static struct hw_event motorspin_event = {
+static MACHINE_LOCAL struct hw_event motorspin_event = {
         .invoke = invoke_motorspin
 };
 
@@ -167,7 +175,7 @@ bool __time_critical_func(invoke_fdc)(struct hw_event *event) {
     return false;
 }
 
-static struct hw_event fdc_event = {
+static MACHINE_LOCAL struct hw_event fdc_event = {
         .invoke = invoke_fdc
 };
 
@@ -205,7 +213,7 @@ void __time_critical_func(disc_cycle_sync)(int drive) {
 }
 #endif
 
-int oldtrack[2] = {0, 0};
+MACHINE_LOCAL int oldtrack[2] = {0, 0};
 void __time_critical_func(disc_seek)(int drive, int track)
 {
         if (drives[drive].seek)
@@ -19,9 +19,9 @@ typedef struct
 #endif
 } DRIVE;
 
-extern DRIVE drives[NUM_DRIVES];
+extern MACHINE_LOCAL DRIVE drives[NUM_DRIVES];
 
-extern int8_t curdrive;
+extern MACHINE_LOCAL int8_t curdrive;
 
 void disc_load(int drive, ALLEGRO_PATH *fn);
 void disc_close(int drive);
@@ -36,19 +36,20 @@ void disc_abort(int drive);
 int disc_verify(int drive, int track, int density);
 void disc_cycle_sync(int drive);
 
-extern int disc_time;
+extern MACHINE_LOCAL int disc_time;
 
-extern void (*fdc_callback)(void);
-extern void (*fdc_data)(uint8_t dat);
-extern void (*fdc_spindown)(void);
-extern void (*fdc_finishread)(void);
-extern void (*fdc_notfound)(void);
-extern void (*fdc_datacrcerror)(void);
-extern void (*fdc_headercrcerror)(void);
-extern void (*fdc_writeprotect)(void);
-extern int  (*fdc_getdata)(int last);
+extern MACHINE_LOCAL void (*fdc_callback)(void);
+extern MACHINE_LOCAL void (*fdc_data)(uint8_t dat);
+extern MACHINE_LOCAL void (*fdc_spindown)(void);
+extern MACHINE_LOCAL void (*fdc_finishread)(void);
+extern MACHINE_LOCAL void (*fdc_notfound)(void);
+extern MACHINE_LOCAL void (*fdc_datacrcerror)(void);
+extern MACHINE_LOCAL void (*fdc_headercrcerror)(void);
+extern MACHINE_LOCAL void (*fdc_writeprotect)(void);
+extern MACHINE_LOCAL int  (*fdc_getdata)(int last);
+extern MACHINE_LOCAL bool (*fdc_drq)(void);
 #ifndef USE_HW_EVENT
-extern int fdc_time;
+extern MACHINE_LOCAL int fdc_time;
 static inline void set_fdc_time(int _fdc_time) {
     fdc_time = _fdc_time;
 }
@@ -57,16 +58,17 @@ extern void set_fdc_time(int fdc_time);
 #endif
 
 #ifndef USE_HW_EVENT
-extern int motorspin;
+extern MACHINE_LOCAL int motorspin;
 static inline void set_motorspin(int other_cycles) { motorspin = other_cycles; }
 #else
 extern void set_motorspin(int other_cycles);
 #endif
-extern bool motoron;
+extern MACHINE_LOCAL bool motoron;
 
 extern bool defaultwriteprot;
-extern ALLEGRO_PATH *discfns[NUM_DRIVES];
+extern MACHINE_LOCAL bool fastdisc;
+extern MACHINE_LOCAL ALLEGRO_PATH *discfns[NUM_DRIVES];
 
-extern int writeprot[NUM_DRIVES], fwriteprot[NUM_DRIVES];
+extern MACHINE_LOCAL int writeprot[NUM_DRIVES], fwriteprot[NUM_DRIVES];
 
 #endif
@@ -17,10 +17,12 @@
 #include "music5000.h"
 #include "savestate.h"
 #include "sid_b-em.h"
+#include "rewind.h"
 #include "scsi.h"
 #include "sdf.h"
 #include "sound.h"
 #include "sn76489.h"
+#include "speedmeter.h"
 #include "tape.h"
 #include "tapecat-allegro.h"
 #include "tube.h"
@@ -109,6 +111,10 @@ static ALLEGRO_MENU *create_file_menu(void)
     al_append_menu_item(menu, "Save Screenshot...", IDM_FILE_SCREEN_SHOT, 0, NULL, NULL);
     add_checkbox_item(menu, "Print to file", IDM_FILE_PRINT, prt_fp);
     add_checkbox_item(menu, "Record Music 5000 to file", IDM_FILE_M5000, music5000_fp);
+#endif
+#ifndef NO_USE_REWIND
+    add_checkbox_item(menu, "Keep rewind history", IDM_FILE_REWIND, rewind_enabled);
+    al_append_menu_item(menu, "Step back", IDM_FILE_STEP_BACK, 0, NULL, NULL);
 #endif
     al_append_menu_item(menu, "Exit", IDM_FILE_EXIT, 0, NULL, NULL);
     return menu;
@@ -160,6 +166,7 @@ static ALLEGRO_MENU *create_disc_menu(void)
     add_checkbox_item(menu, "Write protect disc :0/2", menu_id_num(IDM_DISC_WPROT, 0), writeprot[0]);
     add_checkbox_item(menu, "Write protect disc :1/3", menu_id_num(IDM_DISC_WPROT, 1), writeprot[1]);
     add_checkbox_item(menu, "Default write protect", IDM_DISC_WPROT_D, defaultwriteprot);
+    add_checkbox_item(menu, "Fast disc", IDM_DISC_FAST, fastdisc);
 #ifndef NO_USE_IDE
     add_checkbox_item(menu, "IDE hard disc", IDM_DISC_HARD_IDE, ide_enable);
 #endif
@@ -297,6 +304,9 @@ static ALLEGRO_MENU *create_tube_menu(void)
     for (i = 0; i < NUM_TUBE_SPEEDS; i++)
         add_radio_item(sub, tube_speeds[i].name, IDM_TUBE_SPEED, i, tube_speed_num);
     al_append_menu_item(menu, "Tube speed", 0, 0, NULL, sub);
+#ifndef NO_USE_TUBE_THREAD
+    add_checkbox_item(menu, "Run on own thread", IDM_TUBE_THREAD, tube_threaded);
+#endif
     return menu;
 }
 #endif
@@ -474,6 +484,12 @@ static ALLEGRO_MENU *create_speed_menu(void)
     for (i = 0; i < NUM_EMU_SPEEDS; i++)
         add_radio_item(menu, emu_speeds[i].name, IDM_SPEED, i, emuspeed);
     add_radio_item(menu, "Full-speed", IDM_SPEED, EMU_SPEED_FULL, emuspeed);
+#ifndef NO_USE_SPEED_METER
+    add_checkbox_item(menu, "Show speed", IDM_SPEED_SHOW, speed_show);
+#endif
+#ifndef NO_USE_JIT6502
+    add_checkbox_item(menu, "Translate 6502 code", IDM_SPEED_JIT, jit6502_enabled);
+#endif
     return menu;
 }
 
@@ -977,6 +993,14 @@ void gui_allegro_event(ALLEGRO_EVENT *event)
         case IDM_FILE_M5000:
             m5000_rec(event);
             break;
+#endif
+#ifndef NO_USE_REWIND
+        case IDM_FILE_REWIND:
+            rewind_enabled = !rewind_enabled;
+            break;
+        case IDM_FILE_STEP_BACK:
+            rewind_step(1);
+            break;
 #endif
         case IDM_FILE_EXIT:
             quitting = true;
@@ -1035,6 +1059,9 @@ void gui_allegro_event(ALLEGRO_EVENT *event)
         case IDM_DISC_WPROT_D:
             defaultwriteprot = !defaultwriteprot;
             break;
+        case IDM_DISC_FAST:
+            fastdisc = !fastdisc;
+            break;
 #ifndef NO_USE_IDE
         case IDM_DISC_HARD_IDE:
             disc_toggle_ide(event);
@@ -1090,6 +1117,11 @@ void gui_allegro_event(ALLEGRO_EVENT *event)
         case IDM_TUBE_SPEED:
             change_tube_speed(event);
             break;
+#ifndef NO_USE_TUBE_THREAD
+        case IDM_TUBE_THREAD:
+            tube_threaded = !tube_threaded;
+            break;
+#endif
 #endif
         case IDM_VIDEO_DISPTYPE:
             video_set_disptype(radio_event_simple(event, vid_dtype_user));
@@ -1190,6 +1222,18 @@ void gui_allegro_event(ALLEGRO_EVENT *event)
         case IDM_SPEED:
             main_setspeed(radio_event_simple(event, emuspeed));
             break;
+#ifndef NO_USE_SPEED_METER
+        case IDM_SPEED_SHOW:
+            speed_show = !speed_show;
+            break;
+#endif
+#ifndef NO_USE_JIT6502
+        case IDM_SPEED_JIT:
+            jit6502_enabled = !jit6502_enabled;
+            if (!jit6502_enabled)
+                jit6502_flush();
+            break;
+#endif
 #ifndef NO_USE_DEBUGGER
         case IDM_DEBUGGER:
             debug_toggle_core();
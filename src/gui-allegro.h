@@ -1,6 +1,9 @@
 #ifndef __INC_GUI_ALLEGRO_H
 #define __INC_GUI_ALLEGRO_H
 
+#include "6502jit.h"
+#include "rewind.h"
+
 typedef enum {
     IDM_ZERO,
     IDM_FILE_RESET,
@@ -10,6 +13,10 @@ typedef enum {
     IDM_FILE_SCREEN_SHOT,
     IDM_FILE_PRINT,
     IDM_FILE_M5000,
+#endif
+#ifndef NO_USE_REWIND
+    IDM_FILE_REWIND,
+    IDM_FILE_STEP_BACK,
 #endif
     IDM_FILE_EXIT,
     IDM_EDIT_PASTE,
@@ -34,6 +41,7 @@ typedef enum {
     IDM_DISC_NEW_DFS_18S_INT_80T,
     IDM_DISC_WPROT,
     IDM_DISC_WPROT_D,
+    IDM_DISC_FAST,
 #ifndef NO_USE_IDE
     IDM_DISC_HARD_IDE,
 #endif
@@ -57,6 +65,9 @@ typedef enum {
 #ifndef NO_USE_TUBE
     IDM_TUBE,
     IDM_TUBE_SPEED,
+#ifndef NO_USE_TUBE_THREAD
+    IDM_TUBE_THREAD,
+#endif
 #endif
     IDM_VIDEO_DISPTYPE,
     IDM_VIDEO_PAL,
@@ -101,6 +112,12 @@ typedef enum {
 #endif
     IDM_JOYMAP,
     IDM_SPEED,
+#ifndef NO_USE_SPEED_METER
+    IDM_SPEED_SHOW,
+#endif
+#ifndef NO_USE_JIT6502
+    IDM_SPEED_JIT,
+#endif
 #ifndef NO_USE_DEBUGGER
     IDM_DEBUGGER,
 #ifndef NO_USE_TUBE
@@ -0,0 +1,307 @@
+/*
+ * B-em hard disc I/O testing
+ *
+ * This program drives the SCSI and IDE hard disc emulation through
+ * their registers in place of ADFS.  It builds a scratch image for each,
+ * reads it back block by block and in multi-block commands, in order and
+ * scattered, writes scattered blocks, and checks every byte read and the
+ * images left behind against copies kept in memory.  It also reports the
+ * host time per 256 byte block for each pattern next to the time a bare
+ * fseek and fread of a block takes, which is the most a memory mapped
+ * image could save.
+ */
+
+#include "b-em.h"
+#include "6502.h"
+#include "ide.h"
+#include "scsi.h"
+
+#include <errno.h>
+#include <stdarg.h>
+
+#define BSIZE   256
+#define BLOCKS  40960           // a 10MB image.
+#define IMGSIZE (BLOCKS * BSIZE)
+#define MULTI   16              // blocks in each multi-block command.
+
+#define IDE_SPT 63              // the geometry ide_init gives the drive.
+#define IDE_HPC 16
+
+MACHINE_LOCAL int autoboot;
+
+static const char *scsi_fn = "hdio-test.dat";
+static const char *scsi_dsc = "hdio-test.dsc";
+static const char *ide_fn = "hdio-test.hdf";
+
+uint16_t get_pc(void) { return 0; }
+void interrupt_set_mask(uint mask) {}
+void interrupt_clr_mask(uint mask) {}
+
+// only scsi0 and hd4 are present, so the other drives are left empty.
+ALLEGRO_PATH *find_cfg_file(const char *name, const char *ext)
+{
+    if (!strcmp(name, "scsi/scsi0"))
+        return al_create_path(scsi_fn);
+    if (!strcmp(name, "hd4"))
+        return al_create_path(ide_fn);
+    return NULL;
+}
+
+ALLEGRO_PATH *find_cfg_dest(const char *name, const char *ext)
+{
+    return NULL;
+}
+
+void log_error(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    fputs("ERROR ", stderr);
+    vfprintf(stderr, fmt, ap);
+    putc('\n', stderr);
+    va_end(ap);
+}
+
+// warnings are for the drives left empty.
+void log_warn(const char *fmt, ...) {}
+void log_info(const char *fmt, ...) {}
+
+static uint8_t scsi_image[IMGSIZE];
+static uint8_t ide_image[IMGSIZE];
+static int mismatches;
+
+static uint32_t rng = 1;
+
+static uint32_t rnd(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return rng >> 8;
+}
+
+static bool make_image(const char *fn, uint8_t *image)
+{
+    FILE *fp;
+
+    for (int i = 0; i < IMGSIZE; i++)
+        image[i] = rnd();
+    if (!(fp = fopen(fn, "wb")) || fwrite(image, IMGSIZE, 1, fp) != 1 || fclose(fp)) {
+        fprintf(stderr, "hdio-test: unable to write %s: %s\n", fn, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool check_image(const char *fn, const uint8_t *image)
+{
+    uint8_t buf[BSIZE];
+    FILE *fp;
+
+    if (!(fp = fopen(fn, "rb"))) {
+        fprintf(stderr, "hdio-test: unable to read back %s: %s\n", fn, strerror(errno));
+        return false;
+    }
+    for (int i = 0; i < BLOCKS; i++)
+        if (fread(buf, BSIZE, 1, fp) != 1 || memcmp(buf, image + i * BSIZE, BSIZE))
+            mismatches++;
+    fclose(fp);
+    return true;
+}
+
+// Select lun 0 and send a six byte command, as ADFS does.
+static void scsi_command(int cmd, int block, int count)
+{
+    scsi_write(0, 0x01);
+    scsi_write(2, 0x01);
+    scsi_write(0, cmd);
+    scsi_write(0, (block >> 16) & 0x1f);
+    scsi_write(0, block >> 8);
+    scsi_write(0, block);
+    scsi_write(0, count);
+    scsi_write(0, 0);
+}
+
+static void scsi_status(void)
+{
+    if (scsi_read(0) != 0)  // status.
+        mismatches++;
+    scsi_read(0);           // message.
+}
+
+static void scsi_read_blocks(int block, int count)
+{
+    const uint8_t *ptr = scsi_image + block * BSIZE;
+
+    scsi_command(0x08, block, count);
+    for (int i = 0; i < count * BSIZE; i++)
+        if (scsi_read(0) != *ptr++)
+            mismatches++;
+    scsi_status();
+}
+
+static void scsi_write_blocks(int block, int count)
+{
+    uint8_t *ptr = scsi_image + block * BSIZE;
+
+    scsi_command(0x0a, block, count);
+    for (int i = 0; i < count * BSIZE; i++) {
+        *ptr = rnd();
+        scsi_write(0, *ptr++);
+    }
+    scsi_status();
+}
+
+// Run the command the drive is busy with, as the 6502 core does.
+static void ide_wait(void)
+{
+    while (ide_count) {
+        ide_count = 0;
+        ide_callback();
+    }
+}
+
+// Set up a transfer, which starts at CHS sector 1 so the offsets follow on.
+static int ide_command(int cmd, int block, int count)
+{
+    int sector = block % IDE_SPT;
+    int head = (block / IDE_SPT) % IDE_HPC;
+    int cyl = block / (IDE_SPT * IDE_HPC);
+
+    ide_write(2, count);
+    ide_write(3, sector + 1);
+    ide_write(4, cyl);
+    ide_write(5, cyl >> 8);
+    ide_write(6, head);
+    ide_write(7, cmd);
+    return block + 1;
+}
+
+static void ide_read_blocks(int block, int count)
+{
+    const uint8_t *ptr = ide_image + ide_command(0x20, block, count) * BSIZE;
+
+    for (int b = 0; b < count; b++) {
+        ide_wait();
+        if ((ide_read(7) & 0x01))
+            mismatches++;
+        for (int i = 0; i < BSIZE; i++)
+            if (ide_read(0) != *ptr++)
+                mismatches++;
+    }
+}
+
+static void ide_write_blocks(int block, int count)
+{
+    uint8_t *ptr = ide_image + ide_command(0x30, block, count) * BSIZE;
+
+    for (int b = 0; b < count; b++) {
+        for (int i = 0; i < BSIZE; i++) {
+            *ptr = rnd();
+            ide_write(0, *ptr++);
+        }
+        ide_wait();
+    }
+}
+
+// The IDE offsets start a block in, so leave room for the last one.
+#define LAST (BLOCKS - MULTI - 1)
+
+static void report(const char *what, double start, int blocks)
+{
+    printf("%-24s %8.0f ns/block\n", what, (al_get_time() - start) * 1e9 / blocks);
+}
+
+static void run(const char *name, void (*read_blocks)(int block, int count), void (*write_blocks)(int block, int count), int passes)
+{
+    char what[32];
+    double start;
+    int n = passes * BLOCKS / 4, blocks, count;
+
+    start = al_get_time();
+    for (int block = 0; block < n; block++)
+        read_blocks(block % LAST, 1);
+    snprintf(what, sizeof what, "%s read in order", name);
+    report(what, start, n);
+
+    start = al_get_time();
+    for (int i = 0; i < n / MULTI; i++)
+        read_blocks((i * MULTI) % LAST, MULTI);
+    snprintf(what, sizeof what, "%s read %d at a time", name, MULTI);
+    report(what, start, n / MULTI * MULTI);
+
+    start = al_get_time();
+    for (int i = 0; i < n; i++)
+        read_blocks(rnd() % LAST, 1);
+    snprintf(what, sizeof what, "%s read scattered", name);
+    report(what, start, n);
+
+    start = al_get_time();
+    for (blocks = 0; blocks < n / 4; blocks += count) {
+        count = 1 + rnd() % 4;
+        write_blocks(rnd() % LAST, count);
+    }
+    snprintf(what, sizeof what, "%s write scattered", name);
+    report(what, start, blocks);
+}
+
+int main(int argc, char **argv)
+{
+    int passes = 4;
+    double start;
+    uint8_t buf[BSIZE], geom[22] = {0};
+    FILE *fp;
+
+    if (argc > 1)
+        passes = atoi(argv[1]);
+    if (argc > 2 || passes <= 0) {
+        fputs("Usage: hdio-test [ <passes> ]\n", stderr);
+        return 1;
+    }
+    if (!make_image(scsi_fn, scsi_image) || !make_image(ide_fn, ide_image))
+        return 1;
+
+    // a geometry of 255 heads by 5 cylinders, which covers the image.
+    geom[13] = 0;
+    geom[14] = 5;
+    geom[15] = 255;
+    if (!(fp = fopen(scsi_dsc, "wb")) || fwrite(geom, sizeof geom, 1, fp) != 1 || fclose(fp)) {
+        fprintf(stderr, "hdio-test: unable to write %s: %s\n", scsi_dsc, strerror(errno));
+        return 1;
+    }
+
+    scsi_enabled = true;
+    scsi_init();
+    run("scsi", scsi_read_blocks, scsi_write_blocks, passes);
+    scsi_close();
+
+    ide_enable = true;
+    ide_init();
+    run("ide", ide_read_blocks, ide_write_blocks, passes);
+    ide_close();
+
+    if (!(fp = fopen(scsi_fn, "rb"))) {
+        fprintf(stderr, "hdio-test: unable to read back %s: %s\n", scsi_fn, strerror(errno));
+        return 1;
+    }
+    start = al_get_time();
+    for (int i = 0; i < passes * BLOCKS / 4; i++) {
+        fseek(fp, (rnd() % BLOCKS) * BSIZE, SEEK_SET);
+        if (fread(buf, BSIZE, 1, fp) != 1)
+            mismatches++;
+    }
+    report("bare fseek and fread", start, passes * BLOCKS / 4);
+    fclose(fp);
+
+    if (!check_image(scsi_fn, scsi_image) || !check_image(ide_fn, ide_image))
+        return 1;
+    remove(scsi_fn);
+    remove(ide_fn);
+    remove(scsi_dsc);
+
+    if (mismatches) {
+        printf("hdio-test: %d mismatches\n", mismatches);
+        return 1;
+    }
+    puts("hdio-test: all data matched");
+    return 0;
+}
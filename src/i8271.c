@@ -13,6 +13,7 @@
 #ifndef NO_USE_I8271
 void i8271_callback();
 void i8271_data(uint8_t dat);
+bool i8271_drq(void);
 void i8271_spindown();
 void i8271_finishread();
 void i8271_notfound();
@@ -21,8 +22,8 @@ void i8271_headercrcerror();
 void i8271_writeprotect();
 int  i8271_getdata(int last);
 
-static int bytenum;
-static int i8271_verify = 0;
+static MACHINE_LOCAL int bytenum;
+static MACHINE_LOCAL int i8271_verify = 0;
 
 // Output Port bit definitions in i8271.drvout
 #define SIDESEL   0x20
@@ -30,7 +31,7 @@ static int i8271_verify = 0;
 #define DRIVESEL1 0x80
 #define DRIVESEL (DRIVESEL0 | DRIVESEL1)
 
-struct
+MACHINE_LOCAL struct
 {
         uint8_t command, params[5];
         int paramnum, paramreq;
@@ -59,6 +60,7 @@ void i8271_reset()
                 fdc_headercrcerror = i8271_headercrcerror;
                 fdc_writeprotect   = i8271_writeprotect;
                 fdc_getdata        = i8271_getdata;
+                fdc_drq            = i8271_drq;
                 set_motorspin(45000);
         } else {
             set_motorspin(0);
@@ -482,6 +484,11 @@ void i8271_data(uint8_t dat)
         bytenum++;
 }
 
+bool i8271_drq(void)
+{
+        return i8271.status & 4;
+}
+
 void i8271_finishread()
 {
         set_fdc_time(200);
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include "b-em.h"
 #include "ide.h"
+#include "overlay.h"
 
 #ifndef NO_USE_IDE
 bool ide_enable;
@@ -38,7 +39,7 @@ static void ide_open_hd(int i, const char *name) {
     if (!hdfile[i]) {
         if ((path = find_cfg_file(name, ".hdf"))) {
             cpath = al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP);
-            if ((f = fopen(cpath, "rb+")))
+            if ((f = overlay_fopen(cpath)))
                 hdfile[i] = f;
             else
                 log_error("ide: unable to open hard disk file %s: %s", cpath, strerror(errno));
@@ -0,0 +1,368 @@
+/*B-em v2.2 by Tom Walker
+ * Pico version (C) 2021 Graham Sanderson
+ *
+ * Input recording and replay*/
+
+#include "b-em.h"
+#include "inputlog.h"
+#include "6502.h"
+#include "model.h"
+#include "cmos.h"
+#include "keyboard.h"
+#include "main.h"
+#include "mouse.h"
+#include <errno.h>
+#include <stdarg.h>
+
+#ifndef NO_USE_INPUT_LOG
+
+/*
+ * The log is a text file with one event per line, each preceded by the
+ * number of frames the machine had run when the event arrived.  Input
+ * is only taken between frames, so replaying each event just before
+ * the frame that followed it gives the machine exactly the input it had
+ * when the log was recorded.
+ *
+ * The first line records the machine and the time the recording began.
+ * While recording or replaying the Master's clock counts from that time
+ * at one second per 50 frames, and the first event sets the CMOS RAM to
+ * what it was when recording began, so the clock and configuration a
+ * program reads are the same on each replay.
+ */
+#define INPUTLOG_MAGIC   "b-em-input"
+#define INPUTLOG_VERSION 1
+#define FRAMES_PER_SEC   50
+#define CMOS_SIZE        64
+
+extern MACHINE_LOCAL int framesrun;
+
+typedef enum {
+    INPUTLOG_OFF,
+    INPUTLOG_RECORD,
+    INPUTLOG_REPLAY
+} inputlog_mode_t;
+
+static inputlog_mode_t mode;
+static FILE *ilog_fp;
+static const char *ilog_fn;
+static time_t ilog_epoch;
+static int ilog_model, ilog_tube;
+static bool started;        // the first frame has been seen.
+static bool applying;       // an event from the log is being replayed.
+
+static char *line;
+static size_t line_size;
+static int next_frame;      // frame of the next event, -1 at the end.
+static const char *next_ev; // rest of the line after the frame.
+
+static void record_event(const char *fmt, ...) printflike;
+
+static void record_event(const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(ilog_fp, "%d ", framesrun);
+    va_start(ap, fmt);
+    vfprintf(ilog_fp, fmt, ap);
+    va_end(ap);
+    putc('\n', ilog_fp);
+}
+
+static void record_hex(const char *name, const uint8_t *data, size_t len)
+{
+    fprintf(ilog_fp, "%d %s ", framesrun, name);
+    while (len--)
+        fprintf(ilog_fp, "%02x", *data++);
+    putc('\n', ilog_fp);
+}
+
+static void record_start(void)
+{
+    uint8_t ram[CMOS_SIZE];
+
+    fprintf(ilog_fp, "%s %d model=%d tube=%d time=%lld\n", INPUTLOG_MAGIC,
+            INPUTLOG_VERSION, curmodel, curtube, (long long)ilog_epoch);
+    cmos_get_ram(ram);
+    record_hex("cmos", ram, sizeof ram);
+    started = true;
+}
+
+bool inputlog_record(const char *fn)
+{
+    inputlog_close();
+    if (!(ilog_fp = fopen(fn, "w"))) {
+        log_error("inputlog: unable to open %s for writing: %s", fn, strerror(errno));
+        return false;
+    }
+    ilog_fn = fn;
+    time(&ilog_epoch);
+    started = false;
+    mode = INPUTLOG_RECORD;
+    log_info("inputlog: recording input to %s", fn);
+    return true;
+}
+
+static bool read_line(void)
+{
+    size_t len = 0;
+    int ch;
+
+    while ((ch = getc(ilog_fp)) != EOF && ch != '\n') {
+        if (len + 2 > line_size) {
+            size_t size = line_size ? line_size * 2 : 256;
+            char *new_line = realloc(line, size);
+            if (!new_line) {
+                log_error("inputlog: out of memory reading %s", ilog_fn);
+                return false;
+            }
+            line = new_line;
+            line_size = size;
+        }
+        line[len++] = ch;
+    }
+    if (ch == EOF && !len)
+        return false;
+    if (!line)
+        return true;
+    if (len && line[len-1] == '\r')
+        len--;
+    line[len] = 0;
+    return true;
+}
+
+static void read_event(void)
+{
+    int n;
+
+    while (read_line()) {
+        if (line && sscanf(line, "%d %n", &next_frame, &n) == 1) {
+            next_ev = line + n;
+            return;
+        }
+        if (line && *line && *line != '#')
+            log_warn("inputlog: %s: ignoring bad line '%s'", ilog_fn, line);
+    }
+    next_frame = -1;
+}
+
+bool inputlog_replay(const char *fn)
+{
+    int version;
+    long long epoch;
+
+    inputlog_close();
+    if (!(ilog_fp = fopen(fn, "r"))) {
+        log_error("inputlog: unable to open %s for reading: %s", fn, strerror(errno));
+        return false;
+    }
+    ilog_fn = fn;
+    if (!read_line() || !line || sscanf(line, INPUTLOG_MAGIC " %d model=%d tube=%d time=%lld", &version, &ilog_model, &ilog_tube, &epoch) != 4) {
+        log_error("inputlog: %s is not an input log", fn);
+        fclose(ilog_fp);
+        ilog_fp = NULL;
+        return false;
+    }
+    if (version != INPUTLOG_VERSION) {
+        log_error("inputlog: %s is version %d, only version %d is supported", fn, version, INPUTLOG_VERSION);
+        fclose(ilog_fp);
+        ilog_fp = NULL;
+        return false;
+    }
+    ilog_epoch = epoch;
+    started = false;
+    mode = INPUTLOG_REPLAY;
+    read_event();
+    log_info("inputlog: replaying input from %s", fn);
+    return true;
+}
+
+void inputlog_close(void)
+{
+    if (mode == INPUTLOG_RECORD) {
+        if (!started)
+            record_start();
+        record_event("end");
+        if (ferror(ilog_fp))
+            log_error("inputlog: error writing %s", ilog_fn);
+    }
+    if (ilog_fp) {
+        if (fclose(ilog_fp))
+            log_error("inputlog: error closing %s: %s", ilog_fn, strerror(errno));
+        ilog_fp = NULL;
+    }
+    mode = INPUTLOG_OFF;
+    if (line) {
+        free(line);
+        line = NULL;
+        line_size = 0;
+    }
+}
+
+bool inputlog_active(void)
+{
+    return mode != INPUTLOG_OFF;
+}
+
+bool inputlog_time(time_t *now)
+{
+    if (mode == INPUTLOG_OFF)
+        return false;
+    *now = ilog_epoch + framesrun / FRAMES_PER_SEC;
+    return true;
+}
+
+static size_t hex_decode(const char *hex, uint8_t *data, size_t max)
+{
+    size_t len = 0;
+    unsigned byte;
+
+    while (len < max && sscanf(hex, "%2x", &byte) == 1) {
+        data[len++] = byte;
+        hex += 2;
+    }
+    return len;
+}
+
+static void replay_paste(const char *hex)
+{
+    size_t max = strlen(hex) / 2;
+    char *str = malloc(max + 1);
+
+    if (!str) {
+        log_error("inputlog: out of memory replaying paste");
+        return;
+    }
+    str[hex_decode(hex, (uint8_t *)str, max)] = 0;
+    os_paste_start(str);
+}
+
+/* Apply one event from the log, returning false at the end. */
+
+static bool replay_event(const char *ev)
+{
+    char name[16];
+    int n, a, b;
+    double value;
+    uint8_t ram[CMOS_SIZE];
+
+    if (sscanf(ev, "%15s %n", name, &n) != 1) {
+        log_warn("inputlog: %s: missing event at frame %d", ilog_fn, next_frame);
+        return true;
+    }
+    ev += n;
+    applying = true;
+    if (!strcmp(name, "key") && sscanf(ev, "%d %d", &a, &b) == 2) {
+        if (b)
+            key_down(a);
+        else
+            key_up(a);
+    }
+    else if (!strcmp(name, "joyaxis") && sscanf(ev, "%d %lf", &a, &value) == 2 && a >= 0 && a < 4)
+        joyaxes[a] = value;
+    else if (!strcmp(name, "joybutton") && sscanf(ev, "%d %d", &a, &b) == 2 && a >= 0 && a < 2)
+        joybutton[a] = b;
+#ifndef NO_USE_MOUSE
+    else if (!strcmp(name, "mouse") && sscanf(ev, "%d %d", &a, &b) == 2)
+        mouse_move(a, b);
+    else if (!strcmp(name, "mousebutton") && sscanf(ev, "%d %d", &a, &b) == 2)
+        mouse_button(a, b);
+#endif
+    else if (!strcmp(name, "paste"))
+        replay_paste(ev);
+    else if (!strcmp(name, "break"))
+        main_break();
+    else if (!strcmp(name, "cmos") && hex_decode(ev, ram, sizeof ram) == sizeof ram)
+        cmos_set_ram(ram);
+    else if (!strcmp(name, "end")) {
+        applying = false;
+        return false;
+    }
+    else
+        log_warn("inputlog: %s: ignoring bad event '%s %s' at frame %d", ilog_fn, name, ev, next_frame);
+    applying = false;
+    return true;
+}
+
+bool inputlog_frame(void)
+{
+    if (mode == INPUTLOG_RECORD) {
+        if (!started)
+            record_start();
+        return true;
+    }
+    if (mode != INPUTLOG_REPLAY)
+        return true;
+
+    if (!started) {
+        if (ilog_model != curmodel || ilog_tube != curtube)
+            log_warn("inputlog: %s was recorded on model %d with tube %d, replaying on model %d with tube %d",
+                     ilog_fn, ilog_model, ilog_tube, curmodel, curtube);
+        started = true;
+    }
+    while (next_frame >= 0 && next_frame <= framesrun) {
+        if (!replay_event(next_ev))
+            break;
+        read_event();
+    }
+    if (next_frame >= 0 && next_frame > framesrun)
+        return true;
+    log_info("inputlog: replay of %s finished after %d frames", ilog_fn, framesrun);
+    inputlog_close();
+    return false;
+}
+
+static inline bool live_ok(void)
+{
+    return mode != INPUTLOG_REPLAY || applying;
+}
+
+bool inputlog_key(int code, bool down)
+{
+    if (mode == INPUTLOG_RECORD)
+        record_event("key %d %d", code, down);
+    return live_ok();
+}
+
+bool inputlog_joyaxis(int chan, float value)
+{
+    if (mode == INPUTLOG_RECORD)
+        record_event("joyaxis %d %.9g", chan, value);
+    return live_ok();
+}
+
+bool inputlog_joybutton(int num, bool down)
+{
+    if (mode == INPUTLOG_RECORD)
+        record_event("joybutton %d %d", num, down);
+    return live_ok();
+}
+
+bool inputlog_mouse_move(int dx, int dy)
+{
+    if (mode == INPUTLOG_RECORD)
+        record_event("mouse %d %d", dx, dy);
+    return live_ok();
+}
+
+bool inputlog_mouse_button(int button, bool down)
+{
+    if (mode == INPUTLOG_RECORD)
+        record_event("mousebutton %d %d", button, down);
+    return live_ok();
+}
+
+bool inputlog_paste(const char *str)
+{
+    if (mode == INPUTLOG_RECORD)
+        record_hex("paste", (const uint8_t *)str, strlen(str));
+    return live_ok();
+}
+
+bool inputlog_break(void)
+{
+    if (mode == INPUTLOG_RECORD)
+        record_event("break");
+    return live_ok();
+}
+
+#endif
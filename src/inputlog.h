@@ -0,0 +1,45 @@
+#ifndef __INC_INPUTLOG_H
+#define __INC_INPUTLOG_H
+
+#include <time.h>
+
+// a log is replayed into one machine per process so a batch cannot use it.
+#if (defined(USE_MULTI_MACHINE) || defined(PICO_BUILD)) && !defined(NO_USE_INPUT_LOG)
+#define NO_USE_INPUT_LOG
+#endif
+
+#ifndef NO_USE_INPUT_LOG
+bool inputlog_record(const char *fn);
+bool inputlog_replay(const char *fn);
+void inputlog_close(void);
+bool inputlog_frame(void);
+bool inputlog_active(void);
+bool inputlog_time(time_t *now);
+
+/*
+ * The input hooks are called with each event before it reaches the
+ * machine.  When recording they log the event, when replaying they
+ * drop live events so only those from the log get through.  An event
+ * should be acted on only if its hook returns true.
+ */
+bool inputlog_key(int code, bool down);
+bool inputlog_joyaxis(int chan, float value);
+bool inputlog_joybutton(int num, bool down);
+bool inputlog_mouse_move(int dx, int dy);
+bool inputlog_mouse_button(int button, bool down);
+bool inputlog_paste(const char *str);
+bool inputlog_break(void);
+#else
+static inline void inputlog_close(void) {}
+static inline bool inputlog_frame(void) { return true; }
+static inline bool inputlog_active(void) { return false; }
+static inline bool inputlog_time(time_t *now) { return false; }
+static inline bool inputlog_key(int code, bool down) { return true; }
+static inline bool inputlog_joyaxis(int chan, float value) { return true; }
+static inline bool inputlog_joybutton(int num, bool down) { return true; }
+static inline bool inputlog_mouse_move(int dx, int dy) { return true; }
+static inline bool inputlog_mouse_button(int button, bool down) { return true; }
+static inline bool inputlog_paste(const char *str) { return true; }
+static inline bool inputlog_break(void) { return true; }
+#endif
+#endif
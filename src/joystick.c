@@ -7,6 +7,7 @@
 #include "b-em.h"
 #include "config.h"
 #include "joystick.h"
+#include "inputlog.h"
 #include "keyboard.h"
 #include "keydef-allegro.h"
 #include <ctype.h>
@@ -349,8 +350,10 @@ void joystick_axis(ALLEGRO_EVENT *event)
                         value = -1.0;
                     else if (value > 1.0)
                         value = 1.0;
-                    if (axis->js_adc_chan)
-                        joyaxes[axis->js_adc_chan-1] = value;
+                    if (axis->js_adc_chan) {
+                        if (inputlog_joyaxis(axis->js_adc_chan-1, value))
+                            joyaxes[axis->js_adc_chan-1] = value;
+                    }
                     else
                         log_debug("joystick: unmapped axis %d", event->joystick.axis);
                     if (axis->js_nkey) {
@@ -387,7 +390,7 @@ static void joystick_button(ALLEGRO_EVENT *event, bool value, void (*key_func)(i
             if ((btn = js->js_btns)) {
                 if (event->joystick.button < js->num_butn) {
                     btn += event->joystick.button;
-                    if (btn->js_button)
+                    if (btn->js_button && inputlog_joybutton(btn->js_button-1, value))
                         joybutton[btn->js_button-1] = value;
                     if (btn->js_key)
                         key_func(btn->js_key);
@@ -1,6 +1,7 @@
 #include "b-em.h"
 #include "via.h"
 #include "sysvia.h"
+#include "inputlog.h"
 #include "keyboard.h"
 #include "model.h"
 
@@ -240,8 +241,8 @@ int keylookup[ALLEGRO_KEY_MAX];
 #endif
 bool keyas = 0;
 
-static int8_t keycol, keyrow;
-static uint16_t bbckey[16];
+static MACHINE_LOCAL int8_t keycol, keyrow;
+static MACHINE_LOCAL uint16_t bbckey[16];
 
 void key_clear(void)
 {
@@ -332,12 +333,14 @@ static void set_key(int code, int state)
 
 void key_down(int code)
 {
-    set_key(code, 1);
+    if (inputlog_key(code, true))
+        set_key(code, 1);
 }
 
 void key_up(int code)
 {
-    set_key(code, 0);
+    if (inputlog_key(code, false))
+        set_key(code, 0);
 }
 
 void key_scan(int row, int col) {
@@ -1,7 +1,7 @@
 #ifndef __INC_KEYBOARD_H
 #define __INC_KEYBOARD_H
 
-extern int kbdips;
+extern MACHINE_LOCAL int kbdips;
 
 extern int keylookup[ALLEGRO_KEY_MAX];
 extern bool keyas;
@@ -43,8 +43,8 @@ static FILE *log_fp;
 static const char log_section[]    = "logging";
 static const char log_default_fn[] = "b-emlog";
 
-static char   tmstr[20];
-static time_t last = 0;
+static MACHINE_LOCAL char   tmstr[20];
+static MACHINE_LOCAL time_t last = 0;
 #endif
 
 #ifndef NO_USE_ALLEGRO_GUI
@@ -0,0 +1,185 @@
+/*B-em v2.2 by Tom Walker
+ * Pico version (C) 2021 Graham Sanderson
+ *
+ * Multi-machine batch runs*/
+
+#include "b-em.h"
+#include "machine.h"
+#include "main.h"
+
+#ifdef USE_MULTI_MACHINE
+
+#include <ctype.h>
+#include <errno.h>
+
+#define MAX_BATCH_LINE 4096
+#define MAX_BATCH_ARGS 64
+
+/*
+ * Setting up and closing a machine touches shared configuration and
+ * the shared OS images so only one machine does either at a time; the
+ * emulation itself runs in parallel.
+ */
+static ALLEGRO_MUTEX *machine_lock;
+static ALLEGRO_COND  *machine_done;
+static int machines_running;
+
+static void *machine_thread(ALLEGRO_THREAD *thread, void *data)
+{
+    bem_machine *m = data;
+
+    al_lock_mutex(machine_lock);
+    log_debug("machine: line %d starting", m->line);
+    main_init_machine(m->argc, m->argv, &m->headless);
+    al_unlock_mutex(machine_lock);
+
+    m->frames = main_run_headless(&m->headless);
+
+    al_lock_mutex(machine_lock);
+    main_close_machine();
+    log_info("machine: line %d stopped after %d frames", m->line, m->frames);
+    machines_running--;
+    al_broadcast_cond(machine_done);
+    al_unlock_mutex(machine_lock);
+    return NULL;
+}
+
+static bool machine_setup(void)
+{
+    if (!machine_lock) {
+        if (!(machine_lock = al_create_mutex()))
+            return false;
+        if (!(machine_done = al_create_cond())) {
+            al_destroy_mutex(machine_lock);
+            machine_lock = NULL;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool bem_machine_start(bem_machine *m)
+{
+    if (!machine_setup()) {
+        log_error("machine: unable to create machine lock");
+        return false;
+    }
+    if (!(m->thread = al_create_thread(machine_thread, m))) {
+        log_error("machine: unable to create thread for line %d", m->line);
+        return false;
+    }
+    al_lock_mutex(machine_lock);
+    machines_running++;
+    al_unlock_mutex(machine_lock);
+    al_start_thread(m->thread);
+    return true;
+}
+
+void bem_machine_join(bem_machine *m)
+{
+    if (m->thread) {
+        al_join_thread(m->thread, NULL);
+        al_destroy_thread(m->thread);
+        m->thread = NULL;
+    }
+}
+
+static bool parse_line(bem_machine *m, char *line)
+{
+    char **argv, *p;
+    int argc = 1;
+
+    if (!(argv = malloc(MAX_BATCH_ARGS * sizeof(char *))))
+        return false;
+    argv[0] = "b-em";
+    for (p = line; *p; ) {
+        while (isspace((unsigned char)*p))
+            *p++ = '\0';
+        if (!*p)
+            break;
+        if (argc == MAX_BATCH_ARGS - 1) {
+            log_warn("machine: line %d has too many arguments, ignoring the rest", m->line);
+            break;
+        }
+        argv[argc++] = p;
+        while (*p && !isspace((unsigned char)*p))
+            p++;
+    }
+    argv[argc] = NULL;
+    m->argc = argc;
+    m->argv = argv;
+    return true;
+}
+
+/*
+ * Run one headless machine for each line of the batch file fn, each line
+ * holding the command line options for that machine.  Blank lines and
+ * lines starting with # are ignored.  At most jobs machines run at once,
+ * by default one per CPU.
+ */
+int machine_run_batch(const char *fn, int jobs)
+{
+    FILE *fp;
+    char buf[MAX_BATCH_LINE], *line;
+    bem_machine *machines = NULL, *m;
+    int count = 0, alloc = 0, lineno = 0, next, failed = 0;
+    double start;
+
+    if (!(fp = fopen(fn, "r"))) {
+        log_error("machine: unable to open batch file %s: %s", fn, strerror(errno));
+        return 1;
+    }
+    while (fgets(buf, sizeof buf, fp)) {
+        lineno++;
+        for (line = buf; isspace((unsigned char)*line); line++)
+            ;
+        if (!*line || *line == '#')
+            continue;
+        if (count == alloc) {
+            alloc = alloc ? alloc * 2 : 16;
+            if (!(m = realloc(machines, alloc * sizeof(bem_machine)))) {
+                log_error("machine: out of memory reading %s", fn);
+                break;
+            }
+            machines = m;
+        }
+        m = machines + count;
+        memset(m, 0, sizeof(bem_machine));
+        m->line = lineno;
+        if (!(m->cmdline = strdup(line)) || !parse_line(m, m->cmdline)) {
+            log_error("machine: out of memory reading %s", fn);
+            break;
+        }
+        count++;
+    }
+    fclose(fp);
+
+    if (jobs <= 0)
+        jobs = al_get_cpu_count();
+    if (jobs <= 0)
+        jobs = 1;
+    log_info("machine: running %d machines from %s, %d at a time", count, fn, jobs);
+
+    start = al_get_time();
+    for (next = 0; next < count; next++) {
+        if (machine_setup()) {
+            al_lock_mutex(machine_lock);
+            while (machines_running >= jobs)
+                al_wait_cond(machine_done, machine_lock);
+            al_unlock_mutex(machine_lock);
+        }
+        if (!bem_machine_start(machines + next))
+            failed++;
+    }
+    for (next = 0; next < count; next++) {
+        m = machines + next;
+        bem_machine_join(m);
+        free(m->cmdline);
+        free(m->argv);
+    }
+    log_info("machine: batch of %d machines finished in %.2fs", count, al_get_time() - start);
+    free(machines);
+    return failed;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __INC_MACHINE_H
+#define __INC_MACHINE_H
+
+#ifdef USE_MULTI_MACHINE
+
+#include "main.h"
+
+/*
+ * One BBC of a multi-machine run.  Each machine runs headless on its own
+ * thread and is configured by its own command line, exactly as for a
+ * single headless run.  What is kept here belongs to the machine; the
+ * rest of its state (see MACHINE_LOCAL in b-em.h) is thread-local, so
+ * a machine lives and dies on the thread it was started on and cannot
+ * be moved to another or run a slice at a time from a pool.
+ */
+typedef struct bem_machine {
+    int argc;
+    char **argv;
+    char *cmdline;              // storage the arguments point into
+    int line;                   // line of the batch file, for messages
+    headless_opts_t headless;   // its -frames and output options
+    int frames;                 // frames run once the machine has stopped
+    ALLEGRO_THREAD *thread;
+} bem_machine;
+
+bool bem_machine_start(bem_machine *m);
+void bem_machine_join(bem_machine *m);
+
+int machine_run_batch(const char *fn, int jobs);
+
+#endif
+#endif
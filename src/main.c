@@ -11,6 +11,7 @@
 #include <allegro5/allegro_primitives.h>
 
 #include "6502.h"
+#include "6502jit.h"
 #include "adc.h"
 #include "model.h"
 #include "cmos.h"
@@ -23,6 +24,7 @@
 #include "gui-allegro.h"
 #include "i8271.h"
 #include "ide.h"
+#include "inputlog.h"
 #include "joystick.h"
 #include "keyboard.h"
 #include "keydef-allegro.h"
@@ -33,7 +35,9 @@
 #include "midi.h"
 #include "music4000.h"
 #include "music5000.h"
+#include "overlay.h"
 #include "pal.h"
+#include "rewind.h"
 #include "savestate.h"
 #include "scsi.h"
 #include "sdf.h"
@@ -41,6 +45,7 @@
 #include "sid_b-em.h"
 #include "sn76489.h"
 #include "sound.h"
+#include "speedmeter.h"
 #include "sysacia.h"
 #include "tape.h"
 #include "tapecat-allegro.h"
@@ -61,6 +66,7 @@
 #include "arm.h"
 #include "x86_tube.h"
 #include "z80.h"
+#include "machine.h"
 
 #ifdef USE_SECTOR_READ
 #include "sector_read.h"
@@ -79,7 +85,7 @@
 #endif
 
 bool quitting = false;
-int autoboot=0;
+MACHINE_LOCAL int autoboot=0;
 int joybutton[2];
 float joyaxes[4];
 #ifndef NO_USE_SET_SPEED
@@ -96,10 +102,21 @@ typedef enum {
     FSPEED_RUNNING
 } fspeed_type_t;
 
+static headless_opts_t headless_opts;
+
 #ifndef PICO_BUILD
 static double time_limit;
-static int fcount = 0;
+static MACHINE_LOCAL int fcount = 0;
 static fspeed_type_t fullspeed = FSPEED_NONE;
+
+bool headless = false;
+#ifndef NO_USE_SPEED_METER
+static bool speed_print = false;
+#endif
+#ifdef USE_MULTI_MACHINE
+static const char *batch_fn;
+static int batch_jobs;
+#endif
 #else
 #define fullspeed FSPEED_NONE
 #endif
@@ -169,10 +186,21 @@ static const char helptext[] =
 #endif
 #ifndef NO_USE_TUBE
     "-tx             - start with tube x (see readme.txt for tubes)\n"
+#ifndef NO_USE_TUBE_THREAD
+    "-tubethread     - run the tube processor on a thread of its own\n"
+#endif
+#endif
+#ifndef NO_USE_JIT6502
+    "-jit            - translate 6502 code to host code as it is run\n"
 #endif
     "-disc disc.ssd  - load disc.ssd into drives :0/:2\n"
     "-disc1 disc.ssd - load disc.ssd into drives :1/:3\n"
     "-autoboot       - boot disc in drive :0\n"
+    "-fastdisc       - transfer disc data as fast as the CPU takes it\n"
+#ifndef NO_USE_DISC_WRITE
+    "-overlay        - keep writes to disc images in memory, discarded on exit\n"
+    "-overlaydir dir - as -overlay, but keep the writes in dir between runs\n"
+#endif
 #ifndef NO_USE_TAPE
     "-tape tape.uef  - load tape.uef\n"
     "-fasttape       - set tape speed to fast\n"
@@ -185,11 +213,36 @@ static const char helptext[] =
 #endif
 #ifndef NO_USE_TUBE
     "-debugtube      - start debugging tube processor\n"
+#endif
+#ifndef PICO_BUILD
+    "-headless       - run without display, sound or keyboard at full speed\n"
+    "-frames n       - stop a headless run after n frames (50 per second)\n"
+#ifndef USE_PICO_CPU
+    "-exitpc addr    - stop a headless run when the 6502 reaches hex addr\n"
+#endif
+    "-dumpscreen f   - write the final frame to f (PPM) after a headless run\n"
+    "-dumpaudio f    - record internal sound to f (WAV) during a headless run\n"
+    "-dumpmem f      - write the 64K RAM to f after a headless run\n"
+    "-checksum       - print checksums of the final frame and RAM after a headless run\n"
+#ifndef NO_USE_SPEED_METER
+    "-speed          - show the speed meter and print a full-speed report at exit\n"
+#endif
+#ifndef NO_USE_REWIND
+    "-rewind         - keep a history of snapshots to step back through\n"
+#endif
+#ifndef NO_USE_INPUT_LOG
+    "-recordinput f  - record keyboard, joystick, mouse and paste input to f\n"
+    "-replayinput f  - replay the input recorded in f, ignoring live input\n"
+#endif
+#ifdef USE_MULTI_MACHINE
+    "-batch f        - run one headless machine per line of f, in parallel\n"
+    "-jobs n         - run at most n machines of a batch at once\n"
+#endif
 #endif
     "\n";
 #endif
 
-void main_init(int argc, char *argv[])
+static void main_parse_args(int argc, char *argv[], headless_opts_t *opts)
 {
 #ifndef NO_USE_CMD_LINE
     int c;
@@ -197,29 +250,7 @@ void main_init(int argc, char *argv[])
     int tapenext = 0;
 #endif
     int discnext = 0;
-#endif
-    ALLEGRO_DISPLAY *display;
-
-    if (!al_init()) {
-#ifndef PICO_BUILD
-        fputs("Failed to initialise Allegro!\n", stderr);
-#endif
-        exit(1);
-    }
-
-#ifndef NO_USE_ALLEGRO_GUI
-    al_init_native_dialog_addon();
-    al_set_new_window_title(VERSION_STR);
-    al_init_primitives_addon();
-#endif
-
-    config_load();
-    log_open();
-    log_info("main: starting %s", VERSION_STR);
-
-    model_loadcfg();
 
-#ifndef NO_USE_CMD_LINE
     for (c = 1; c < argc; c++) {
         if (!strcasecmp(argv[c], "--help")) {
             fwrite(helptext, sizeof helptext - 1, 1, stdout);
@@ -240,7 +271,15 @@ void main_init(int argc, char *argv[])
             curmodel = tmp;
         }
 #endif
+#ifndef NO_USE_JIT6502
+        else if (!strcasecmp(argv[c], "-jit"))
+            jit6502_enabled = true;
+#endif
 #ifndef NO_USE_TUBE
+#ifndef NO_USE_TUBE_THREAD
+        else if (!strcasecmp(argv[c], "-tubethread"))
+            tube_threaded = true;
+#endif
         else if (argv[c][0] == '-' && (argv[c][1] == 't' || argv[c][1] == 'T')) {
             int tmp;
             sscanf(&argv[c][2], "%i", &tmp);
@@ -253,6 +292,54 @@ void main_init(int argc, char *argv[])
 #endif
         else if (!strcasecmp(argv[c], "-autoboot"))
             autoboot = 150;
+        else if (!strcasecmp(argv[c], "-fastdisc"))
+            fastdisc = true;
+#ifndef NO_USE_DISC_WRITE
+        else if (!strcasecmp(argv[c], "-overlay"))
+            overlay_enabled = true;
+        else if (!strcasecmp(argv[c], "-overlaydir") && c + 1 < argc) {
+            overlay_dir = argv[++c];
+            overlay_enabled = true;
+        }
+#endif
+#ifndef PICO_BUILD
+        else if (!strcasecmp(argv[c], "-headless"))
+            headless = true;
+        else if (!strcasecmp(argv[c], "-frames") && c + 1 < argc)
+            opts->frames = atoi(argv[++c]);
+#ifndef USE_PICO_CPU
+        else if (!strcasecmp(argv[c], "-exitpc") && c + 1 < argc)
+            m6502_exit_pc = strtol(argv[++c], NULL, 16) & 0xffff;
+#endif
+        else if (!strcasecmp(argv[c], "-dumpscreen") && c + 1 < argc)
+            opts->screen_fn = argv[++c];
+        else if (!strcasecmp(argv[c], "-dumpaudio") && c + 1 < argc)
+            opts->audio_fn = argv[++c];
+        else if (!strcasecmp(argv[c], "-dumpmem") && c + 1 < argc)
+            opts->mem_fn = argv[++c];
+        else if (!strcasecmp(argv[c], "-checksum"))
+            opts->checksum = true;
+#ifndef NO_USE_SPEED_METER
+        else if (!strcasecmp(argv[c], "-speed"))
+            speed_show = speed_print = true;
+#endif
+#ifndef NO_USE_REWIND
+        else if (!strcasecmp(argv[c], "-rewind"))
+            rewind_enabled = true;
+#endif
+#ifndef NO_USE_INPUT_LOG
+        else if (!strcasecmp(argv[c], "-recordinput") && c + 1 < argc)
+            inputlog_record(argv[++c]);
+        else if (!strcasecmp(argv[c], "-replayinput") && c + 1 < argc)
+            inputlog_replay(argv[++c]);
+#endif
+#ifdef USE_MULTI_MACHINE
+        else if (!strcasecmp(argv[c], "-batch") && c + 1 < argc)
+            batch_fn = argv[++c];
+        else if (!strcasecmp(argv[c], "-jobs") && c + 1 < argc)
+            batch_jobs = atoi(argv[++c]);
+#endif
+#endif
 #ifndef NO_USE_ALLEGRO_GUI
         else if (argv[c][0] == '-' && (argv[c][1] == 'f' || argv[c][1]=='F')) {
             sscanf(&argv[c][2], "%i", &vid_fskipmax);
@@ -317,6 +404,79 @@ void main_init(int argc, char *argv[])
         if (tapenext) tapenext--;
 #endif
     }
+#if !defined(PICO_BUILD) && !defined(USE_PICO_CPU)
+    // the core stops at the exit address, so only a headless run can end there.
+    if (m6502_exit_pc >= 0 && !headless) {
+        log_fatal("main: -exitpc can only be used with -headless");
+        exit(1);
+    }
+#endif
+#endif
+}
+
+static void main_load_media(void)
+{
+#if !defined(USE_SECTOR_READ)
+#ifndef NO_USE_MMB
+    if (mmb_fn)
+        mmb_load(mmb_fn);
+    else
+        disc_load(0, discfns[0]);
+#else
+    disc_load(0, discfns[0]);
+#endif
+    disc_load(1, discfns[1]);
+#else
+#ifndef NO_USE_CMD_LINE
+    disc_load(0, discfns[0]);
+#endif
+    // noop dic should be loaded by menu init
+#endif
+#ifndef NO_USE_TAPE
+    tape_load(tape_fn);
+#endif
+#ifndef NO_USE_DISC_WRITE
+    if (defaultwriteprot)
+        writeprot[0] = writeprot[1] = 1;
+    if (!headless) {
+        if (discfns[0])
+            gui_set_disc_wprot(0, writeprot[0]);
+        if (discfns[1])
+            gui_set_disc_wprot(1, writeprot[1]);
+    }
+#endif
+}
+
+void main_init(int argc, char *argv[])
+{
+    ALLEGRO_DISPLAY *display;
+
+    if (!al_init()) {
+#ifndef PICO_BUILD
+        fputs("Failed to initialise Allegro!\n", stderr);
+#endif
+        exit(1);
+    }
+
+#ifndef NO_USE_ALLEGRO_GUI
+    al_init_native_dialog_addon();
+    al_set_new_window_title(VERSION_STR);
+    al_init_primitives_addon();
+#endif
+
+    config_load();
+    log_open();
+    log_info("main: starting %s", VERSION_STR);
+
+    model_loadcfg();
+
+    main_parse_args(argc, argv, &headless_opts);
+#ifdef USE_MULTI_MACHINE
+    if (batch_fn) {
+        // each machine of the batch is set up by its own thread.
+        headless = true;
+        return;
+    }
 #endif
 
     display = video_init();
@@ -333,34 +493,42 @@ void main_init(int argc, char *argv[])
         log_fatal("main: unable to create event queue");
         exit(1);
     }
-    al_register_event_source(queue, al_get_display_event_source(display));
+    if (!headless) {
+        al_register_event_source(queue, al_get_display_event_source(display));
 
-    if (!al_install_audio()) {
-        log_fatal("main: unable to initialise audio");
-        exit(1);
-    }
-    if (!al_reserve_samples(3)) {
-        log_fatal("main: unable to reserve audio samples");
-        exit(1);
-    }
-    if (!al_init_acodec_addon()) {
-        log_fatal("main: unable to initialise audio codecs");
-        exit(1);
-    }
+        if (!al_install_audio()) {
+            log_fatal("main: unable to initialise audio");
+            exit(1);
+        }
+        if (!al_reserve_samples(3)) {
+            log_fatal("main: unable to reserve audio samples");
+            exit(1);
+        }
+        if (!al_init_acodec_addon()) {
+            log_fatal("main: unable to initialise audio codecs");
+            exit(1);
+        }
 
-    sound_init();
+        sound_init();
+    }
 #ifndef NO_USE_SID
     sid_init();
     sid_settype(sidmethod, cursid);
 #endif
+    if (!headless) {
 #ifndef NO_USE_MUSIC5000
-    music5000_init(queue);
+        music5000_init(queue);
 #endif
 #ifndef NO_USE_DD_NOISE
-    ddnoise_init();
+        ddnoise_init();
 #endif
 #ifndef NO_USE_TAPE
-    tapenoise_init(queue);
+        tapenoise_init(queue);
+#endif
+    }
+#ifndef PICO_BUILD
+    else if (headless_opts.audio_fn)
+        sound_rec_start(headless_opts.audio_fn);
 #endif
 
 #ifndef NO_USE_ADC
@@ -388,64 +556,40 @@ void main_init(int argc, char *argv[])
     midi_init();
     main_reset();
 
+    if (!headless) {
 #ifndef NO_USE_JOYSTICK
-    joystick_init(queue);
+        joystick_init(queue);
 #endif
 
 #ifndef NO_USE_ALLEGRO_GUI
-    gui_allegro_init(queue, display);
+        gui_allegro_init(queue, display);
 #endif
 
 #ifndef PICO_BUILD
-    time_limit = 2.0 / 50.0;
-    if (!(timer = al_create_timer(1.0 / 50.0))) {
-        log_fatal("main: unable to create timer");
-        exit(1);
-    }
+        time_limit = 2.0 / 50.0;
+        if (!(timer = al_create_timer(1.0 / 50.0))) {
+            log_fatal("main: unable to create timer");
+            exit(1);
+        }
 #endif
-    al_register_event_source(queue, al_get_timer_event_source(timer));
-    al_init_user_event_source(&evsrc);
-    al_register_event_source(queue, &evsrc);
+        al_register_event_source(queue, al_get_timer_event_source(timer));
+        al_init_user_event_source(&evsrc);
+        al_register_event_source(queue, &evsrc);
 
-    if (!al_install_keyboard()) {
-        log_fatal("main: unable to install keyboard");
-        exit(1);
-    }
-    al_register_event_source(queue, al_get_keyboard_event_source());
-
-    oldmodel = curmodel;
+        if (!al_install_keyboard()) {
+            log_fatal("main: unable to install keyboard");
+            exit(1);
+        }
+        al_register_event_source(queue, al_get_keyboard_event_source());
 
 #ifndef NO_USE_MOUSE
-    al_install_mouse();
-    al_register_event_source(queue, al_get_mouse_event_source());
-#endif
-#if !defined(USE_SECTOR_READ)
-#ifndef NO_USE_MMB
-    if (mmb_fn)
-        mmb_load(mmb_fn);
-    else
-        disc_load(0, discfns[0]);
-#else
-    disc_load(0, discfns[0]);
-#endif
-    disc_load(1, discfns[1]);
-#else
-#ifndef NO_USE_CMD_LINE
-    disc_load(0, discfns[0]);
-#endif
-    // noop dic should be loaded by menu init
-#endif
-#ifndef NO_USE_TAPE
-    tape_load(tape_fn);
-#endif
-#ifndef NO_USE_DISC_WRITE
-    if (defaultwriteprot)
-        writeprot[0] = writeprot[1] = 1;
-    if (discfns[0])
-        gui_set_disc_wprot(0, writeprot[0]);
-    if (discfns[1])
-        gui_set_disc_wprot(1, writeprot[1]);
+        al_install_mouse();
+        al_register_event_source(queue, al_get_mouse_event_source());
 #endif
+    }
+
+    oldmodel = curmodel;
+    main_load_media();
 #ifndef NO_USE_DEBUGGER
     debug_start();
 #endif
@@ -459,13 +603,14 @@ void main_restart()
     cmos_save(models[oldmodel]);
 #endif
 
+    rewind_clear();
     model_init();
     main_reset();
     main_resume();
 }
 
-int resetting = 0;
-int framesrun = 0;
+MACHINE_LOCAL int resetting = 0;
+MACHINE_LOCAL int framesrun = 0;
 
 #ifndef PICO_BUILD
 void main_cleardrawit()
@@ -487,6 +632,29 @@ static void main_start_fullspeed(void)
 }
 #endif
 
+void main_break(void)
+{
+    if (!inputlog_break())
+        return;
+    m6502_reset();
+    video_reset();
+#ifndef NO_USE_I8271
+    i8271_reset();
+#endif
+    wd1770_reset();
+#ifndef NO_USE_SID
+    sid_reset();
+#endif
+#ifndef NO_USE_MUSIC5000
+    music5000_reset();
+#endif
+#ifndef NO_USE_TUBE
+    if (curtube != -1)
+        tubes[curtube].reset();
+    tube_reset();
+#endif
+}
+
 void main_key_down(ALLEGRO_EVENT *event)
 {
     int code = key_map(event);
@@ -536,23 +704,7 @@ void main_key_down(ALLEGRO_EVENT *event)
 #endif
         case ALLEGRO_KEY_F12:
         case ALLEGRO_KEY_PRINTSCREEN:
-            m6502_reset();
-            video_reset();
-#ifndef NO_USE_I8271
-            i8271_reset();
-#endif
-            wd1770_reset();
-#ifndef NO_USE_SID
-            sid_reset();
-#endif
-#ifndef NO_USE_MUSIC5000
-            music5000_reset();
-#endif
-#ifndef NO_USE_TUBE
-            if (curtube != -1)
-                tubes[curtube].reset();
-            tube_reset();
-#endif
+            main_break();
             break;
         default:
 #ifndef NO_USE_SET_SPEED
@@ -607,37 +759,116 @@ static bool event_delay_ok(ALLEGRO_EVENT *event) {
 }
 #endif
 
-static void main_timer(ALLEGRO_EVENT *event)
+static void main_exec_frame(void)
 {
-    if (event_delay_ok(event)) {
-        if (autoboot)
-            autoboot--;
-        framesrun++;
+    speed_sect_t sect;
 
-        if (x65c02)
-            m65c02_exec();
-        else
-            m6502_exec();
+    // a headless replay stops where the recording did.
+    if (!inputlog_frame() && headless) {
+        quitting = true;
+        return;
+    }
+    if (autoboot)
+        autoboot--;
+    framesrun++;
+
+    sect = speed_enter(SPEED_CPU);
+#ifndef NO_USE_TUBE
+    tube_thread_begin();
+#endif
+    if (x65c02)
+        m65c02_exec();
+    else
+        m6502_exec();
+#ifndef NO_USE_TUBE
+    tube_thread_end();
+#endif
+    speed_leave(sect);
+#ifndef NO_USE_SPEED_METER
+    speed_frame(headless || fullspeed == FSPEED_RUNNING);
+#endif
 
 #ifndef NO_USE_DD_NOISE
-        if (ddnoise_ticks > 0 && --ddnoise_ticks == 0)
-            ddnoise_headdown();
+    if (ddnoise_ticks > 0 && --ddnoise_ticks == 0)
+        ddnoise_headdown();
 #endif
 #ifndef NO_USE_SAVE_STATE
-        if (savestate_wantload)
-            savestate_doload();
-        if (savestate_wantsave)
-            savestate_dosave();
+    if (savestate_wantload)
+        savestate_doload();
+    if (savestate_wantsave)
+        savestate_dosave();
 #endif
+    rewind_frame();
+}
+
+static void main_timer(ALLEGRO_EVENT *event)
+{
+    if (event_delay_ok(event)) {
+        main_exec_frame();
         if (fullspeed == FSPEED_RUNNING)
             al_emit_user_event(&evsrc, event, NULL);
     }
 }
 
+#ifndef PICO_BUILD
+#ifndef USE_MULTI_MACHINE
+static
+#endif
+int main_run_headless(const headless_opts_t *opts)
+{
+#ifndef USE_PICO_CPU
+    if (!opts->frames && m6502_exit_pc < 0)
+#else
+    if (!opts->frames)
+#endif
+        log_warn("main: headless run has no -frames or -exitpc limit");
+
+    log_debug("main: entering headless loop, frames=%d", opts->frames);
+    while (!quitting) {
+        main_exec_frame();
+        if (opts->frames && framesrun >= opts->frames)
+            break;
+#ifndef USE_PICO_CPU
+        if (m6502_exit_hit) {
+            log_info("main: reached exit address %04X after %d frames", m6502_exit_pc, framesrun);
+            break;
+        }
+#endif
+    }
+    log_debug("main: end headless loop after %d frames", framesrun);
+
+    if (opts->audio_fn)
+        sound_rec_stop();
+    if (opts->screen_fn)
+        video_dump_screen(opts->screen_fn);
+    if (opts->mem_fn)
+        mem_dump_ram(opts->mem_fn);
+    if (opts->checksum) {
+        uint32_t sum;
+        if (video_checksum(&sum))
+            printf("checksum: %08X after %d frames\n", sum, framesrun);
+        printf("memory: %08X\n", mem_checksum_ram());
+    }
+    return framesrun;
+}
+#endif
+
 void main_run()
 {
     ALLEGRO_EVENT event;
 
+#ifndef PICO_BUILD
+#ifdef USE_MULTI_MACHINE
+    if (batch_fn) {
+        machine_run_batch(batch_fn, batch_jobs);
+        return;
+    }
+#endif
+    if (headless) {
+        main_run_headless(&headless_opts);
+        return;
+    }
+#endif
     log_debug("main: about to start timer");
     al_start_timer(timer);
 
@@ -706,19 +937,40 @@ void main_close()
 {
 #ifndef NO_USE_CLOSE
 
+#ifdef USE_MULTI_MACHINE
+    if (batch_fn) {
+        log_close();
+        return;
+    }
+#endif
+
 #ifndef NO_USE_ALLEGRO_GUI
-    gui_tapecat_close();
-    gui_keydefine_close();
+    if (!headless) {
+        gui_tapecat_close();
+        gui_keydefine_close();
+    }
 #endif
 
 #ifndef NO_USE_DEBUGGER
     debug_kill();
 #endif
 
-    config_save();
-    cmos_save(models[curmodel]);
+    speed_close();
+    inputlog_close();
+    rewind_close();
+#ifndef NO_USE_SPEED_METER
+    if (speed_print)
+        speed_report(stdout);
+#endif
+
+    // a headless run must not disturb the interactive configuration.
+    if (!headless) {
+        config_save();
+        cmos_save(models[curmodel]);
+    }
 
     midi_close();
+    jit6502_close();
     mem_close();
 #ifndef NO_USE_UEF
     uef_close();
@@ -727,6 +979,7 @@ void main_close()
     csw_close();
 #endif
 #ifndef NO_USE_TUBE
+    tube_thread_close();
     tube_6502_close();
     arm_close();
     x86_close();
@@ -759,6 +1012,48 @@ void main_close()
 #endif
 }
 
+#ifdef USE_MULTI_MACHINE
+/*
+ * Set up and tear down one machine of a batch.  These run on the machine's
+ * own thread, after main_init has done the process-wide set-up, and are
+ * serialised by the caller as they touch shared configuration.
+ */
+void main_init_machine(int argc, char *argv[], headless_opts_t *opts)
+{
+    config_load_machine();
+    main_parse_args(argc, argv, opts);
+
+    video_init();
+    mode7_makechars();
+    mem_init();
+    if (opts->audio_fn)
+        sound_rec_start(opts->audio_fn);
+#ifndef NO_USE_ADC
+    adc_init();
+#endif
+#ifndef NO_USE_PAL
+    pal_init();
+#endif
+    disc_init();
+    model_init();
+    main_reset();
+
+    oldmodel = curmodel;
+    main_load_media();
+}
+
+void main_close_machine(void)
+{
+    disc_close(0);
+    disc_close(1);
+#ifndef NO_USE_TAPE
+    tape_close();
+#endif
+    mem_close();
+    video_close();
+}
+#endif
+
 #ifndef NO_USE_SET_SPEED
 void main_setspeed(int speed)
 {
@@ -786,13 +1081,14 @@ void main_setspeed(int speed)
 
 void main_pause(void)
 {
-    al_stop_timer(timer);
+    if (timer)
+        al_stop_timer(timer);
 }
 
 void main_resume(void)
 {
 #ifndef NO_USE_SET_SPEED
-    if (emuspeed != EMU_SPEED_PAUSED && emuspeed != EMU_SPEED_FULL)
+    if (timer && emuspeed != EMU_SPEED_PAUSED && emuspeed != EMU_SPEED_FULL)
         al_start_timer(timer);
 #endif
 }
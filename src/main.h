@@ -15,6 +15,23 @@ extern const emu_speed_t emu_speeds[NUM_EMU_SPEEDS];
 extern int emuspeed;
 
 extern bool quitting;
+#ifndef PICO_BUILD
+extern bool headless;
+#else
+#define headless false
+#endif
+
+/*
+ * When a headless run stops and what it writes out at the end.  Each
+ * machine of a multi-machine run keeps its own in its bem_machine.
+ */
+typedef struct {
+    int frames;                 // frames to run, or 0 for no limit
+    const char *screen_fn;      // -dumpscreen
+    const char *audio_fn;       // -dumpaudio
+    const char *mem_fn;         // -dumpmem
+    bool checksum;              // -checksum
+} headless_opts_t;
 
 void main_init(int argc, char *argv[]);
 void main_softreset(void);
@@ -26,6 +43,13 @@ void main_pause(void);
 void main_resume(void);
 void main_setspeed(int speed);
 void main_setquit(void);
+void main_break(void);
+
+#ifdef USE_MULTI_MACHINE
+void main_init_machine(int argc, char *argv[], headless_opts_t *opts);
+int main_run_headless(const headless_opts_t *opts);
+void main_close_machine(void);
+#endif
 
 void main_cleardrawit(void);
 void main_setmouse(void);
@@ -6,6 +6,7 @@
 #include <ctype.h>
 #include "b-em.h"
 #include "6502.h"
+#include "6502jit.h"
 #include "config.h"
 #include "mem.h"
 #include "model.h"
@@ -21,11 +22,11 @@
 #include "roms/roms.h"
 #endif
 
-uint8_t ram_fe30, ram_fe34;
+MACHINE_LOCAL uint8_t ram_fe30, ram_fe34;
 
-rom_slot_t rom_slots[ROM_NSLOT];
+MACHINE_LOCAL rom_slot_t rom_slots[ROM_NSLOT];
 
-ALLEGRO_PATH *os_dir, *rom_dir;
+MACHINE_LOCAL ALLEGRO_PATH *os_dir, *rom_dir;
 
 static const char slotkeys[16][6] = {
     "rom00", "rom01", "rom02", "rom03",
@@ -34,12 +35,12 @@ static const char slotkeys[16][6] = {
     "rom12", "rom13", "rom14", "rom15"
 };
 
-uint8_t *ram;
+MACHINE_LOCAL uint8_t *ram;
 #ifndef NO_USE_RAM_ROMS
-uint8_t *os;
-uint8_t *rom;
+MACHINE_LOCAL uint8_t *os;
+MACHINE_LOCAL uint8_t *rom;
 #else
-const uint8_t *os;
+MACHINE_LOCAL const uint8_t *os;
 #endif
 
 void mem_init() {
@@ -52,7 +53,9 @@ void mem_init() {
     ram = (uint8_t *)malloc(RAM_SIZE);
 #ifndef NO_USE_RAM_ROMS
     rom = (uint8_t *)malloc(ROM_NSLOT * ROM_SIZE);
+#ifndef USE_MULTI_MACHINE
     os  = (uint8_t *)malloc(ROM_SIZE);
+#endif
 #endif
     memset(ram, 0, RAM_SIZE);
     os_dir  = al_create_path_for_directory("roms/os");
@@ -83,8 +86,10 @@ void mem_close() {
 #ifndef PICO_BUILD
     if (ram) free(ram);
     if (rom) free(rom);
+#ifndef USE_MULTI_MACHINE
     if (os)  free(os);
 #endif
+#endif
 }
 
 static void dump_mem(void *start, size_t size, const char *which, const char *file) {
@@ -97,6 +102,22 @@ static void dump_mem(void *start, size_t size, const char *which, const char *fi
         log_error("mem: unable to open %s dump file %s: %s", which, file, strerror(errno));
 }
 
+void mem_dump_ram(const char *file) {
+    dump_mem(ram, RAM_SIZE, "RAM", file);
+}
+
+/*
+ * A 32-bit FNV-1a hash of the RAM mem_dump_ram would write, so runs can
+ * be compared for identical machine state as well as identical frames.
+ */
+uint32_t mem_checksum_ram(void) {
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < RAM_SIZE; i++)
+        hash = (hash ^ ram[i]) * 16777619u;
+    return hash;
+}
+
 void mem_dump(void) {
     dump_mem(ram, 64*1024, "RAM", "ram.dmp");
 #ifndef NO_USE_RAM_ROMS
@@ -115,6 +136,46 @@ const uint8_t *get_included_rom(const char *name) {
 }
 #endif
 
+#ifdef USE_MULTI_MACHINE
+/*
+ * The OS ROM is never written so the machines of a multi-machine run share
+ * one copy of each image.  Machines are set up one at a time (see
+ * machine.c) so the list needs no lock of its own.
+ */
+struct os_image {
+    struct os_image *next;
+    char *path;
+    uint8_t data[ROM_SIZE];
+};
+
+static struct os_image *os_images;
+
+static bool os_read(FILE *f, const char *cpath) {
+    struct os_image *img;
+
+    for (img = os_images; img; img = img->next) {
+        if (!strcmp(img->path, cpath)) {
+            log_debug("mem: sharing OS image from %s", cpath);
+            os = img->data;
+            return fseek(f, ROM_SIZE, SEEK_CUR) == 0;
+        }
+    }
+    if (!(img = malloc(sizeof(struct os_image))))
+        return false;
+    if (fread(img->data, ROM_SIZE, 1, f) != 1) {
+        free(img);
+        return false;
+    }
+    img->path = strdup(cpath);
+    img->next = os_images;
+    os_images = img;
+    os = img->data;
+    return true;
+}
+#else
+#define os_read(f, cpath) (fread(os, ROM_SIZE, 1, f) == 1)
+#endif
+
 static void load_os_rom(const char *sect) {
     const char *osname;
 #ifndef INCLUDE_ROMS
@@ -128,7 +189,7 @@ static void load_os_rom(const char *sect) {
     if ((path = find_dat_file(os_dir, osname, ".rom"))) {
         cpath = al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP);
         if ((f = fopen(cpath, "rb"))) {
-            if (fread(os, ROM_SIZE, 1, f) == 1) {
+            if (os_read(f, cpath)) {
                 fclose(f);
                 log_debug("mem: OS %s loaded from %s", osname, cpath);
                 al_destroy_path(path);
@@ -173,6 +234,7 @@ const uint8_t *mem_romdetail(int slot) {
 }
 
 void mem_loadrom(int slot, const char *name, const char *path, uint8_t use_name) {
+    jit6502_flush();
 #ifndef INCLUDE_ROMS
     FILE *f;
 
@@ -342,7 +404,7 @@ void mem_romsetup_master(void) {
     if ((path = find_dat_file(os_dir, osname, ".rom"))) {
         cpath = al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP);
         if ((f = fopen(cpath, "rb"))) {
-            if (fread(os, ROM_SIZE, 1, f) == 1) {
+            if (os_read(f, cpath)) {
 #if defined(PICO_BUILD) && defined(__arm)
                 assert(false);
 #endif
@@ -435,6 +497,7 @@ void mem_clearrom(int slot) {
     uint8_t *base = rom_slot_ptr(slot);
 
     memset(base, 0xff, ROM_SIZE);
+    jit6502_flush();
 #endif
     rom_clearmeta(slot);
 }
@@ -470,6 +533,7 @@ void mem_loadzlib(ZFILE *zfp)
     writemem(0xFE34, latches[1]);
     savestate_zread(zfp, ram, RAM_SIZE);
     savestate_zread(zfp, rom, ROM_SIZE*ROM_NSLOT);
+    jit6502_flush();
 }
 
 void mem_loadstate(FILE *f) {
@@ -477,6 +541,7 @@ void mem_loadstate(FILE *f) {
     writemem(0xFE34, getc(f));
     fread(ram, RAM_SIZE, 1, f);
     fread(rom, ROM_SIZE*ROM_NSLOT, 1, f);
+    jit6502_flush();
 }
 #endif
 
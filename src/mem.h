@@ -45,19 +45,21 @@ void mem_loadstate(FILE *f);
 #endif
 
 void mem_dump(void);
+void mem_dump_ram(const char *file);
+uint32_t mem_checksum_ram(void);
 
-extern uint8_t ram_fe30, ram_fe34;
-extern uint8_t *ram;
-extern rom_slot_t rom_slots[ROM_NSLOT];
+extern MACHINE_LOCAL uint8_t ram_fe30, ram_fe34;
+extern MACHINE_LOCAL uint8_t *ram;
+extern MACHINE_LOCAL rom_slot_t rom_slots[ROM_NSLOT];
 
 #ifndef NO_USE_RAM_ROMS
-extern uint8_t *os;
+extern MACHINE_LOCAL uint8_t *os;
 static inline uint8_t* rom_slot_ptr(int slot) {
-    extern uint8_t *rom;
+    extern MACHINE_LOCAL uint8_t *rom;
     return rom + slot * ROM_SIZE;
 }
 #else
-extern const uint8_t *os;
+extern MACHINE_LOCAL const uint8_t *os;
 // read and write for non device so code can't mutate value and read it back
 extern uint8_t *g_garbage_read;
 extern uint8_t *g_garbage_write;
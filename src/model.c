@@ -19,15 +19,16 @@
 
 #define CFG_SECT_LEN 20
 
-fdc_type_t fdc_type;
-bool BPLUS, x65c02, MASTER, MODELA, OS01;
+MACHINE_LOCAL fdc_type_t fdc_type;
+MACHINE_LOCAL bool BPLUS, x65c02, MASTER, MODELA, OS01;
 #ifndef NO_USE_COMPACT
-bool compactcmos;
+MACHINE_LOCAL bool compactcmos;
 #endif
 #ifndef NO_USE_TUBE
 int8_t curtube;
 #endif
-int8_t oldmodel, model_count;
+MACHINE_LOCAL int8_t oldmodel;
+int8_t model_count;
 MODEL *models;
 ALLEGRO_PATH *tube_dir;
 
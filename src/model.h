@@ -60,8 +60,8 @@ typedef struct
 extern TUBE tubes[NUM_TUBES];
 #endif
 
-extern int8_t curmodel;
-extern int8_t oldmodel;
+extern MACHINE_LOCAL int8_t curmodel;
+extern MACHINE_LOCAL int8_t oldmodel;
 #ifndef NO_USE_TUBE
 extern int8_t curtube;
 extern int8_t selecttube;
@@ -69,10 +69,10 @@ extern int8_t selecttube;
 #define curtube 0
 #define selecttube -1
 #endif
-extern fdc_type_t fdc_type;
-extern bool BPLUS, x65c02, MASTER, MODELA, OS01;
+extern MACHINE_LOCAL fdc_type_t fdc_type;
+extern MACHINE_LOCAL bool BPLUS, x65c02, MASTER, MODELA, OS01;
 #ifndef NO_USE_COMPACT
-extern bool compactcmos;
+extern MACHINE_LOCAL bool compactcmos;
 #else
 #define compactcmos false
 #endif
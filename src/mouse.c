@@ -1,5 +1,6 @@
 #include "b-em.h"
 
+#include "inputlog.h"
 #include "mouse.h"
 #include "mem.h"
 #include "model.h"
@@ -14,68 +15,57 @@ uint8_t mouse_portb = 0xff;
 static int mx = 0,  my = 0;
 static int mouse_xff = 0, mouse_yff = 0;
 
-void mouse_axes(ALLEGRO_EVENT *event)
+void mouse_move(int dx, int dy)
 {
+    if (!inputlog_mouse_move(dx, dy))
+        return;
     if (curtube == 3) {
-        mx += event->mouse.dx;
-        my += event->mouse.dy;
+        mx += dx;
+        my += dy;
     }
     else if (mouse_amx) {
-        mx += event->mouse.dx * 2;
-        my += event->mouse.dy * 2;
+        mx += dx * 2;
+        my += dy * 2;
     }
-    log_debug("mouse: axes event, dx=%d, mx=%d, dy=%d, my=%d", event->mouse.dx, mx, event->mouse.dy, my);
+    log_debug("mouse: axes event, dx=%d, mx=%d, dy=%d, my=%d", dx, mx, dy, my);
+}
+
+void mouse_button(int button, bool down)
+{
+    static const uint8_t x86_bits[3] = { 1, 4, 2 };
+    static const uint8_t amx_bits[3] = { 0x20, 0x80, 0x40 };
+    uint8_t bit;
+
+    if (!inputlog_mouse_button(button, down))
+        return;
+    log_debug("mouse: button #%d %s", button, down ? "down" : "up");
+    if (button < 1 || button > 3)
+        return;
+    if (curtube == 3)
+        bit = x86_bits[button-1];
+    else if (mouse_amx)
+        bit = amx_bits[button-1];
+    else
+        return;
+    if (down)
+        mouse_portb &= ~bit;
+    else
+        mouse_portb |= bit;
+}
+
+void mouse_axes(ALLEGRO_EVENT *event)
+{
+    mouse_move(event->mouse.dx, event->mouse.dy);
 }
 
 void mouse_btn_down(ALLEGRO_EVENT *event)
 {
-    int button = event->mouse.button;
-    log_debug("mouse: button #%d down", button);
-    switch(button) {
-        case 1:
-            if (curtube == 3)
-                mouse_portb &= ~1;
-            else if (mouse_amx)
-                mouse_portb &= ~0x20;
-            break;
-        case 2:
-            if (curtube == 3)
-                mouse_portb &= ~4;
-            else if (mouse_amx)
-                mouse_portb &= ~0x80;
-            break;
-        case 3:
-            if (curtube == 3)
-                mouse_portb &= ~2;
-            else if (mouse_amx)
-                mouse_portb &= ~0x40;
-            break;
-    }
+    mouse_button(event->mouse.button, true);
 }
 
-void mouse_btn_up(ALLEGRO_EVENT *event) {
-    int button = event->mouse.button;
-    log_debug("mouse: button #%d up", button);
-    switch(button) {
-        case 1:
-            if (curtube == 3)
-                mouse_portb |=  1;
-            else if (mouse_amx)
-                mouse_portb |=  0x20;
-            break;
-        case 2:
-            if (curtube == 3)
-                mouse_portb |=  4;
-            else if (mouse_amx)
-                mouse_portb |=  0x80;
-            break;
-        case 3:
-            if (curtube == 3)
-                mouse_portb |= 2;
-            else if (mouse_amx)
-                mouse_portb |=  0x40;
-            break;
-    }
+void mouse_btn_up(ALLEGRO_EVENT *event)
+{
+    mouse_button(event->mouse.button, false);
 }
 
 static void mouse_poll_x86(int xmask, int ymask)
@@ -5,6 +5,8 @@
 extern void mouse_axes(ALLEGRO_EVENT *event);
 extern void mouse_btn_down(ALLEGRO_EVENT *event);
 extern void mouse_btn_up(ALLEGRO_EVENT *event);
+extern void mouse_move(int dx, int dy);
+extern void mouse_button(int button, bool down);
 
 void mouse_poll(void);
 
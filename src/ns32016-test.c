@@ -0,0 +1,193 @@
+/*
+ * B-em 32016 co-processor testing
+ *
+ * This program runs the 32016 core on its own, with the tube replaced by
+ * stubs, through a set of cases and prints a hash of the registers and PC
+ * taken after every slice of each.  It is built twice, once with the
+ * decoded instruction cache and once with NO_USE_NS32016_DECODE_CACHE,
+ * and utils/core-compare.sh checks the two print the same.  The cases
+ * are the Pandora ROM booting, a loop working on memory, loops which
+ * modify their own code across each position of a 64 byte block
+ * boundary, and images of random bytes run with random interrupts.
+ */
+
+#include "b-em.h"
+#include "tube.h"
+#include "NS32016/32016.h"
+#include "NS32016/mem32016.h"
+
+#include <stdarg.h>
+
+#define SLICE   1000    // tubecycles given to each call of n32016_exec.
+#define ORG     0x1000  // where the test code is loaded.
+#define RANDOM  4096    // bytes in each random image.
+
+int tubecycles;
+int tube_irq;
+
+void log_warn(const char *fmt, ...) {}
+void log_info(const char *fmt, ...) {}
+void log_error(const char *fmt, ...) {}
+
+static uint32_t wsum;
+
+uint8_t tube_parasite_read(uint32_t addr)
+{
+    return (addr & 1) ? 0 : 0x40;
+}
+
+void tube_parasite_write(uint32_t addr, uint8_t val)
+{
+    wsum = wsum * 31 + val + addr;
+}
+
+static uint32_t rng;
+
+static uint32_t rnd(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return (rng >> 8) ^ (rng << 13);
+}
+
+// Encode a 32016 displacement, as the assembler would.
+static int disp(uint8_t *p, int32_t v)
+{
+    if (v >= -64 && v <= 63) {
+        p[0] = v & 0x7f;
+        return 1;
+    }
+    if (v >= -8192 && v <= 8191) {
+        p[0] = 0x80 | ((v >> 8) & 0x3f);
+        p[1] = v;
+        return 2;
+    }
+    p[0] = 0xc0 | ((v >> 24) & 0x3f);
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return 4;
+}
+
+static void load(const uint8_t *code, int len)
+{
+    for (int i = 0; i < len; i++)
+        write_x8(ORG + i, code[i]);
+    n32016_set_pc(ORG);
+}
+
+/*
+ * Two nested loops which store, add, index and read back through R1 and
+ * absolute addresses, using the common general addressing modes.
+ */
+static const uint8_t loop_code[] = {
+    0x97, 0xa0, 0x00, 0x00, 0x00, 0xc8,         // start: movd 200,r2
+    0x57, 0xa0, 0x00, 0x02, 0x00, 0x00,         // outer: movd 0x20000,r1
+    0x5f, 0x18,                                 // movqd 0,r3
+    0x17, 0xa1, 0x00, 0x00, 0x01, 0x00,         // movd 256,r4
+    0x57, 0x1a, 0x00,                           // inner: movd r3,0(r1)
+    0xc3, 0x48, 0x04,                           // addd 4(r1),r3
+    0xfb, 0x20,                                 // xord r4,r3
+    0x41, 0xa2, 0x12, 0x34, 0x7e,               // addw 0x1234,-2(r1)
+    0x54, 0xe1, 0x4c, 0x00,                     // movb 0(r1)[r4:b],r5
+    0x43, 0xa9, 0xc0, 0x03, 0x00, 0x00,         // addd @0x30000,r5
+    0x57, 0x2d, 0xc0, 0x03, 0x00, 0x04,         // movd r5,@0x30004
+    0x0f, 0x0a,                                 // addqd 4,r1
+    0xcf, 0x27, 0x61,                           // acbd -1,r4,inner
+    0xcf, 0x17, 0x50,                           // acbd -1,r2,outer
+    0xea, 0x47                                  // br start
+};
+
+/*
+ * A loop which adds one more each time round to the last byte of the
+ * immediate of its own addd, after pad nops which move that instruction
+ * along, and then restarts.
+ */
+static int smc_code(uint8_t *code, int pad)
+{
+    uint8_t *p = code;
+    uint32_t x;
+
+    memset(p, 0xa2, pad);                       // nop
+    p += pad;
+    memcpy(p, "\x97\xa0\x00\x00\x03\xe8", 6);   // movd 1000,r2
+    p += 6;
+    x = ORG + (p - code);
+    memcpy(p, "\x83\xa1\x00\x00\x00\x01", 6);   // x: addd 1,r6
+    p += 6;
+    memcpy(p, "\x40\xa5\x01", 3);               // addb 1,@x+5
+    p += 3;
+    p += disp(p, x + 5);
+    memcpy(p, "\xcf\x17", 2);                   // acbd -1,r2,x
+    p += 2;
+    p += disp(p, x - (ORG + (p - 2 - code)));
+    *p = 0xea;                                  // br 0
+    p += 1 + disp(p + 1, code - p);
+    return p - code;
+}
+
+static void run(const char *name, long slices, bool irqs)
+{
+    uint32_t hash = 0;
+
+    wsum = 0;
+    for (long i = 0; i < slices; i++) {
+        if (irqs)
+            tube_irq = rnd() & 3;
+        tubecycles += SLICE;
+        n32016_exec();
+        for (int k = 0; k < 8; k++)
+            hash = hash * 31 + r[k];
+        hash = hash * 31 + n32016_get_pc();
+    }
+    tube_irq = 0;
+    printf("%-12s %08x %08x %06x\n", name, hash, wsum, n32016_get_pc());
+}
+
+int main(int argc, char **argv)
+{
+    static const int pads[] = { 0, 50, 54, 56, 58, 60, 62, 63 };
+    uint8_t code[128];
+    char name[24];
+    long slices = 20000;
+    int images = 300, len;
+
+    if (argc > 1)
+        slices = atol(argv[1]);
+    if (argc > 2)
+        images = atoi(argv[2]);
+    if (argc > 3 || slices <= 0 || images < 0) {
+        fputs("Usage: ns32016-test [ <slices> [ <random-images> ] ]\n", stderr);
+        return 1;
+    }
+
+    n32016_init();
+    n32016_reset();
+    run("pandora", slices, false);
+
+    n32016_reset();
+    load(loop_code, sizeof loop_code);
+    run("loop", slices, false);
+
+    for (int i = 0; i < sizeof pads / sizeof pads[0]; i++) {
+        n32016_reset();
+        len = smc_code(code, pads[i]);
+        load(code, len);
+        snprintf(name, sizeof name, "smc-%d", pads[i]);
+        run(name, slices / 4, false);
+    }
+
+    // some images trap at once, so run them for less long.
+    for (int i = 1; i <= images; i++) {
+        uint8_t image[RANDOM];
+
+        n32016_reset();
+        rng = i;
+        for (int j = 0; j < RANDOM; j++)
+            image[j] = rnd();
+        load(image, RANDOM);
+        snprintf(name, sizeof name, "random-%d", i);
+        run(name, 40, true);
+    }
+    n32016_close();
+    return 0;
+}
@@ -0,0 +1,484 @@
+/*B-em v2.2 by Tom Walker
+ * Pico version (C) 2021 Graham Sanderson
+ *
+ * Copy-on-write overlays for disc and hard disc images*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // for fopencookie.
+#endif
+
+#include "b-em.h"
+#include "overlay.h"
+#include <errno.h>
+
+#ifndef NO_USE_DISC_WRITE
+
+/*
+ * With overlays enabled the disc and hard disc images are opened
+ * read-only and the writes made to them are kept separately, so any
+ * number of emulators can share one set of images and each sees only its
+ * own changes.  By default those are kept in memory and discarded when
+ * the image is closed; if overlay_dir is set they are saved there when
+ * the image is closed and picked up again when it is next opened, so
+ * each emulator given its own directory keeps its own changes between
+ * runs.  overlay_open returns an ordinary stream so the disc backends
+ * need not know.
+ */
+bool overlay_enabled = false;
+char *overlay_dir;
+
+// The full path of fn, so the same image reached two ways is one image.
+static char *full_path(const char *fn)
+{
+    char *path;
+
+#ifdef _WIN32
+    path = _fullpath(NULL, fn, 0);
+#else
+    path = realpath(fn, NULL);
+#endif
+    return path ? path : strdup(fn);
+}
+
+/*
+ * The file in overlay_dir that keeps the changes to the image at the full
+ * path given, or NULL for none.  It is named after the image with a
+ * 32-bit FNV-1a hash of the full path added, so images of the same name
+ * in different directories keep their changes apart.
+ */
+static char *overlay_path(const char *full, const char *ext)
+{
+    const char *name, *p;
+    uint32_t hash = 2166136261u;
+    char *path;
+    size_t len;
+
+    if (!overlay_dir || !full)
+        return NULL;
+    for (name = p = full; *p; p++) {
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    len = strlen(overlay_dir) + strlen(name) + strlen(ext) + 11;
+    if ((path = malloc(len)))
+        snprintf(path, len, "%s/%s-%08x%s", overlay_dir, name, (unsigned)hash, ext);
+    return path;
+}
+
+#ifdef __GLIBC__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * The image is split into blocks and a block is copied from the base
+ * image the first time it is written; reads come from the copy if there
+ * is one and from the base image otherwise.
+ *
+ * A saved delta is the magic number, the size and modification time of
+ * the base image it was made from and the size of the image, each as a
+ * 64-bit number, then each written block as its 64-bit block number
+ * followed by its contents, all in host byte order.  A delta made from a
+ * base image that has changed since is ignored.
+ *
+ * An image opened more than once, say as an MMB and through the SD card,
+ * shares one overlay between the streams, which each keep their own
+ * position, so they see each other's writes and the changes are saved
+ * when the last is closed.
+ */
+#define OV_BLOCK 4096
+
+static const char ov_magic[8] = "B-EMOVL2";
+
+typedef struct overlay {
+    int fd;             // the base image, or -1 for none.
+    off64_t base_size;  // its size.
+    int64_t base_mtime; // its modification time.
+    off64_t size;       // size of the image including anything written.
+    uint8_t **blocks;   // the blocks written, indexed by block number.
+    size_t nblocks;     // entries in blocks.
+    char *key;          // full path of the base image, or NULL for none.
+    char *delta;        // where to save the written blocks, or NULL.
+    bool dirty;         // blocks have been written since the delta was read.
+    int refs;           // streams open on it.
+    struct overlay *next;
+} overlay_t;
+
+typedef struct {
+    overlay_t *ov;
+    off64_t pos;
+} overlay_stream_t;
+
+static MACHINE_LOCAL overlay_t *overlays; // those with a base image.
+
+static bool read_base(overlay_t *ov, char *buf, size_t size, off64_t pos)
+{
+    while (size > 0) {
+        ssize_t n = 0;
+        if (pos < ov->base_size) {
+            n = pread(ov->fd, buf, size, pos);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+        }
+        if (n == 0) {
+            memset(buf, 0, size); // past the end of the base image.
+            break;
+        }
+        buf += n;
+        size -= n;
+        pos += n;
+    }
+    return true;
+}
+
+static uint8_t **block_slot(overlay_t *ov, size_t blk)
+{
+    if (blk >= ov->nblocks) {
+        size_t nblocks = ov->nblocks ? ov->nblocks : 64;
+        uint8_t **blocks;
+        while (nblocks <= blk)
+            nblocks *= 2;
+        if (!(blocks = realloc(ov->blocks, nblocks * sizeof(uint8_t *))))
+            return NULL;
+        memset(blocks + ov->nblocks, 0, (nblocks - ov->nblocks) * sizeof(uint8_t *));
+        ov->blocks = blocks;
+        ov->nblocks = nblocks;
+    }
+    return &ov->blocks[blk];
+}
+
+static uint8_t *get_block(overlay_t *ov, size_t blk)
+{
+    uint8_t **slot, *block;
+
+    if (!(slot = block_slot(ov, blk)))
+        return NULL;
+    if (!(block = *slot)) {
+        if (!(block = malloc(OV_BLOCK)))
+            return NULL;
+        if (!read_base(ov, (char *)block, OV_BLOCK, (off64_t)blk * OV_BLOCK)) {
+            free(block);
+            return NULL;
+        }
+        *slot = block;
+    }
+    return block;
+}
+
+static void load_delta(overlay_t *ov)
+{
+    FILE *fp;
+    char magic[sizeof ov_magic];
+    uint64_t base_size, size, blk;
+    int64_t base_mtime;
+    uint8_t **slot, *block;
+
+    if (!(fp = fopen(ov->delta, "rb")))
+        return;
+    if (fread(magic, sizeof magic, 1, fp) != 1 || memcmp(magic, ov_magic, sizeof magic) || fread(&base_size, sizeof base_size, 1, fp) != 1
+        || fread(&base_mtime, sizeof base_mtime, 1, fp) != 1 || fread(&size, sizeof size, 1, fp) != 1)
+        log_warn("overlay: %s is not an overlay, ignoring it", ov->delta);
+    else if (base_size != ov->base_size || base_mtime != ov->base_mtime)
+        log_warn("overlay: %s has changed since %s was saved, ignoring it", ov->key, ov->delta);
+    else {
+        ov->size = size;
+        while (fread(&blk, sizeof blk, 1, fp) == 1) {
+            if (!(block = malloc(OV_BLOCK)) || !(slot = block_slot(ov, blk))) {
+                free(block);
+                log_error("overlay: out of memory loading %s", ov->delta);
+                break;
+            }
+            if (fread(block, OV_BLOCK, 1, fp) != 1) {
+                free(block);
+                log_warn("overlay: %s is truncated", ov->delta);
+                break;
+            }
+            free(*slot);
+            *slot = block;
+        }
+    }
+    fclose(fp);
+}
+
+static void save_delta(overlay_t *ov)
+{
+    size_t len = strlen(ov->delta) + 5;
+    char *tmp;
+    FILE *fp;
+    uint64_t base_size = ov->base_size, size = ov->size, blk;
+    int64_t base_mtime = ov->base_mtime;
+    bool ok;
+
+    if (!(tmp = malloc(len)))
+        return;
+    snprintf(tmp, len, "%s.tmp", ov->delta);
+    if ((fp = fopen(tmp, "wb"))) {
+        ok = fwrite(ov_magic, sizeof ov_magic, 1, fp) == 1 && fwrite(&base_size, sizeof base_size, 1, fp) == 1
+            && fwrite(&base_mtime, sizeof base_mtime, 1, fp) == 1 && fwrite(&size, sizeof size, 1, fp) == 1;
+        for (blk = 0; ok && blk < ov->nblocks; blk++)
+            if (ov->blocks[blk])
+                ok = fwrite(&blk, sizeof blk, 1, fp) == 1 && fwrite(ov->blocks[blk], OV_BLOCK, 1, fp) == 1;
+        if (fclose(fp))
+            ok = false;
+        if (ok && !rename(tmp, ov->delta))
+            log_debug("overlay: saved changes to %s", ov->delta);
+        else {
+            log_error("overlay: unable to save changes to %s: %s", ov->delta, strerror(errno));
+            remove(tmp);
+        }
+    }
+    else
+        log_error("overlay: unable to create %s: %s", tmp, strerror(errno));
+    free(tmp);
+}
+
+static ssize_t overlay_read(void *cookie, char *buf, size_t size)
+{
+    overlay_stream_t *st = cookie;
+    overlay_t *ov = st->ov;
+    size_t done = 0;
+
+    while (done < size && st->pos < ov->size) {
+        size_t blk = st->pos / OV_BLOCK;
+        size_t off = st->pos % OV_BLOCK;
+        size_t n = OV_BLOCK - off;
+        if (n > size - done)
+            n = size - done;
+        if (n > ov->size - st->pos)
+            n = ov->size - st->pos;
+        if (blk < ov->nblocks && ov->blocks[blk])
+            memcpy(buf + done, ov->blocks[blk] + off, n);
+        else if (!read_base(ov, buf + done, n, st->pos))
+            return done ? (ssize_t)done : -1;
+        done += n;
+        st->pos += n;
+    }
+    return done;
+}
+
+static ssize_t overlay_write(void *cookie, const char *buf, size_t size)
+{
+    overlay_stream_t *st = cookie;
+    overlay_t *ov = st->ov;
+    size_t done = 0;
+
+    while (done < size) {
+        size_t blk = st->pos / OV_BLOCK;
+        size_t off = st->pos % OV_BLOCK;
+        size_t n = OV_BLOCK - off;
+        uint8_t *block;
+        if (n > size - done)
+            n = size - done;
+        if (!(block = get_block(ov, blk))) {
+            log_error("overlay: out of memory for written blocks");
+            break;
+        }
+        memcpy(block + off, buf + done, n);
+        done += n;
+        st->pos += n;
+        if (st->pos > ov->size)
+            ov->size = st->pos;
+        ov->dirty = true;
+    }
+    return done;
+}
+
+static int overlay_seek(void *cookie, off64_t *offset, int whence)
+{
+    overlay_stream_t *st = cookie;
+    off64_t pos;
+
+    switch(whence) {
+        case SEEK_SET:
+            pos = *offset;
+            break;
+        case SEEK_CUR:
+            pos = st->pos + *offset;
+            break;
+        case SEEK_END:
+            pos = st->ov->size + *offset;
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    if (pos < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    st->pos = *offset = pos;
+    return 0;
+}
+
+// Drop a reference to ov, saving and freeing it with the last.
+static void overlay_put(overlay_t *ov)
+{
+    overlay_t **link;
+
+    if (--ov->refs > 0)
+        return;
+    for (link = &overlays; *link; link = &(*link)->next)
+        if (*link == ov) {
+            *link = ov->next;
+            break;
+        }
+    if (ov->delta && ov->dirty)
+        save_delta(ov);
+    for (size_t blk = 0; blk < ov->nblocks; blk++)
+        free(ov->blocks[blk]);
+    free(ov->blocks);
+    free(ov->key);
+    free(ov->delta);
+    if (ov->fd >= 0)
+        close(ov->fd);
+    free(ov);
+}
+
+static int overlay_close(void *cookie)
+{
+    overlay_stream_t *st = cookie;
+
+    overlay_put(st->ov);
+    free(st);
+    return 0;
+}
+
+static const cookie_io_functions_t overlay_funcs = {
+    .read  = overlay_read,
+    .write = overlay_write,
+    .seek  = overlay_seek,
+    .close = overlay_close
+};
+
+// The overlay for fn, shared with any stream already open on it.
+static overlay_t *overlay_get(const char *fn)
+{
+    overlay_t *ov;
+    struct stat st;
+    char *key = NULL;
+
+    if (fn) {
+        if (!(key = full_path(fn)))
+            return NULL;
+        for (ov = overlays; ov; ov = ov->next)
+            if (!strcmp(ov->key, key)) {
+                free(key);
+                ov->refs++;
+                return ov;
+            }
+    }
+    if (!(ov = calloc(1, sizeof(overlay_t)))) {
+        free(key);
+        return NULL;
+    }
+    ov->fd = -1;
+    ov->key = key;
+    ov->refs = 1;
+    if (fn) {
+        if ((ov->fd = open(fn, O_RDONLY)) < 0 || fstat(ov->fd, &st)) {
+            int err = errno;
+            overlay_put(ov);
+            errno = err;
+            return NULL;
+        }
+        ov->base_size = ov->size = st.st_size;
+        ov->base_mtime = st.st_mtime;
+        if ((ov->delta = overlay_path(key, ".ovl")))
+            load_delta(ov);
+        ov->next = overlays;
+        overlays = ov;
+    }
+    return ov;
+}
+
+// Open fn as an overlay, or an empty image if fn is NULL.
+FILE *overlay_open(const char *fn)
+{
+    overlay_stream_t *st;
+    FILE *fp;
+
+    if (!(st = calloc(1, sizeof(overlay_stream_t))))
+        return NULL;
+    if (!(st->ov = overlay_get(fn))) {
+        free(st);
+        return NULL;
+    }
+    if (!(fp = fopencookie(st, "r+", overlay_funcs)))
+        overlay_close(st);
+    else
+        setvbuf(fp, NULL, _IONBF, 0); // so streams sharing it see each other's writes.
+    return fp;
+}
+
+#else
+
+/*
+ * Without fopencookie the overlay is a temporary copy of the image, or
+ * with overlay_dir set a copy in that directory which is made the first
+ * time the image is opened and used as it is after that.
+ */
+FILE *overlay_open(const char *fn)
+{
+    FILE *src, *fp;
+    char buf[8192], *full, *copy = NULL;
+    size_t n;
+    int err;
+
+    if (fn && (full = full_path(fn))) {
+        copy = overlay_path(full, "");
+        free(full);
+    }
+    if (copy) {
+        if ((fp = fopen(copy, "rb+"))) {
+            free(copy);
+            return fp;
+        }
+        fp = fopen(copy, "wb+");
+    }
+    else
+        fp = tmpfile();
+    if (!fp) {
+        free(copy);
+        return NULL;
+    }
+    if (fn) {
+        if (!(src = fopen(fn, "rb")))
+            goto fail;
+        while ((n = fread(buf, 1, sizeof buf, src)) > 0) {
+            if (fwrite(buf, n, 1, fp) != 1) {
+                err = errno;
+                fclose(src);
+                log_error("overlay: unable to copy %s: %s", fn, strerror(err));
+                errno = err;
+                goto fail;
+            }
+        }
+        if (ferror(src)) {
+            err = errno;
+            fclose(src);
+            errno = err;
+            goto fail;
+        }
+        fclose(src);
+        rewind(fp);
+    }
+    free(copy);
+    return fp;
+
+fail:
+    err = errno;
+    fclose(fp);
+    if (copy) {
+        remove(copy); // don't leave a partial copy to be used next time.
+        free(copy);
+    }
+    errno = err;
+    return NULL;
+}
+
+#endif
+#endif
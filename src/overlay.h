@@ -0,0 +1,20 @@
+#ifndef __INC_OVERLAY_H
+#define __INC_OVERLAY_H
+
+#ifndef NO_USE_DISC_WRITE
+extern bool overlay_enabled;
+extern char *overlay_dir;
+
+FILE *overlay_open(const char *fn);
+#endif
+
+// Open an image for update, as an overlay if they are enabled.
+static inline FILE *overlay_fopen(const char *fn)
+{
+#ifndef NO_USE_DISC_WRITE
+    if (overlay_enabled)
+        return overlay_open(fn);
+#endif
+    return fopen(fn, "rb+");
+}
+#endif
@@ -219,7 +219,7 @@ static inline void put_pixel(ALLEGRO_LOCKED_REGION *region, int x, int y, uint32
 }
 
 static float vision_iir(float NewSample) {
-    static float x; //input samples
+    static MACHINE_LOCAL float x; //input samples
 
     x = (x + NewSample) * 0.5;
 //    x = NewSample;
@@ -231,8 +231,8 @@ static float vision_iir(float NewSample) {
 #define NCoef 2
 
 static inline float chroma_iir(float NewSample) {
-    static float y[NCoef+1]; //output samples
-    static float x[NCoef+1]; //input samples
+    static MACHINE_LOCAL float y[NCoef+1]; //output samples
+    static MACHINE_LOCAL float x[NCoef+1]; //input samples
 
     x[2] = x[1];
     x[1] = x[0];
@@ -252,7 +252,7 @@ static inline float chroma_iir(float NewSample) {
 
 #define WT_INC ((4433618.75 / 16000000.0) * (2 * 3.14))
 
-static float sint[832*2], cost[832*2];
+static MACHINE_LOCAL float sint[832*2], cost[832*2];
 
 void pal_init(void)
 {
@@ -266,22 +266,21 @@ void pal_init(void)
         }
 }
 
-void pal_convert(int x1, int y1, int x2, int y2, int yoff)
+/* Convert from the locked bitmap b into dr, the locked bitmap b32. */
+void pal_convert(ALLEGRO_LOCKED_REGION *dr, int x1, int y1, int x2, int y2, int yoff)
 {
         int x, y;
         uint32_t pixel;
         float r, g, b, Y, U, V, signal;
-        static int wt;
+        static MACHINE_LOCAL int wt;
         float u_old[2][1536], v_old[2][1536];
         float u_filt[4], v_filt[4];
         float *uo[2], *vo[2];
-        ALLEGRO_LOCKED_REGION *dr;
 
         for (x = x1; x < x2; x++)
             u_old[0][x] = u_old[1][x] = v_old[0][x] = v_old[1][x] = 0.0;
         for (x = 0; x < 4; x++)
             u_filt[x] = v_filt[x] = 0.0;
-        dr = al_lock_bitmap(b32, ALLEGRO_PIXEL_FORMAT_ARGB_8888, ALLEGRO_LOCK_WRITEONLY);
         for (y = y1; y < y2; y += yoff)
         {
                 uo[0] = u_old[y&1];
@@ -327,7 +326,6 @@ void pal_convert(int x1, int y1, int x2, int y2, int yoff)
                 wt += (1024 - (x2 - x1));
                 wt %= 832;
         }
-        al_unlock_bitmap(b32);
 }
 
 #endif
@@ -0,0 +1,439 @@
+/*B-em v2.2 by Tom Walker
+ * Pico version (C) 2021 Graham Sanderson
+ *
+ * Rewind ring of in-memory savestates*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // for open_memstream and fmemopen.
+#endif
+
+#include "b-em.h"
+#include "rewind.h"
+#include "6502.h"
+#include "debugger.h"
+#include "inputlog.h"
+#include "mem.h"
+#include "model.h"
+#include "savestate.h"
+#include <errno.h>
+
+#ifndef NO_USE_REWIND
+
+/*
+ * Every rewind_frames frames the machine is captured as one image: main
+ * RAM, the sideways ROM/RAM slots, then the paging latches and the CPU
+ * and other devices in savestate section format.  Only the newest image
+ * is kept whole.  Each older snapshot is kept as the pages by which it
+ * differed from the next newer one, so a snapshot costs only the pages
+ * written in between and stepping back is a matter of copying pages
+ * back over the newest image.  When the ring grows past rewind_mb
+ * megabytes the oldest snapshots are dropped.
+ */
+#define RW_PAGE   256
+#define MEM_BYTES (RAM_SIZE + ROM_SIZE * ROM_NSLOT)
+
+extern MACHINE_LOCAL int framesrun;
+
+bool rewind_enabled = false;
+int rewind_frames = 10;
+int rewind_mb = 16;
+
+typedef struct {
+    int frame;          // framesrun when the snapshot was taken.
+    size_t size;        // size of its image.
+    size_t npages;
+    size_t bytes;       // memory taken by this delta.
+    uint32_t *index;    // page numbers within the image.
+    uint8_t *data;      // old contents of those pages.
+} rewind_delta_t;
+
+static rewind_delta_t **ring;
+static int ring_cap, ring_head, ring_count;
+static size_t ring_bytes;
+
+static uint8_t *ref;        // the newest snapshot, whole.
+static size_t ref_size, ref_cap;
+static int ref_frame;
+static bool at_ref;         // the machine has not run since ref.
+
+static uint8_t *devs;       // the devices as just captured.
+static size_t devs_cap;
+static uint32_t *diff_index;
+static uint8_t *diff_data;
+static size_t index_cap, data_cap;
+
+#ifdef _WIN32
+static FILE *scratch_fp;    // Windows has no memory streams.
+#endif
+static int frames_left;
+static int want_steps;
+static bool tube_warned;
+
+static inline size_t page_round(size_t size)
+{
+    return (size + RW_PAGE - 1) & ~(size_t)(RW_PAGE - 1);
+}
+
+static bool grow(void *ptr, size_t *cap, size_t want, size_t unit)
+{
+    void **pp = ptr;
+    void *np;
+
+    if (want <= *cap)
+        return true;
+    if (!(np = realloc(*pp, want * unit))) {
+        log_error("rewind: out of memory, rewind disabled");
+        rewind_enabled = false;
+        rewind_clear();
+        return false;
+    }
+    if (unit == 1)
+        memset((uint8_t *)np + *cap, 0, want - *cap);
+    *pp = np;
+    *cap = want;
+    return true;
+}
+
+static void drop_oldest(void)
+{
+    rewind_delta_t *d = ring[ring_head];
+
+    ring_bytes -= d->bytes;
+    free(d);
+    ring_head = (ring_head + 1) % ring_cap;
+    ring_count--;
+}
+
+static rewind_delta_t *pop_newest(void)
+{
+    rewind_delta_t *d = ring[(ring_head + ring_count - 1) % ring_cap];
+
+    ring_bytes -= d->bytes;
+    ring_count--;
+    return d;
+}
+
+static void push_newest(rewind_delta_t *d)
+{
+    if (ring_count == ring_cap) {
+        int new_cap = ring_cap ? ring_cap * 2 : 256;
+        rewind_delta_t **new_ring = malloc(new_cap * sizeof(*new_ring));
+        int i;
+
+        if (!new_ring) {
+            drop_oldest();
+        }
+        else {
+            for (i = 0; i < ring_count; i++)
+                new_ring[i] = ring[(ring_head + i) % ring_cap];
+            free(ring);
+            ring = new_ring;
+            ring_cap = new_cap;
+            ring_head = 0;
+        }
+    }
+    ring[(ring_head + ring_count) % ring_cap] = d;
+    ring_count++;
+    ring_bytes += d->bytes;
+    while (ring_count > 1 && ring_bytes + ref_cap > (size_t)rewind_mb << 20)
+        drop_oldest();
+}
+
+void rewind_clear(void)
+{
+    while (ring_count)
+        drop_oldest();
+    ref_size = 0;
+    at_ref = false;
+    want_steps = 0;
+    frames_left = 0;
+}
+
+void rewind_close(void)
+{
+    rewind_clear();
+    free(ring);
+    ring = NULL;
+    ring_cap = ring_head = 0;
+    free(ref);
+    ref = NULL;
+    ref_cap = 0;
+    free(devs);
+    devs = NULL;
+    devs_cap = 0;
+    free(diff_index);
+    free(diff_data);
+    diff_index = NULL;
+    diff_data = NULL;
+    index_cap = data_cap = 0;
+#ifdef _WIN32
+    if (scratch_fp) {
+        fclose(scratch_fp);
+        scratch_fp = NULL;
+    }
+#endif
+}
+
+/* Save the latches and devices into devs, through a memory stream or,
+ * on Windows, a scratch file which is read back.
+ */
+
+#ifdef _WIN32
+
+static long capture_devices(void)
+{
+    long size;
+
+    if (!scratch_fp && !(scratch_fp = tmpfile())) {
+        log_error("rewind: unable to create scratch file: %s, rewind disabled", strerror(errno));
+        rewind_enabled = false;
+        return -1;
+    }
+    fseek(scratch_fp, 0, SEEK_SET);
+    putc(ram_fe30, scratch_fp);
+    putc(ram_fe34, scratch_fp);
+    savestate_save_devices(scratch_fp);
+    size = ftell(scratch_fp);
+    if (!grow(&devs, &devs_cap, page_round(size), 1))
+        return -1;
+    fseek(scratch_fp, 0, SEEK_SET);
+    if (fread(devs, size, 1, scratch_fp) != 1) {
+        log_error("rewind: unable to read back scratch file, rewind disabled");
+        rewind_enabled = false;
+        return -1;
+    }
+    return size;
+}
+
+static FILE *open_devices(long size)
+{
+    fseek(scratch_fp, 0, SEEK_SET);
+    fwrite(ref + MEM_BYTES, size, 1, scratch_fp);
+    fseek(scratch_fp, 0, SEEK_SET);
+    return scratch_fp;
+}
+
+static void close_devices(FILE *fp) {}
+
+#else
+
+static long capture_devices(void)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    long size;
+    int failed;
+    FILE *fp;
+
+    if (!(fp = open_memstream(&buf, &len))) {
+        log_error("rewind: unable to open memory stream: %s, rewind disabled", strerror(errno));
+        rewind_enabled = false;
+        return -1;
+    }
+    putc(ram_fe30, fp);
+    putc(ram_fe34, fp);
+    savestate_save_devices(fp);
+    size = ftell(fp);
+    failed = ferror(fp);
+    if (fclose(fp) || failed) {
+        log_error("rewind: unable to save devices to memory stream, rewind disabled");
+        rewind_enabled = false;
+        free(buf);
+        return -1;
+    }
+    if (!grow(&devs, &devs_cap, page_round(size), 1)) {
+        free(buf);
+        return -1;
+    }
+    memcpy(devs, buf, size);
+    free(buf);
+    return size;
+}
+
+static FILE *open_devices(long size)
+{
+    return fmemopen(ref + MEM_BYTES, size, "rb");
+}
+
+static void close_devices(FILE *fp)
+{
+    fclose(fp);
+}
+
+#endif
+
+/* Move the pages of old that differ from new into the diff buffers and
+ * bring old up to date with new.
+ */
+static size_t diff_pages(uint8_t *old, const uint8_t *new, size_t len, size_t first, size_t n)
+{
+    size_t off, page = first;
+
+    for (off = 0; off < len; off += RW_PAGE, page++) {
+        if (memcmp(old + off, new + off, RW_PAGE)) {
+            diff_index[n] = page;
+            memcpy(diff_data + n * RW_PAGE, old + off, RW_PAGE);
+            memcpy(old + off, new + off, RW_PAGE);
+            n++;
+        }
+    }
+    return n;
+}
+
+static void capture(void)
+{
+    long devs_size = capture_devices();
+    size_t size, span, n;
+    rewind_delta_t *d;
+
+    if (devs_size < 0)
+        return;
+    size = MEM_BYTES + devs_size;
+    span = page_round(size > ref_size ? size : ref_size);
+    if (!grow(&ref, &ref_cap, span, 1) || !grow(&devs, &devs_cap, span - MEM_BYTES, 1))
+        return;
+    memset(devs + devs_size, 0, span - MEM_BYTES - devs_size);
+
+    if (!ref_size) {
+        memcpy(ref, ram, RAM_SIZE);
+        memcpy(ref + RAM_SIZE, rom_slot_ptr(0), ROM_SIZE * ROM_NSLOT);
+        memcpy(ref + MEM_BYTES, devs, span - MEM_BYTES);
+        ref_size = size;
+        ref_frame = framesrun;
+        return;
+    }
+    if (!grow(&diff_index, &index_cap, span / RW_PAGE, sizeof(uint32_t)) || !grow(&diff_data, &data_cap, span, 1))
+        return;
+
+    n = diff_pages(ref, ram, RAM_SIZE, 0, 0);
+    n = diff_pages(ref + RAM_SIZE, rom_slot_ptr(0), ROM_SIZE * ROM_NSLOT, RAM_SIZE / RW_PAGE, n);
+    n = diff_pages(ref + MEM_BYTES, devs, span - MEM_BYTES, MEM_BYTES / RW_PAGE, n);
+
+    if (!(d = malloc(sizeof(*d) + n * (sizeof(uint32_t) + RW_PAGE)))) {
+        log_error("rewind: out of memory, history cleared");
+        rewind_clear();
+        return;
+    }
+    d->frame = ref_frame;
+    d->size = ref_size;
+    d->npages = n;
+    d->bytes = sizeof(*d) + n * (sizeof(uint32_t) + RW_PAGE);
+    d->data = (uint8_t *)(d + 1);
+    d->index = (uint32_t *)(d->data + n * RW_PAGE);
+    memcpy(d->data, diff_data, n * RW_PAGE);
+    memcpy(d->index, diff_index, n * sizeof(uint32_t));
+    push_newest(d);
+    ref_size = size;
+    ref_frame = framesrun;
+}
+
+static void restore(void)
+{
+    long devs_size = ref_size - MEM_BYTES;
+    FILE *fp;
+
+    memcpy(ram, ref, RAM_SIZE);
+    memcpy(rom_slot_ptr(0), ref + RAM_SIZE, ROM_SIZE * ROM_NSLOT);
+    if (!(fp = open_devices(devs_size))) {
+        log_error("rewind: unable to open memory stream: %s, devices not restored", strerror(errno));
+        return;
+    }
+    writemem(0xFE30, getc(fp));
+    writemem(0xFE34, getc(fp));
+    savestate_load_devices(fp, devs_size - 2);
+    close_devices(fp);
+}
+
+bool rewind_step(int steps)
+{
+    rewind_delta_t *d;
+    size_t i;
+
+    if (!ref_size) {
+        log_warn("rewind: no snapshot to rewind to");
+        return false;
+    }
+    if (at_ref && !ring_count) {
+        log_warn("rewind: no older snapshot");
+        return false;
+    }
+    if (inputlog_active()) {
+        log_warn("rewind: not available while recording or replaying input");
+        return false;
+    }
+    if (at_ref)
+        steps++;
+    if (steps - 1 > ring_count)
+        steps = ring_count + 1;
+    while (--steps > 0) {
+        d = pop_newest();
+        for (i = 0; i < d->npages; i++)
+            memcpy(ref + d->index[i] * RW_PAGE, d->data + i * RW_PAGE, RW_PAGE);
+        ref_size = d->size;
+        ref_frame = d->frame;
+        free(d);
+    }
+    restore();
+    at_ref = true;
+    frames_left = rewind_frames;
+    log_info("rewind: back to frame %d, %d frames ago", ref_frame, framesrun - ref_frame);
+    return true;
+}
+
+/* For callers in the middle of a frame, such as the debugger. */
+
+void rewind_request(int steps)
+{
+    want_steps = steps;
+}
+
+void rewind_frame(void)
+{
+    if (want_steps) {
+        int steps = want_steps;
+        want_steps = 0;
+        if (rewind_step(steps)) {
+#ifndef NO_USE_DEBUGGER
+            if (debug_core)
+                debug_step = 1;
+#endif
+        }
+        return;
+    }
+    at_ref = false;
+    if (!rewind_enabled) {
+        if (ref_size)
+            rewind_clear();
+        return;
+    }
+    if (curtube != -1) {
+        if (!tube_warned) {
+            log_warn("rewind: not available with a second processor");
+            tube_warned = true;
+        }
+        if (ref_size)
+            rewind_clear();
+        return;
+    }
+    tube_warned = false;
+    if (--frames_left > 0)
+        return;
+    frames_left = rewind_frames;
+    capture();
+}
+
+const char *rewind_text(void)
+{
+    static char buf[100];
+
+    if (!ref_size)
+        snprintf(buf, sizeof buf, "no snapshots");
+    else
+        snprintf(buf, sizeof buf, "%d snapshots back to frame %d (%d frames ago), %zuKB",
+                 ring_count + 1, ring_count ? ring[ring_head]->frame : ref_frame,
+                 framesrun - (ring_count ? ring[ring_head]->frame : ref_frame),
+                 (ring_bytes + ref_cap) >> 10);
+    return buf;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef __INC_REWIND_H
+#define __INC_REWIND_H
+
+// the ring is built from savestate sections and keeps the ROMs writable.
+#if (defined(NO_USE_SAVE_STATE) || defined(NO_USE_RAM_ROMS)) && !defined(NO_USE_REWIND)
+#define NO_USE_REWIND
+#endif
+
+#ifndef NO_USE_REWIND
+extern bool rewind_enabled;
+extern int rewind_frames;
+extern int rewind_mb;
+
+void rewind_frame(void);
+void rewind_clear(void);
+void rewind_close(void);
+bool rewind_step(int steps);
+void rewind_request(int steps);
+const char *rewind_text(void);
+#else
+static inline void rewind_frame(void) {}
+static inline void rewind_clear(void) {}
+static inline void rewind_close(void) {}
+#endif
+#endif
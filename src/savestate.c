@@ -1,6 +1,7 @@
 /*B-em v2.2 by Tom Walker
   Savestate handling*/
 #include "b-em.h"
+#include <limits.h>
 #include <zlib.h>
 
 #include "6502.h"
@@ -188,12 +189,8 @@ void savestate_zwrite(ZFILE *zfp, void *src, size_t size)
     log_warn("savestate: compression error %d (%s)", res, zfp->zs.msg);
 }
 
-void savestate_dosave(void)
+static void save_devices(void)
 {
-    fwrite("BEMSNAP2", 8, 1, savestate_fp);
-    save_sect('m', model_savestate);
-    save_sect('6', m6502_savestate);
-    save_zlib('M', mem_savezlib);
     save_sect('S', sysvia_savestate);
     save_sect('U', uservia_savestate);
     save_sect('V', videoula_savestate);
@@ -207,6 +204,15 @@ void savestate_dosave(void)
     save_sect('F', vdfs_savestate);
 #endif
     save_sect('5', music5000_savestate);
+}
+
+void savestate_dosave(void)
+{
+    fwrite("BEMSNAP2", 8, 1, savestate_fp);
+    save_sect('m', model_savestate);
+    save_sect('6', m6502_savestate);
+    save_zlib('M', mem_savezlib);
+    save_devices();
 #ifndef NO_USE_TUBE
     if (curtube != -1) {
         save_sect('T', tube_ula_savestate);
@@ -289,12 +295,12 @@ void savestate_zread(ZFILE *zfp, void *dest, size_t size)
     } while (res == Z_OK && zfp->zs.avail_out > 0);
 }
 
-static void load_state_two(void)
+static void load_sections(long limit)
 {
     unsigned char hdr[4];
     long start, end, size;
 
-    while (fread(hdr, sizeof hdr, 1, savestate_fp) == 1) {
+    while (ftell(savestate_fp) < limit && fread(hdr, sizeof hdr, 1, savestate_fp) == 1) {
         size = hdr[1] | (hdr[2] << 8) | (hdr[3] << 16);
         start = ftell(savestate_fp);
         log_debug("savestate: found section %c of %ld bytes", hdr[0], size);
@@ -365,6 +371,11 @@ static void load_state_two(void)
             fseek(savestate_fp, start + size, SEEK_SET);
         }
     }
+}
+
+static void load_state_two(void)
+{
+    load_sections(LONG_MAX);
     log_debug("savestate: loaded V2 snapshot file");
 }
 
@@ -385,6 +396,28 @@ void savestate_doload(void)
     savestate_fp = NULL;
 }
 
+/* The CPU and devices other than memory, in the V2 section format but
+ * without the model, memory or tube sections, for the rewind ring.
+ */
+void savestate_save_devices(FILE *fp)
+{
+    FILE *save_fp = savestate_fp;
+
+    savestate_fp = fp;
+    save_sect('6', m6502_savestate);
+    save_devices();
+    savestate_fp = save_fp;
+}
+
+void savestate_load_devices(FILE *fp, long size)
+{
+    FILE *load_fp = savestate_fp;
+
+    savestate_fp = fp;
+    load_sections(ftell(fp) + size);
+    savestate_fp = load_fp;
+}
+
 void savestate_save_var(unsigned var, FILE *f) {
     uint8_t byte;
 
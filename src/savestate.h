@@ -13,6 +13,8 @@ void savestate_save(const char *name);
 void savestate_load(const char *name);
 void savestate_dosave(void);
 void savestate_doload(void);
+void savestate_save_devices(FILE *f);
+void savestate_load_devices(FILE *f, long size);
 
 void savestate_zread(ZFILE *zfp, void *dest, size_t size);
 void savestate_zwrite(ZFILE *zfp, void *src, size_t size);
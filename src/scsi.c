@@ -43,6 +43,7 @@ Offset  Description                 Access
 #include <string.h>
 #include "b-em.h"
 #include "main.h"
+#include "overlay.h"
 #include "scsi.h"
 #include "6502.h"
 
@@ -94,6 +95,11 @@ typedef struct {
 static scsi_t scsi;
 static FILE *SCSIDisc[SCSI_DRIVES] = {0};
 static int SCSISize[SCSI_DRIVES];
+#ifndef NO_USE_DISC_WRITE
+// With overlays the geometry is kept here rather than in the .dsc files.
+static unsigned char SCSIGeom[SCSI_DRIVES][22];
+static bool SCSIGeomSet[SCSI_DRIVES];
+#endif
 
 static void BusFree(void)
 {
@@ -222,7 +228,13 @@ static bool DiscFormat(unsigned char *buf)
 
         log_debug("scsi lun %d: format\n", scsi.lun);
         snprintf(name, sizeof(name), "scsi/scsi%d.dat", scsi.lun);
-        if ((dat = fopen(name, "wb+")))
+#ifndef NO_USE_DISC_WRITE
+        if (overlay_enabled)
+                dat = overlay_open(NULL);
+        else
+#endif
+                dat = fopen(name, "wb+");
+        if (dat)
         {
                 if (SCSIDisc[scsi.lun])
                         fclose(SCSIDisc[scsi.lun]);
@@ -424,16 +436,27 @@ static int DiscModeSense(unsigned char *cdb, unsigned char *buf)
 
 	if (SCSIDisc[scsi.lun] == NULL) return 0;
 
+	size = cdb[4];
+	if (size == 0)
+		size = 22;
+
+#ifndef NO_USE_DISC_WRITE
+	if (overlay_enabled) {
+		if (!SCSIGeomSet[scsi.lun]) return 0;
+		if (size > 22)
+			size = 22;
+		memcpy(buf, SCSIGeom[scsi.lun], size);
+		log_debug("scsi lun %d: mode sense, returning %d\n", scsi.lun, size);
+		return size;
+	}
+#endif
+
 	sprintf(buff, "scsi/scsi%d.dsc", scsi.lun);
 
 	f = fopen(buff, "rb");
 
 	if (f == NULL) return 0;
 
-	size = cdb[4];
-	if (size == 0)
-		size = 22;
-
 	size = (int)fread(buf, 1, size, f);
 
 // heads = buf[15];
@@ -570,6 +593,14 @@ static bool WriteGeometory(unsigned char *buf)
 
 	if (SCSIDisc[scsi.lun] == NULL) return false;
 
+#ifndef NO_USE_DISC_WRITE
+	if (overlay_enabled) {
+		memcpy(SCSIGeom[scsi.lun], buf, 22);
+		SCSIGeomSet[scsi.lun] = true;
+		return true;
+	}
+#endif
+
 	sprintf(buff, "scsi/scsi%d.dsc", scsi.lun);
 
 	f = fopen(buff, "wb");
@@ -815,18 +846,21 @@ static void scsi_init_lun(int lun)
 {
         int size, cyl;
         FILE *dat, *dsc;
-        char name[50], geom[22];
+        char name[50], geom[22] = {0};
         ALLEGRO_PATH *path;
         const char *cpath;
 
         SCSISize[lun] = 0;
+#ifndef NO_USE_DISC_WRITE
+        SCSIGeomSet[lun] = false;
+#endif
         snprintf(name, sizeof(name), "scsi/scsi%d", lun);
         if ((path = find_cfg_file(name, ".dat"))) {
             cpath = al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP);
-            if ((dat = fopen(cpath, "rb+"))) {
+            if ((dat = overlay_fopen(cpath))) {
                 al_set_path_extension(path, ".dsc");
                 cpath = al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP);
-                if ((dsc = fopen(cpath, "rb+")))
+                if ((dsc = fopen(cpath, "rb")))
                 {
                         if (fread(geom, sizeof geom, 1, dsc) == 1)
                         {
@@ -835,6 +869,10 @@ static void scsi_init_lun(int lun)
                                 // Number of sectors on disk = heads * cyls * 33
 
                                 SCSISize[lun] = geom[15] * (geom[13] * 256 + geom[14]) * 33;
+#ifndef NO_USE_DISC_WRITE
+                                memcpy(SCSIGeom[lun], geom, sizeof geom);
+                                SCSIGeomSet[lun] = true;
+#endif
                         }
                         else
                                 log_error("scsi lun %d: corrupt dsc file %s", lun, name);
@@ -845,12 +883,19 @@ static void scsi_init_lun(int lun)
                 if (SCSISize[lun] == 0)
                 {
                         SCSISize[lun] = size = fseek(dat, 0, SEEK_END);
+                        cyl = 1 + ((size - 1) / (33 * 255));
+                        geom[13] = (char)(cyl % 256);
+                        geom[14] = (char)(cyl / 256);
+                        geom[15] = (char)255;
+#ifndef NO_USE_DISC_WRITE
+                        if (overlay_enabled) {
+                                memcpy(SCSIGeom[lun], geom, sizeof geom);
+                                SCSIGeomSet[lun] = true;
+                        }
+                        else
+#endif
                         if ((dsc = fopen(name, "wb")))
                         {
-                                cyl = 1 + ((size - 1) / (33 * 255));
-                                geom[13] = (char)(cyl % 256);
-                                geom[14] = (char)(cyl / 256);
-                                geom[15] = (char)255;
                                 if (fwrite(geom, sizeof geom, 1, dsc) != 1)
                                         log_warn("scsi lun %d: unable to write to dsc file %s: %s", lun, name, strerror(errno));
                                 fclose(dsc);
@@ -15,22 +15,26 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "b-em.h"
 #include "disc.h"
+#include "overlay.h"
 #include "sdf.h"
 #if USE_SECTOR_READ
 #include "sector_read.h"
 #endif
 
 #define MMB_CAT_SIZE 0x2000
+#define MMB_CAT_DISCS (MMB_CAT_SIZE / 16 - 1)
+#define MMB_HASH_SIZE 0x4000 // comfortably more than MMB_CAT_DISCS * 17 keys.
 
 #ifdef USE_HW_EVENT
 cycle_timestamp_t hw_event_motor_base;
 #endif
 
 #ifndef USE_SECTOR_READ
-static FILE *sdf_fp[NUM_DRIVES];
+static MACHINE_LOCAL FILE *sdf_fp[NUM_DRIVES];
 #ifndef NO_USE_MMB
 static FILE *mmb_fp;
 #endif
@@ -40,11 +44,13 @@ static struct sector_buffer *sr_sector[NUM_DRIVES];
 static int8_t sr_counter[NUM_DRIVES]; // so we can detect disc change
 static int8_t sr_counter_last[NUM_DRIVES];
 #endif
-static const struct sdf_geometry *geometry[NUM_DRIVES];
-static uint8_t current_track[NUM_DRIVES];
+static MACHINE_LOCAL const struct sdf_geometry *geometry[NUM_DRIVES];
+static MACHINE_LOCAL uint8_t current_track[NUM_DRIVES];
 #ifndef NO_USE_MMB
 static off_t mmb_offset[NUM_DRIVES][2];
 static char *mmb_cat;
+static uint16_t *mmb_hash;
+static struct stat mmb_cat_stat;
 char *mmb_fn;
 #endif
 
@@ -63,15 +69,15 @@ typedef enum {
     ST_FORMAT
 } state_t;
 
-state_t state = ST_IDLE;
+MACHINE_LOCAL state_t state = ST_IDLE;
 
-static uint16_t count = 0;
+static MACHINE_LOCAL uint16_t count = 0;
 
-static int     sdf_time;
-static uint8_t sdf_drive;
-static uint8_t sdf_side;
-static uint8_t sdf_track;
-static uint8_t sdf_sector;
+static MACHINE_LOCAL int     sdf_time;
+static MACHINE_LOCAL uint8_t sdf_drive;
+static MACHINE_LOCAL uint8_t sdf_side;
+static MACHINE_LOCAL uint8_t sdf_track;
+static MACHINE_LOCAL uint8_t sdf_sector;
 
 #ifdef USE_HW_EVENT
 static void sdf_poll();
@@ -79,7 +85,7 @@ static bool invoke_sdf(struct hw_event *event);
 
 //static void sdf_cycle_sync(int);
 
-static struct hw_event sdf_event = {
+static MACHINE_LOCAL struct hw_event sdf_event = {
         .invoke = invoke_sdf
 };
 
@@ -339,14 +345,31 @@ static void sdf_format(int drive, int track, int side, int density)
     }
 }
 
+// States in which each poll moves a byte to or from the FDC's data register.
+static inline bool sdf_transferring(void)
+{
+    return state == ST_READSECTOR || state == ST_WRITESECTOR || (state >= ST_READ_ADDR0 && state <= ST_READ_ADDR5);
+}
+
 static void __time_critical_func(sdf_poll)()
 {
 #ifndef USE_SECTOR_READ
     int c;
 #endif
     uint16_t sect_size;
+    bool fast = fastdisc && sdf_transferring();
 
-    if (++sdf_time <= 16) {
+    if (fast) {
+        // move on as soon as the CPU has read or written the data register.
+        if (fdc_drq && fdc_drq()) {
+#ifdef USE_HW_EVENT
+            sdf_time = 16;
+            set_state(state);
+#endif
+            return;
+        }
+    }
+    else if (++sdf_time <= 16) {
         // todo not sure what this was about!
 //#ifdef USE_HW_EVENT
 //        set_state(state); // hack for HW_EVENT for now; only used by write ... reasonable hack saves a bunch of effort
@@ -493,6 +516,8 @@ static void __time_critical_func(sdf_poll)()
             break;
     }
 #ifdef USE_HW_EVENT
+    if (fast)
+        sdf_time = 16; // poll again in 16 cycles rather than 16 * 17.
     set_state(state);
 #endif
 }
@@ -578,7 +603,7 @@ void sdf_load(int drive, const char *fn, const char *ext)
 #ifndef NO_USE_DISC_WRITE
     writeprot[drive] = 0;
 #endif
-    if ((fp = fopen(fn, "rb+")) == NULL) {
+    if ((fp = overlay_fopen(fn)) == NULL) {
         if ((fp = fopen(fn, "rb")) == NULL) {
             log_error("Unable to open file '%s' for reading - %s", fn, strerror(errno));
             return;
@@ -637,25 +662,107 @@ void sdf_new_disc(int drive, ALLEGRO_PATH *fn, enum sdf_disc_type dtype)
 #endif
 
 #ifndef NO_USE_MMB
+/*
+ * mmb_find looks names up through a hash table of catalogue entries rather
+ * than searching the catalogue.  A name matches an entry if the characters
+ * agree ignoring case, and the entry has a NUL where the name ends, so an
+ * entry is entered once for each NUL in it, and once for sixteen
+ * characters, keyed on that many characters.  Entries are entered in
+ * catalogue order and the table is linearly probed, so the first match
+ * found is the first in the catalogue, as the search found.
+ */
+static uint32_t mmb_name_hash(const char *name, int len)
+{
+    uint32_t hash = 2166136261u ^ len;
+    for (int i = 0; i < len; i++)
+        hash = (hash ^ (name[i] & 0x5f)) * 16777619u;
+    return hash;
+}
+
+static void mmb_index_cat(void)
+{
+    memset(mmb_hash, 0, MMB_HASH_SIZE * sizeof(uint16_t));
+    for (int disc = 0; disc < MMB_CAT_DISCS; disc++) {
+        const char *entry = mmb_cat + 16 * (disc + 1);
+        for (int len = 0; len <= 16; len++) {
+            if (len == 16 || !entry[len]) {
+                uint32_t slot = mmb_name_hash(entry, len) & (MMB_HASH_SIZE - 1);
+                while (mmb_hash[slot])
+                    slot = (slot + 1) & (MMB_HASH_SIZE - 1);
+                mmb_hash[slot] = disc + 1;
+            }
+        }
+    }
+}
+
+static bool mmb_read_cat(FILE *fp, const char *fn)
+{
+    if (fread(mmb_cat, MMB_CAT_SIZE, 1, fp) != 1)
+        return false;
+    mmb_index_cat();
+    // by name so this works for an overlay, which has no file descriptor.
+    if (stat(fn, &mmb_cat_stat))
+        memset(&mmb_cat_stat, 0, sizeof(mmb_cat_stat));
+    return true;
+}
+
+/*
+ * The MMB file may be updated in place by another program, typically an MMB
+ * utility adding or renaming discs, while it is loaded so re-read the
+ * catalogue if the file has changed since it was last read.
+ */
+static bool mmb_cat_changed(const struct stat *st)
+{
+    if (st->st_mtime != mmb_cat_stat.st_mtime || st->st_size != mmb_cat_stat.st_size)
+        return true;
+#if defined(__APPLE__)
+    if (st->st_mtimespec.tv_nsec != mmb_cat_stat.st_mtimespec.tv_nsec)
+        return true;
+#elif defined(st_mtime)
+    // st_mtime is st_mtim.tv_sec so the time is kept to the nanosecond.
+    if (st->st_mtim.tv_nsec != mmb_cat_stat.st_mtim.tv_nsec)
+        return true;
+#endif
+    return false;
+}
+
+static void mmb_check_cat(void)
+{
+    struct stat st;
+    long pos;
+
+    if (!mmb_fp || stat(mmb_fn, &st) || !mmb_cat_changed(&st))
+        return;
+    log_debug("mmb: %s has changed, re-reading catalogue", mmb_fn);
+    pos = ftell(mmb_fp);
+    fflush(mmb_fp); // discard anything already buffered.
+    fseek(mmb_fp, 0, SEEK_SET);
+    if (!mmb_read_cat(mmb_fp, mmb_fn))
+        log_warn("mmb: unable to re-read catalogue from %s", mmb_fn);
+    fseek(mmb_fp, pos, SEEK_SET);
+}
+
 void mmb_load(char *fn)
 {
     FILE *fp;
 
     if (!mmb_cat) {
-        if (!(mmb_cat = malloc(MMB_CAT_SIZE))) {
+        if (!(mmb_cat = malloc(MMB_CAT_SIZE)) || !(mmb_hash = malloc(MMB_HASH_SIZE * sizeof(uint16_t)))) {
             log_error("sdf: out of memory allocating MMB catalogue");
+            free(mmb_cat);
+            mmb_cat = NULL;
             return;
         }
     }
     writeprot[0] = 0;
-    if ((fp = fopen(fn, "rb+")) == NULL) {
+    if ((fp = overlay_fopen(fn)) == NULL) {
         if ((fp = fopen(fn, "rb")) == NULL) {
             log_error("Unable to open file '%s' for reading - %s", fn, strerror(errno));
             return;
         }
         writeprot[0] = 1;
     }
-    if (fread(mmb_cat, MMB_CAT_SIZE, 1, fp) != 1) {
+    if (!mmb_read_cat(fp, fn)) {
         log_error("mmb: %s is not a valid MMB file", fn);
         fclose(fp);
         return;
@@ -766,18 +873,21 @@ static inline int cat_name_cmp(const char *nam_ptr, const char *cat_ptr, const c
 
 int mmb_find(const char *name)
 {
-    const char *cat_ptr = mmb_cat + 16;
-    const char *cat_end = mmb_cat + MMB_CAT_SIZE;
-    int i;
-
-    do {
-        const char *cat_nxt = cat_ptr + 16;
-        if ((i = cat_name_cmp(name, cat_ptr, cat_nxt)) >= 0) {
+    uint32_t slot;
+    int len, i;
+
+    mmb_check_cat();
+    for (len = 0; len < 16 && name[len]; len++)
+        ;
+    slot = mmb_name_hash(name, len) & (MMB_HASH_SIZE - 1);
+    while (mmb_hash[slot]) {
+        const char *cat_ptr = mmb_cat + 16 * mmb_hash[slot];
+        if ((i = cat_name_cmp(name, cat_ptr, cat_ptr + 16)) >= 0) {
             log_debug("mmb: found MMB SSD '%s' at %d", name, i);
             return i;
         }
-        cat_ptr = cat_nxt;
-    } while (cat_ptr < cat_end);
+        slot = (slot + 1) & (MMB_HASH_SIZE - 1);
+    }
     return -1;
 }
 #endif
@@ -0,0 +1,250 @@
+/*
+ * B-EM SDF - Simple Disk Formats - I/O Testing
+ *
+ * This B-Em module is part of the handling of simple disc formats,
+ * i.e. those where the sectors that comprise the disk image are
+ * stored in the file in a logical order and without ID headers.
+ *
+ * This module contains a test harness which drives the SDF backend
+ * in place of a disc controller.  It builds an 80 track SSD image,
+ * reads it back in track order and scattered, writes sectors through
+ * the controller and through the OSWORD &7F path used by VDFS, and
+ * checks every byte read and the image left behind against a copy
+ * kept in memory.  It also reports the host time per sector for each
+ * pattern next to the time a bare fseek and fread of a sector takes,
+ * which is the most a memory mapped or fully loaded image could save.
+ */
+
+#include "b-em.h"
+#include "disc.h"
+#include "sdf.h"
+
+#include <errno.h>
+#include <stdarg.h>
+
+#define TRACKS  80
+#define SECTORS 10
+#define SSIZE   256
+#define IMGSIZE (TRACKS * SECTORS * SSIZE)
+
+MACHINE_LOCAL DRIVE drives[NUM_DRIVES];
+ALLEGRO_PATH *discfns[NUM_DRIVES];
+int writeprot[NUM_DRIVES];
+MACHINE_LOCAL bool fastdisc;
+MACHINE_LOCAL void (*fdc_data)(uint8_t dat);
+MACHINE_LOCAL void (*fdc_spindown)(void);
+MACHINE_LOCAL void (*fdc_finishread)(void);
+MACHINE_LOCAL void (*fdc_notfound)(void);
+MACHINE_LOCAL void (*fdc_writeprotect)(void);
+MACHINE_LOCAL int  (*fdc_getdata)(int last);
+MACHINE_LOCAL bool (*fdc_drq)(void);
+
+void disc_close(int drive) {}
+void disc_load(int drive, ALLEGRO_PATH *fn) {}
+
+void log_error(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    fputs("ERROR ", stderr);
+    vfprintf(stderr, fmt, ap);
+    putc('\n', stderr);
+    va_end(ap);
+}
+
+void log_warn(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    fputs("WARN  ", stderr);
+    vfprintf(stderr, fmt, ap);
+    putc('\n', stderr);
+    va_end(ap);
+}
+
+void log_info(const char *fmt, ...) {}
+
+static uint8_t image[IMGSIZE];  // what the image should hold.
+static uint8_t *expect;         // the next byte a read should give.
+static uint8_t *source;         // the next byte a write should take.
+static int mismatches;
+static int done;
+
+static uint32_t rng = 1;
+
+static uint32_t rnd(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return rng >> 8;
+}
+
+static uint8_t *sector_ptr(int track, int sector)
+{
+    return image + (track * SECTORS + sector) * SSIZE;
+}
+
+static void test_data(uint8_t dat)
+{
+    if (*expect++ != dat)
+        mismatches++;
+}
+
+static int test_getdata(int last)
+{
+    return *source++;
+}
+
+static void test_finished(void)
+{
+    done = 1;
+}
+
+static void test_failed(void)
+{
+    done = 2;
+}
+
+static bool test_drq(void)
+{
+    return false;
+}
+
+static void run(void)
+{
+    done = 0;
+    while (!done)
+        drives[0].poll();
+    if (done != 1)
+        mismatches++;
+}
+
+static void read_sector(int track, int sector)
+{
+    expect = sector_ptr(track, sector);
+    drives[0].seek(0, track);
+    drives[0].readsector(0, sector, track, 0, 0);
+    run();
+}
+
+static void write_sector(int track, int sector)
+{
+    uint8_t *ptr = sector_ptr(track, sector);
+
+    for (int i = 0; i < SSIZE; i++)
+        ptr[i] = rnd();
+    source = ptr;
+    drives[0].seek(0, track);
+    drives[0].writesector(0, sector, track, 0, 0);
+    run();
+}
+
+static void osword_sectors(int track, int sector)
+{
+    uint8_t buf[SSIZE], *ptr;
+    FILE *fp;
+
+    // read one sector and write the next, as OSWORD &7F does.
+    ptr = sector_ptr(track, sector);
+    if (!(fp = sdf_owseek(0, sector, track, 0, SSIZE)) || fread(buf, SSIZE, 1, fp) != 1 || memcmp(buf, ptr, SSIZE))
+        mismatches++;
+    sector = (sector + 1) % SECTORS;
+    ptr = sector_ptr(track, sector);
+    for (int i = 0; i < SSIZE; i++)
+        ptr[i] = rnd();
+    if (!(fp = sdf_owseek(0, sector, track, 0, SSIZE)) || fwrite(ptr, SSIZE, 1, fp) != 1)
+        mismatches++;
+}
+
+static void report(const char *what, double start, int sectors)
+{
+    printf("%-24s %8.0f ns/sector\n", what, (al_get_time() - start) * 1e9 / sectors);
+}
+
+int main(int argc, char **argv)
+{
+    const char *fn = "sdf-iotest.ssd";
+    int passes = 20, track, sector;
+    double start;
+    uint8_t buf[SSIZE];
+    FILE *fp;
+
+    if (argc > 1)
+        passes = atoi(argv[1]);
+    if (argc > 2)
+        fn = argv[2];
+    if (argc > 3 || passes <= 0) {
+        fputs("Usage: sdf-iotest [ <passes> [ <scratch-img.ssd> ] ]\n", stderr);
+        return 1;
+    }
+
+    // a DFS catalogue giving the size of the disc, so it is seen as 80 tracks.
+    for (int i = 0; i < IMGSIZE; i++)
+        image[i] = rnd();
+    memset(image, 0, 2 * SSIZE);
+    image[0x106] = (TRACKS * SECTORS) >> 8;
+    image[0x107] = (TRACKS * SECTORS) & 0xff;
+    if (!(fp = fopen(fn, "wb")) || fwrite(image, IMGSIZE, 1, fp) != 1 || fclose(fp)) {
+        fprintf(stderr, "sdf-iotest: unable to write %s: %s\n", fn, strerror(errno));
+        return 1;
+    }
+
+    fdc_data = test_data;
+    fdc_getdata = test_getdata;
+    fdc_finishread = test_finished;
+    fdc_notfound = test_failed;
+    fdc_writeprotect = test_failed;
+    fdc_drq = test_drq;
+    sdf_load(0, fn, "ssd");
+
+    start = al_get_time();
+    for (int pass = 0; pass < passes; pass++)
+        for (track = 0; track < TRACKS; track++)
+            for (sector = 0; sector < SECTORS; sector++)
+                read_sector(track, sector);
+    report("read in track order", start, passes * TRACKS * SECTORS);
+
+    start = al_get_time();
+    for (int i = 0; i < passes * TRACKS * SECTORS; i++)
+        read_sector(rnd() % TRACKS, rnd() % SECTORS);
+    report("read scattered", start, passes * TRACKS * SECTORS);
+
+    start = al_get_time();
+    for (int i = 0; i < passes * TRACKS; i++) {
+        track = 2 + rnd() % (TRACKS - 2); // leave the catalogue alone.
+        write_sector(track, rnd() % SECTORS);
+    }
+    report("write scattered", start, passes * TRACKS);
+
+    for (track = 2; track < TRACKS; track += 3) {
+        osword_sectors(track, track % SECTORS);
+        read_sector(track, (track + 1) % SECTORS);
+    }
+    drives[0].close(0);
+
+    if (!(fp = fopen(fn, "rb"))) {
+        fprintf(stderr, "sdf-iotest: unable to read back %s: %s\n", fn, strerror(errno));
+        return 1;
+    }
+    start = al_get_time();
+    for (int i = 0; i < passes * TRACKS * SECTORS; i++) {
+        fseek(fp, ((rnd() % TRACKS) * SECTORS + rnd() % SECTORS) * SSIZE, SEEK_SET);
+        if (fread(buf, SSIZE, 1, fp) != 1)
+            mismatches++;
+    }
+    report("bare fseek and fread", start, passes * TRACKS * SECTORS);
+    rewind(fp);
+    for (int i = 0; i < TRACKS * SECTORS; i++)
+        if (fread(buf, SSIZE, 1, fp) != 1 || memcmp(buf, image + i * SSIZE, SSIZE))
+            mismatches++;
+    fclose(fp);
+    remove(fn);
+
+    if (mismatches) {
+        printf("sdf-iotest: %d mismatches\n", mismatches);
+        return 1;
+    }
+    puts("sdf-iotest: all data matched");
+    return 0;
+}
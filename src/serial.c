@@ -9,10 +9,10 @@
 #include "tapenoise.h"
 
 #ifndef NO_USE_ACIA
-int motor, acia_is_tape;
+MACHINE_LOCAL int motor, acia_is_tape;
 
-static uint8_t serial_reg;
-static uint8_t serial_transmit_rate, serial_recive_rate;
+static MACHINE_LOCAL uint8_t serial_reg;
+static MACHINE_LOCAL uint8_t serial_transmit_rate, serial_recive_rate;
 
 void serial_reset()
 {
@@ -9,7 +9,7 @@ void    serial_reset(void);
 void serial_savestate(FILE *f);
 void serial_loadstate(FILE *f);
 
-extern int motor;
-extern int acia_is_tape;
+extern MACHINE_LOCAL int motor;
+extern MACHINE_LOCAL int acia_is_tape;
 #endif
 #endif
@@ -4,6 +4,7 @@
   * Internal SN sound chip emulation*/
 
 #include "b-em.h"
+#include "inputlog.h"
 #include "sid_b-em.h"
 #include "sn76489.h"
 #include "sound.h"
@@ -20,17 +21,17 @@ CU_REGISTER_DEBUG_PINS(sound_gen)
 #define DEBUG_PINS_CLR(x)
 #define DEBUG_PINS_XOR(x)
 #endif
-uint8_t sn_freqhi[4], sn_freqlo[4];
-uint8_t sn_vol[4];
-uint8_t sn_noise;
-static uint16_t sn_shift;
-static int8_t lasttone;
-static int sn_count[4], sn_stat[4];
-uint32_t sn_latch[4];
+MACHINE_LOCAL uint8_t sn_freqhi[4], sn_freqlo[4];
+MACHINE_LOCAL uint8_t sn_vol[4];
+MACHINE_LOCAL uint8_t sn_noise;
+static MACHINE_LOCAL uint16_t sn_shift;
+static MACHINE_LOCAL int8_t lasttone;
+static MACHINE_LOCAL int sn_count[4], sn_stat[4];
+MACHINE_LOCAL uint32_t sn_latch[4];
 
 #ifndef PICO_BUILD
-static int sn_rect_pos = 0;
-static int sn_rect_dir = 0;
+static MACHINE_LOCAL int sn_rect_pos = 0;
+static MACHINE_LOCAL int sn_rect_dir = 0;
 #else
 #define SQUARE_ONLY_SOUND
 #endif
@@ -72,7 +73,7 @@ static uint8_t volslog_int[16] = {
 };*/
 
 #ifndef SQUARE_ONLY_SOUND
-static int16_t snwaves[5][32] =
+static MACHINE_LOCAL int16_t snwaves[5][32] =
 {
         {
 	         127,  127,  127,  127,  127,  127,  127,  127,  127,  127,  127,  127,  127,  127,  127,  127,
@@ -111,7 +112,7 @@ void __time_critical_func(sn_fillbuf)(int16_t *buffer, int len)
 #endif
 #ifndef SQUARE_ONLY_SOUND
         int c, d;
-        static int sidcount = 0;
+        static MACHINE_LOCAL int sidcount = 0;
         for (d = 0; d < len; d++)
         {
                 for (c = 0; c < 3; c++)
@@ -270,7 +271,9 @@ void sn_init()
         sn_latch[0] = sn_latch[1] = sn_latch[2] = sn_latch[3] = 0x3FF << 6;
         sn_vol[0] = 0;
         sn_vol[1] = sn_vol[2] = sn_vol[3] = 8;
-        srand(time(NULL));
+        // keep the noise phases the same for each replay of an input log.
+        if (!inputlog_active())
+            srand(time(NULL));
         sn_count[0] = 0;
         sn_count[1] = (rand()&0x3FF)<<6;
         sn_count[2] = (rand()&0x3FF)<<6;
@@ -279,7 +282,7 @@ void sn_init()
         sn_shift = 0x4000;
 }
 
-static uint8_t firstdat;
+static MACHINE_LOCAL uint8_t firstdat;
 void sn_handle_write(uint8_t data)
 {
         int freq;
@@ -10,10 +10,10 @@ void sn_loadstate(FILE *f);
 #endif
 void sn_setvolume(uint8_t vol);
 
-extern uint8_t sn_freqhi[4],sn_freqlo[4];
-extern uint8_t sn_vol[4];
-extern uint8_t sn_noise;
-extern uint32_t sn_latch[4];
+extern MACHINE_LOCAL uint8_t sn_freqhi[4],sn_freqlo[4];
+extern MACHINE_LOCAL uint8_t sn_vol[4];
+extern MACHINE_LOCAL uint8_t sn_noise;
+extern MACHINE_LOCAL uint32_t sn_latch[4];
 
 extern int curwave;
 
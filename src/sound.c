@@ -2,11 +2,13 @@
   * Pico version (C) 2021 Graham Sanderson
   * Internal SN sound chip emulation*/
 
+#include <errno.h>
 #include "b-em.h"
 #include <allegro5/allegro_audio.h>
 #include "sid_b-em.h"
 #include "sn76489.h"
 #include "sound.h"
+#include "speedmeter.h"
 #include "via.h"
 #include "uservia.h"
 #include "music5000.h"
@@ -22,9 +24,10 @@ static ALLEGRO_VOICE *voice;
 static ALLEGRO_MIXER *mixer;
 static ALLEGRO_AUDIO_STREAM *stream;
 
-static int sound_pos = 0;
+static MACHINE_LOCAL int sound_pos = 0;
 //#ifndef PICO_BUILD
-static short sound_buffer[BUFLEN_SO];
+static MACHINE_LOCAL short sound_buffer[BUFLEN_SO];
+static MACHINE_LOCAL FILE *sound_fp;
 //#else
 //static int16_t *sound_buffer;
 //#endif
@@ -48,8 +51,8 @@ static float iir(float NewSample) {
         0.17253125052500490000
     };
 
-    static float y[NCoef+1]; //output samples
-    static float x[NCoef+1]; //input samples
+    static MACHINE_LOCAL float y[NCoef+1]; //output samples
+    static MACHINE_LOCAL float x[NCoef+1]; //input samples
     int n;
 
     //shift the old samples
@@ -68,11 +71,22 @@ static float iir(float NewSample) {
 }
 #endif
 
+static void sound_rec_write(void)
+{
+    uint8_t bytes[BUFLEN_SO * 2];
+
+    for (int c = 0; c < BUFLEN_SO; c++) {
+        bytes[c * 2] = sound_buffer[c] & 0xff;
+        bytes[c * 2 + 1] = (sound_buffer[c] >> 8) & 0xff;
+    }
+    fwrite(bytes, sizeof bytes, 1, sound_fp);
+}
+
 void __time_critical_func(sound_poll)()
 {
     int c;
 
-    if ((sound_internal || sound_beebsid) && stream) {
+    if ((sound_internal || sound_beebsid) && (stream || sound_fp)) {
 #ifndef NO_USE_SID
         if (sound_beebsid)
             sid_fillbuf(sound_buffer + sound_pos, 2);
@@ -88,7 +102,11 @@ void __time_critical_func(sound_poll)()
         sound_pos += 2;
         if (sound_pos == BUFLEN_SO) {
             float *buf;
-            if ((buf = al_get_audio_stream_fragment(stream))) {
+            if (sound_fp)
+                sound_rec_write();
+            if (!stream)
+                ;
+            else if ((buf = al_get_audio_stream_fragment(stream))) {
 #ifndef NO_USE_SOUND_FILTER
                 if (sound_filter) {
                     for (c = 0; c < BUFLEN_SO; c++)
@@ -109,6 +127,57 @@ void __time_critical_func(sound_poll)()
     }
 }
 
+void sound_poll_n(int n)
+{
+    while (n--)
+        sound_poll();
+}
+
+#ifdef USE_HW_EVENT
+// with the hardware event queue sound is generated in batches of 128
+// polls, and brought up to date before each write to the sound chip.
+#define SOUND_CYCLES (128 * 128)
+
+static bool sound_invoke(struct hw_event *event);
+
+static MACHINE_LOCAL struct hw_event sound_event = {
+    .invoke = sound_invoke
+};
+
+int sound_cycle_sync() {
+    uint32_t delta = get_hardware_timestamp() - sound_event.user_time;
+    int n = delta >> 7;
+
+    if (n > 0) {
+        if (stream || sound_fp) {
+            speed_sect_t sect = speed_enter(SPEED_SOUND);
+            sound_poll_n(n);
+            speed_leave(sect);
+        }
+        sound_event.user_time += n * 128;
+    }
+    return delta & 127;
+}
+
+static bool sound_invoke(struct hw_event *event)
+{
+    sound_cycle_sync();
+    event->target += SOUND_CYCLES;
+    return true;
+}
+
+static void sound_start_events(void)
+{
+    sound_event.user_time = get_hardware_timestamp();
+    sound_event.target = sound_event.user_time + SOUND_CYCLES;
+    upsert_hw_event(&sound_event);
+}
+#else
+int sound_cycle_sync() {
+    return 0;
+}
+#endif
+
 static ALLEGRO_VOICE *sound_create_voice(void)
 {
     ALLEGRO_VOICE *voice;
@@ -148,6 +217,9 @@ void sound_init(void)
                 if ((stream = al_create_audio_stream(4, BUFLEN_SO, FREQ_SO, ALLEGRO_AUDIO_DEPTH_FLOAT32, ALLEGRO_CHANNEL_CONF_1))) {
                     if (!al_attach_audio_stream_to_mixer(stream, mixer))
                         log_error("sound: unable to attach stream to mixer for internal/SID/DAC sound");
+#ifdef USE_HW_EVENT
+                    sound_start_events();
+#endif
                 } else
                     log_error("sound: unable to create stream for internal/SID/DAC sound");
             } else
@@ -168,6 +240,60 @@ void sound_close(void)
         al_destroy_voice(voice);
 }
 
-int sound_cycle_sync() {
-    return 0;
+FILE *sound_rec_start(const char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (fp) {
+        fseek(fp, 44, SEEK_SET);
+        sound_fp = fp;
+        sound_pos = 0;
+        memset(sound_buffer, 0, sizeof(sound_buffer));
+#ifdef USE_HW_EVENT
+        sound_start_events();
+#endif
+    }
+    else
+        log_error("sound: unable to open %s for writing: %s", filename, strerror(errno));
+    return fp;
 }
+
+static void fput16le(uint16_t v, FILE *fp)
+{
+    putc(v & 0xff, fp);
+    putc((v >> 8) & 0xff, fp);
+}
+
+static void fput32le(uint32_t v, FILE *fp)
+{
+    putc(v & 0xff, fp);
+    putc((v >> 8) & 0xff, fp);
+    putc((v >> 16) & 0xff, fp);
+    putc((v >> 24) & 0xff, fp);
+}
+
+void sound_rec_stop(void)
+{
+    FILE *fp = sound_fp;
+    long size;
+
+    if (!fp)
+        return;
+    sound_cycle_sync();
+    size = ftell(fp) - 8;
+    fseek(fp, 0, SEEK_SET);
+    fwrite("RIFF", 4, 1, fp);
+    fput32le(size, fp);
+    fwrite("WAVEfmt ", 8, 1, fp);
+    fput32le(16, fp);          // format chunk size.
+    fput16le(1, fp);           // format 1=PCM.
+    fput16le(1, fp);           // channels 1=mono.
+    fput32le(FREQ_SO, fp);     // sample rate.
+    fput32le(FREQ_SO * 2, fp); // byte rate.
+    fput16le(2, fp);           // block align.
+    fput16le(16, fp);          // bits per sample.
+    fwrite("data", 4, 1, fp);
+    fput32le(size - 36, fp);   // data size.
+    fclose(fp);
+    sound_fp = NULL;
+}
+
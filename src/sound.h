@@ -24,4 +24,8 @@ void sound_poll(void);
 void sound_poll_n(int n);
 int sound_cycle_sync();
 
+/* Record internal/SID/DAC sound to a 16-bit mono WAV file. */
+FILE *sound_rec_start(const char *filename);
+void sound_rec_stop(void);
+
 #endif
@@ -0,0 +1,204 @@
+/*B-em v2.2 by Tom Walker
+ * Pico version (C) 2021 Graham Sanderson
+ *
+ * Emulation speed meter*/
+
+#include "b-em.h"
+#include "speedmeter.h"
+#include <time.h>
+
+#ifndef NO_USE_SPEED_METER
+
+/*
+ * A sampling thread notes which part of the emulator is running about
+ * once a millisecond, so the emulation itself only has to store a byte
+ * on entry to and exit from each part.  The frame counts come from
+ * speed_frame, called once per emulated frame of 40000 6502 cycles,
+ * which also starts the thread when the speed is shown or the emulator
+ * is running at full speed and stops it otherwise, so there is nothing
+ * waking up a thousand times a second when there is nothing to measure.
+ */
+#define SPEED_SAMPLE_SECS 0.001
+#define SPEED_WINDOW_SECS 1.0
+#define CYCLES_PER_FRAME  40000
+
+volatile uint8_t speed_sect;
+bool speed_show = false;
+
+typedef struct {
+    int frames;
+    int drawn;
+    double secs;
+    double cpu;         // process CPU time, all threads
+    unsigned samples[SPEED_NSECT];
+} speed_count_t;
+
+static const char *const sect_names[SPEED_NSECT] = {
+    "other", "cpu", "video", "sound", "tube", "disc"
+};
+
+static ALLEGRO_THREAD *speed_thread;
+static volatile unsigned speed_samples[SPEED_NSECT];
+static unsigned last_samples[SPEED_NSECT];
+static double last_time;
+static clock_t last_clock;
+static speed_count_t window;    // the last second or so, for the display
+static speed_count_t total;     // all frames run at full speed
+static char speed_buf[80];
+
+static void *speed_sampler(ALLEGRO_THREAD *thread, void *data)
+{
+    while (!al_get_thread_should_stop(thread)) {
+        speed_samples[speed_sect % SPEED_NSECT]++;
+        al_rest(SPEED_SAMPLE_SECS);
+    }
+    return NULL;
+}
+
+static void speed_start(void)
+{
+    int i;
+
+    if (!(speed_thread = al_create_thread(speed_sampler, NULL))) {
+        log_warn("speed: unable to create sampling thread, speed meter disabled");
+        return;
+    }
+    for (i = 0; i < SPEED_NSECT; i++)
+        last_samples[i] = speed_samples[i];
+    memset(&window, 0, sizeof window);
+    speed_buf[0] = 0;
+    last_time = al_get_time();
+    last_clock = clock();
+    al_start_thread(speed_thread);
+}
+
+static void speed_stop(void)
+{
+    if (speed_thread) {
+        al_set_thread_should_stop(speed_thread);
+        al_join_thread(speed_thread, NULL);
+        al_destroy_thread(speed_thread);
+        speed_thread = NULL;
+    }
+}
+
+void speed_close(void)
+{
+    speed_stop();
+    if (total.frames)
+        log_info("speed: %d frames at full speed, %.2fMHz, %.0f%% of real time",
+                 total.frames, total.frames * CYCLES_PER_FRAME / total.secs / 1e6,
+                 total.frames * 100.0 / (total.secs * 50.0));
+}
+
+static unsigned sample_sum(const speed_count_t *c)
+{
+    unsigned sum = 0;
+    int i;
+
+    for (i = 0; i < SPEED_NSECT; i++)
+        sum += c->samples[i];
+    return sum;
+}
+
+static void speed_format(const speed_count_t *c)
+{
+    unsigned sum = sample_sum(c);
+    double mhz = c->frames * CYCLES_PER_FRAME / c->secs / 1e6;
+    int len;
+
+    len = snprintf(speed_buf, sizeof speed_buf, "%3.0f%% %5.2fMHz %3.0ffps %3.0f drawn",
+                   mhz * 50.0, mhz, c->frames / c->secs, c->drawn / c->secs);
+    if (sum && len > 0 && len < sizeof speed_buf)
+        snprintf(speed_buf + len, sizeof speed_buf - len, " cpu %2u%% vid %2u%% snd %2u%%",
+                 c->samples[SPEED_CPU] * 100 / sum, c->samples[SPEED_VIDEO] * 100 / sum,
+                 c->samples[SPEED_SOUND] * 100 / sum);
+}
+
+void speed_frame(bool fullspeed)
+{
+    unsigned samples[SPEED_NSECT];
+    double now, secs, cpu;
+    clock_t now_clock;
+    int i;
+
+    if (!speed_thread) {
+        // timing starts from here, so this frame is not counted.
+        if (speed_show || fullspeed)
+            speed_start();
+        return;
+    }
+    if (!speed_show && !fullspeed) {
+        speed_stop();
+        return;
+    }
+    now = al_get_time();
+    secs = now - last_time;
+    last_time = now;
+    now_clock = clock();
+    cpu = (double)(now_clock - last_clock) / CLOCKS_PER_SEC;
+    last_clock = now_clock;
+    for (i = 0; i < SPEED_NSECT; i++) {
+        unsigned count = speed_samples[i];
+        samples[i] = count - last_samples[i];
+        last_samples[i] = count;
+    }
+
+    window.frames++;
+    window.secs += secs;
+    for (i = 0; i < SPEED_NSECT; i++)
+        window.samples[i] += samples[i];
+    if (window.secs >= SPEED_WINDOW_SECS) {
+        speed_format(&window);
+        memset(&window, 0, sizeof window);
+    }
+
+    if (fullspeed) {
+        total.frames++;
+        total.secs += secs;
+        total.cpu += cpu;
+        for (i = 0; i < SPEED_NSECT; i++)
+            total.samples[i] += samples[i];
+    }
+}
+
+void speed_drawn(void)
+{
+    window.drawn++;
+    total.drawn++;
+}
+
+const char *speed_text(void)
+{
+    return speed_buf;
+}
+
+/*
+ * Summarise the frames run at full speed, which is all of them for a
+ * headless run, as a measure of how fast the emulator itself is.
+ */
+void speed_report(FILE *fp)
+{
+    unsigned sum = sample_sum(&total);
+    int i;
+
+    if (!total.frames || total.secs <= 0.0) {
+        fputs("speed: no frames were run at full speed\n", fp);
+        return;
+    }
+    fprintf(fp, "speed: %d frames (%d drawn) in %.2fs\n", total.frames, total.drawn, total.secs);
+    fprintf(fp, "speed: %.2fMHz, %.0f%% of real time, %.1f frames/s, %.3fms per frame\n",
+            total.frames * CYCLES_PER_FRAME / total.secs / 1e6,
+            total.frames * 100.0 / (total.secs * 50.0),
+            total.frames / total.secs, total.secs * 1000.0 / total.frames);
+    fprintf(fp, "speed: %.3fms host CPU per frame, %.0f%% of one core\n",
+            total.cpu * 1000.0 / total.frames, total.cpu * 100.0 / total.secs);
+    if (sum) {
+        fputs("speed: time in", fp);
+        for (i = 0; i < SPEED_NSECT; i++)
+            fprintf(fp, " %s %.1f%%", sect_names[i], total.samples[i] * 100.0 / sum);
+        putc('\n', fp);
+    }
+}
+
+#endif
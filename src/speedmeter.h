@@ -0,0 +1,49 @@
+#ifndef __INC_SPEEDMETER_H
+#define __INC_SPEEDMETER_H
+
+// where the emulator is spending its time, as sampled by the speed meter.
+typedef enum {
+    SPEED_OTHER,    // outside the emulation: GUI, events, waiting
+    SPEED_CPU,
+    SPEED_VIDEO,
+    SPEED_SOUND,
+    SPEED_TUBE,
+    SPEED_DISC,
+    SPEED_NSECT
+} speed_sect_t;
+
+// the sections are per process so machines of a batch cannot share them.
+#if defined(USE_MULTI_MACHINE) && !defined(NO_USE_SPEED_METER)
+#define NO_USE_SPEED_METER
+#endif
+
+#ifndef NO_USE_SPEED_METER
+extern volatile uint8_t speed_sect;
+extern bool speed_show;
+
+void speed_close(void);
+void speed_frame(bool fullspeed);
+void speed_drawn(void);
+const char *speed_text(void);
+void speed_report(FILE *fp);
+
+static inline speed_sect_t speed_enter(speed_sect_t sect)
+{
+    speed_sect_t prev = speed_sect;
+    speed_sect = sect;
+    return prev;
+}
+
+static inline void speed_leave(speed_sect_t prev)
+{
+    speed_sect = prev;
+}
+#else
+#define speed_show false
+static inline void speed_close(void) {}
+static inline void speed_frame(bool fullspeed) {}
+static inline void speed_drawn(void) {}
+static inline speed_sect_t speed_enter(speed_sect_t sect) { return SPEED_OTHER; }
+static inline void speed_leave(speed_sect_t prev) {}
+#endif
+#endif
@@ -29,7 +29,7 @@ static void sysacia_tx_end(ACIA *acia) {
 void tape_receive(ACIA *acia, uint8_t byte) {}
 #endif
 #ifndef NO_USE_ACIA
-ACIA sysacia = {
+MACHINE_LOCAL ACIA sysacia = {
     .set_params = sysvia_set_params,
     .rx_hook    = tape_receive,
     .tx_hook    = sysacia_tx_hook,
@@ -4,7 +4,7 @@
 #ifndef NO_USE_ACIA
 #include "acia.h"
 
-extern ACIA sysacia;
+extern MACHINE_LOCAL ACIA sysacia;
 extern int sysacia_tapespeed;
 
 void sysacia_poll(void);
@@ -13,7 +13,7 @@
 #include "sn76489.h"
 #include "video.h"
 
-VIA sysvia;
+MACHINE_LOCAL VIA sysvia;
 
 #define KB_CAPSLOCK_FLAG 0x0400
 #define KB_SCROLOCK_FLAG 0x0100
@@ -48,14 +48,14 @@ void __time_critical_func(sysvia_via_set_cb2)(int level)
 
 
 /*Current state of IC32 output*/
-uint8_t IC32=0;
+MACHINE_LOCAL uint8_t IC32=0;
 /*Current effective state of the slow data bus*/
-uint8_t sdbval;
+MACHINE_LOCAL uint8_t sdbval;
 /*What the System VIA is actually outputting to the slow data bus
   For use when contending with whatever else is outputting to the bus*/
-static uint8_t sysvia_sdb_out;
+static MACHINE_LOCAL uint8_t sysvia_sdb_out;
 
-int kbdips;
+MACHINE_LOCAL int kbdips;
 
 /*Calculate current state of slow data bus
   B-em emulates three bus masters - the System VIA itself, the keyboard (bit 7
@@ -1,15 +1,15 @@
 #ifndef __INC_SYSVIA_H
 #define __INC_SYSVIA_H
 
-extern VIA sysvia;
+extern MACHINE_LOCAL VIA sysvia;
 
 void    sysvia_reset(void);
 
 void    sysvia_savestate(FILE *f);
 void    sysvia_loadstate(FILE *f);
 
-extern uint8_t IC32;
-extern uint8_t sdbval;
+extern MACHINE_LOCAL uint8_t IC32;
+extern MACHINE_LOCAL uint8_t sdbval;
 
 void set_scrsize(int);
 
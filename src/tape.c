@@ -6,11 +6,11 @@
 #include "csw.h"
 
 #ifndef NO_USE_TAPE
-int tapelcount,tapellatch;
+MACHINE_LOCAL int tapelcount,tapellatch;
 
-bool tape_loaded = false;
-bool fasttape = false;
-ALLEGRO_PATH *tape_fn = NULL;
+MACHINE_LOCAL bool tape_loaded = false;
+MACHINE_LOCAL bool fasttape = false;
+MACHINE_LOCAL ALLEGRO_PATH *tape_fn = NULL;
 
 static struct
 {
@@ -29,7 +29,7 @@ loaders[]=
         {0,0,0}
 };
 
-static int tape_loader;
+static MACHINE_LOCAL int tape_loader;
 
 void tape_load(ALLEGRO_PATH *fn)
 {
@@ -66,7 +66,7 @@ void tape_close()
 /*Every 128 clocks, ie 15.625khz*/
 /*Div by 13 gives roughly 1200hz*/
 
-static uint16_t newdat;
+static MACHINE_LOCAL uint16_t newdat;
 
 void tape_poll(void) {
     if (motor) {
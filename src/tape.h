@@ -4,16 +4,16 @@
 #include "acia.h"
 
 #ifndef NO_USE_TAPE
-extern ALLEGRO_PATH *tape_fn;
+extern MACHINE_LOCAL ALLEGRO_PATH *tape_fn;
 
 void tape_load(ALLEGRO_PATH *fn);
 void tape_close(void);
 void tape_poll(void);
 void tape_receive(ACIA *acia, uint8_t data);
 
-extern bool tape_loaded;
-extern int tapelcount,tapellatch;
-extern bool fasttape;
+extern MACHINE_LOCAL bool tape_loaded;
+extern MACHINE_LOCAL int tapelcount,tapellatch;
+extern MACHINE_LOCAL bool fasttape;
 #endif
 
 #endif
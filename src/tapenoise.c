@@ -70,6 +70,8 @@ static void send_buffer(void)
     int c;
 
     tpnoisep = 0;
+    if (!stream) // no sound output, as in a headless run.
+        return;
     if ((tapebuffer = al_get_audio_stream_fragment(stream))) {
 
         for (c = 0; c < BUFLEN_DD; c++) {
@@ -66,11 +66,11 @@ const uint8_t *fcff_ram_mapping;
 // is selected when executing code from 0xc000-0xe000 (and sometimes 0xa000-0xb000)
 
 
-#if PICO_NO_HARDWARE
+#if !PICO_ON_DEVICE
 #ifndef MAX
 #define MAX(a,b) ((a)<(b)?(b):(a))
 #endif
-// on hardware this points into our XIP cache bit dumpster
+// on hardware this points into our XIP cache bit dumpster (see mem_init)
 static uint8_t garbage_read[ MAX(CPU_MEM_BLOCKSIZE, ROM_SIZE) ];
 static uint8_t garbage_write[ MAX(CPU_MEM_BLOCKSIZE, ROM_SIZE) ];
 uint8_t *g_garbage_read = garbage_read;
@@ -521,7 +521,7 @@ uint8_t hw_read(uint16_t addr) {
 #ifndef NO_USE_ADC
             case 0x18/8:
                 if (off < 0x1c) return master_only_adc_read(addr);
-                breaj;
+                break;
 #endif
             case 0x20/8:
                 if (off >= 0x24) return master_only_wd1770_read(addr);
@@ -532,6 +532,7 @@ uint8_t hw_read(uint16_t addr) {
             case 0x30/8:
                 if (off >= 0x34) return master_only_acccon(addr);
                 break;
+#endif
             case 0x40/8:
             case 0x48/8:
             case 0x50/8:
@@ -547,26 +548,20 @@ uint8_t hw_read(uint16_t addr) {
             case 0x90/8:
             case 0x98/8:
                 return non_master_fdc_read(addr);
-#endif
 #ifndef NO_USE_ADC
-                [0xc0/4] = master_only_adc_read,
-        [0xc4/4] = master_only_adc_read,
-        [0xc8/4] = master_only_adc_read,
-        [0xcc/4] = master_only_adc_read,
-        [0xd0/4] = master_only_adc_read,
-        [0xd4/4] = master_only_adc_read,
-        [0xd8/4] = master_only_adc_read,
-        [0xdc/4] = master_only_adc_read,
+            case 0xc0/8:
+            case 0xc8/8:
+            case 0xd0/8:
+            case 0xd8/8:
+                if (!MASTER) return adc_read(addr);
+                break;
 #endif
 #ifndef NO_USE_TUBE
-                [0xe0/4] = tube_host_read,
-        [0xe4/4] = tube_host_read,
-        [0xe8/4] = tube_host_read,
-        [0xec/4] = tube_host_read,
-        [0xf0/4] = tube_host_read,
-        [0xf4/4] = tube_host_read,
-        [0xf8/4] = tube_host_read,
-        [0xfc/4] = tube_host_read,
+            case 0xe0/8:
+            case 0xe8/8:
+            case 0xf0/8:
+            case 0xf8/8:
+                return tube_host_read(addr);
 #endif
         }
         return SHIELA_DEFAULT_READ;
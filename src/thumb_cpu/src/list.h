@@ -3,7 +3,13 @@
  */
 #ifndef B_EM_PICO_LIST_H
 #define B_EM_PICO_LIST_H
+#ifdef PICO_BUILD
 #include <pico.h>
+#else
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#endif
 
 struct list_element {
     struct list_element *next;
@@ -4,7 +4,10 @@
 #include <stdio.h>
 #include "b-em.h"
 #include "6502.h"
+#include "debugger.h"
+#include "inputlog.h"
 #include "model.h"
+#include "speedmeter.h"
 #include "tube.h"
 
 #include "NS32016/32016.h"
@@ -49,6 +52,51 @@ tubetype tube_type=TUBEX86;
 
 static int tube_romin=1;
 
+#ifndef NO_USE_TUBE_THREAD
+#include <stdatomic.h>
+
+/*
+ * With tube_threaded set the parasite runs on a thread of its own.  The
+ * host hands it cycles as it goes and waits once it is more than
+ * TUBE_SKEW of its own cycles ahead.  At the end of each frame the host
+ * waits for the parasite to use up all it has been given, so outside
+ * the 6502 exec the parasite is always idle and the rest of the emulator
+ * can treat it as before.
+ *
+ * The ULA registers are shared under tube_lock.  A register access
+ * updates the interrupts of the processor making it at once and leaves
+ * the other processor to update its own, on its own thread, when it
+ * next checks in.
+ */
+#define TUBE_SKEW 2000
+
+bool tube_threaded;
+bool tube_thread_on;
+
+static ALLEGRO_THREAD *tube_thread;
+static ALLEGRO_MUTEX *tube_lock, *tube_wait_lock;
+static ALLEGRO_COND *tube_para_cond, *tube_host_cond;
+static atomic_int tube_credit;
+static atomic_bool tube_para_idle, tube_host_waiting, tube_stop;
+static atomic_bool tube_host_dirty, tube_para_dirty;
+static _Thread_local bool on_tube_thread;
+
+static inline void tube_ula_lock(void)
+{
+    if (tube_thread_on)
+        al_lock_mutex(tube_lock);
+}
+
+static inline void tube_ula_unlock(void)
+{
+    if (tube_thread_on)
+        al_unlock_mutex(tube_lock);
+}
+#else
+static inline void tube_ula_lock(void) {}
+static inline void tube_ula_unlock(void) {}
+#endif
+
 #define PH1_SIZE 24
 
 struct
@@ -59,14 +107,17 @@ struct
         int ph1tail,ph1head,ph1count,ph3pos,hp3pos;
 } tubeula;
 
-void tube_updateints()
+static void tube_update_host(void)
 {
-    int new_irq = 0;
-
     interrupt_clr_mask(8);
 
     if ((tubeula.r1stat & 1) && (tubeula.hstat[3] & 128))
         interrupt_set_mask(8);
+}
+
+static void tube_update_parasite(void)
+{
+    int new_irq = 0;
 
     if (((tubeula.r1stat & 2) && (tubeula.pstat[0] & 128)) || ((tubeula.r1stat & 4) && (tubeula.pstat[3] & 128))) {
         new_irq |= 1;
@@ -90,10 +141,29 @@ void tube_updateints()
     tube_irq = new_irq;
 }
 
+void tube_updateints()
+{
+#ifndef NO_USE_TUBE_THREAD
+    if (tube_thread_on) {
+        if (on_tube_thread) {
+            tube_update_parasite();
+            atomic_store(&tube_host_dirty, true);
+        } else {
+            tube_update_host();
+            atomic_store(&tube_para_dirty, true);
+        }
+        return;
+    }
+#endif
+    tube_update_host();
+    tube_update_parasite();
+}
+
 uint8_t tube_host_read(uint16_t addr)
 {
         uint8_t temp = 0;
         if (!tube_exec) return 0xFE;
+        tube_ula_lock();
         switch (addr & 7)
         {
             case 0: /*Reg 1 Stat*/
@@ -150,12 +220,14 @@ uint8_t tube_host_read(uint16_t addr)
                 break;
         }
         tube_updateints();
+        tube_ula_unlock();
         return temp;
 }
 
 void tube_host_write(uint16_t addr, uint8_t val)
 {
         if (!tube_exec) return;
+        tube_ula_lock();
         switch (addr & 7)
         {
             case 0: /*Register 1 stat*/
@@ -204,11 +276,13 @@ void tube_host_write(uint16_t addr, uint8_t val)
                 break;
         }
         tube_updateints();
+        tube_ula_unlock();
 }
 
 uint8_t tube_parasite_read(uint32_t addr)
 {
         uint8_t temp = 0;
+        tube_ula_lock();
         switch (addr & 7)
         {
             case 0: /*Register 1 stat*/
@@ -272,11 +346,13 @@ uint8_t tube_parasite_read(uint32_t addr)
                 break;
         }
         tube_updateints();
+        tube_ula_unlock();
         return temp;
 }
 
 void tube_parasite_write(uint32_t addr, uint8_t val)
 {
+        tube_ula_lock();
         switch (addr & 7)
         {
             case 1: /*Register 1*/
@@ -324,6 +400,7 @@ void tube_parasite_write(uint32_t addr, uint8_t val)
                 break;
         }
         tube_updateints();
+        tube_ula_unlock();
 }
 
 void tube_updatespeed()
@@ -370,3 +447,173 @@ void tube_ula_loadstate(FILE *f)
     fread(&tubeula, sizeof tubeula, 1, f);
     tube_updateints();
 }
+
+#ifndef NO_USE_TUBE_THREAD
+
+static void *tube_thread_main(ALLEGRO_THREAD *thread, void *data)
+{
+    on_tube_thread = true;
+    for (;;) {
+        int cycles = atomic_exchange(&tube_credit, 0);
+        if (cycles && atomic_load(&tube_host_waiting)) {
+            al_lock_mutex(tube_wait_lock);
+            al_signal_cond(tube_host_cond);
+            al_unlock_mutex(tube_wait_lock);
+        }
+        tubecycles += cycles;
+        if (atomic_load(&tube_para_dirty) && atomic_exchange(&tube_para_dirty, false)) {
+            al_lock_mutex(tube_lock);
+            tube_update_parasite();
+            al_unlock_mutex(tube_lock);
+        }
+        if (tubecycles > 3) {
+            tube_exec();
+            continue;
+        }
+        // nothing to run until the host catches up.
+        al_lock_mutex(tube_wait_lock);
+        atomic_store(&tube_para_idle, true);
+        if (atomic_load(&tube_host_waiting))
+            al_signal_cond(tube_host_cond);
+        while (atomic_load(&tube_credit) + tubecycles <= 3 && !atomic_load(&tube_stop))
+            al_wait_cond(tube_para_cond, tube_wait_lock);
+        atomic_store(&tube_para_idle, false);
+        al_unlock_mutex(tube_wait_lock);
+        if (atomic_load(&tube_stop))
+            break;
+    }
+    return NULL;
+}
+
+static void tube_thread_destroy(void)
+{
+    if (tube_thread) {
+        al_lock_mutex(tube_wait_lock);
+        atomic_store(&tube_stop, true);
+        al_signal_cond(tube_para_cond);
+        al_unlock_mutex(tube_wait_lock);
+        al_join_thread(tube_thread, NULL);
+        al_destroy_thread(tube_thread);
+        tube_thread = NULL;
+    }
+    if (tube_host_cond) {
+        al_destroy_cond(tube_host_cond);
+        tube_host_cond = NULL;
+    }
+    if (tube_para_cond) {
+        al_destroy_cond(tube_para_cond);
+        tube_para_cond = NULL;
+    }
+    if (tube_wait_lock) {
+        al_destroy_mutex(tube_wait_lock);
+        tube_wait_lock = NULL;
+    }
+    if (tube_lock) {
+        al_destroy_mutex(tube_lock);
+        tube_lock = NULL;
+    }
+}
+
+static bool tube_thread_create(void)
+{
+    if (!(tube_lock = al_create_mutex()) || !(tube_wait_lock = al_create_mutex())
+        || !(tube_para_cond = al_create_cond()) || !(tube_host_cond = al_create_cond())) {
+        log_warn("tube: unable to create locks, running the parasite on the main thread");
+        tube_thread_destroy();
+        return false;
+    }
+    atomic_store(&tube_stop, false);
+    atomic_store(&tube_para_idle, false);
+    atomic_store(&tube_credit, 0);
+    if (!(tube_thread = al_create_thread(tube_thread_main, NULL))) {
+        log_warn("tube: unable to create thread, running the parasite on the main thread");
+        tube_thread_destroy();
+        return false;
+    }
+    al_start_thread(tube_thread);
+    log_debug("tube: parasite running on its own thread");
+    return true;
+}
+
+/* Wait until the parasite is idle with fewer than limit cycles owing. */
+static void tube_host_wait(int limit)
+{
+    speed_sect_t sect = speed_enter(SPEED_TUBE);
+
+    al_lock_mutex(tube_wait_lock);
+    atomic_store(&tube_host_waiting, true);
+    for (;;) {
+        int credit = atomic_load(&tube_credit);
+        if (limit ? credit <= limit : atomic_load(&tube_para_idle) && credit + tubecycles <= 3)
+            break;
+        al_signal_cond(tube_para_cond);
+        al_wait_cond(tube_host_cond, tube_wait_lock);
+    }
+    atomic_store(&tube_host_waiting, false);
+    al_unlock_mutex(tube_wait_lock);
+    speed_leave(sect);
+}
+
+/* Called at the start of each frame to pick inline or threaded running. */
+void tube_thread_begin(void)
+{
+    bool want = tube_threaded && tube_exec;
+
+#ifndef NO_USE_DEBUGGER
+    // the tube debugger expects to be called on the main thread.
+    if (debug_tube)
+        want = false;
+#endif
+    // the order of host and parasite accesses must not vary in a replay.
+    if (inputlog_active())
+        want = false;
+    if (want && !tube_thread && !tube_thread_create())
+        tube_threaded = false;
+    else if (!want && tube_thread)
+        tube_thread_destroy();
+    tube_thread_on = tube_thread;
+}
+
+/* Called at the end of each frame to bring the parasite to a stop. */
+void tube_thread_end(void)
+{
+    if (!tube_thread_on)
+        return;
+    tube_host_wait(0);
+    tube_thread_on = false;
+    // keep any odd cycles for the next frame, threaded or not.
+    al_lock_mutex(tube_wait_lock);
+    tubecycles += atomic_exchange(&tube_credit, 0);
+    al_unlock_mutex(tube_wait_lock);
+    if (atomic_exchange(&tube_host_dirty, false))
+        tube_update_host();
+    if (atomic_exchange(&tube_para_dirty, false))
+        tube_update_parasite();
+}
+
+void tube_thread_close(void)
+{
+    tube_thread_end();
+    tube_thread_destroy();
+}
+
+/* Give the parasite thread cycles to run, waiting if it is too far behind. */
+void tube_thread_credit(int cycles)
+{
+    int credit = atomic_fetch_add(&tube_credit, cycles) + cycles;
+
+    if (atomic_load(&tube_host_dirty) && atomic_exchange(&tube_host_dirty, false)) {
+        al_lock_mutex(tube_lock);
+        tube_update_host();
+        al_unlock_mutex(tube_lock);
+    }
+    if (credit > 3 && atomic_load(&tube_para_idle)) {
+        al_lock_mutex(tube_wait_lock);
+        al_signal_cond(tube_para_cond);
+        al_unlock_mutex(tube_wait_lock);
+    }
+    if (credit > ((TUBE_SKEW * tube_multipler) >> 1))
+        tube_host_wait((TUBE_SKEW * tube_multipler) >> 2);
+}
+
+#endif
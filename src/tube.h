@@ -53,5 +53,21 @@ void tube_updatespeed(void);
 void tube_ula_savestate(FILE *f);
 void tube_ula_loadstate(FILE *f);
 
+#ifndef NO_USE_TUBE_THREAD
+extern bool tube_threaded;   // run the parasite on its own thread
+extern bool tube_thread_on;  // and it is doing so this frame
+
+void tube_thread_begin(void);
+void tube_thread_end(void);
+void tube_thread_close(void);
+void tube_thread_credit(int cycles);
+#else
+#define tube_thread_on false
+static inline void tube_thread_begin(void) {}
+static inline void tube_thread_end(void) {}
+static inline void tube_thread_close(void) {}
+static inline void tube_thread_credit(int cycles) {}
+#endif
+
 #endif
 #endif
@@ -11,11 +11,11 @@
 #include "music4000.h"
 #include "sound.h"
 
-VIA uservia;
+MACHINE_LOCAL VIA uservia;
 
-uint8_t lpt_dac;
-ALLEGRO_USTR *prt_clip_str;
-FILE *prt_fp;
+MACHINE_LOCAL uint8_t lpt_dac;
+MACHINE_LOCAL ALLEGRO_USTR *prt_clip_str;
+MACHINE_LOCAL FILE *prt_fp;
 
 void uservia_write_portA(uint8_t val)
 {
@@ -3,16 +3,16 @@
 
 #include "via.h"
 
-extern VIA uservia;
-extern ALLEGRO_USTR *prt_clip_str;
-extern FILE *prt_fp;
+extern MACHINE_LOCAL VIA uservia;
+extern MACHINE_LOCAL ALLEGRO_USTR *prt_clip_str;
+extern MACHINE_LOCAL FILE *prt_fp;
 
 void    uservia_reset(void);
 
 void    uservia_savestate(FILE *f);
 void    uservia_loadstate(FILE *f);
 
-extern uint8_t lpt_dac;
+extern MACHINE_LOCAL uint8_t lpt_dac;
 
 static inline void uservia_write(uint16_t addr, uint8_t val)
 {
@@ -35,6 +35,7 @@
 
 #include "b-em.h"
 #include "6502.h"
+#include "6502jit.h"
 #include "disc.h"
 #include "keyboard.h"
 #include "main.h"
@@ -1231,6 +1232,7 @@ static void exec_swr_fs(uint8_t flags, uint16_t fname, int8_t romid, uint32_t st
                             if (fread(rom_slot_ptr(romid) + start, len, 1, fp) != 1 && ferror(fp))
                                 log_warn("vdfs: error reading file '%s': %s", ent->host_fn, strerror(errno));
                             fclose(fp);
+                            jit6502_flush();
                         } else {
                             log_warn("vdfs: unable to load file '%s': %s", ent->host_fn, strerror(errno));
                             adfs_hosterr(errno);
@@ -1302,6 +1304,8 @@ static void exec_swr_ram(uint8_t flags, uint32_t ram_start, uint16_t len, uint32
                     tube_writemem(ram_start++, *rom_ptr++);
         }
 #endif
+        if (flags & 0x80)
+            jit6502_flush();
     }
 }
 
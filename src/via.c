@@ -2,6 +2,8 @@
   * Pico version (C) 2021 Graham Sanderson
   *
   * VIA  emulation*/
+#include <limits.h>
+
 #include "b-em.h"
 #include "6502.h"
 #include "via.h"
@@ -172,6 +174,27 @@ void via_poll(VIA *v, int cycles)
     if (v->acr & 0x1c)
         via_shift(v, cycles);
 }
+
+/*
+ * The number of cycles via_poll can be given in one go before the next
+ * one in which a timer or the shift register sets an interrupt flag.
+ */
+int via_next_event(VIA *v)
+{
+    int next = INT_MAX;
+
+    if (!v->t1hit)
+        next = v->t1c - TLIMIT + 1;
+    if (!(v->acr & 0x20) && !v->t2hit && v->t2c - TLIMIT + 1 < next)
+        next = v->t2c - TLIMIT + 1;
+    if ((v->acr & 0x1c) == 0x18) {
+        // the flag is set again on every cycle once the count has run out.
+        int sr = v->sr_count > 0 ? v->sr_count : 1;
+        if (sr < next)
+            next = sr;
+    }
+    return next;
+}
 #endif
 
 void __time_critical_func(via_write)(VIA *v, uint16_t addr, uint8_t val)
@@ -571,8 +594,9 @@ void via_savestate(VIA *v, FILE *f)
         putc(v->ier,f);
         putc(v->t1l,f); putc(v->t1l>>8,f); putc(v->t1l>>16,f); putc(v->t1l>>24,f);
         putc(v->t2l,f); putc(v->t2l>>8,f); putc(v->t2l>>16,f); putc(v->t2l>>24,f);
-        putc(v->t1c,f); putc(v->t1c>>8,f); putc(v->t1c>>16,f); putc(v->t1c>>24,f);
-        putc(v->t2c,f); putc(v->t2c>>8,f); putc(v->t2c>>16,f); putc(v->t2c>>24,f);
+        int t1c = via_get_t1c(v), t2c = via_get_t2c(v);
+        putc(t1c,f); putc(t1c>>8,f); putc(t1c>>16,f); putc(t1c>>24,f);
+        putc(t2c,f); putc(t2c>>8,f); putc(t2c>>16,f); putc(t2c>>24,f);
         putc(v->t1hit,f);
         putc(v->t2hit,f);
         putc(v->ca1,f);
@@ -596,8 +620,18 @@ void via_loadstate(VIA *v, FILE *f)
         v->ier=getc(f);
         v->t1l=getc(f); v->t1l|=getc(f)<<8; v->t1l|=getc(f)<<16; v->t1l|=getc(f)<<24;
         v->t2l=getc(f); v->t2l|=getc(f)<<8; v->t2l|=getc(f)<<16; v->t2l|=getc(f)<<24;
-        v->t1c=getc(f); v->t1c|=getc(f)<<8; v->t1c|=getc(f)<<16; v->t1c|=getc(f)<<24;
-        v->t2c=getc(f); v->t2c|=getc(f)<<8; v->t2c|=getc(f)<<16; v->t2c|=getc(f)<<24;
+        int t1c, t2c;
+        t1c=getc(f); t1c|=getc(f)<<8; t1c|=getc(f)<<16; t1c|=getc(f)<<24;
+        t2c=getc(f); t2c|=getc(f)<<8; t2c|=getc(f)<<16; t2c|=getc(f)<<24;
+        via_set_t1c(v, t1c);
+        via_set_t2c(v, t2c);
+#ifdef USE_HW_EVENT
+        if (v->acr & 0x20) {
+            v->t2_stopped_at = t2c;
+            remove_hw_event(&v->timer2_event);
+        } else
+            v->t2_stopped_at = -1;
+#endif
         v->t1hit=getc(f);
         v->t2hit=getc(f);
         v->ca1=getc(f);
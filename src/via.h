@@ -54,6 +54,7 @@ void via_savestate(VIA *v, FILE *f);
 void via_loadstate(VIA *v, FILE *f);
 
 void via_poll(VIA *v, int cycles);
+int via_next_event(VIA *v);
 
 int via_get_t1c(VIA *v);
 int via_get_t2c(VIA *v);
@@ -1,33 +1,66 @@
 /*B-em v2.2 by Tom Walker
   Allegro video code*/
 #include <allegro5/allegro_primitives.h>
+#include <errno.h>
+#ifndef NO_USE_SPEED_METER
+#include <allegro5/allegro_font.h>
+#endif
 #include "b-em.h"
+#include "main.h"
 #include "pal.h"
 #include "serial.h"
+#include "speedmeter.h"
 #include "tape.h"
 #include "video.h"
 #include "video_render.h"
 
-enum vid_disptype vid_dtype_user, vid_dtype_intern;
+MACHINE_LOCAL enum vid_disptype vid_dtype_user, vid_dtype_intern;
 bool vid_pal;
 int vid_fskipmax = 1;
 int vid_fullborders = 1;
 
-static int fskipcount;
+static MACHINE_LOCAL int fskipcount;
 
-int vid_savescrshot = 0;
-char vid_scrshotname[260];
+MACHINE_LOCAL int vid_savescrshot = 0;
+MACHINE_LOCAL char vid_scrshotname[260];
 
 int winsizex, winsizey;
 int scr_x_start, scr_x_size, scr_y_start, scr_y_size;
 
 bool vid_print_mode = false;
 
+/* Limits of the most recently completed frame, for headless dumps. */
+static MACHINE_LOCAL int dump_firstx, dump_firsty, dump_lastx, dump_lasty;
+
+#ifndef NO_USE_SPEED_METER
+static ALLEGRO_FONT *speed_font;
+#endif
+
+/* A frame to be PAL converted from b into b32, and how to show it. */
+typedef struct {
+    int x1, y1, x2, y2;
+    enum vid_disptype dtype;
+    ALLEGRO_LOCKED_REGION *dst;
+} pal_frame_t;
+
+static MACHINE_LOCAL pal_frame_t pal_frame;
+#ifdef USE_VIDEO_THREAD
+static bool pal_pending;
+#endif
+
 void video_close()
 {
+    video_render_stop();
+    video_pal_discard();
     al_destroy_bitmap(b32);
     al_destroy_bitmap(b16);
     al_destroy_bitmap(b);
+#ifndef NO_USE_SPEED_METER
+    if (speed_font) {
+        al_destroy_font(speed_font);
+        speed_font = NULL;
+    }
+#endif
 }
 
 #ifdef WIN32
@@ -157,19 +190,84 @@ static void upscale_only(ALLEGRO_BITMAP *src, int sx, int sy, int sw, int sh, in
     }
 }
 
-static void line_double(void)
+static void line_double(int y1, int y2)
 {
-    char *yptr1 = (char *)region->data + region->pitch * firsty * 2;
+    char *yptr1 = (char *)region->data + region->pitch * y1 * 2;
     char *yptr2 = yptr1 + region->pitch;
     size_t linesize = abs(region->pitch);
 
-    for (int y = firsty; y < lasty; y++) {
+    for (int y = y1; y < y2; y++) {
         memcpy(yptr2, yptr1, linesize);
         yptr1 = yptr2 + region->pitch;
         yptr2 = yptr1 + region->pitch;
     }
 }
 
+static void pal_start(void)
+{
+    pal_frame.x1 = firstx;
+    pal_frame.y1 = firsty;
+    pal_frame.x2 = lastx;
+    pal_frame.y2 = lasty;
+    pal_frame.dtype = vid_dtype_intern;
+    pal_frame.dst = al_lock_bitmap(b32, ALLEGRO_PIXEL_FORMAT_ARGB_8888, ALLEGRO_LOCK_WRITEONLY);
+}
+
+/* Convert the frame described by pal_frame, on the render thread if there is one. */
+void video_pal_frame(void)
+{
+    const pal_frame_t *f = &pal_frame;
+
+    switch(f->dtype) {
+        case VDT_SCALE:
+        case VDT_SCANLINES:
+            pal_convert(f->dst, f->x1, f->y1, f->x2, f->y2, 1);
+            break;
+        case VDT_LINEDOUBLE:
+            line_double(f->y1, f->y2);
+            // fall through
+        case VDT_INTERLACE:
+            pal_convert(f->dst, f->x1, f->y1 << 1, f->x2, f->y2 << 1, 1);
+            break;
+    }
+}
+
+#ifdef USE_VIDEO_THREAD
+/* Drop a frame still being converted, leaving b32 unlocked. */
+void video_pal_discard(void)
+{
+    if (pal_pending) {
+        video_render_sync();
+        al_unlock_bitmap(b32);
+        pal_pending = false;
+    }
+}
+#endif
+
+static void blit_pal(const pal_frame_t *f)
+{
+    int xsize = f->x2 - f->x1;
+    int ysize = f->y2 - f->y1 + 1;
+
+    switch(f->dtype) {
+        case VDT_SCALE:
+            al_set_target_backbuffer(al_get_current_display());
+            al_draw_scaled_bitmap(b32, f->x1, f->y1, xsize, ysize, scr_x_start, scr_y_start, scr_x_size, scr_y_size, 0);
+            break;
+        case VDT_INTERLACE:
+        case VDT_LINEDOUBLE:
+            upscale_only(b32, f->x1, f->y1 << 1, xsize, ysize << 1, scr_x_start, scr_y_start, scr_x_size, scr_y_size);
+            break;
+        case VDT_SCANLINES:
+            al_set_target_bitmap(b16);
+            al_clear_to_color(al_map_rgb(0, 0,0));
+            for (int c = f->y1; c < f->y2; c++)
+                al_draw_bitmap_region(b32, f->x1, c, xsize, 1, 0, c << 1, 0);
+            upscale_only(b16, 0, f->y1 << 1, xsize, ysize << 1, scr_x_start, scr_y_start, scr_x_size, scr_y_size);
+            break;
+    }
+}
+
 static inline void save_screenshot(void)
 {
     vid_savescrshot--;
@@ -180,32 +278,26 @@ static inline void save_screenshot(void)
         int c;
 
         if (vid_pal) {
+            video_pal_discard();
+            pal_start();
+            video_pal_frame();
+            al_unlock_bitmap(b32);
+            al_set_target_bitmap(scrshotb);
             switch(vid_dtype_intern) {
                 case VDT_SCALE:
-                    pal_convert(firstx, firsty, lastx, lasty, 1);
-                    al_set_target_bitmap(scrshotb);
                     al_draw_scaled_bitmap(b32, firstx, firsty, xsize, ysize, 0, 0, xsize, ysize << 1, 0);
                     break;
                 case VDT_INTERLACE:
-                    pal_convert(firstx, firsty << 1, lastx, lasty << 1, 1);
-                    al_set_target_bitmap(scrshotb);
+                case VDT_LINEDOUBLE:
                     al_draw_bitmap_region(b32, firstx, firsty << 1, xsize, ysize << 1, 0, 0, 0);
                     break;
                 case VDT_SCANLINES:
-                    pal_convert(firstx, firsty, lastx, lasty, 1);
-                    al_set_target_bitmap(scrshotb);
                     c = 0;
                     for (int y = firsty; y < lasty; y++) {
                         al_draw_bitmap_region(b32, firstx, y, xsize, 1, 0, c, 0);
                         c += 2;
                     }
                     break;
-                case VDT_LINEDOUBLE:
-                    line_double();
-                    pal_convert(firstx, firsty << 1, lastx, lasty << 1, 1);
-                    al_set_target_bitmap(scrshotb);
-                    al_draw_bitmap_region(b32, firstx, firsty << 1, xsize, ysize << 1, 0, 0, 0);
-                    break;
             }
         }
         else {
@@ -231,7 +323,7 @@ static inline void save_screenshot(void)
                     }
                     break;
                 case VDT_LINEDOUBLE:
-                    line_double();
+                    line_double(firsty, lasty);
                     al_unlock_bitmap(b);
                     al_draw_scaled_bitmap(b, firstx, firsty << 1, xsize, ysize << 1, 0, 0, xsize, ysize << 1, 0);
                     break;
@@ -302,38 +394,35 @@ static inline void calc_limits(bool non_ttx, uint8_t vtotal)
     }
 }
 
-static inline void blit_screen(void)
+/* Draw the frame just finished, returning false if there is nothing to show yet. */
+static inline bool blit_screen(void)
 {
     int xsize = lastx - firstx;
     int ysize = lasty - firsty + 1;
 
     if (vid_pal) {
-        switch(vid_dtype_intern) {
-            case VDT_SCALE:
-                pal_convert(firstx, firsty, lastx, lasty, 1);
-                al_set_target_backbuffer(al_get_current_display());
-                al_draw_scaled_bitmap(b32, firstx, firsty, xsize, ysize, scr_x_start, scr_y_start, scr_x_size, scr_y_size, 0);
-                break;
-            case VDT_INTERLACE:
-                pal_convert(firstx, firsty << 1, lastx, lasty << 1, 1);
-                upscale_only(b32, firstx, firsty << 1, xsize, ysize << 1, scr_x_start, scr_y_start, scr_x_size, scr_y_size);
-                break;
-            case VDT_SCANLINES:
-                pal_convert(firstx, firsty, lastx, lasty, 1);
-                al_set_target_bitmap(b16);
-                al_clear_to_color(al_map_rgb(0, 0,0));
-                for (int c = firsty; c < lasty; c++)
-                    al_draw_bitmap_region(b32, firstx, c, lastx - firstx, 1, 0, c << 1, 0);
-                upscale_only(b16, 0, firsty << 1, xsize, ysize << 1, scr_x_start, scr_y_start, scr_x_size, scr_y_size);
-                break;
-            case VDT_LINEDOUBLE:
-                line_double();
-                pal_convert(firstx, firsty << 1, lastx, lasty << 1, 1);
-                upscale_only(b32, firstx, firsty << 1, xsize, ysize << 1, scr_x_start, scr_y_start, scr_x_size, scr_y_size);
-                break;
+#ifdef USE_VIDEO_THREAD
+        // show the frame converted while this one was emulated and
+        // have the render thread convert this one meanwhile.
+        bool shown = pal_pending;
+        if (pal_pending) {
+            al_unlock_bitmap(b32);
+            blit_pal(&pal_frame);
         }
+        pal_start();
+        pal_pending = true;
+        video_render_pal();
+        return shown;
+#else
+        pal_start();
+        video_pal_frame();
+        al_unlock_bitmap(b32);
+        blit_pal(&pal_frame);
+        return true;
+#endif
     }
     else {
+        video_pal_discard();
         switch(vid_dtype_intern) {
             case VDT_SCALE:
                 al_unlock_bitmap(b);
@@ -353,12 +442,13 @@ static inline void blit_screen(void)
                 upscale_only(b16, 0, firsty << 1, lastx - firstx, (lasty - firsty) << 1, scr_x_start, scr_y_start, scr_x_size, scr_y_size);
                 break;
             case VDT_LINEDOUBLE:
-                line_double();
+                line_double(firsty, lasty);
                 al_unlock_bitmap(b);
                 upscale_only(b, firstx, firsty << 1, xsize, ysize  << 1, scr_x_start, scr_y_start, scr_x_size, scr_y_size);
         }
         region = al_lock_bitmap(b, ALLEGRO_PIXEL_FORMAT_ARGB_8888, ALLEGRO_LOCK_READWRITE);
     }
+    return true;
 }
 
 static inline void fill_pillarbox(void)
@@ -377,8 +467,49 @@ static inline void fill_letterbox(void)
     al_draw_filled_rectangle(0, scr_y_start + scr_y_size, winsizex, winsizey, border_col);
 }
 
+#ifndef NO_USE_SPEED_METER
+/* Overlay the speed meter on the top left of the window. */
+static void draw_speed(void)
+{
+    const char *text = speed_text();
+
+    if (!*text)
+        return;
+    if (!speed_font) {
+        al_init_font_addon();
+        if (!(speed_font = al_create_builtin_font())) {
+            log_warn("video: unable to create font for speed meter");
+            speed_show = false;
+            return;
+        }
+    }
+    al_draw_filled_rectangle(0, 0, strlen(text) * 8 + 4, 12, al_map_rgb(0, 0, 0));
+    al_draw_text(speed_font, al_map_rgb(255, 255, 0), 2, 2, ALLEGRO_ALIGN_LEFT, text);
+}
+#endif
+
+static void headless_doblit(bool non_ttx, uint8_t vtotal)
+{
+    lasty++;
+    calc_limits(non_ttx, vtotal);
+    if (vid_dtype_intern == VDT_LINEDOUBLE)
+        line_double(firsty, lasty);
+    dump_firstx = firstx;
+    dump_firsty = firsty;
+    dump_lastx  = lastx;
+    dump_lasty  = lasty;
+}
+
 void video_doblit(bool non_ttx, uint8_t vtotal)
 {
+    video_render_sync();
+    if (headless) {
+        headless_doblit(non_ttx, vtotal);
+        speed_drawn();
+        firstx = firsty = 65535;
+        lastx  = lasty  = 0;
+        return;
+    }
     if (vid_savescrshot)
         save_screenshot();
 
@@ -386,13 +517,97 @@ void video_doblit(bool non_ttx, uint8_t vtotal)
         lasty++;
         calc_limits(non_ttx, vtotal);
         fskipcount = 0;
-        blit_screen();
-        if (scr_x_start > 0)
-            fill_pillarbox();
-        else if (scr_y_start > 0)
-            fill_letterbox();
-        al_flip_display();
+        if (blit_screen()) {
+            if (scr_x_start > 0)
+                fill_pillarbox();
+            else if (scr_y_start > 0)
+                fill_letterbox();
+#ifndef NO_USE_SPEED_METER
+            if (speed_show)
+                draw_speed();
+#endif
+            al_flip_display();
+            speed_drawn();
+        }
     }
     firstx = firsty = 65535;
     lastx  = lasty  = 0;
 }
+
+// one output row of the last complete frame as RGB bytes.
+static void dump_row(int y, uint8_t *dst)
+{
+    bool dbl_rows = vid_dtype_intern == VDT_INTERLACE || vid_dtype_intern == VDT_LINEDOUBLE;
+    int srcy = dbl_rows ? y : y >> 1;
+    const uint32_t *src = (const uint32_t *)((const char *)region->data + region->pitch * srcy) + dump_firstx;
+
+    for (int x = dump_firstx; x < dump_lastx; x++) {
+        uint32_t col = *src++;
+        *dst++ = col >> 16;
+        *dst++ = col >> 8;
+        *dst++ = col;
+    }
+}
+
+void video_dump_screen(const char *fn)
+{
+    FILE *fp;
+    int xsize = dump_lastx - dump_firstx;
+    int ysize = dump_lasty - dump_firsty;
+    uint8_t *line;
+
+    if (xsize <= 0 || ysize <= 0) {
+        log_warn("vidalleg: no completed frame to write to %s", fn);
+        return;
+    }
+    video_render_sync();
+    if (!(fp = fopen(fn, "wb"))) {
+        log_error("vidalleg: unable to open %s for writing: %s", fn, strerror(errno));
+        return;
+    }
+    if (!(line = malloc(xsize * 3))) {
+        log_error("vidalleg: out of memory writing %s", fn);
+        fclose(fp);
+        return;
+    }
+    // always write 2 output rows per frame line so the aspect ratio
+    // matches what the window would show.
+    fprintf(fp, "P6\n%d %d\n255\n", xsize, ysize * 2);
+    for (int y = dump_firsty * 2; y < dump_lasty * 2; y++) {
+        dump_row(y, line);
+        fwrite(line, xsize * 3, 1, fp);
+    }
+    free(line);
+    fclose(fp);
+    log_info("vidalleg: wrote %dx%d frame to %s", xsize, ysize * 2, fn);
+}
+
+/*
+ * A 32-bit FNV-1a hash of the pixels video_dump_screen would write, so
+ * runs can be compared for identical output without keeping images.
+ */
+bool video_checksum(uint32_t *sum)
+{
+    int xsize = dump_lastx - dump_firstx;
+    int ysize = dump_lasty - dump_firsty;
+    uint32_t hash = 2166136261u;
+    uint8_t *line;
+
+    if (xsize <= 0 || ysize <= 0) {
+        log_warn("vidalleg: no completed frame to checksum");
+        return false;
+    }
+    video_render_sync();
+    if (!(line = malloc(xsize * 3))) {
+        log_error("vidalleg: out of memory checksumming frame");
+        return false;
+    }
+    for (int y = dump_firsty * 2; y < dump_lasty * 2; y++) {
+        dump_row(y, line);
+        for (int x = 0; x < xsize * 3; x++)
+            hash = (hash ^ line[x]) * 16777619u;
+    }
+    free(line);
+    *sum = hash;
+    return true;
+}
@@ -7,41 +7,83 @@
 #include "b-em.h"
 
 #include "bbctext.h"
+#include "main.h"
 #include "mem.h"
 #include "model.h"
 #include "serial.h"
+#include "speedmeter.h"
 #include "tape.h"
 #include "via.h"
 #include "sysvia.h"
 #include "video.h"
 #include "video_render.h"
 
-int fullscreen = 0;
+#ifdef USE_VIDEO_THREAD
+#ifdef USE_MULTI_MACHINE
+#error USE_VIDEO_THREAD keeps the render state per process
+#endif
+#include <stdatomic.h>
+#endif
 
-static int scrx, scry;
-int interlline = 0;
+MACHINE_LOCAL int fullscreen = 0;
 
-static int colblack;
-static int colwhite;
+static MACHINE_LOCAL int scrx, scry;
+MACHINE_LOCAL int interlline = 0;
+
+static MACHINE_LOCAL int colblack;
+static MACHINE_LOCAL int colwhite;
 
 /*6845 CRTC*/
-uint8_t crtc[32];
+MACHINE_LOCAL uint8_t crtc[32];
 static const uint8_t crtc_mask[32] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x7F, 0x1F, 0x7F, 0x7F, 0xF3, 0x1F, 0x7F, 0x1F, 0x3F, 0xFF, 0x3F, 0xFF, 0x3F, 0xFF };
 
-int crtc_i;
-
-int hc, vc, sc;
-static int vadj;
-uint16_t ma;
-static uint16_t maback;
-static int vdispen, dispen;
-static int crtc_mode;
-static int scrsize;
+MACHINE_LOCAL int crtc_i;
+
+MACHINE_LOCAL int hc, vc, sc;
+static MACHINE_LOCAL int vadj;
+MACHINE_LOCAL uint16_t ma;
+static MACHINE_LOCAL uint16_t maback;
+static MACHINE_LOCAL int vdispen, dispen;
+static MACHINE_LOCAL int crtc_mode;
+static MACHINE_LOCAL int scrsize;
+
+/*
+ * The emulation of the CRTC and ULA below decides what is drawn where and
+ * describes it with the record_* calls; the pixels are drawn by the
+ * matching effect_* calls from a copy of the state they need.  Normally
+ * each record is its effect.  With USE_VIDEO_THREAD the records are
+ * queued on a ring and the effects run on a render thread, which is then
+ * the only writer of the locked bitmap until video_render_sync.
+ */
+struct video_ula_state {
+    int pal[16];                // ula_pal
+    int collook[16];            // nula_collook
+    uint8_t ctrl;
+    uint8_t mode;
+    uint8_t crtc_mode;
+    uint8_t palette_mode;
+    uint8_t attribute_mode;
+    uint8_t attribute_text;
+    uint8_t clip;               // NULA offset or left blank in use
+    uint8_t dtype;              // vid_dtype_intern
+};
+
+#define VID_ULA_WORDS (sizeof(struct video_ula_state) / sizeof(uint32_t))
+
+static MACHINE_LOCAL struct video_ula_state rula;      // as seen by the renderer
+static MACHINE_LOCAL struct video_ula_state ula_sent;  // as last recorded
+static MACHINE_LOCAL int rend_y, rend_sc, rend_interlline, rend_hdisp;
+static MACHINE_LOCAL int row_sent = -1;
+
+static void record_ula(void);
+static void record_hdisp(int hdisp);
+static void record_line_start(int sc, bool new_row);
 
 void crtc_reset()
 {
     hc = vc = sc = vadj = 0;
     crtc[9] = 10;
+    record_line_start(sc, false);
 }
 
 static void set_intern_dtype(enum vid_disptype dtype)
@@ -51,6 +93,7 @@ static void set_intern_dtype(enum vid_disptype dtype)
     else if (dtype == VDT_INTERLACE && !(crtc[8] & 1))
         dtype = VDT_SCALE;
     vid_dtype_intern = dtype;
+    record_ula();
 }
 
 void crtc_write(uint16_t addr, uint8_t val)
@@ -59,12 +102,17 @@ void crtc_write(uint16_t addr, uint8_t val)
     if (!(addr & 1))
         crtc_i = val & 31;
     else {
+#ifdef USE_HW_EVENT
+        video_cycle_sync();
+#endif
         val &= crtc_mask[crtc_i];
         crtc[crtc_i] = val;
         if (crtc_i == 6 && vc == val)
             vdispen = 0;
         if (crtc_i == 8)
             set_intern_dtype(vid_dtype_user);
+        if (crtc_i == 1)
+            record_hdisp(val);
     }
 }
 
@@ -107,32 +155,34 @@ void crtc_loadstate(FILE * f)
     ma |= getc(f) << 8;
     maback = getc(f);
     maback |= getc(f) << 8;
+    record_hdisp(crtc[1]);
+    record_line_start(sc, false);
 }
 
 
 /*Video ULA (VIDPROC)*/
-uint8_t ula_ctrl;
-static int ula_pal[16];         // maps from actual physical colour to bitmap display
-uint8_t ula_palbak[16];         // palette RAM in orginal ULA maps actual colour to logical colour
-static int ula_mode;
-int nula_collook[16];           // maps palette (logical) colours to 12-bit RGB
+MACHINE_LOCAL uint8_t ula_ctrl;
+static MACHINE_LOCAL int ula_pal[16];         // maps from actual physical colour to bitmap display
+MACHINE_LOCAL uint8_t ula_palbak[16];         // palette RAM in orginal ULA maps actual colour to logical colour
+static MACHINE_LOCAL int ula_mode;
+MACHINE_LOCAL int nula_collook[16];           // maps palette (logical) colours to 12-bit RGB
 
-static uint8_t table4bpp[4][256][16];
+static MACHINE_LOCAL uint8_t table4bpp[4][256][16];
 
-static int nula_pal_write_flag = 0;
-static uint8_t nula_pal_first_byte;
-uint8_t nula_flash[8];
+static MACHINE_LOCAL int nula_pal_write_flag = 0;
+static MACHINE_LOCAL uint8_t nula_pal_first_byte;
+MACHINE_LOCAL uint8_t nula_flash[8];
 
-uint8_t nula_palette_mode;
-uint8_t nula_horizontal_offset;
-uint8_t nula_left_blank;
-uint8_t nula_disable;
-uint8_t nula_attribute_mode;
-uint8_t nula_attribute_text;
+MACHINE_LOCAL uint8_t nula_palette_mode;
+MACHINE_LOCAL uint8_t nula_horizontal_offset;
+MACHINE_LOCAL uint8_t nula_left_blank;
+MACHINE_LOCAL uint8_t nula_disable;
+MACHINE_LOCAL uint8_t nula_attribute_mode;
+MACHINE_LOCAL uint8_t nula_attribute_text;
 
-static int nula_left_cut;
-static int nula_left_edge;
-static int mode7_need_new_lookup;
+static MACHINE_LOCAL int nula_left_cut;
+static MACHINE_LOCAL int nula_left_edge;
+static MACHINE_LOCAL int mode7_need_new_lookup;
 
 static inline uint32_t makecol(int red, int green, int blue)
 {
@@ -170,7 +220,7 @@ static inline void put_pixels_checked(ALLEGRO_LOCKED_REGION *region, int x, int
 
 static inline void nula_putpixel_checked(ALLEGRO_LOCKED_REGION *region, int x, int y, uint32_t colour, int line)
 {
-    if (crtc_mode && (nula_horizontal_offset || nula_left_blank) && (x < nula_left_cut || x >= nula_left_edge + (crtc[1] * crtc_mode * 8)))
+    if (rula.crtc_mode && rula.clip && (x < nula_left_cut || x >= nula_left_edge + (rend_hdisp * rula.crtc_mode * 8)))
         put_pixel_checked(region, x, y, colblack, line);
     else if (x < 1280)
         put_pixel_checked(region, x, y, colour, line);
@@ -198,7 +248,7 @@ static inline void put_pixels(ALLEGRO_LOCKED_REGION *region, int x, int y, int c
 
 static inline void nula_putpixel(ALLEGRO_LOCKED_REGION *region, int x, int y, uint32_t colour)
 {
-    if (crtc_mode && (nula_horizontal_offset || nula_left_blank) && (x < nula_left_cut || x >= nula_left_edge + (crtc[1] * crtc_mode * 8)))
+    if (rula.crtc_mode && rula.clip && (x < nula_left_cut || x >= nula_left_edge + (rend_hdisp * rula.crtc_mode * 8)))
         put_pixel(region, x, y, colblack);
     else if (x < 1280)
         put_pixel(region, x, y, colour);
@@ -225,12 +275,15 @@ void nula_default_palette(void)
     nula_collook[14] = 0xff00ffff; // cyan
     nula_collook[15] = 0xffffffff; // white
 
-    mode7_need_new_lookup = 1;
+    record_ula();
 }
 
 void videoula_write(uint16_t addr, uint8_t val)
 {
     int c;
+#ifdef USE_HW_EVENT
+    video_cycle_sync();
+#endif
     if (nula_disable)
         addr &= ~2;             // nuke additional NULA addresses
 
@@ -364,7 +417,6 @@ void videoula_write(uint16_t addr, uint8_t val)
                     if ((ula_palbak[c] & 8) && (ula_ctrl & 1) && nula_flash[(ula_palbak[c] & 7) ^ 7])
                         ula_pal[c] = nula_collook[ula_palbak[c] & 15];
                 }
-                mode7_need_new_lookup = 1;
             } else {
                 // Remember the first byte
                 nula_pal_first_byte = val;
@@ -375,6 +427,7 @@ void videoula_write(uint16_t addr, uint8_t val)
         break;
 
     }
+    record_ula();
 }
 
 void videoula_savestate(FILE * f)
@@ -428,22 +481,23 @@ void videoula_loadstate(FILE * f)
     nula_disable = getc(f);
     nula_attribute_mode = getc(f);
     nula_attribute_text = getc(f);
+    record_ula();
 }
 
 /*Mode 7 (SAA5050)*/
-static uint8_t mode7_chars[96 * 160], mode7_charsi[96 * 160], mode7_graph[96 * 160], mode7_graphi[96 * 160], mode7_sepgraph[96 * 160], mode7_sepgraphi[96 * 160], mode7_tempi[96 * 120], mode7_tempi2[96 * 120];
-static int mode7_lookup[8][8][16];
+static MACHINE_LOCAL uint8_t mode7_chars[96 * 160], mode7_charsi[96 * 160], mode7_graph[96 * 160], mode7_graphi[96 * 160], mode7_sepgraph[96 * 160], mode7_sepgraphi[96 * 160], mode7_tempi[96 * 120], mode7_tempi2[96 * 120];
+static MACHINE_LOCAL int mode7_lookup[8][8][16];
 
-static int mode7_col = 7, mode7_bg = 0;
-static int mode7_sep = 0;
-static int mode7_dbl, mode7_nextdbl, mode7_wasdbl;
-static int mode7_gfx;
-static int mode7_flash, mode7_flashon = 0, mode7_flashtime = 0;
-static uint8_t mode7_buf[2];
-static uint8_t *mode7_p[2] = { mode7_chars, mode7_charsi };
+static MACHINE_LOCAL int mode7_col = 7, mode7_bg = 0;
+static MACHINE_LOCAL int mode7_sep = 0;
+static MACHINE_LOCAL int mode7_dbl, mode7_nextdbl, mode7_wasdbl;
+static MACHINE_LOCAL int mode7_gfx;
+static MACHINE_LOCAL int mode7_flash, mode7_flashon = 0, mode7_flashtime = 0;
+static MACHINE_LOCAL uint8_t mode7_buf[2];
+static MACHINE_LOCAL uint8_t *mode7_p[2];
 
-static uint8_t mode7_heldchar, mode7_holdchar;
-static uint8_t *mode7_heldp[2];
+static MACHINE_LOCAL uint8_t mode7_heldchar, mode7_holdchar;
+static MACHINE_LOCAL uint8_t *mode7_heldp[2];
 
 void mode7_makechars()
 {
@@ -530,6 +584,8 @@ void mode7_makechars()
         offs1 += 12;
         offs2 += 16;
     }
+    mode7_p[0] = mode7_chars;
+    mode7_p[1] = mode7_charsi;
 }
 
 static void mode7_gen_nula_lookup(void)
@@ -539,12 +595,12 @@ static void mode7_gen_nula_lookup(void)
     int weight, lu_red, lu_grn, lu_blu;
 
     for (fg_ix = 0; fg_ix < 8; fg_ix++) {
-        fg_pix = nula_collook[fg_ix];
+        fg_pix = rula.collook[fg_ix];
         fg_red = (fg_pix >> 16) & 0xff;
         fg_grn = (fg_pix >> 8) & 0xff;
         fg_blu = fg_pix & 0xff;
         for (bg_ix = 0; bg_ix < 8; bg_ix++) {
-            bg_pix = nula_collook[bg_ix];
+            bg_pix = rula.collook[bg_ix];
             bg_red = (bg_pix >> 16) & 0xff;
             bg_grn = (bg_pix >> 8) & 0xff;
             bg_blu = bg_pix & 0xff;
@@ -559,7 +615,7 @@ static void mode7_gen_nula_lookup(void)
     mode7_need_new_lookup = 0;
 }
 
-static inline void mode7_render(ALLEGRO_LOCKED_REGION *region, uint8_t dat)
+static inline void mode7_render(int x, uint8_t dat)
 {
     int t, c;
     int off;
@@ -569,7 +625,7 @@ static inline void mode7_render(ALLEGRO_LOCKED_REGION *region, uint8_t dat)
     int mode7_flashx = mode7_flash, mode7_dblx = mode7_dbl;
     int *on;
 
-    if (scrx < (1280-32)) {
+    if (x < (1280-32)) {
         if (mode7_need_new_lookup)
             mode7_gen_nula_lookup();
 
@@ -584,7 +640,7 @@ static inline void mode7_render(ALLEGRO_LOCKED_REGION *region, uint8_t dat)
             on = mode7_lookup[mode7_bg & 7][mode7_bg & 7];
         if (dat == 255) {
             for (c = 0; c < 16; c++)
-                put_pixel(region, scrx + c + 16, scry, colblack);
+                put_pixel(region, x + c + 16, rend_y, colblack);
             return;
         }
 
@@ -679,11 +735,11 @@ static inline void mode7_render(ALLEGRO_LOCKED_REGION *region, uint8_t dat)
         }
 
         if (mode7_dblx && !mode7_nextdbl)
-            t = ((dat - 0x20) * 160) + ((sc >> 1) * 16);
+            t = ((dat - 0x20) * 160) + ((rend_sc >> 1) * 16);
         else if (mode7_dblx)
-            t = ((dat - 0x20) * 160) + ((sc >> 1) * 16) + (5 * 16);
+            t = ((dat - 0x20) * 160) + ((rend_sc >> 1) * 16) + (5 * 16);
         else
-            t = ((dat - 0x20) * 160) + (sc * 16);
+            t = ((dat - 0x20) * 160) + (rend_sc * 16);
 
         off = mode7_lookup[0][mode7_bg & 7][0];
         if (!mode7_dbl && mode7_nextdbl)
@@ -691,21 +747,21 @@ static inline void mode7_render(ALLEGRO_LOCKED_REGION *region, uint8_t dat)
         else
             on = mode7_lookup[mcolx & 7][mode7_bg & 7];
 
-        int interindex = (vid_dtype_intern == VDT_INTERLACE) && interlline;
+        int interindex = (rula.dtype == VDT_INTERLACE) && rend_interlline;
         for (c = 0; c < 16; c++) {
             if (mode7_flashx && !mode7_flashon)
-                put_pixel(region, scrx + c + 16, scry, off);
+                put_pixel(region, x + c + 16, rend_y, off);
             else if (mode7_dblx)
-                put_pixel(region, scrx + c + 16, scry, on[mode7_px[sc & 1][t] & 15]);
+                put_pixel(region, x + c + 16, rend_y, on[mode7_px[rend_sc & 1][t] & 15]);
             else
-                put_pixel(region, scrx + c + 16, scry, on[mode7_px[interindex][t] & 15]);
+                put_pixel(region, x + c + 16, rend_y, on[mode7_px[interindex][t] & 15]);
             t++;
         }
 
-        if ((scrx + 16) < firstx)
-            firstx = scrx + 16;
-        if ((scrx + 32) > lastx)
-            lastx = scrx + 32;
+        if ((x + 16) < firstx)
+            firstx = x + 16;
+        if ((x + 32) > lastx)
+            lastx = x + 32;
 
         if (holdoff) {
             mode7_holdchar = 0;
@@ -716,50 +772,645 @@ static inline void mode7_render(ALLEGRO_LOCKED_REGION *region, uint8_t dat)
     }
 }
 
-uint16_t vidbank;
+MACHINE_LOCAL uint16_t vidbank;
 static const int screenlen[4] = { 0x4000, 0x5000, 0x2000, 0x2800 };
 
-static int vsynctime;
-static int interline;
-static int hvblcount;
-static int frameodd;
-static int con, cdraw, coff;
-static int cursoron;
-static int frcount;
-static int charsleft;
+static MACHINE_LOCAL int vsynctime;
+static MACHINE_LOCAL int interline;
+static MACHINE_LOCAL int hvblcount;
+static MACHINE_LOCAL int frameodd;
+static MACHINE_LOCAL int con, cdraw, coff;
+static MACHINE_LOCAL int cursoron;
+static MACHINE_LOCAL int frcount;
+static MACHINE_LOCAL int charsleft;
 
-static int vidclocks = 0;
-static int oddclock = 0;
-static int vidbytes = 0;
+static MACHINE_LOCAL int vidclocks = 0;
+static MACHINE_LOCAL int oddclock = 0;
+static MACHINE_LOCAL int vidbytes = 0;
 
-static int oldr8;
+static MACHINE_LOCAL int oldr8;
 
-int firstx, firsty, lastx, lasty;
+MACHINE_LOCAL int firstx, firsty, lastx, lasty;
 
 static ALLEGRO_DISPLAY *display;
-ALLEGRO_BITMAP *b, *b16, *b32;
+MACHINE_LOCAL ALLEGRO_BITMAP *b, *b16, *b32;
+
+MACHINE_LOCAL ALLEGRO_LOCKED_REGION *region;
+
+MACHINE_LOCAL ALLEGRO_COLOR border_col;
+
+/* Rendering, from the records below. */
+
+static inline void render_cursor(int x)
+{
+    int c;
+
+    for (c = ((rula.ctrl & 0x10) ? 8 : 16); c >= 0; c--)
+        nula_putpixel(region, x + c, rend_y, get_pixel(region, x + c, rend_y) ^ colwhite);
+}
+
+static inline void render_char(int x, uint8_t dat)
+{
+    int c;
+
+    switch (rula.crtc_mode) {
+    case 0:
+        mode7_render(x, dat & 0x7F);
+        break;
+    case 1:
+        {
+            if (x < firstx)
+                firstx = x;
+            if ((x + 8) > lastx)
+                lastx = x + 8;
+            if (rula.attribute_mode && rula.mode > 1) {
+                if (rula.mode == 3) {
+                    // 1bpp
+                    if (rula.attribute_text) {
+                        int attribute = ((dat & 7) << 1);
+                        float pc = 0.0f;
+                        for (c = 0; c < 7; c++, pc += 0.75f) {
+                            int output = rula.pal[attribute | (dat >> (7 - (int) pc) & 1)];
+                            nula_putpixel(region, x + c, rend_y, output);
+                        }
+                        // Very loose approximation of the text attribute mode
+                        nula_putpixel(region, x + 7, rend_y, rula.pal[attribute]);
+                    } else {
+                        int attribute = ((dat & 3) << 2);
+                        float pc = 0.0f;
+                        for (c = 0; c < 8; c++, pc += 0.75f) {
+                            int output = rula.pal[attribute | (dat >> (7 - (int) pc) & 1)];
+                            nula_putpixel(region, x + c, rend_y, output);
+                        }
+                    }
+                } else {
+                    int attribute = (((dat & 16) >> 1) | ((dat & 1) << 2));
+                    float pc = 0.0f;
+                    for (c = 0; c < 8; c++, pc += 0.75f) {
+                        int a = 3 - ((int) pc) / 2;
+                        int output = rula.pal[attribute | ((dat >> (a + 3)) & 2) | ((dat >> a) & 1)];
+                        nula_putpixel(region, x + c, rend_y, output);
+                    }
+                }
+            } else {
+                for (c = 0; c < 8; c++) {
+                    nula_putpixel(region, x + c, rend_y, rula.palette_mode ? rula.collook[table4bpp[rula.mode][dat][c]] : rula.pal[table4bpp[rula.mode][dat][c]]);
+                }
+            }
+        }
+        break;
+    case 2:
+        {
+            if (x < firstx)
+                firstx = x;
+            if ((x + 16) > lastx)
+                lastx = x + 16;
+            if (rula.attribute_mode && rula.mode > 1) {
+                // In low frequency clock can only have 1bpp modes
+                if (rula.attribute_text) {
+                    int attribute = ((dat & 7) << 1);
+                    float pc = 0.0f;
+                    for (c = 0; c < 14; c++, pc += 0.375f) {
+                        int output = rula.pal[attribute | (dat >> (7 - (int) pc) & 1)];
+                        nula_putpixel(region, x + c, rend_y, output);
+                    }
+
+                    // Very loose approximation of the text attribute mode
+                    nula_putpixel(region, x + 14, rend_y, rula.pal[attribute]);
+                    nula_putpixel(region, x + 15, rend_y, rula.pal[attribute]);
+                } else {
+                    int attribute = ((dat & 3) << 2);
+                    float pc = 0.0f;
+                    for (c = 0; c < 16; c++, pc += 0.375f) {
+                        int output = rula.pal[attribute | (dat >> (7 - (int) pc) & 1)];
+                        nula_putpixel(region, x + c, rend_y, output);
+                    }
+                }
+            } else {
+                for (c = 0; c < 16; c++) {
+                    nula_putpixel(region, x + c, rend_y, rula.palette_mode ? rula.collook[table4bpp[rula.mode][dat][c]] : rula.pal[table4bpp[rula.mode][dat][c]]);
+                }
+            }
+        }
+        break;
+    }
+}
+
+/*
+ * Graphics characters are gathered into runs along the scanline and
+ * expanded a run at a time.  Each byte's pixels, resolved through the
+ * palette, are kept until the ULA state next changes, so most bytes are
+ * a single copy of 8 or 16 pixels.  NULA clipping and attribute modes
+ * still go a character at a time.
+ */
+#define RUN_MAX 160
+
+static MACHINE_LOCAL uint8_t run_dat[RUN_MAX];
+static MACHINE_LOCAL int run_x, run_n;
+static MACHINE_LOCAL uint32_t run_pix[256][16];
+static MACHINE_LOCAL uint32_t run_pix_gen[256], run_gen = 1;
+
+static void run_pix_make(uint8_t dat)
+{
+    const uint8_t *idx = table4bpp[rula.mode][dat];
+    const int *cols = rula.palette_mode ? rula.collook : rula.pal;
+    int c;
+
+    for (c = 0; c < 16; c++)
+        run_pix[dat][c] = cols[idx[c]];
+    run_pix_gen[dat] = run_gen;
+}
+
+static void run_flush(void)
+{
+    int n = run_n, x = run_x, w = rula.crtc_mode * 8, i;
+    uint32_t *p;
+
+    if (!n)
+        return;
+    run_n = 0;
+    if (rula.clip || (rula.attribute_mode && rula.mode > 1)) {
+        for (i = 0; i < n; i++, x += w)
+            render_char(x, run_dat[i]);
+        return;
+    }
+    if (x < firstx)
+        firstx = x;
+    if ((x + n * w) > lastx)
+        lastx = x + n * w;
+    p = (uint32_t *)((char *)region->data + region->pitch * rend_y) + x;
+    for (i = 0; i < n; i++, p += w) {
+        uint8_t dat = run_dat[i];
+        if (run_pix_gen[dat] != run_gen)
+            run_pix_make(dat);
+        // fixed sizes so the compiler can use its widest moves.
+        if (w == 8)
+            memcpy(p, run_pix[dat], 8 * sizeof(uint32_t));
+        else
+            memcpy(p, run_pix[dat], 16 * sizeof(uint32_t));
+    }
+}
 
-ALLEGRO_LOCKED_REGION *region;
+// a displayed character; gap is the blank lines between rows in modes 3 & 6.
+static inline void effect_char(int x, uint8_t dat, bool gap, bool cursor)
+{
+    if (rula.crtc_mode && !gap && !cursor) {
+        if (run_n && (x != run_x + run_n * rula.crtc_mode * 8 || run_n == RUN_MAX))
+            run_flush();
+        if (!run_n)
+            run_x = x;
+        run_dat[run_n++] = dat;
+        return;
+    }
+    run_flush();
+    if (gap)
+        put_pixels(region, x, rend_y, (rula.ctrl & 0x10) ? 8 : 16, colblack);
+    else
+        render_char(x, dat);
+    if (cursor)
+        render_cursor(x);
+}
+
+// a character outside the displayed area, which may finish off teletext.
+static inline void effect_blank(int x, bool teletext, bool fill, bool cursor)
+{
+    run_flush();
+    if (teletext)
+        mode7_render(x, 255);
+    else if (fill) {
+        put_pixels(region, x, rend_y, (rula.ctrl & 0x10) ? 8 : 16, colblack);
+        if (!rula.crtc_mode)
+            put_pixels(region, x + 16, rend_y, 16, colblack);
+    }
+    if (cursor)
+        render_cursor(x);
+}
+
+static inline void effect_row(int y)
+{
+    run_flush();
+    rend_y = y;
+}
+
+static void effect_ula(const struct video_ula_state *s)
+{
+    run_flush();
+    run_gen++;
+    if (memcmp(rula.collook, s->collook, sizeof(rula.collook)))
+        mode7_need_new_lookup = 1;
+    rula = *s;
+}
+
+static inline void effect_hdisp(int hdisp)
+{
+    run_flush();
+    rend_hdisp = hdisp;
+}
+
+static inline void effect_nula_edges(int edge, int cut)
+{
+    run_flush();
+    nula_left_edge = edge;
+    nula_left_cut = cut;
+}
+
+// horizontal total: teletext starts afresh, NULA may delay the next line.
+static void effect_line_end(int y, int delay)
+{
+    int c;
+
+    run_flush();
+    mode7_col = 7;
+    mode7_bg = 0;
+    mode7_holdchar = 0;
+    mode7_heldchar = 0x20;
+    mode7_p[0] = mode7_chars;
+    mode7_p[1] = mode7_charsi;
+    mode7_flash = 0;
+    mode7_sep = 0;
+    mode7_gfx = 0;
+    mode7_heldp[0] = mode7_p[0];
+    mode7_heldp[1] = mode7_p[1];
+
+    for (c = 0; c < delay && nula_left_edge + c < 1280; c++)
+        put_pixel(region, nula_left_edge + c, y, colblack);
+}
+
+static inline void effect_line_start(int sc, bool new_row)
+{
+    run_flush();
+    rend_sc = sc;
+    if (new_row) {
+        if (mode7_nextdbl)
+            mode7_nextdbl = 0;
+        else
+            mode7_nextdbl = mode7_wasdbl;
+    }
+    mode7_dbl = mode7_wasdbl = 0;
+}
+
+static inline void effect_vsync(int interlline)
+{
+    run_flush();
+    rend_interlline = interlline;
+    mode7_flashtime++;
+    if ((mode7_flashon && mode7_flashtime == 32) || (!mode7_flashon && mode7_flashtime == 16)) {
+        mode7_flashon = !mode7_flashon;
+        mode7_flashtime = 0;
+    }
+}
+
+#ifdef USE_VIDEO_THREAD
+
+/*
+ * Single producer, single consumer ring of 32 bit records, the command in
+ * the top byte.  The emulation thread publishes a batch at a time and
+ * only sleeps when the ring is full or it needs the renderer to finish;
+ * the render thread sleeps when the ring is empty.
+ */
+#define VID_RING_SIZE  (1 << 16)
+#define VID_RING_MASK  (VID_RING_SIZE - 1)
+#define VID_RING_BATCH 1024
+
+enum {
+    VID_CMD_CHAR,
+    VID_CMD_BLANK,
+    VID_CMD_ROW,
+    VID_CMD_ULA,
+    VID_CMD_HDISP,
+    VID_CMD_NULA_EDGES,
+    VID_CMD_LINE_END,
+    VID_CMD_LINE_START,
+    VID_CMD_VSYNC,
+    VID_CMD_PAL
+};
+
+#define VID_FLAG_GAP      0x080000
+#define VID_FLAG_TELETEXT 0x080000
+#define VID_FLAG_CURSOR   0x100000
+#define VID_FLAG_FILL     0x200000
+
+static uint32_t vid_ring[VID_RING_SIZE];
+static atomic_uint vid_ring_head, vid_ring_tail;
+static atomic_bool vid_render_waiting, vid_emu_waiting;
+static unsigned vid_head, vid_published, vid_tail_seen;
+
+static ALLEGRO_THREAD *vid_thread;
+static ALLEGRO_MUTEX *vid_lock;
+static ALLEGRO_COND *vid_data_cond, *vid_space_cond;
+static bool vid_stop;
+
+static unsigned video_render_run(unsigned tail, unsigned head)
+{
+    while (tail != head) {
+        uint32_t rec = vid_ring[tail++ & VID_RING_MASK];
+        uint32_t arg = rec & 0xffffff;
+        switch (rec >> 24) {
+            case VID_CMD_CHAR:
+                effect_char((arg >> 8) & 0x7ff, arg & 0xff, arg & VID_FLAG_GAP, arg & VID_FLAG_CURSOR);
+                break;
+            case VID_CMD_BLANK:
+                effect_blank((arg >> 8) & 0x7ff, arg & VID_FLAG_TELETEXT, arg & VID_FLAG_FILL, arg & VID_FLAG_CURSOR);
+                break;
+            case VID_CMD_ROW:
+                effect_row(arg);
+                break;
+            case VID_CMD_ULA:
+                {
+                    struct video_ula_state s;
+                    uint32_t *p = (uint32_t *)&s;
+                    for (unsigned i = 0; i < VID_ULA_WORDS; i++)
+                        p[i] = vid_ring[tail++ & VID_RING_MASK];
+                    effect_ula(&s);
+                }
+                break;
+            case VID_CMD_HDISP:
+                effect_hdisp(arg);
+                break;
+            case VID_CMD_NULA_EDGES:
+                effect_nula_edges(arg & 0xfff, arg >> 12);
+                break;
+            case VID_CMD_LINE_END:
+                effect_line_end(arg & 0x3ff, arg >> 10);
+                break;
+            case VID_CMD_LINE_START:
+                effect_line_start(arg & 31, arg & 32);
+                break;
+            case VID_CMD_VSYNC:
+                effect_vsync(arg);
+                break;
+            case VID_CMD_PAL:
+                run_flush();
+                video_pal_frame();
+                break;
+        }
+    }
+    return tail;
+}
 
-ALLEGRO_COLOR border_col;
+static void *video_render_thread(ALLEGRO_THREAD *thread, void *data)
+{
+    unsigned tail = atomic_load(&vid_ring_tail), head;
+
+    for (;;) {
+        head = atomic_load(&vid_ring_head);
+        if (head == tail) {
+            al_lock_mutex(vid_lock);
+            atomic_store(&vid_render_waiting, true);
+            while ((head = atomic_load(&vid_ring_head)) == tail && !vid_stop)
+                al_wait_cond(vid_data_cond, vid_lock);
+            atomic_store(&vid_render_waiting, false);
+            al_unlock_mutex(vid_lock);
+            if (head == tail)
+                break;
+        }
+        tail = video_render_run(tail, head);
+        run_flush();
+        atomic_store(&vid_ring_tail, tail);
+        if (atomic_load(&vid_emu_waiting)) {
+            al_lock_mutex(vid_lock);
+            al_signal_cond(vid_space_cond);
+            al_unlock_mutex(vid_lock);
+        }
+    }
+    return NULL;
+}
+
+static void vid_publish(void)
+{
+    if (vid_published == vid_head)
+        return;
+    vid_published = vid_head;
+    if (!vid_thread) {
+        // no render thread yet, or any more: render here.
+        vid_tail_seen = video_render_run(atomic_load(&vid_ring_tail), vid_head);
+        run_flush();
+        atomic_store(&vid_ring_tail, vid_tail_seen);
+        atomic_store(&vid_ring_head, vid_head);
+        return;
+    }
+    atomic_store(&vid_ring_head, vid_head);
+    if (atomic_load(&vid_render_waiting)) {
+        al_lock_mutex(vid_lock);
+        al_signal_cond(vid_data_cond);
+        al_unlock_mutex(vid_lock);
+    }
+}
+
+// wait until the ring has room for n more words.
+static void vid_wait(unsigned n)
+{
+    vid_publish();
+    if (vid_head - (vid_tail_seen = atomic_load(&vid_ring_tail)) <= VID_RING_SIZE - n)
+        return;
+    al_lock_mutex(vid_lock);
+    atomic_store(&vid_emu_waiting, true);
+    while (vid_head - (vid_tail_seen = atomic_load(&vid_ring_tail)) > VID_RING_SIZE - n)
+        al_wait_cond(vid_space_cond, vid_lock);
+    atomic_store(&vid_emu_waiting, false);
+    al_unlock_mutex(vid_lock);
+}
+
+static inline void vid_reserve(unsigned n)
+{
+    if (vid_head - vid_tail_seen > VID_RING_SIZE - n)
+        vid_wait(n);
+}
+
+static inline void vid_commit(void)
+{
+    if (vid_head - vid_published >= VID_RING_BATCH)
+        vid_publish();
+}
+
+static inline void vid_put(unsigned cmd, uint32_t arg)
+{
+    vid_reserve(1);
+    vid_ring[vid_head++ & VID_RING_MASK] = (cmd << 24) | arg;
+    vid_commit();
+}
+
+static inline void record_char(int x, uint8_t dat, bool gap, bool cursor)
+{
+    vid_put(VID_CMD_CHAR, dat | (x << 8) | (gap ? VID_FLAG_GAP : 0) | (cursor ? VID_FLAG_CURSOR : 0));
+}
+
+static inline void record_blank(int x, bool teletext, bool fill, bool cursor)
+{
+    vid_put(VID_CMD_BLANK, (x << 8) | (teletext ? VID_FLAG_TELETEXT : 0) | (fill ? VID_FLAG_FILL : 0) | (cursor ? VID_FLAG_CURSOR : 0));
+}
+
+static inline void record_row(int y)
+{
+    vid_put(VID_CMD_ROW, y);
+}
+
+static void record_ula_state(const struct video_ula_state *s)
+{
+    const uint32_t *p = (const uint32_t *)s;
+
+    vid_reserve(VID_ULA_WORDS + 1);
+    vid_ring[vid_head++ & VID_RING_MASK] = VID_CMD_ULA << 24;
+    for (unsigned i = 0; i < VID_ULA_WORDS; i++)
+        vid_ring[vid_head++ & VID_RING_MASK] = p[i];
+    vid_commit();
+}
+
+static void record_hdisp(int hdisp)
+{
+    vid_put(VID_CMD_HDISP, hdisp);
+}
+
+static inline void record_nula_edges(int edge, int cut)
+{
+    // past the right of the screen is as good as anywhere further right.
+    if (edge > 0xfff)
+        edge = 0xfff;
+    if (cut > 0xfff)
+        cut = 0xfff;
+    vid_put(VID_CMD_NULA_EDGES, (edge & 0xfff) | ((cut & 0xfff) << 12));
+}
+
+static inline void record_line_end(int y, int delay)
+{
+    vid_put(VID_CMD_LINE_END, (y & 0x3ff) | (delay << 10));
+}
+
+static void record_line_start(int sc, bool new_row)
+{
+    vid_put(VID_CMD_LINE_START, sc | (new_row ? 32 : 0));
+}
+
+static inline void record_vsync(int interlline)
+{
+    vid_put(VID_CMD_VSYNC, interlline);
+}
+
+void video_render_pal(void)
+{
+    vid_put(VID_CMD_PAL, 0);
+    vid_publish();
+}
+
+/* Wait for the render thread to draw everything recorded so far. */
+void video_render_sync(void)
+{
+    vid_wait(VID_RING_SIZE);
+}
+
+static void video_render_start(void)
+{
+    if (!(vid_lock = al_create_mutex()) || !(vid_data_cond = al_create_cond()) || !(vid_space_cond = al_create_cond())) {
+        log_warn("video: unable to create render thread locks, rendering on the emulation thread");
+        return;
+    }
+    vid_stop = false;
+    if (!(vid_thread = al_create_thread(video_render_thread, NULL))) {
+        log_warn("video: unable to create render thread, rendering on the emulation thread");
+        return;
+    }
+    al_start_thread(vid_thread);
+}
+
+void video_render_stop(void)
+{
+    if (vid_thread) {
+        vid_publish();
+        al_lock_mutex(vid_lock);
+        vid_stop = true;
+        al_signal_cond(vid_data_cond);
+        al_unlock_mutex(vid_lock);
+        al_join_thread(vid_thread, NULL);
+        al_destroy_thread(vid_thread);
+        vid_thread = NULL;
+        vid_tail_seen = atomic_load(&vid_ring_tail);
+    }
+    if (vid_space_cond) {
+        al_destroy_cond(vid_space_cond);
+        vid_space_cond = NULL;
+    }
+    if (vid_data_cond) {
+        al_destroy_cond(vid_data_cond);
+        vid_data_cond = NULL;
+    }
+    if (vid_lock) {
+        al_destroy_mutex(vid_lock);
+        vid_lock = NULL;
+    }
+}
+
+#else
+
+#define record_char       effect_char
+#define record_blank      effect_blank
+#define record_row        effect_row
+#define record_ula_state  effect_ula
+#define record_nula_edges effect_nula_edges
+#define record_line_end   effect_line_end
+#define record_vsync      effect_vsync
+
+static void record_hdisp(int hdisp)
+{
+    effect_hdisp(hdisp);
+}
+
+static void record_line_start(int sc, bool new_row)
+{
+    effect_line_start(sc, new_row);
+}
+
+/* Finish drawing the characters gathered so far. */
+void video_render_sync(void)
+{
+    run_flush();
+}
+
+#endif
+
+/* Pass on the ULA state the renderer uses if it has changed. */
+static void record_ula(void)
+{
+    struct video_ula_state s;
+
+    memcpy(s.pal, ula_pal, sizeof(s.pal));
+    memcpy(s.collook, nula_collook, sizeof(s.collook));
+    s.ctrl = ula_ctrl;
+    s.mode = ula_mode;
+    s.crtc_mode = crtc_mode;
+    s.palette_mode = nula_palette_mode;
+    s.attribute_mode = nula_attribute_mode;
+    s.attribute_text = nula_attribute_text;
+    s.clip = nula_horizontal_offset || nula_left_blank;
+    s.dtype = vid_dtype_intern;
+    if (memcmp(&s, &ula_sent, sizeof(s))) {
+        ula_sent = s;
+        record_ula_state(&s);
+    }
+}
 
 ALLEGRO_DISPLAY *video_init(void)
 {
     int c;
     int temp, temp2, left;
 
+    if (headless) {
+        // render into memory only; nothing is ever flipped to a window.
+        display = NULL;
+        al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    }
+    else {
 #ifdef ALLEGRO_GTK_TOPLEVEL
-    al_set_new_display_flags(ALLEGRO_WINDOWED | ALLEGRO_GTK_TOPLEVEL | ALLEGRO_RESIZABLE);
+        al_set_new_display_flags(ALLEGRO_WINDOWED | ALLEGRO_GTK_TOPLEVEL | ALLEGRO_RESIZABLE);
 #else
-    al_set_new_display_flags(ALLEGRO_WINDOWED | ALLEGRO_RESIZABLE);
+        al_set_new_display_flags(ALLEGRO_WINDOWED | ALLEGRO_RESIZABLE);
 #endif
-    video_set_window_size(true);
-    if ((display = al_create_display(winsizex, winsizey)) == NULL) {
-        log_fatal("video: unable to create display");
-        exit(1);
+        video_set_window_size(true);
+        if ((display = al_create_display(winsizex, winsizey)) == NULL) {
+            log_fatal("video: unable to create display");
+            exit(1);
+        }
+        al_set_new_bitmap_flags(ALLEGRO_VIDEO_BITMAP);
     }
-
-    al_set_new_bitmap_flags(ALLEGRO_VIDEO_BITMAP);
     b16 = al_create_bitmap(832, 614);
     b32 = al_create_bitmap(1536, 800);
 
@@ -797,6 +1448,9 @@ ALLEGRO_DISPLAY *video_init(void)
     al_set_target_bitmap(b);
     al_clear_to_color(al_map_rgb(0, 0,0));
     region = al_lock_bitmap(b, ALLEGRO_PIXEL_FORMAT_ARGB_8888, ALLEGRO_LOCK_READWRITE);
+#ifdef USE_VIDEO_THREAD
+    video_render_start();
+#endif
     return display;
 }
 
@@ -811,12 +1465,79 @@ static const int cdrawlook[4] = { 3, 2, 1, 0 };
 
 static const int cmask[4] = { 0, 0, 16, 32 };
 
-static int lasthc0 = 0, lasthc;
-static int ccount = 0;
+static MACHINE_LOCAL int lasthc0 = 0, lasthc;
+static MACHINE_LOCAL int ccount = 0;
 
-static int vid_cleared;
+static MACHINE_LOCAL int vid_cleared;
 
-static int firstdispen = 0;
+static MACHINE_LOCAL int firstdispen = 0;
+
+/*
+ * The number of CPU cycles before the CRTC next reaches its horizontal
+ * total, which is where vertical sync can start or stop, or 1 while the
+ * vsync pulse is counting down.  The hardware event queue wakes the video
+ * then and the 6502 translator keeps its blocks short of it.
+ */
+int video_next_event(void)
+{
+    int delay;
+
+    if (hvblcount)
+        delay = 1; // vsync pulse is counting down, stay in step.
+    else {
+        int hc_target = interline ? (crtc[0] >> 1) : crtc[0];
+        delay = ((hc_target - hc) & 0xff) + 1;
+        if (!(ula_ctrl & 0x10)) {
+            // 1MHz character clock.
+            delay *= 2;
+            if (!oddclock)
+                delay--;
+        }
+    }
+    return delay;
+}
+
+#ifdef USE_HW_EVENT
+/*
+ * With the hardware event queue the CRTC is not clocked by the CPU.  It
+ * is caught up whenever its registers, the ULA or the screen bank change
+ * or the 6502 writes to &3000-&7FFF, where the screen can be, and is woken
+ * at each horizontal total so that vertical sync reaches the system VIA on
+ * the right cycle.
+ */
+static bool video_invoke(struct hw_event *event);
+
+static MACHINE_LOCAL struct hw_event video_event = {
+    .invoke = video_invoke
+};
+
+void video_cycle_sync(void)
+{
+    cycle_timestamp_t now = get_hardware_timestamp();
+    int32_t delta = now - video_event.user_time;
+
+    video_event.user_time = now;
+    if (delta > 0) {
+        speed_sect_t sect = speed_enter(SPEED_VIDEO);
+        video_poll(delta, 1);
+        speed_leave(sect);
+    }
+}
+
+static bool video_invoke(struct hw_event *event)
+{
+    video_cycle_sync();
+    event->target = event->user_time + video_next_event();
+    return true;
+}
+
+static void video_start_events(void)
+{
+    video_event.user_time = get_hardware_timestamp();
+    video_event.target = video_event.user_time + 1;
+    upsert_hw_event(&video_event);
+}
+#endif
 
 void video_reset()
 {
@@ -829,11 +1550,14 @@ void video_reset()
     charsleft = 0;
     vidbank = 0;
 
-    nula_left_cut = 0;
-    nula_left_edge = 0;
+    record_nula_edges(0, 0);
     nula_left_blank = 0;
     nula_horizontal_offset = 0;
+    record_ula();
 
+#ifdef USE_HW_EVENT
+    video_start_events();
+#endif
 }
 
 #if 0
@@ -850,9 +1574,10 @@ static inline int is_free_run(void) {
 
 void video_poll(int clocks, int timer_enable)
 {
-    int c, oldvc;
+    int oldvc;
     uint16_t addr;
     uint8_t dat;
+    bool cursor;
 
     while (clocks--) {
         scrx += 8;
@@ -889,10 +1614,17 @@ void video_poll(int clocks, int timer_enable)
             default:
                 break;
         }
+        if (scry != row_sent) {
+            row_sent = scry;
+            record_row(scry);
+        }
 
+        cursor = cdraw && cursoron && (ula_ctrl & cursorlook[cdraw]);
         if (dispen) {
-            if (!((ma ^ (crtc[15] | (crtc[14] << 8))) & 0x3FFF) && con)
+            if (!((ma ^ (crtc[15] | (crtc[14] << 8))) & 0x3FFF) && con) {
                 cdraw = cdrawlook[crtc[8] >> 6];
+                cursor = cursoron && (ula_ctrl & cursorlook[cdraw]);
+            }
 
             if (ma & 0x2000)
                 dat = ram[0x7C00 | (ma & 0x3FF) | vidbank];
@@ -907,97 +1639,10 @@ void video_poll(int clocks, int timer_enable)
             }
 
             if (scrx < (1280-16)) {
-                if ((crtc[8] & 0x30) == 0x30 || ((sc & 8) && !(ula_ctrl & 2))) {
-                    // Gaps between lines in modes 3 & 6.
-                    put_pixels(region, scrx, scry, (ula_ctrl & 0x10) ? 8 : 16, colblack);
-                } else
-                    switch (crtc_mode) {
-                    case 0:
-                        mode7_render(region, dat & 0x7F);
-                        break;
-                    case 1:
-                        {
-                            if (scrx < firstx)
-                                firstx = scrx;
-                            if ((scrx + 8) > lastx)
-                                lastx = scrx + 8;
-                            if (nula_attribute_mode && ula_mode > 1) {
-                                if (ula_mode == 3) {
-                                    // 1bpp
-                                    if (nula_attribute_text) {
-                                        int attribute = ((dat & 7) << 1);
-                                        float pc = 0.0f;
-                                        for (c = 0; c < 7; c++, pc += 0.75f) {
-                                            int output = ula_pal[attribute | (dat >> (7 - (int) pc) & 1)];
-                                            nula_putpixel(region, scrx + c, scry, output);
-                                        }
-                                        // Very loose approximation of the text attribute mode
-                                        nula_putpixel(region, scrx + 7, scry, ula_pal[attribute]);
-                                    } else {
-                                        int attribute = ((dat & 3) << 2);
-                                        float pc = 0.0f;
-                                        for (c = 0; c < 8; c++, pc += 0.75f) {
-                                            int output = ula_pal[attribute | (dat >> (7 - (int) pc) & 1)];
-                                            nula_putpixel(region, scrx + c, scry, output);
-                                        }
-                                    }
-                                } else {
-                                    int attribute = (((dat & 16) >> 1) | ((dat & 1) << 2));
-                                    float pc = 0.0f;
-                                    for (c = 0; c < 8; c++, pc += 0.75f) {
-                                        int a = 3 - ((int) pc) / 2;
-                                        int output = ula_pal[attribute | ((dat >> (a + 3)) & 2) | ((dat >> a) & 1)];
-                                        nula_putpixel(region, scrx + c, scry, output);
-                                    }
-                                }
-                            } else {
-                                for (c = 0; c < 8; c++) {
-                                    nula_putpixel(region, scrx + c, scry, nula_palette_mode ? nula_collook[table4bpp[ula_mode][dat][c]] : ula_pal[table4bpp[ula_mode][dat][c]]);
-                                }
-                            }
-                        }
-                        break;
-                    case 2:
-                        {
-                            if (scrx < firstx)
-                                firstx = scrx;
-                            if ((scrx + 16) > lastx)
-                                lastx = scrx + 16;
-                            if (nula_attribute_mode && ula_mode > 1) {
-                                // In low frequency clock can only have 1bpp modes
-                                if (nula_attribute_text) {
-                                    int attribute = ((dat & 7) << 1);
-                                    float pc = 0.0f;
-                                    for (c = 0; c < 14; c++, pc += 0.375f) {
-                                        int output = ula_pal[attribute | (dat >> (7 - (int) pc) & 1)];
-                                        nula_putpixel(region, scrx + c, scry, output);
-                                    }
-
-                                    // Very loose approximation of the text attribute mode
-                                    nula_putpixel(region, scrx + 14, scry, ula_pal[attribute]);
-                                    nula_putpixel(region, scrx + 15, scry, ula_pal[attribute]);
-                                } else {
-                                    int attribute = ((dat & 3) << 2);
-                                    float pc = 0.0f;
-                                    for (c = 0; c < 16; c++, pc += 0.375f) {
-                                        int output = ula_pal[attribute | (dat >> (7 - (int) pc) & 1)];
-                                        nula_putpixel(region, scrx + c, scry, output);
-                                    }
-                                }
-                            } else {
-                                for (c = 0; c < 16; c++) {
-                                    nula_putpixel(region, scrx + c, scry, nula_palette_mode ? nula_collook[table4bpp[ula_mode][dat][c]] : ula_pal[table4bpp[ula_mode][dat][c]]);
-                                }
-                            }
-                        }
-                        break;
-                    }
+                // gaps between lines in modes 3 & 6.
+                bool gap = (crtc[8] & 0x30) == 0x30 || ((sc & 8) && !(ula_ctrl & 2));
+                record_char(scrx, dat, gap, cursor);
                 if (cdraw) {
-                    if (cursoron && (ula_ctrl & cursorlook[cdraw])) {
-                        for (c = ((ula_ctrl & 0x10) ? 8 : 16); c >= 0; c--) {
-                            nula_putpixel(region, scrx + c, scry, get_pixel(region, scrx + c, scry) ^ colwhite);
-                        }
-                    }
                     cdraw++;
                     if (cdraw == 7)
                         cdraw = 0;
@@ -1006,22 +1651,17 @@ void video_poll(int clocks, int timer_enable)
             ma++;
             vidbytes++;
         } else {
+            bool teletext = false, fill = false;
             if (charsleft) {
-                if (charsleft != 1)
-                    mode7_render(region, 255);
+                teletext = charsleft != 1 && scrx < (1280-32);
                 charsleft--;
-
-            } else if (scrx < (1280-32)) {
-                put_pixels(region, scrx, scry, (ula_ctrl & 0x10) ? 8 : 16, colblack);
-                if (!crtc_mode)
-                    put_pixels(region, scrx + 16, scry, 16, colblack);
-            }
+            } else
+                fill = scrx < (1280-32);
+            if (scrx >= (1280-16))
+                cursor = false;
+            if (teletext || fill || cursor)
+                record_blank(scrx, teletext, fill, cursor);
             if (cdraw && scrx < (1280-16)) {
-                if (cursoron && (ula_ctrl & cursorlook[cdraw])) {
-                    for (c = ((ula_ctrl & 0x10) ? 8 : 16); c >= 0; c--) {
-                        nula_putpixel(region, scrx + c, scry, get_pixel(region, scrx + c, scry) ^ colwhite);
-                    }
-                }
                 cdraw++;
                 if (cdraw == 7)
                     cdraw = 0;
@@ -1050,32 +1690,23 @@ void video_poll(int clocks, int timer_enable)
             else
                 scrx = 128 - ((crtc[3] & 15) * 8);
         } else if (hc == crtc[0]) {
-            mode7_col = 7;
-            mode7_bg = 0;
-            mode7_holdchar = 0;
-            mode7_heldchar = 0x20;
-            mode7_p[0] = mode7_chars;
-            mode7_p[1] = mode7_charsi;
-            mode7_flash = 0;
-            mode7_sep = 0;
-            mode7_gfx = 0;
-            mode7_heldp[0] = mode7_p[0];
-            mode7_heldp[1] = mode7_p[1];
+            // the work of the line is done here so only this is timed.
+            speed_sect_t sect = speed_enter(SPEED_VIDEO);
+            bool new_row = false;
+            int delay = 0;
 
             hc = 0;
 
             if (crtc_mode) {
-                // NULA left edge
-                nula_left_edge = scrx + crtc_mode * 8;
-
-                // NULA left cut
-                nula_left_cut = nula_left_edge + nula_left_blank * crtc_mode * 8;
+                // NULA left edge and left cut
+                int edge = scrx + crtc_mode * 8;
+                record_nula_edges(edge, edge + nula_left_blank * crtc_mode * 8);
 
                 // NULA horizontal offset - "delay" the pixel clock
-                for (c = 0; c < nula_horizontal_offset * crtc_mode; c++, scrx++) {
-                    put_pixel(region, scrx + crtc_mode * 8, scry, colblack);
-                }
+                delay = nula_horizontal_offset * crtc_mode;
+                scrx += delay;
             }
+            record_line_end(scry, delay);
 
             if (sc == (crtc[11] & 31) || ((crtc[8] & 3) == 3 && sc == ((crtc[11] & 31) >> 1))) {
                 con = 0;
@@ -1097,10 +1728,7 @@ void video_poll(int clocks, int timer_enable)
                 sc = 0;
                 con = 0;
                 coff = 0;
-                if (mode7_nextdbl)
-                    mode7_nextdbl = 0;
-                else
-                    mode7_nextdbl = mode7_wasdbl;
+                new_row = true;
                 oldvc = vc;
                 vc++;
                 vc &= 127;
@@ -1125,6 +1753,8 @@ void video_poll(int clocks, int timer_enable)
                     int intsync = crtc[8] & 1;
                     if (!intsync && oldr8) {
                         ALLEGRO_COLOR black = al_map_rgb(0, 0, 0);
+                        video_render_sync();
+                        video_pal_discard();
                         al_set_target_bitmap(b32);
                         al_clear_to_color(black);
                         al_unlock_bitmap(b);
@@ -1142,6 +1772,7 @@ void video_poll(int clocks, int timer_enable)
                         vid_cleared = 0;
                     } else if (vidclocks <= 1024 && !vid_cleared) {
                         vid_cleared = 1;
+                        video_render_sync();
                         al_unlock_bitmap(b);
                         al_clear_to_color(al_map_rgb(0, 0, 0));
                         region = al_lock_bitmap(b, ALLEGRO_PIXEL_FORMAT_ARGB_8888, ALLEGRO_LOCK_READWRITE);
@@ -1158,11 +1789,7 @@ void video_poll(int clocks, int timer_enable)
                     if (!(crtc[3] >> 4))
                         vsynctime = 17;
 
-                    mode7_flashtime++;
-                    if ((mode7_flashon && mode7_flashtime == 32) || (!mode7_flashon && mode7_flashtime == 16)) {
-                        mode7_flashon = !mode7_flashon;
-                        mode7_flashtime = 0;
-                    }
+                    record_vsync(interlline);
 
                     vidclocks = vidbytes = 0;
                 }
@@ -1172,7 +1799,7 @@ void video_poll(int clocks, int timer_enable)
                 ma = maback;
             }
 
-            mode7_dbl = mode7_wasdbl = 0;
+            record_line_start(sc, new_row);
             if ((sc == (crtc[10] & 31) || ((crtc[8] & 3) == 3 && sc == ((crtc[10] & 31) >> 1))) && !coff)
                 con = 1;
 
@@ -1195,6 +1822,7 @@ void video_poll(int clocks, int timer_enable)
 
             firstdispen = 1;
             lasthc0 = 1;
+            speed_leave(sect);
         } else {
             hc++;
             hc &= 255;
@@ -1230,9 +1858,17 @@ void video_loadstate(FILE * f)
 }
 
 void select_vidbank(bool shadow) {
+#ifdef USE_HW_EVENT
+    if (vidbank != (shadow ? 0x8000 : 0))
+        video_cycle_sync();
+#endif
     vidbank = shadow ? 0x8000 : 0;
 }
 
 void set_scrsize(int s) {
+#ifdef USE_HW_EVENT
+    if (scrsize != s)
+        video_cycle_sync();
+#endif
     scrsize = s;
 }
@@ -12,11 +12,11 @@ void    crtc_savestate(FILE *f);
 void    crtc_loadstate(FILE *f);
 
 #ifndef NO_USE_DEBUGGER
-extern uint8_t crtc[32];
-extern int crtc_i;
+extern MACHINE_LOCAL uint8_t crtc[32];
+extern MACHINE_LOCAL int crtc_i;
 
-extern int hc, vc, sc;
-extern uint16_t ma;
+extern MACHINE_LOCAL int hc, vc, sc;
+extern MACHINE_LOCAL uint16_t ma;
 #endif
 
 /*Video ULA (VIDPROC)*/
@@ -25,22 +25,22 @@ void videoula_savestate(FILE *f);
 void videoula_loadstate(FILE *f);
 
 #ifndef NO_USE_DEBUGGER
-extern uint8_t ula_ctrl;
-extern uint8_t ula_palbak[16];
-extern int nula_collook[16];
-extern uint8_t nula_flash[8];
-
-extern uint8_t nula_palette_mode;
-extern uint8_t nula_horizontal_offset;
-extern uint8_t nula_left_blank;
-extern uint8_t nula_attribute_mode;
-extern uint8_t nula_attribute_text;
+extern MACHINE_LOCAL uint8_t ula_ctrl;
+extern MACHINE_LOCAL uint8_t ula_palbak[16];
+extern MACHINE_LOCAL int nula_collook[16];
+extern MACHINE_LOCAL uint8_t nula_flash[8];
+
+extern MACHINE_LOCAL uint8_t nula_palette_mode;
+extern MACHINE_LOCAL uint8_t nula_horizontal_offset;
+extern MACHINE_LOCAL uint8_t nula_left_blank;
+extern MACHINE_LOCAL uint8_t nula_attribute_mode;
+extern MACHINE_LOCAL uint8_t nula_attribute_text;
 #endif
-extern uint8_t nula_disable;
+extern MACHINE_LOCAL uint8_t nula_disable;
 
 ALLEGRO_DISPLAY *video_init(void);
 void video_reset(void);
-#ifndef USE_HW_EVENT
+#if !defined(USE_HW_EVENT) || !defined(PICO_BUILD)
 void video_poll(int clocks, int timer_enable);
 #endif
 void video_savestate(FILE *f);
@@ -51,9 +51,10 @@ void nula_default_palette(void);
 void select_vidbank(bool shadow);
 void mode7_makechars(void);
 #ifndef PICO_BUILD
-extern int interlline;
+extern MACHINE_LOCAL int interlline;
 #endif
 
+int video_next_event(void);
 #ifdef USE_HW_EVENT
 void video_cycle_sync();
 #endif
@@ -3,9 +3,9 @@
 
 // disabling here to catch all uses
 #ifndef PICO_BUILD
-extern ALLEGRO_BITMAP *b, *b16, *b32;
-extern ALLEGRO_LOCKED_REGION *region;
-extern ALLEGRO_COLOR border_col;
+extern MACHINE_LOCAL ALLEGRO_BITMAP *b, *b16, *b32;
+extern MACHINE_LOCAL ALLEGRO_LOCKED_REGION *region;
+extern MACHINE_LOCAL ALLEGRO_COLOR border_col;
 #endif
 
 #define BORDER_NONE_X_START_GRA 336
@@ -35,28 +35,28 @@ extern ALLEGRO_COLOR border_col;
 #define BORDER_FULL_Y_START_TXT   4
 #define BORDER_FULL_Y_END_TXT   308
 
-extern int firstx, firsty, lastx, lasty;
+extern MACHINE_LOCAL int firstx, firsty, lastx, lasty;
 extern int scr_x_start, scr_x_size, scr_y_start, scr_y_size;
 extern int winsizex, winsizey;
 
-extern int fullscreen;
+extern MACHINE_LOCAL int fullscreen;
 
-extern enum vid_disptype {
+extern MACHINE_LOCAL enum vid_disptype {
     VDT_SCALE,
     VDT_INTERLACE,
     VDT_SCANLINES,
     VDT_LINEDOUBLE,
 } vid_dtype_user;
 #ifndef PICO_BUILD
-extern enum vid_disptype vid_dtype_intern;
+extern MACHINE_LOCAL enum vid_disptype vid_dtype_intern;
 #endif
 
 extern bool vid_pal;
 extern int vid_fskipmax, vid_fullborders;
 extern bool vid_print_mode;
 
-extern int vid_savescrshot;
-extern char vid_scrshotname[260];
+extern MACHINE_LOCAL int vid_savescrshot;
+extern MACHINE_LOCAL char vid_scrshotname[260];
 
 void video_doblit(bool non_ttx, uint8_t vtotal);
 void video_enterfullscreen(void);
@@ -68,6 +68,19 @@ void video_set_disptype(enum vid_disptype dtype);
 void video_set_borders(int borders);
 
 void video_close(void);
+void video_dump_screen(const char *fn);
+bool video_checksum(uint32_t *sum);
+
+void video_pal_frame(void);
+void video_render_sync(void);
+#ifdef USE_VIDEO_THREAD
+void video_render_pal(void);
+void video_render_stop(void);
+void video_pal_discard(void);
+#else
+static inline void video_render_stop(void) {}
+static inline void video_pal_discard(void) {}
+#endif
 
 void clearscreen(void);
 
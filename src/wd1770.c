@@ -15,6 +15,7 @@
 
 void wd1770_callback();
 void wd1770_data(uint8_t dat);
+bool wd1770_drq(void);
 void wd1770_spindown();
 void wd1770_finishread();
 void wd1770_notfound();
@@ -23,7 +24,7 @@ void wd1770_headercrcerror();
 void wd1770_writeprotect();
 int  wd1770_getdata(int last);
 
-struct
+MACHINE_LOCAL struct
 {
     uint8_t command, sector, track, status, data;
     uint8_t ctrl;
@@ -42,7 +43,7 @@ static uint8_t nmi_on_completion[5] = {
     1  // WD1770_WATFORD
 };
 
-static int bytenum;
+static MACHINE_LOCAL int bytenum;
 
 void wd1770_reset()
 {
@@ -60,6 +61,7 @@ void wd1770_reset()
         fdc_headercrcerror = wd1770_headercrcerror;
         fdc_writeprotect   = wd1770_writeprotect;
         fdc_getdata        = wd1770_getdata;
+        fdc_drq            = wd1770_drq;
         set_motorspin(45000);
     } else {
         set_motorspin(0);
@@ -104,7 +106,7 @@ static void short_spindown(void)
 
 #define track0 (wd1770.curtrack ? 0 : 4)
 
-static int data_count = 0;
+static MACHINE_LOCAL int data_count = 0;
 
 static void begin_read_sector(const char *variant)
 {
@@ -447,7 +449,7 @@ void wd1770_callback()
         } else {
             log_debug("wd1770: multi-sector read, inter-sector gap");
             wd1770.in_gap = 1;
-            set_fdc_time(5000);
+            set_fdc_time(fastdisc ? 200 : 5000);
         }
         break;
     case 0xA: /*Write sector*/
@@ -464,7 +466,7 @@ void wd1770_callback()
         } else {
             log_debug("wd1770: multi-sector write, inter-sector gap");
             wd1770.in_gap = 1;
-            set_fdc_time(5000);
+            set_fdc_time(fastdisc ? 200 : 5000);
         }
         break;
 
@@ -497,6 +499,11 @@ void wd1770_data(uint8_t dat)
     }
 }
 
+bool wd1770_drq(void)
+{
+    return wd1770.status & 2;
+}
+
 void wd1770_finishread()
 {
     log_debug("wd1770: data i/o finished");
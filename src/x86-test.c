@@ -0,0 +1,300 @@
+/*
+ * B-em 80186 co-processor testing
+ *
+ * This program runs the 80186 core on its own, with the tube replaced by
+ * stubs, through a loop benchmark, a loop over every REP string
+ * instruction in both directions and with segment overrides before and
+ * after the REP, and images of random bytes with random registers,
+ * interrupts and DMA, and prints a hash of the whole processor state
+ * taken after every slice of each, and of the RAM at the end.  It is
+ * built twice, once running each REP string instruction to the end of
+ * the slice and once with NO_USE_X86_REP_WHOLE, which goes back round
+ * x86_exec for each element, and utils/core-compare.sh checks the two
+ * print the same.
+ *
+ * The core keeps its registers in statics, so it is included here
+ * rather than linked.
+ */
+
+#include "b-em.h"
+#include "tube.h"
+
+#include <stdarg.h>
+
+tubetype tube_type;
+uint8_t (*tube_readmem)(uint32_t addr);
+void (*tube_writemem)(uint32_t addr, uint8_t byte);
+void (*tube_exec)(void);
+int tubecycles;
+int tube_irq;
+uint32_t oldpc;
+
+void log_warn(const char *fmt, ...) {}
+void log_error(const char *fmt, ...) {}
+
+FILE *x_fopen(const char *fn, const char *mode)
+{
+    return NULL;
+}
+
+static uint32_t rng;
+static uint32_t wsum;
+
+static uint32_t rnd(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return (rng >> 8) ^ (rng << 13);
+}
+
+uint8_t tube_parasite_read(uint32_t addr)
+{
+    return rnd();
+}
+
+void tube_parasite_write(uint32_t addr, uint8_t val)
+{
+    wsum = wsum * 31 + val + addr;
+}
+
+// the core reports opcodes it does not know on stdout.
+#define printf(...) ((void)0)
+#include "x86.c"
+#undef printf
+
+#define SLICE   1000    // tubecycles given to each slice of the benchmark.
+#define ORG     0x1000  // the code segment the benchmarks are loaded at.
+#define STEPS   2000    // slices each random image is run for.
+
+/*
+ * Fill 4K with a pattern, copy it with REP MOVSW and add it up a word at
+ * a time through a subroutine, over and over.
+ */
+static const uint8_t loop_code[] = {
+    0xbd, 0xc8, 0x00,           // start: mov bp,200
+    0x31, 0xf6,                 // outer: xor si,si
+    0xbf, 0x00, 0x01,           // mov di,0x100
+    0xb9, 0x00, 0x02,           // mov cx,0x200
+    0x89, 0xc8,                 // fill: mov ax,cx
+    0x01, 0xf0,                 // add ax,si
+    0x89, 0x04,                 // mov [si],ax
+    0x35, 0x5a, 0x5a,           // xor ax,0x5a5a
+    0x89, 0x44, 0x02,           // mov [si+2],ax
+    0x83, 0xc6, 0x04,           // add si,4
+    0xe2, 0xef,                 // loop fill
+    0x1e,                       // push ds
+    0x07,                       // pop es
+    0xfc,                       // cld
+    0x31, 0xf6,                 // xor si,si
+    0xbf, 0x00, 0x40,           // mov di,0x4000
+    0xb9, 0x00, 0x04,           // mov cx,0x400
+    0xf3, 0xa5,                 // rep movsw
+    0xb9, 0x00, 0x01,           // mov cx,0x100
+    0x31, 0xf6,                 // xor si,si
+    0x31, 0xd2,                 // xor dx,dx
+    0xad,                       // sum: lodsw
+    0x01, 0xc2,                 // add dx,ax
+    0x83, 0xd3, 0x00,           // adc bx,0
+    0x3d, 0x34, 0x12,           // cmp ax,0x1234
+    0x75, 0x01,                 // jne skip
+    0x43,                       // inc bx
+    0xe8, 0x27, 0x00,           // skip: call sub1
+    0xa8, 0x01,                 // test al,1
+    0x74, 0x02,                 // je even
+    0xd1, 0xe2,                 // shl dx,1
+    0xe2, 0xe9,                 // even: loop sum
+    0x26, 0x89, 0x16, 0x00, 0x80, // mov es:[0x8000],dx
+    0x8a, 0x40, 0x10,           // mov al,[bx+si+0x10]
+    0xb9, 0x40, 0x00,           // mov cx,0x40
+    0x89, 0xcb,                 // inner: mov bx,cx
+    0x83, 0xe3, 0x3f,           // and bx,0x3f
+    0x8a, 0x47, 0x20,           // mov al,[bx+0x20]
+    0x88, 0x87, 0x00, 0x60,     // mov [bx+0x6000],al
+    0x49,                       // dec cx
+    0x75, 0xf1,                 // jne inner
+    0x4d,                       // dec bp
+    0x75, 0x9f,                 // jne outer
+    0xeb, 0x9a,                 // jmp start
+    0x51,                       // sub1: push cx
+    0x89, 0xd1,                 // mov cx,dx
+    0xd1, 0xc9,                 // ror cx,1
+    0x31, 0xca,                 // xor dx,cx
+    0x59,                       // pop cx
+    0xc3                        // ret
+};
+
+/*
+ * Run each REP string instruction, some stopped part way by REPE and
+ * REPNE, some backwards and some with segment overrides, over and over.
+ */
+static const uint8_t rep_code[] = {
+    0x1e,                       // start: push ds
+    0x07,                       // pop es
+    0xfc,                       // cld
+    0xbf, 0x00, 0x01,           // mov di,0x100
+    0xb8, 0x34, 0x12,           // mov ax,0x1234
+    0xb9, 0x2c, 0x01,           // mov cx,300
+    0xf3, 0xab,                 // rep stosw
+    0xbe, 0x00, 0x01,           // mov si,0x100
+    0xbf, 0x01, 0x01,           // mov di,0x101
+    0xb9, 0xc8, 0x00,           // mov cx,200
+    0xf3, 0xa4,                 // rep movsb
+    0xbe, 0x00, 0x01,           // mov si,0x100
+    0xbf, 0x00, 0x20,           // mov di,0x2000
+    0xb9, 0x64, 0x00,           // mov cx,100
+    0xf3, 0xa5,                 // rep movsw
+    0xc6, 0x06, 0x80, 0x20, 0x77, // mov byte [0x2080],0x77
+    0xbe, 0x00, 0x01,           // mov si,0x100
+    0xbf, 0x00, 0x20,           // mov di,0x2000
+    0xb9, 0x2c, 0x01,           // mov cx,300
+    0xf3, 0xa6,                 // repe cmpsb
+    0x89, 0xca,                 // mov dx,cx
+    0xbf, 0x00, 0x20,           // mov di,0x2000
+    0xb0, 0x77,                 // mov al,0x77
+    0xb9, 0xf4, 0x01,           // mov cx,500
+    0xf2, 0xae,                 // repne scasb
+    0x01, 0xca,                 // add dx,cx
+    0xfd,                       // std
+    0xbe, 0x00, 0x30,           // mov si,0x3000
+    0xbf, 0x00, 0x50,           // mov di,0x5000
+    0xb9, 0x4d, 0x00,           // mov cx,77
+    0xf3, 0xa5,                 // rep movsw
+    0xb9, 0x28, 0x00,           // mov cx,40
+    0x26, 0xf3, 0xa4,           // es: rep movsb
+    0xb9, 0x0a, 0x00,           // mov cx,10
+    0xf3, 0x2e, 0xa5,           // rep cs: movsw
+    0xba, 0x80, 0x00,           // mov dx,0x80
+    0xb9, 0x08, 0x00,           // mov cx,8
+    0xf3, 0x6e,                 // rep outsb
+    0xb9, 0x21, 0x00,           // mov cx,33
+    0xf3, 0xac,                 // rep lodsb
+    0xb9, 0x21, 0x00,           // mov cx,33
+    0xf3, 0xad,                 // rep lodsw
+    0xfc,                       // cld
+    0xbf, 0x00, 0x30,           // mov di,0x3000
+    0xb9, 0x14, 0x00,           // mov cx,20
+    0xf3, 0xaf,                 // repe scasw
+    0xb9, 0x00, 0x00,           // mov cx,0
+    0xf3, 0xa4,                 // rep movsb
+    0x01, 0xd3,                 // add bx,dx
+    0x31, 0x1e, 0x10, 0x00,     // xor [0x10],bx
+    0xe9, 0x7d, 0xff            // jmp start
+};
+
+static uint32_t state(void)
+{
+    uint32_t h = 0;
+
+    for (int i = 0; i < 8; i++)
+        h = h * 31 + regs[i].w;
+    h = h * 31 + pc;
+    h = h * 31 + CS;
+    h = h * 31 + ds;
+    h = h * 31 + ES;
+    h = h * 31 + ss;
+    h = h * 31 + flags;
+    h = h * 31 + ssegs;
+    h = h * 31 + inhlt;
+    h = h * 31 + firstrepcycle;
+    h = h * 31 + x86src;
+    h = h * 31 + x86dst;
+    h = h * 31 + x86ena;
+    h = h * 31 + x86imask;
+    h = h * 31 + (uint32_t)tubecycles;
+    return h;
+}
+
+static void report(const char *name, uint32_t hash)
+{
+    for (int i = 0; i < X86_RAM_SIZE; i++)
+        hash = hash * 33 + x86ram[i];
+    printf("%-12s %08x %08x %04x:%04x\n", name, hash, wsum, CS, pc);
+}
+
+static void load(const uint8_t *code, size_t size)
+{
+    memset(x86ram, 0, X86_RAM_SIZE);
+    memcpy(x86ram + (ORG << 4), code, size);
+    x86_reset();
+    loadcs(ORG);
+    loadseg(0x2000, &_ds);
+    loadseg(0x3000, &_es);
+    loadseg(0x4000, &_ss);
+    SP = 0xfffe;
+    tubecycles = 0;
+    wsum = 0;
+}
+
+static void run(const char *name, long slices)
+{
+    uint32_t hash = 0;
+
+    for (long i = 0; i < slices; i++) {
+        tubecycles += SLICE;
+        x86_exec();
+        hash = hash * 33 + state();
+    }
+    report(name, hash);
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t rom[X86_ROM_SIZE];
+    char name[24];
+    long slices = 20000;
+    int images = 300;
+    uint32_t hash;
+
+    if (argc > 1)
+        slices = atol(argv[1]);
+    if (argc > 2)
+        images = atoi(argv[2]);
+    if (argc > 3 || slices <= 0 || images < 0) {
+        fputs("Usage: x86-test [ <slices> [ <random-images> ] ]\n", stderr);
+        return 1;
+    }
+    if (!x86_init(rom))
+        return 1;
+
+    load(loop_code, sizeof loop_code);
+    run("loop", slices);
+    load(rep_code, sizeof rep_code);
+    run("rep", slices);
+
+    /*
+     * Even images are run an instruction at a time and odd ones in slices
+     * of many.  Raising an interrupt or DMA part way through a REP makes
+     * it go back round x86_exec for the rest, so both the loop in rep()
+     * and leaving it for the next pass are covered.
+     */
+    for (int i = 1; i <= images; i++) {
+        rng = i;
+        for (int j = 0; j < sizeof rom; j++)
+            rom[j] = rnd();
+        for (int j = 0; j < X86_RAM_SIZE; j++)
+            x86ram[j] = rnd();
+        for (int r = 0; r < 8; r++)
+            regs[r].w = rnd();
+        loadcs(rnd());
+        loadseg(rnd(), &_ds);
+        loadseg(rnd(), &_es);
+        loadseg(rnd(), &_ss);
+        pc = rnd();
+        flags = (rnd() & 0x0fd5) | 2;
+        ssegs = noint = inhlt = 0;
+        firstrepcycle = 1;
+        x86src = x86dst = x86ena = x86imask = 0;
+        tubecycles = 0;
+        hash = wsum = 0;
+        for (int s = 0; s < STEPS; s++) {
+            tube_irq = (rnd() % 16 == 0) | ((rnd() % 64 == 0) << 1);
+            tubecycles += (i & 1) ? 1 + rnd() % 400 : 1;
+            x86_exec();
+            hash = hash * 33 + state();
+        }
+        tube_irq = 0;
+        snprintf(name, sizeof name, "random-%d", i);
+        report(name, hash);
+    }
+    x86_close();
+    return 0;
+}
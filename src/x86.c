@@ -53,7 +53,11 @@ static inline uint16_t readmemwlx86(uint32_t addr)
 {
         if (addr<0xE0000) return *(uint16_t *)(&x86ram[addr]);
 //        if (addr<0xC0000) return *(uint16_t *)(&x86ram[addr-0x40000]);
-        if (addr>0xF0000) return *(uint16_t *)(&x86rom[addr&0x3FFF]);
+        if (addr>0xF0000)
+        {
+                if ((addr&0x3FFF)==0x3FFF) return x86rom[0x3FFF]|(x86rom[0]<<8);
+                return *(uint16_t *)(&x86rom[addr&0x3FFF]);
+        }
         return 0xFFFF;
 }
 
@@ -84,7 +88,14 @@ static inline void writemembl(uint32_t addr, uint8_t byte)
 
 static inline void writememwlx86(uint32_t addr, uint16_t word)
 {
-    *(uint16_t *)(&x86ram[addr & 0xFFFFF]) = word;
+    addr &= 0xFFFFF;
+    if (addr == 0xFFFFF) {
+        // the high byte wraps round to the bottom of memory.
+        x86ram[addr] = word;
+        x86ram[0] = word >> 8;
+        return;
+    }
+    *(uint16_t *)(&x86ram[addr]) = word;
 }
 
 static inline void writememwl(uint32_t seg, uint32_t addr, uint16_t word)
@@ -928,6 +939,16 @@ static void x86_dma()
 }
 
 static int firstrepcycle=1;
+
+/*Called after each element of a REP string instruction, which has been
+  charged to tubecycles, with whether there are more to do.  Unless DMA, an
+  interrupt or the debugger has to get in between elements, or the time
+  slice is used up, carry on with the next one here rather than going back
+  round x86_exec and fetching and decoding the prefixes and opcode again.
+  The segment overrides either side of the REP are charged again for each
+  element as going back round would have done.*/
+#define repagain(more) ((more) && whole && tubecycles>0 && ((tubecycles-=overcycles),1))
+
 static void rep(int fv)
 {
         uint8_t temp;
@@ -937,6 +958,12 @@ static void rep(int fv)
         uint16_t ipc=oldpc;//pc-1;
         int changeds = 0;
         uint32_t oldds = 0;
+#ifndef NO_USE_X86_REP_WHOLE
+        int whole=!dbg_x86 && !(tube_irq&2) && !((flags&I_FLAG) && (tube_irq&1));
+#else
+        int whole=0;    /*one element each pass round x86_exec*/
+#endif
+        int overcycles=(uint16_t)(pc-1-ipc)*4;
         startrep:
         temp=readmembl(cs+pc); pc++;
 //        if (firstrepcycle && temp==0xA5) printf("REP MOVSW %06X:%04X %06X:%04X\n",ds,SI,es,DI);
@@ -945,27 +972,30 @@ static void rep(int fv)
         {
                 case 0x08:
                 pc=ipc+1;
-                cycles-=2;
+                tubecycles-=2;
                 break;
                 case 0x26: /*ES:*/
                 oldds=ds;
                 ds=es;
                 changeds=1;
-                cycles-=2;
+                tubecycles-=2;
+                overcycles+=2;
                 goto startrep;
                 break;
                 case 0x2E: /*CS:*/
                 oldds=ds;
                 ds=cs;
                 changeds=1;
-                cycles-=2;
+                tubecycles-=2;
+                overcycles+=2;
                 goto startrep;
                 break;
                 case 0x36: /*SS:*/
                 oldds=ds;
                 ds=ss;
                 changeds=1;
-                cycles-=2;
+                tubecycles-=2;
+                overcycles+=2;
                 goto startrep;
                 break;
                 case 0x6E: /*REP OUTSB*/
@@ -976,13 +1006,13 @@ static void rep(int fv)
                         if (flags&D_FLAG) SI--;
                         else              SI++;
                         c--;
-                        cycles-=5;
+                        tubecycles-=5;
                 }
                 if (c>0) { firstrepcycle=0; pc=ipc; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
                 break;
                 case 0xA4: /*REP MOVSB*/
-                if (c>0)
+                while (c>0)
                 {
                         temp2=readmembl(ds+SI);
                         writemembl(es+DI,temp2);
@@ -990,21 +1020,23 @@ static void rep(int fv)
                         if (flags&D_FLAG) { DI--; SI--; }
                         else              { DI++; SI++; }
                         c--;
-                        cycles-=8;
+                        tubecycles-=8;
+                        if (!repagain(c>0)) break;
                 }
                 if (c>0) { firstrepcycle=0; pc=ipc; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
 //                }
                 break;
                 case 0xA5: /*REP MOVSW*/
-                if (c>0)
+                while (c>0)
                 {
                         tempw=readmemwl(ds,SI);
                         writememwl(es,DI,tempw);
                         if (flags&D_FLAG) { DI-=2; SI-=2; }
                         else              { DI+=2; SI+=2; }
                         c--;
-                        cycles-=8;
+                        tubecycles-=8;
+                        if (!repagain(c>0)) break;
                 }
                 if (c>0) { firstrepcycle=0; pc=ipc; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
@@ -1013,7 +1045,7 @@ static void rep(int fv)
                 case 0xA6: /*REP CMPSB*/
                 if (fv) flags|=Z_FLAG;
                 else    flags&=~Z_FLAG;
-                if ((c>0) && (fv==((flags&Z_FLAG)?1:0)))
+                while ((c>0) && (fv==((flags&Z_FLAG)?1:0)))
                 {
                         temp=readmembl(ds+SI);
                         temp2=readmembl(es+DI);
@@ -1021,8 +1053,9 @@ static void rep(int fv)
                         if (flags&D_FLAG) { DI--; SI--; }
                         else              { DI++; SI++; }
                         c--;
-                        cycles-=22;
+                        tubecycles-=22;
                         setsub8(temp,temp2);
+                        if (!repagain((c>0) && (fv==((flags&Z_FLAG)?1:0)))) break;
                 }
                 if ((c>0) && (fv==((flags&Z_FLAG)?1:0))) { pc=ipc; firstrepcycle=0; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
@@ -1030,64 +1063,69 @@ static void rep(int fv)
                 case 0xA7: /*REP CMPSW*/
                 if (fv) flags|=Z_FLAG;
                 else    flags&=~Z_FLAG;
-                if ((c>0) && (fv==((flags&Z_FLAG)?1:0)))
+                while ((c>0) && (fv==((flags&Z_FLAG)?1:0)))
                 {
                         tempw=readmemwl(ds,SI);
                         tempw2=readmemwl(es,DI);
                         if (flags&D_FLAG) { DI-=2; SI-=2; }
                         else              { DI+=2; SI+=2; }
                         c--;
-                        cycles-=22;
+                        tubecycles-=22;
                         setsub16(tempw,tempw2);
+                        if (!repagain((c>0) && (fv==((flags&Z_FLAG)?1:0)))) break;
                 }
                 if ((c>0) && (fv==((flags&Z_FLAG)?1:0))) { pc=ipc; firstrepcycle=0; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
                 break;
                 case 0xAA: /*REP STOSB*/
-                if (c>0)
+                while (c>0)
                 {
                         writemembl(es+DI,AL);
                         if (flags&D_FLAG) DI--;
                         else              DI++;
                         c--;
-                        cycles-=9;
+                        tubecycles-=9;
+                        if (!repagain(c>0)) break;
                 }
                 if (c>0) { firstrepcycle=0; pc=ipc; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
                 break;
                 case 0xAB: /*REP STOSW*/
-                if (c>0)
+                while (c>0)
                 {
                         writememwl(es,DI,AX);
                         if (flags&D_FLAG) DI-=2;
                         else              DI+=2;
                         c--;
-                        cycles-=9;
+                        tubecycles-=9;
+                        if (!repagain(c>0)) break;
                 }
                 if (c>0) { firstrepcycle=0; pc=ipc; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
 //                printf("REP STOSW %04X:%04X %04X:%04X %04X %04X\n",CS,pc,ES,DI,AX,CX); }
                 break;
                 case 0xAC: /*REP LODSB*/
-                if (c>0)
+                while (c>0)
                 {
                         temp2=readmembl(ds+SI);
                         if (flags&D_FLAG) SI--;
                         else              SI++;
                         c--;
-                        cycles-=4;
+                        tubecycles-=4;
+                        if (!repagain(c>0)) break;
                 }
                 if (c>0) { firstrepcycle=0; pc=ipc; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
                 break;
                 case 0xAD: /*REP LODSW*/
-                if (c>0)
+                while (c>0)
                 {
                         tempw2=readmemwl(ds,SI);
                         if (flags&D_FLAG) SI-=2;
                         else              SI+=2;
                         c--;
-                        cycles-=4;
+                        tubecycles-=4;
+                        if (!repagain(c>0)) break;
                 }
                 if (c>0) { firstrepcycle=0; pc=ipc; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
@@ -1095,7 +1133,7 @@ static void rep(int fv)
                 case 0xAE: /*REP SCASB*/
                 if (fv) flags|=Z_FLAG;
                 else    flags&=~Z_FLAG;
-                if ((c>0) && (fv==((flags&Z_FLAG)?1:0)))
+                while ((c>0) && (fv==((flags&Z_FLAG)?1:0)))
                 {
                         temp2=readmembl(es+DI);
 //                        if (x86output) printf("SCASB %02X %c %02X %05X  ",temp2,temp2,AL,es+DI);
@@ -1104,7 +1142,8 @@ static void rep(int fv)
                         if (flags&D_FLAG) DI--;
                         else              DI++;
                         c--;
-                        cycles-=15;
+                        tubecycles-=15;
+                        if (!repagain((c>0) && (fv==((flags&Z_FLAG)?1:0)))) break;
                 }
 //if (x86output)                printf("%i %i %i %i\n",c,(c>0),(fv==((flags&Z_FLAG)?1:0)),((c>0) && (fv==((flags&Z_FLAG)?1:0))));
                 if ((c>0) && (fv==((flags&Z_FLAG)?1:0)))  { pc=ipc; firstrepcycle=0; if (ssegs) ssegs++; }
@@ -1114,21 +1153,22 @@ static void rep(int fv)
                 case 0xAF: /*REP SCASW*/
                 if (fv) flags|=Z_FLAG;
                 else    flags&=~Z_FLAG;
-                if ((c>0) && (fv==((flags&Z_FLAG)?1:0)))
+                while ((c>0) && (fv==((flags&Z_FLAG)?1:0)))
                 {
                         tempw=readmemwl(es,DI);
                         setsub16(AX,tempw);
                         if (flags&D_FLAG) DI-=2;
                         else              DI+=2;
                         c--;
-                        cycles-=15;
+                        tubecycles-=15;
+                        if (!repagain((c>0) && (fv==((flags&Z_FLAG)?1:0)))) break;
                 }
                 if ((c>0) && (fv==((flags&Z_FLAG)?1:0)))  { pc=ipc; firstrepcycle=0; if (ssegs) ssegs++; }
                 else firstrepcycle=1;
                 break;
                 default:
                         pc=ipc;
-                        cycles-=20;
+                        tubecycles-=20;
 //                printf("Bad REP %02X\n",temp);
 //                x86dumpregs();
 //                exit(-1);
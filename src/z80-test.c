@@ -0,0 +1,211 @@
+/*
+ * B-em Z80 co-processor testing
+ *
+ * This program runs the Z80 core on its own, with the tube replaced by
+ * stubs, through a loop benchmark and through images of random bytes
+ * with random registers, interrupts and NMIs, and prints a hash of the
+ * whole processor state taken after every slice of each, and of the
+ * RAM at the end.  It is built twice, once with the threaded dispatch
+ * and once with NO_USE_Z80_THREADED, and utils/core-compare.sh checks
+ * the two print the same.
+ *
+ * The core keeps its registers in statics, so it is included here
+ * rather than linked.
+ */
+
+#include "b-em.h"
+#include "tube.h"
+
+#include <stdarg.h>
+
+tubetype tube_type;
+uint8_t (*tube_readmem)(uint32_t addr);
+void (*tube_writemem)(uint32_t addr, uint8_t byte);
+void (*tube_exec)(void);
+int tubecycles;
+int tube_irq;
+int endtimeslice;
+
+void log_warn(const char *fmt, ...) {}
+void log_error(const char *fmt, ...) {}
+
+FILE *x_fopen(const char *fn, const char *mode)
+{
+    return NULL;
+}
+
+static uint32_t rng;
+static uint32_t wsum;
+
+static uint32_t rnd(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return (rng >> 8) ^ (rng << 13);
+}
+
+uint8_t tube_parasite_read(uint32_t addr)
+{
+    return rnd();
+}
+
+void tube_parasite_write(uint32_t addr, uint8_t val)
+{
+    wsum = wsum * 31 + val + addr;
+}
+
+#include "z80.c"
+
+#define SLICE   1000    // tubecycles given to each slice of the benchmark.
+#define ORG     0x100   // where the benchmark is loaded.
+#define STEPS   2000    // slices each random image is run for.
+
+/*
+ * Fill 4K with a pattern, copy it with LDIR and add it up a byte at a
+ * time through IX and a subroutine, over and over.
+ */
+static const uint8_t loop_code[] = {
+    0x31, 0x00, 0xf0,           // start: ld sp,0xf000
+    0x21, 0x00, 0x40,           // outer: ld hl,0x4000
+    0x01, 0x00, 0x10,           // ld bc,0x1000
+    0x1e, 0x5a,                 // ld e,0x5a
+    0x7d,                       // fill: ld a,l
+    0xac,                       // xor h
+    0x83,                       // add a,e
+    0x77,                       // ld (hl),a
+    0x23,                       // inc hl
+    0x0b,                       // dec bc
+    0x78,                       // ld a,b
+    0xb1,                       // or c
+    0x20, 0xf6,                 // jr nz,fill
+    0x21, 0x00, 0x40,           // ld hl,0x4000
+    0x11, 0x00, 0x60,           // ld de,0x6000
+    0x01, 0x00, 0x10,           // ld bc,0x1000
+    0xed, 0xb0,                 // ldir
+    0xdd, 0x21, 0x00, 0x60,     // ld ix,0x6000
+    0x21, 0x00, 0x00,           // ld hl,0
+    0x06, 0x00,                 // ld b,0
+    0x0e, 0x10,                 // ld c,0x10
+    0xcd, 0x41, 0x01,           // sum: call add1
+    0xdd, 0x23,                 // inc ix
+    0x10, 0xf9,                 // djnz sum
+    0x0d,                       // dec c
+    0x20, 0xf6,                 // jr nz,sum
+    0x7c,                       // ld a,h
+    0xfe, 0x80,                 // cp 0x80
+    0x38, 0x02,                 // jr c,skip
+    0xcb, 0xc5,                 // set 0,l
+    0xcb, 0x7c,                 // skip: bit 7,h
+    0xc3, 0x03, 0x01,           // jp outer
+    0xdd, 0x5e, 0x00,           // add1: ld e,(ix+0)
+    0x16, 0x00,                 // ld d,0
+    0xb7,                       // or a
+    0xed, 0x5a,                 // adc hl,de
+    0xe5,                       // push hl
+    0xe1,                       // pop hl
+    0xc9                        // ret
+};
+
+static uint32_t state(void)
+{
+    uint32_t h = af.w;
+
+    h = h * 31 + bc.w;
+    h = h * 31 + de.w;
+    h = h * 31 + hl.w;
+    h = h * 31 + ix.w;
+    h = h * 31 + iy.w;
+    h = h * 31 + ir.w;
+    h = h * 31 + saf.w;
+    h = h * 31 + sbc.w;
+    h = h * 31 + sde.w;
+    h = h * 31 + shl.w;
+    h = h * 31 + sp;
+    h = h * 31 + z80pc;
+    h = h * 31 + iff1 * 2 + iff2;
+    h = h * 31 + im;
+    h = h * 31 + tuberomin;
+    h = h * 31 + intreg;
+    h = h * 31 + (uint32_t)tubecycles;
+    return h;
+}
+
+static void report(const char *name, uint32_t hash)
+{
+    for (int i = 0; i < Z80_RAM_SIZE; i++)
+        hash = hash * 33 + z80ram[i];
+    printf("%-12s %08x %08x %04x\n", name, hash, wsum, z80pc);
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t rom[0x1000];
+    char name[24];
+    long slices = 20000;
+    int images = 300;
+    uint32_t hash;
+
+    if (argc > 1)
+        slices = atol(argv[1]);
+    if (argc > 2)
+        images = atoi(argv[2]);
+    if (argc > 3 || slices <= 0 || images < 0) {
+        fputs("Usage: z80-test [ <slices> [ <random-images> ] ]\n", stderr);
+        return 1;
+    }
+    if (!z80_init(rom))
+        return 1;
+
+    memset(z80ram, 0, Z80_RAM_SIZE);
+    memcpy(z80ram + ORG, loop_code, sizeof loop_code);
+    tuberomin = 0;
+    z80pc = ORG;
+    hash = wsum = 0;
+    for (long i = 0; i < slices; i++) {
+        tubecycles += SLICE;
+        z80_exec();
+        hash = hash * 33 + state();
+    }
+    report("loop", hash);
+
+    /*
+     * Even images are run an instruction at a time and odd ones in slices
+     * of many, so both the top of the loop and the jump from the end of
+     * each instruction straight to the next are covered.
+     */
+    for (int i = 1; i <= images; i++) {
+        rng = i;
+        for (int j = 0; j < sizeof rom; j++)
+            rom[j] = rnd();
+        for (int j = 0; j < Z80_RAM_SIZE; j++)
+            z80ram[j] = rnd();
+        af.w = rnd();
+        bc.w = rnd();
+        de.w = rnd();
+        hl.w = rnd();
+        ix.w = rnd();
+        iy.w = rnd();
+        sp = rnd();
+        z80pc = rnd();
+        saf.w = rnd();
+        sbc.w = rnd();
+        sde.w = rnd();
+        shl.w = rnd();
+        ir.w = rnd();
+        im = rnd() % 3;
+        iff1 = iff2 = rnd() & 1;
+        tuberomin = rnd() & 1;
+        tubecycles = 0;
+        hash = wsum = 0;
+        for (int s = 0; s < STEPS; s++) {
+            tube_irq = (rnd() % 16 == 0) | ((rnd() % 64 == 0) << 1);
+            tubecycles += (i & 1) ? 1 + rnd() % 400 : 1;
+            z80_exec();
+            hash = hash * 33 + state();
+        }
+        tube_irq = 0;
+        snprintf(name, sizeof name, "random-%d", i);
+        report(name, hash);
+    }
+    z80_close();
+    return 0;
+}
@@ -553,11 +553,53 @@ void z80_reset()
 
 static uint16_t oopc,opc;
 
+/*
+ * With GCC and clang each instruction ends by fetching the next opcode
+ * and jumping straight to its case through a table of label addresses,
+ * so every case has its own indirect jump for the host to predict
+ * rather than all of them sharing the one at the top of the switch.
+ * Anything that needs the rest of the loop - an interrupt, an NMI,
+ * trace output, the debugger or the end of the time slice - leaves the
+ * switch as before.  Other compilers just get the switch.
+ */
+#if defined(__GNUC__) && !defined(NO_USE_Z80_THREADED)
+#define OP(n) case 0x##n: op_##n
+#define NEXT \
+        if (!(enterint|output|dbg_tube_z80|(tube_irq&2))) \
+        { \
+                ins++; \
+                z80_oldnmi=0; \
+                tubecycles-=cycles; \
+                if (tubecycles<=0) return; \
+                oopc=opc; \
+                opc=pc; \
+                if ((tube_irq&1) && iff1) enterint=1; \
+                cycles=0; \
+                tempc=af.b.l&C_FLAG; \
+                opcode=z80_readmem(pc++); \
+                ir.b.l=((ir.b.l+1)&0x7F)|(ir.b.l&0x80); \
+                goto *optab[opcode]; \
+        } \
+        break
+#define OPS16(h) &&op_##h##0,&&op_##h##1,&&op_##h##2,&&op_##h##3,&&op_##h##4,&&op_##h##5,&&op_##h##6,&&op_##h##7, \
+                 &&op_##h##8,&&op_##h##9,&&op_##h##A,&&op_##h##B,&&op_##h##C,&&op_##h##D,&&op_##h##E,&&op_##h##F
+#else
+#define OP(n) case 0x##n
+#define NEXT  break
+#endif
+
 void z80_exec()
 {
         uint8_t opcode,temp;
         uint16_t addr;
         int enterint=0;
+#if defined(__GNUC__) && !defined(NO_USE_Z80_THREADED)
+        static const void *const optab[256]=
+        {
+                OPS16(0),OPS16(1),OPS16(2),OPS16(3),OPS16(4),OPS16(5),OPS16(6),OPS16(7),
+                OPS16(8),OPS16(9),OPS16(A),OPS16(B),OPS16(C),OPS16(D),OPS16(E),OPS16(F)
+        };
+#endif
 //        tubecycles+=(cy<<1);
         while (tubecycles>0)
         {
@@ -572,42 +614,45 @@ void z80_exec()
         tempc=af.b.l&C_FLAG;
                 opcode=z80_readmem(pc++);
                 ir.b.l=((ir.b.l+1)&0x7F)|(ir.b.l&0x80);
+#if defined(__GNUC__) && !defined(NO_USE_Z80_THREADED)
+                goto *optab[opcode];
+#endif
                 switch (opcode)
                 {
-                        case 0x00: /*NOP*/
+                        OP(00): /*NOP*/
                         cycles+=4;
 //                        printf("NOP!\n");
 //                        z80_dumpregs();
 //                        exit(-1);
-                        break;
-                        case 0x01: /*LD BC,nn*/
+                        NEXT;
+                        OP(01): /*LD BC,nn*/
                         cycles+=4; bc.b.l=z80_readmem(pc++);
                         cycles+=3; bc.b.h=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x02: /*LD (BC),A*/
+                        NEXT;
+                        OP(02): /*LD (BC),A*/
                         cycles+=4; z80_writemem(bc.w,af.b.h);
                         cycles+=3;
-                        break;
-                        case 0x03: /*INC BC*/
+                        NEXT;
+                        OP(03): /*INC BC*/
                         bc.w++;
                         cycles+=6;
-                        break;
-                        case 0x04: /*INC B*/
+                        NEXT;
+                        OP(04): /*INC B*/
                         setinc(bc.b.h);
                         bc.b.h++;
                         cycles+=4;
-                        break;
-                        case 0x05: /*DEC B*/
+                        NEXT;
+                        OP(05): /*DEC B*/
                         setdec(bc.b.h);
                         bc.b.h--;
                         cycles+=4;
-                        break;
-                        case 0x06: /*LD B,nn*/
+                        NEXT;
+                        OP(06): /*LD B,nn*/
                         cycles+=4; bc.b.h=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x07: /*RLCA*/
+                        NEXT;
+                        OP(07): /*RLCA*/
                         temp=af.b.h&0x80;
                         af.b.h<<=1;
                         if (temp) af.b.h|=1;
@@ -615,40 +660,40 @@ void z80_exec()
                         if (temp) af.b.l|=C_FLAG;
                         else      af.b.l&=~C_FLAG;
                         cycles+=4;
-                        break;
-                        case 0x08: /*EX AF,AF'*/
+                        NEXT;
+                        OP(08): /*EX AF,AF'*/
                         addr=af.w; af.w=saf.w; saf.w=addr;
                         cycles+=4;
-                        break;
-                        case 0x09: /*ADD HL,BC*/
+                        NEXT;
+                        OP(09): /*ADD HL,BC*/
                         intreg=hl.b.h;
                         z80_setadd16(hl.w,bc.w);
                         hl.w+=bc.w;
                         cycles+=11;
-                        break;
-                        case 0x0A: /*LD A,(BC)*/
+                        NEXT;
+                        OP(0A): /*LD A,(BC)*/
                         cycles+=4; af.b.h=z80_readmem(bc.w);
                         cycles+=3;
-                        break;
-                        case 0x0B: /*DEC BC*/
+                        NEXT;
+                        OP(0B): /*DEC BC*/
                         bc.w--;
                         cycles+=6;
-                        break;
-                        case 0x0C: /*INC C*/
+                        NEXT;
+                        OP(0C): /*INC C*/
                         setinc(bc.b.l);
                         bc.b.l++;
                         cycles+=4;
-                        break;
-                        case 0x0D: /*DEC C*/
+                        NEXT;
+                        OP(0D): /*DEC C*/
                         setdec(bc.b.l);
                         bc.b.l--;
                         cycles+=4;
-                        break;
-                        case 0x0E: /*LD C,nn*/
+                        NEXT;
+                        OP(0E): /*LD C,nn*/
                         cycles+=4; bc.b.l=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x0F: /*RRCA*/
+                        NEXT;
+                        OP(0F): /*RRCA*/
                         temp=af.b.h&1;
                         af.b.h>>=1;
                         if (temp) af.b.h|=0x80;
@@ -656,9 +701,9 @@ void z80_exec()
                         if (temp) af.b.l|=C_FLAG;
                         else      af.b.l&=~C_FLAG;
                         cycles+=4;
-                        break;
+                        NEXT;
 
-                        case 0x10: /*DJNZ*/
+                        OP(10): /*DJNZ*/
                         cycles+=5; addr=z80_readmem(pc++);
                         if (addr&0x80) addr|=0xFF00;
                         if (--bc.b.h)
@@ -668,35 +713,35 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0x11: /*LD DE,nn*/
+                        NEXT;
+                        OP(11): /*LD DE,nn*/
                         cycles+=4; de.b.l=z80_readmem(pc++);
                         cycles+=3; de.b.h=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x12: /*LD (DE),A*/
+                        NEXT;
+                        OP(12): /*LD (DE),A*/
                         cycles+=4; z80_writemem(de.w,af.b.h);
                         cycles+=3;
-                        break;
-                        case 0x13: /*INC DE*/
+                        NEXT;
+                        OP(13): /*INC DE*/
                         de.w++;
                         cycles+=6;
-                        break;
-                        case 0x14: /*INC D*/
+                        NEXT;
+                        OP(14): /*INC D*/
                         setinc(de.b.h);
                         de.b.h++;
                         cycles+=4;
-                        break;
-                        case 0x15: /*DEC D*/
+                        NEXT;
+                        OP(15): /*DEC D*/
                         setdec(de.b.h);
                         de.b.h--;
                         cycles+=4;
-                        break;
-                        case 0x16: /*LD D,nn*/
+                        NEXT;
+                        OP(16): /*LD D,nn*/
                         cycles+=4; de.b.h=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x17: /*RLA*/
+                        NEXT;
+                        OP(17): /*RLA*/
                         temp=af.b.h&0x80;
                         af.b.h<<=1;
                         if (tempc) af.b.h|=1;
@@ -704,43 +749,43 @@ void z80_exec()
                         if (temp) af.b.l|=C_FLAG;
                         else      af.b.l&=~C_FLAG;
                         cycles+=4;
-                        break;
-                        case 0x18: /*JR*/
+                        NEXT;
+                        OP(18): /*JR*/
                         cycles+=4; addr=z80_readmem(pc++);
                         if (addr&0x80) addr|=0xFF00;
                         pc+=addr;
                         intreg=pc>>8;
                         cycles+=8;
-                        break;
-                        case 0x19: /*ADD HL,DE*/
+                        NEXT;
+                        OP(19): /*ADD HL,DE*/
                         intreg=hl.b.h;
                         z80_setadd16(hl.w,de.w);
                         hl.w+=de.w;
                         cycles+=11;
-                        break;
-                        case 0x1A: /*LD A,(DE)*/
+                        NEXT;
+                        OP(1A): /*LD A,(DE)*/
                         cycles+=4; af.b.h=z80_readmem(de.w);
                         cycles+=3;
-                        break;
-                        case 0x1B: /*DEC DE*/
+                        NEXT;
+                        OP(1B): /*DEC DE*/
                         de.w--;
                         cycles+=6;
-                        break;
-                        case 0x1C: /*INC E*/
+                        NEXT;
+                        OP(1C): /*INC E*/
                         setinc(de.b.l);
                         de.b.l++;
                         cycles+=4;
-                        break;
-                        case 0x1D: /*DEC E*/
+                        NEXT;
+                        OP(1D): /*DEC E*/
                         setdec(de.b.l);
                         de.b.l--;
                         cycles+=4;
-                        break;
-                        case 0x1E: /*LD E,nn*/
+                        NEXT;
+                        OP(1E): /*LD E,nn*/
                         cycles+=4; de.b.l=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x1F: /*RRA*/
+                        NEXT;
+                        OP(1F): /*RRA*/
                         temp=af.b.h&1;
                         af.b.h>>=1;
                         if (tempc) af.b.h|=0x80;
@@ -748,9 +793,9 @@ void z80_exec()
                         if (temp) af.b.l|=C_FLAG;
                         else      af.b.l&=~C_FLAG;
                         cycles+=4;
-                        break;
+                        NEXT;
 
-                        case 0x20: /*JR NZ*/
+                        OP(20): /*JR NZ*/
                         cycles+=4; addr=z80_readmem(pc++);
                         if (addr&0x80) addr|=0xFF00;
                         if (!(af.b.l&Z_FLAG))
@@ -760,46 +805,46 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0x21: /*LD HL,nn*/
+                        NEXT;
+                        OP(21): /*LD HL,nn*/
                         cycles+=4; hl.b.l=z80_readmem(pc++);
                         cycles+=3; hl.b.h=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x22: /*LD (nn),HL*/
+                        NEXT;
+                        OP(22): /*LD (nn),HL*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         cycles+=3; z80_writemem(addr,hl.b.l);
                         cycles+=3; z80_writemem(addr+1,hl.b.h);
                         cycles+=3;
-                        break;
-                        case 0x23: /*INC HL*/
+                        NEXT;
+                        OP(23): /*INC HL*/
                         hl.w++;
                         cycles+=6;
-                        break;
-                        case 0x24: /*INC H*/
+                        NEXT;
+                        OP(24): /*INC H*/
                         setinc(hl.b.h);
                         hl.b.h++;
                         cycles+=4;
-                        break;
-                        case 0x25: /*DEC H*/
+                        NEXT;
+                        OP(25): /*DEC H*/
                         setdec(hl.b.h);
                         hl.b.h--;
                         cycles+=4;
-                        break;
-                        case 0x26: /*LD H,nn*/
+                        NEXT;
+                        OP(26): /*LD H,nn*/
                         cycles+=4; hl.b.h=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x27: /*DAA*/
+                        NEXT;
+                        OP(27): /*DAA*/
                         addr=af.b.h;
                         if (af.b.l&C_FLAG) addr|=256;
                         if (af.b.l&H_FLAG) addr|=512;
                         if (af.b.l&S_FLAG) addr|=1024;
                         af.w=DAATable[addr];
                         cycles+=4;
-                        break;
-                        case 0x28: /*JR Z*/
+                        NEXT;
+                        OP(28): /*JR Z*/
                         cycles+=4; addr=z80_readmem(pc++);
                         if (addr&0x80) addr|=0xFF00;
                         if (af.b.l&Z_FLAG)
@@ -809,44 +854,44 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0x29: /*ADD HL,HL*/
+                        NEXT;
+                        OP(29): /*ADD HL,HL*/
                         intreg=hl.b.h;
                         z80_setadd16(hl.w,hl.w);
                         hl.w+=hl.w;
                         cycles+=11;
-                        break;
-                        case 0x2A: /*LD HL,(nn)*/
+                        NEXT;
+                        OP(2A): /*LD HL,(nn)*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         cycles+=3; hl.b.l=z80_readmem(addr);
                         cycles+=3; hl.b.h=z80_readmem(addr+1);
                         cycles+=3;
-                        break;
-                        case 0x2B: /*DEC HL*/
+                        NEXT;
+                        OP(2B): /*DEC HL*/
                         hl.w--;
                         cycles+=6;
-                        break;
-                        case 0x2C: /*INC L*/
+                        NEXT;
+                        OP(2C): /*INC L*/
                         setinc(hl.b.l);
                         hl.b.l++;
                         cycles+=4;
-                        break;
-                        case 0x2D: /*DEC L*/
+                        NEXT;
+                        OP(2D): /*DEC L*/
                         setdec(hl.b.l);
                         hl.b.l--;
                         cycles+=4;
-                        break;
-                        case 0x2E: /*LD L,nn*/
+                        NEXT;
+                        OP(2E): /*LD L,nn*/
                         cycles+=4; hl.b.l=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x2F: /*CPL*/
+                        NEXT;
+                        OP(2F): /*CPL*/
                         af.b.h^=0xFF;
                         af.b.l|=(H_FLAG|S_FLAG);
                         cycles+=4;
-                        break;
-                        case 0x30: /*JR NC*/
+                        NEXT;
+                        OP(30): /*JR NC*/
                         cycles+=4; addr=z80_readmem(pc++);
                         if (addr&0x80) addr|=0xFF00;
                         if (!(af.b.l&C_FLAG))
@@ -856,44 +901,44 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0x31: /*LD SP,nn*/
+                        NEXT;
+                        OP(31): /*LD SP,nn*/
                         cycles+=4; temp=z80_readmem(pc++);
                         cycles+=3; sp=(z80_readmem(pc++)<<8)|temp;
                         cycles+=3;
-                        break;
-                        case 0x32: /*LD (nn),A*/
+                        NEXT;
+                        OP(32): /*LD (nn),A*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         cycles+=3; z80_writemem(addr,af.b.h);
                         cycles+=3;
-                        break;
-                        case 0x33: /*INC SP*/
+                        NEXT;
+                        OP(33): /*INC SP*/
                         sp++;
                         cycles+=6;
-                        break;
-                        case 0x34: /*INC (HL)*/
+                        NEXT;
+                        OP(34): /*INC (HL)*/
                         cycles+=4; temp=z80_readmem(hl.w);
                         setinc(temp);
                         cycles+=3; z80_writemem(hl.w,temp+1);
                         cycles+=3;
-                        break;
-                        case 0x35: /*DEC (HL)*/
+                        NEXT;
+                        OP(35): /*DEC (HL)*/
                         cycles+=4; temp=z80_readmem(hl.w);
                         setdec(temp);
                         cycles+=3; z80_writemem(hl.w,temp-1);
                         cycles+=3;
-                        break;
-                        case 0x36: /*LD (HL),nn*/
+                        NEXT;
+                        OP(36): /*LD (HL),nn*/
                         cycles+=4; temp=z80_readmem(pc++);
                         cycles+=3; z80_writemem(hl.w,temp);
                         cycles+=3;
-                        break;
-                        case 0x37: /*SCF*/
+                        NEXT;
+                        OP(37): /*SCF*/
                         af.b.l|=C_FLAG;
                         cycles+=4;
-                        break;
-                        case 0x38: /*JR C*/
+                        NEXT;
+                        OP(38): /*JR C*/
                         cycles+=4; addr=z80_readmem(pc++);
                         if (addr&0x80) addr|=0xFF00;
                         if (af.b.l&C_FLAG)
@@ -903,180 +948,180 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0x39: /*ADD HL,SP*/
+                        NEXT;
+                        OP(39): /*ADD HL,SP*/
                         intreg=hl.b.h;
                         z80_setadd16(hl.w,sp);
                         hl.w+=sp;
                         cycles+=11;
-                        break;
-                        case 0x3A: /*LD A,(nn)*/
+                        NEXT;
+                        OP(3A): /*LD A,(nn)*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         cycles+=3; af.b.h=z80_readmem(addr);
                         cycles+=3;
-                        break;
-                        case 0x3B: /*DEC SP*/
+                        NEXT;
+                        OP(3B): /*DEC SP*/
                         sp--;
                         cycles+=6;
-                        break;
-                        case 0x3C: /*INC A*/
+                        NEXT;
+                        OP(3C): /*INC A*/
                         setinc(af.b.h);
                         af.b.h++;
                         cycles+=4;
-                        break;
-                        case 0x3D: /*DEC A*/
+                        NEXT;
+                        OP(3D): /*DEC A*/
                         setdec(af.b.h);
                         af.b.h--;
                         cycles+=4;
-                        break;
-                        case 0x3E: /*LD A,nn*/
+                        NEXT;
+                        OP(3E): /*LD A,nn*/
                         cycles+=4; af.b.h=z80_readmem(pc++);
                         cycles+=3;
-                        break;
-                        case 0x3F: /*CCF*/
+                        NEXT;
+                        OP(3F): /*CCF*/
                         af.b.l^=C_FLAG;
                         cycles+=4;
-                        break;
-
-                        case 0x40: bc.b.h=bc.b.h;        cycles+=4; break; /*LD B,B*/
-                        case 0x41: bc.b.h=bc.b.l;        cycles+=4; break; /*LD B,C*/
-                        case 0x42: bc.b.h=de.b.h;        cycles+=4; break; /*LD B,D*/
-                        case 0x43: bc.b.h=de.b.l;        cycles+=4; break; /*LD B,E*/
-                        case 0x44: bc.b.h=hl.b.h;        cycles+=4; break; /*LD B,H*/
-                        case 0x45: bc.b.h=hl.b.l;        cycles+=4; break; /*LD B,L*/
-                        case 0x46: cycles+=4; bc.b.h=z80_readmem(hl.w); cycles+=3; break; /*LD B,(HL)*/
-                        case 0x47: bc.b.h=af.b.h;        cycles+=4; break; /*LD B,A*/
-                        case 0x48: bc.b.l=bc.b.h;        cycles+=4; break; /*LD C,B*/
-                        case 0x49: bc.b.l=bc.b.l;        cycles+=4; break; /*LD C,C*/
-                        case 0x4A: bc.b.l=de.b.h;        cycles+=4; break; /*LD C,D*/
-                        case 0x4B: bc.b.l=de.b.l;        cycles+=4; break; /*LD C,E*/
-                        case 0x4C: bc.b.l=hl.b.h;        cycles+=4; break; /*LD C,H*/
-                        case 0x4D: bc.b.l=hl.b.l;        cycles+=4; break; /*LD C,L*/
-                        case 0x4E: cycles+=4; bc.b.l=z80_readmem(hl.w); cycles+=3; break; /*LD C,(HL)*/
-                        case 0x4F: bc.b.l=af.b.h;        cycles+=4; break; /*LD C,A*/
-                        case 0x50: de.b.h=bc.b.h;        cycles+=4; break; /*LD D,B*/
-                        case 0x51: de.b.h=bc.b.l;        cycles+=4; break; /*LD D,C*/
-                        case 0x52: de.b.h=de.b.h;        cycles+=4; break; /*LD D,D*/
-                        case 0x53: de.b.h=de.b.l;        cycles+=4; break; /*LD D,E*/
-                        case 0x54: de.b.h=hl.b.h;        cycles+=4; break; /*LD D,H*/
-                        case 0x55: de.b.h=hl.b.l;        cycles+=4; break; /*LD D,L*/
-                        case 0x56: cycles+=4; de.b.h=z80_readmem(hl.w); cycles+=3; break; /*LD D,(HL)*/
-                        case 0x57: de.b.h=af.b.h;        cycles+=4; break; /*LD D,A*/
-                        case 0x58: de.b.l=bc.b.h;        cycles+=4; break; /*LD E,B*/
-                        case 0x59: de.b.l=bc.b.l;        cycles+=4; break; /*LD E,C*/
-                        case 0x5A: de.b.l=de.b.h;        cycles+=4; break; /*LD E,D*/
-                        case 0x5B: de.b.l=de.b.l;        cycles+=4; break; /*LD E,E*/
-                        case 0x5C: de.b.l=hl.b.h;        cycles+=4; break; /*LD E,H*/
-                        case 0x5D: de.b.l=hl.b.l;        cycles+=4; break; /*LD E,L*/
-                        case 0x5E: cycles+=4; de.b.l=z80_readmem(hl.w); cycles+=3; break; /*LD E,(HL)*/
-                        case 0x5F: de.b.l=af.b.h;        cycles+=4; break; /*LD E,A*/
-                        case 0x60: hl.b.h=bc.b.h;        cycles+=4; break; /*LD H,B*/
-                        case 0x61: hl.b.h=bc.b.l;        cycles+=4; break; /*LD H,C*/
-                        case 0x62: hl.b.h=de.b.h;        cycles+=4; break; /*LD H,D*/
-                        case 0x63: hl.b.h=de.b.l;        cycles+=4; break; /*LD H,E*/
-                        case 0x64: hl.b.h=hl.b.h;        cycles+=4; break; /*LD H,H*/
-                        case 0x65: hl.b.h=hl.b.l;        cycles+=4; break; /*LD H,L*/
-                        case 0x66: cycles+=4; hl.b.h=z80_readmem(hl.w); cycles+=3; break; /*LD H,(HL)*/
-                        case 0x67: hl.b.h=af.b.h;        cycles+=4; break; /*LD H,A*/
-                        case 0x68: hl.b.l=bc.b.h;        cycles+=4; break; /*LD L,B*/
-                        case 0x69: hl.b.l=bc.b.l;        cycles+=4; break; /*LD L,C*/
-                        case 0x6A: hl.b.l=de.b.h;        cycles+=4; break; /*LD L,D*/
-                        case 0x6B: hl.b.l=de.b.l;        cycles+=4; break; /*LD L,E*/
-                        case 0x6C: hl.b.l=hl.b.h;        cycles+=4; break; /*LD L,H*/
-                        case 0x6D: hl.b.l=hl.b.l;        cycles+=4; break; /*LD L,L*/
-                        case 0x6E: cycles+=4; hl.b.l=z80_readmem(hl.w); cycles+=3; break; /*LD L,(HL)*/
-                        case 0x6F: hl.b.l=af.b.h;        cycles+=4; break; /*LD L,A*/
-                        case 0x70: cycles+=4; z80_writemem(hl.w,bc.b.h); cycles+=3; break; /*LD (HL),B*/
-                        case 0x71: cycles+=4; z80_writemem(hl.w,bc.b.l); cycles+=3; break; /*LD (HL),C*/
-                        case 0x72: cycles+=4; z80_writemem(hl.w,de.b.h); cycles+=3; break; /*LD (HL),D*/
-                        case 0x73: cycles+=4; z80_writemem(hl.w,de.b.l); cycles+=3; break; /*LD (HL),E*/
-                        case 0x74: cycles+=4; z80_writemem(hl.w,hl.b.h); cycles+=3; break; /*LD (HL),H*/
-                        case 0x75: cycles+=4; z80_writemem(hl.w,hl.b.l); cycles+=3; break; /*LD (HL),L*/
-                        case 0x77: cycles+=4; z80_writemem(hl.w,af.b.h); cycles+=3; break; /*LD (HL),A*/
-                        case 0x78: af.b.h=bc.b.h;        cycles+=4; break; /*LD A,B*/
-                        case 0x79: af.b.h=bc.b.l;        cycles+=4; break; /*LD A,C*/
-                        case 0x7A: af.b.h=de.b.h;        cycles+=4; break; /*LD A,D*/
-                        case 0x7B: af.b.h=de.b.l;        cycles+=4; break; /*LD A,E*/
-                        case 0x7C: af.b.h=hl.b.h;        cycles+=4; break; /*LD A,H*/
-                        case 0x7D: af.b.h=hl.b.l;        cycles+=4; break; /*LD A,L*/
-                        case 0x7E: cycles+=4; af.b.h=z80_readmem(hl.w); cycles+=3; break; /*LD A,(HL)*/
-                        case 0x7F: af.b.h=af.b.h;        cycles+=4; break; /*LD A,A*/
-
-                        case 0x76: /*HALT*/
+                        NEXT;
+
+                        OP(40): bc.b.h=bc.b.h;        cycles+=4; NEXT; /*LD B,B*/
+                        OP(41): bc.b.h=bc.b.l;        cycles+=4; NEXT; /*LD B,C*/
+                        OP(42): bc.b.h=de.b.h;        cycles+=4; NEXT; /*LD B,D*/
+                        OP(43): bc.b.h=de.b.l;        cycles+=4; NEXT; /*LD B,E*/
+                        OP(44): bc.b.h=hl.b.h;        cycles+=4; NEXT; /*LD B,H*/
+                        OP(45): bc.b.h=hl.b.l;        cycles+=4; NEXT; /*LD B,L*/
+                        OP(46): cycles+=4; bc.b.h=z80_readmem(hl.w); cycles+=3; NEXT; /*LD B,(HL)*/
+                        OP(47): bc.b.h=af.b.h;        cycles+=4; NEXT; /*LD B,A*/
+                        OP(48): bc.b.l=bc.b.h;        cycles+=4; NEXT; /*LD C,B*/
+                        OP(49): bc.b.l=bc.b.l;        cycles+=4; NEXT; /*LD C,C*/
+                        OP(4A): bc.b.l=de.b.h;        cycles+=4; NEXT; /*LD C,D*/
+                        OP(4B): bc.b.l=de.b.l;        cycles+=4; NEXT; /*LD C,E*/
+                        OP(4C): bc.b.l=hl.b.h;        cycles+=4; NEXT; /*LD C,H*/
+                        OP(4D): bc.b.l=hl.b.l;        cycles+=4; NEXT; /*LD C,L*/
+                        OP(4E): cycles+=4; bc.b.l=z80_readmem(hl.w); cycles+=3; NEXT; /*LD C,(HL)*/
+                        OP(4F): bc.b.l=af.b.h;        cycles+=4; NEXT; /*LD C,A*/
+                        OP(50): de.b.h=bc.b.h;        cycles+=4; NEXT; /*LD D,B*/
+                        OP(51): de.b.h=bc.b.l;        cycles+=4; NEXT; /*LD D,C*/
+                        OP(52): de.b.h=de.b.h;        cycles+=4; NEXT; /*LD D,D*/
+                        OP(53): de.b.h=de.b.l;        cycles+=4; NEXT; /*LD D,E*/
+                        OP(54): de.b.h=hl.b.h;        cycles+=4; NEXT; /*LD D,H*/
+                        OP(55): de.b.h=hl.b.l;        cycles+=4; NEXT; /*LD D,L*/
+                        OP(56): cycles+=4; de.b.h=z80_readmem(hl.w); cycles+=3; NEXT; /*LD D,(HL)*/
+                        OP(57): de.b.h=af.b.h;        cycles+=4; NEXT; /*LD D,A*/
+                        OP(58): de.b.l=bc.b.h;        cycles+=4; NEXT; /*LD E,B*/
+                        OP(59): de.b.l=bc.b.l;        cycles+=4; NEXT; /*LD E,C*/
+                        OP(5A): de.b.l=de.b.h;        cycles+=4; NEXT; /*LD E,D*/
+                        OP(5B): de.b.l=de.b.l;        cycles+=4; NEXT; /*LD E,E*/
+                        OP(5C): de.b.l=hl.b.h;        cycles+=4; NEXT; /*LD E,H*/
+                        OP(5D): de.b.l=hl.b.l;        cycles+=4; NEXT; /*LD E,L*/
+                        OP(5E): cycles+=4; de.b.l=z80_readmem(hl.w); cycles+=3; NEXT; /*LD E,(HL)*/
+                        OP(5F): de.b.l=af.b.h;        cycles+=4; NEXT; /*LD E,A*/
+                        OP(60): hl.b.h=bc.b.h;        cycles+=4; NEXT; /*LD H,B*/
+                        OP(61): hl.b.h=bc.b.l;        cycles+=4; NEXT; /*LD H,C*/
+                        OP(62): hl.b.h=de.b.h;        cycles+=4; NEXT; /*LD H,D*/
+                        OP(63): hl.b.h=de.b.l;        cycles+=4; NEXT; /*LD H,E*/
+                        OP(64): hl.b.h=hl.b.h;        cycles+=4; NEXT; /*LD H,H*/
+                        OP(65): hl.b.h=hl.b.l;        cycles+=4; NEXT; /*LD H,L*/
+                        OP(66): cycles+=4; hl.b.h=z80_readmem(hl.w); cycles+=3; NEXT; /*LD H,(HL)*/
+                        OP(67): hl.b.h=af.b.h;        cycles+=4; NEXT; /*LD H,A*/
+                        OP(68): hl.b.l=bc.b.h;        cycles+=4; NEXT; /*LD L,B*/
+                        OP(69): hl.b.l=bc.b.l;        cycles+=4; NEXT; /*LD L,C*/
+                        OP(6A): hl.b.l=de.b.h;        cycles+=4; NEXT; /*LD L,D*/
+                        OP(6B): hl.b.l=de.b.l;        cycles+=4; NEXT; /*LD L,E*/
+                        OP(6C): hl.b.l=hl.b.h;        cycles+=4; NEXT; /*LD L,H*/
+                        OP(6D): hl.b.l=hl.b.l;        cycles+=4; NEXT; /*LD L,L*/
+                        OP(6E): cycles+=4; hl.b.l=z80_readmem(hl.w); cycles+=3; NEXT; /*LD L,(HL)*/
+                        OP(6F): hl.b.l=af.b.h;        cycles+=4; NEXT; /*LD L,A*/
+                        OP(70): cycles+=4; z80_writemem(hl.w,bc.b.h); cycles+=3; NEXT; /*LD (HL),B*/
+                        OP(71): cycles+=4; z80_writemem(hl.w,bc.b.l); cycles+=3; NEXT; /*LD (HL),C*/
+                        OP(72): cycles+=4; z80_writemem(hl.w,de.b.h); cycles+=3; NEXT; /*LD (HL),D*/
+                        OP(73): cycles+=4; z80_writemem(hl.w,de.b.l); cycles+=3; NEXT; /*LD (HL),E*/
+                        OP(74): cycles+=4; z80_writemem(hl.w,hl.b.h); cycles+=3; NEXT; /*LD (HL),H*/
+                        OP(75): cycles+=4; z80_writemem(hl.w,hl.b.l); cycles+=3; NEXT; /*LD (HL),L*/
+                        OP(77): cycles+=4; z80_writemem(hl.w,af.b.h); cycles+=3; NEXT; /*LD (HL),A*/
+                        OP(78): af.b.h=bc.b.h;        cycles+=4; NEXT; /*LD A,B*/
+                        OP(79): af.b.h=bc.b.l;        cycles+=4; NEXT; /*LD A,C*/
+                        OP(7A): af.b.h=de.b.h;        cycles+=4; NEXT; /*LD A,D*/
+                        OP(7B): af.b.h=de.b.l;        cycles+=4; NEXT; /*LD A,E*/
+                        OP(7C): af.b.h=hl.b.h;        cycles+=4; NEXT; /*LD A,H*/
+                        OP(7D): af.b.h=hl.b.l;        cycles+=4; NEXT; /*LD A,L*/
+                        OP(7E): cycles+=4; af.b.h=z80_readmem(hl.w); cycles+=3; NEXT; /*LD A,(HL)*/
+                        OP(7F): af.b.h=af.b.h;        cycles+=4; NEXT; /*LD A,A*/
+
+                        OP(76): /*HALT*/
                         if (!enterint) pc--;
 //                        else printf("HALT %02X\n",bc.b.h);
                         cycles+=4;
-                        break;
-
-                        case 0x80: z80_setadd(af.b.h,bc.b.h); af.b.h+=bc.b.h; cycles+=4; break; /*ADD B*/
-                        case 0x81: z80_setadd(af.b.h,bc.b.l); af.b.h+=bc.b.l; cycles+=4; break; /*ADD C*/
-                        case 0x82: z80_setadd(af.b.h,de.b.h); af.b.h+=de.b.h; cycles+=4; break; /*ADD D*/
-                        case 0x83: z80_setadd(af.b.h,de.b.l); af.b.h+=de.b.l; cycles+=4; break; /*ADD E*/
-                        case 0x84: z80_setadd(af.b.h,hl.b.h); af.b.h+=hl.b.h; cycles+=4; break; /*ADD H*/
-                        case 0x85: z80_setadd(af.b.h,hl.b.l); af.b.h+=hl.b.l; cycles+=4; break; /*ADD L*/
-                        case 0x86: cycles+=4; temp=z80_readmem(hl.w); z80_setadd(af.b.h,temp); af.b.h+=temp; cycles+=3; break; /*ADD (HL)*/
-                        case 0x87: z80_setadd(af.b.h,af.b.h); af.b.h+=af.b.h; cycles+=4; break; /*ADD A*/
-                        case 0x88: setadc(af.b.h,bc.b.h); af.b.h+=bc.b.h+tempc; cycles+=4; break; /*ADC B*/
-                        case 0x89: setadc(af.b.h,bc.b.l); af.b.h+=bc.b.l+tempc; cycles+=4; break; /*ADC C*/
-                        case 0x8A: setadc(af.b.h,de.b.h); af.b.h+=de.b.h+tempc; cycles+=4; break; /*ADC D*/
-                        case 0x8B: setadc(af.b.h,de.b.l); af.b.h+=de.b.l+tempc; cycles+=4; break; /*ADC E*/
-                        case 0x8C: setadc(af.b.h,hl.b.h); af.b.h+=hl.b.h+tempc; cycles+=4; break; /*ADC H*/
-                        case 0x8D: setadc(af.b.h,hl.b.l); af.b.h+=hl.b.l+tempc; cycles+=4; break; /*ADC L*/
-                        case 0x8E: cycles+=4; temp=z80_readmem(hl.w); setadc(af.b.h,temp); af.b.h+=temp+tempc; cycles+=3; break; /*ADC (HL)*/
-                        case 0x8F: setadc(af.b.h,af.b.h); af.b.h+=af.b.h+tempc; cycles+=4; break; /*ADC A*/
-
-                        case 0x90: z80_setsub(af.b.h,bc.b.h); af.b.h-=bc.b.h; cycles+=4; break; /*SUB B*/
-                        case 0x91: z80_setsub(af.b.h,bc.b.l); af.b.h-=bc.b.l; cycles+=4; break; /*SUB C*/
-                        case 0x92: z80_setsub(af.b.h,de.b.h); af.b.h-=de.b.h; cycles+=4; break; /*SUB D*/
-                        case 0x93: z80_setsub(af.b.h,de.b.l); af.b.h-=de.b.l; cycles+=4; break; /*SUB E*/
-                        case 0x94: z80_setsub(af.b.h,hl.b.h); af.b.h-=hl.b.h; cycles+=4; break; /*SUB H*/
-                        case 0x95: z80_setsub(af.b.h,hl.b.l); af.b.h-=hl.b.l; cycles+=4; break; /*SUB L*/
-                        case 0x96: cycles+=4; temp=z80_readmem(hl.w); z80_setsub(af.b.h,temp); af.b.h-=temp; cycles+=3; break; /*SUB (HL)*/
-                        case 0x97: z80_setsub(af.b.h,af.b.h); af.b.h-=af.b.h; cycles+=4; break; /*SUB A*/
-                        case 0x98: setsbc(af.b.h,bc.b.h); af.b.h-=(bc.b.h+tempc); cycles+=4; break; /*SBC B*/
-                        case 0x99: setsbc(af.b.h,bc.b.l); af.b.h-=(bc.b.l+tempc); cycles+=4; break; /*SBC C*/
-                        case 0x9A: setsbc(af.b.h,de.b.h); af.b.h-=(de.b.h+tempc); cycles+=4; break; /*SBC D*/
-                        case 0x9B: setsbc(af.b.h,de.b.l); af.b.h-=(de.b.l+tempc); cycles+=4; break; /*SBC E*/
-                        case 0x9C: setsbc(af.b.h,hl.b.h); af.b.h-=(hl.b.h+tempc); cycles+=4; break; /*SBC H*/
-                        case 0x9D: setsbc(af.b.h,hl.b.l); af.b.h-=(hl.b.l+tempc); cycles+=4; break; /*SBC L*/
-                        case 0x9E: cycles+=4; temp=z80_readmem(hl.w); setsbc(af.b.h,temp); af.b.h-=(temp+tempc); cycles+=3; break; /*SBC (HL)*/
-                        case 0x9F: setsbc(af.b.h,af.b.h); af.b.h-=(af.b.h+tempc); cycles+=4; break; /*SBC A*/
-
-                        case 0xA0: af.b.h&=bc.b.h;        setand(af.b.h); cycles+=4; break; /*AND B*/
-                        case 0xA1: af.b.h&=bc.b.l;        setand(af.b.h); cycles+=4; break; /*AND C*/
-                        case 0xA2: af.b.h&=de.b.h;        setand(af.b.h); cycles+=4; break; /*AND D*/
-                        case 0xA3: af.b.h&=de.b.l;        setand(af.b.h); cycles+=4; break; /*AND E*/
-                        case 0xA4: af.b.h&=hl.b.h;        setand(af.b.h); cycles+=4; break; /*AND H*/
-                        case 0xA5: af.b.h&=hl.b.l;        setand(af.b.h); cycles+=4; break; /*AND L*/
-                        case 0xA6: cycles+=4; af.b.h&=z80_readmem(hl.w); setand(af.b.h); cycles+=3; break; /*AND (HL)*/
-                        case 0xA7: af.b.h&=af.b.h;        setand(af.b.h); cycles+=4; break; /*AND A*/
-                        case 0xA8: af.b.h^=bc.b.h;        setzn(af.b.h); cycles+=4; break; /*XOR B*/
-                        case 0xA9: af.b.h^=bc.b.l;        setzn(af.b.h); cycles+=4; break; /*XOR C*/
-                        case 0xAA: af.b.h^=de.b.h;        setzn(af.b.h); cycles+=4; break; /*XOR D*/
-                        case 0xAB: af.b.h^=de.b.l;        setzn(af.b.h); cycles+=4; break; /*XOR E*/
-                        case 0xAC: af.b.h^=hl.b.h;        setzn(af.b.h); cycles+=4; break; /*XOR H*/
-                        case 0xAD: af.b.h^=hl.b.l;        setzn(af.b.h); cycles+=4; break; /*XOR L*/
-                        case 0xAE: cycles+=4; af.b.h^=z80_readmem(hl.w); setzn(af.b.h); cycles+=3; break; /*XOR (HL)*/
-                        case 0xAF: af.b.h^=af.b.h;        setzn(af.b.h); cycles+=4; break; /*XOR A*/
-                        case 0xB0: af.b.h|=bc.b.h;        setzn(af.b.h); cycles+=4; break; /*OR B*/
-                        case 0xB1: af.b.h|=bc.b.l;        setzn(af.b.h); cycles+=4; break; /*OR C*/
-                        case 0xB2: af.b.h|=de.b.h;        setzn(af.b.h); cycles+=4; break; /*OR D*/
-                        case 0xB3: af.b.h|=de.b.l;        setzn(af.b.h); cycles+=4; break; /*OR E*/
-                        case 0xB4: af.b.h|=hl.b.h;        setzn(af.b.h); cycles+=4; break; /*OR H*/
-                        case 0xB5: af.b.h|=hl.b.l;        setzn(af.b.h); cycles+=4; break; /*OR L*/
-                        case 0xB6: cycles+=4; af.b.h|=z80_readmem(hl.w); setzn(af.b.h); cycles+=3; break; /*OR (HL)*/
-                        case 0xB7: af.b.h|=af.b.h;        setzn(af.b.h); cycles+=4; break; /*OR A*/
-                        case 0xB8: setcp(af.b.h,bc.b.h); cycles+=4; break; /*CP B*/
-                        case 0xB9: setcp(af.b.h,bc.b.l); cycles+=4; break; /*CP C*/
-                        case 0xBA: setcp(af.b.h,de.b.h); cycles+=4; break; /*CP D*/
-                        case 0xBB: setcp(af.b.h,de.b.l); cycles+=4; break; /*CP E*/
-                        case 0xBC: setcp(af.b.h,hl.b.h); cycles+=4; break; /*CP H*/
-                        case 0xBD: setcp(af.b.h,hl.b.l); cycles+=4; break; /*CP L*/
-                        case 0xBE: cycles+=4; temp=z80_readmem(hl.w); setcp(af.b.h,temp); cycles+=3; break; /*CP (HL)*/
-                        case 0xBF: setcp(af.b.h,af.b.h); cycles+=4; break; /*CP A*/
-
-                        case 0xC0: /*RET NZ*/
+                        NEXT;
+
+                        OP(80): z80_setadd(af.b.h,bc.b.h); af.b.h+=bc.b.h; cycles+=4; NEXT; /*ADD B*/
+                        OP(81): z80_setadd(af.b.h,bc.b.l); af.b.h+=bc.b.l; cycles+=4; NEXT; /*ADD C*/
+                        OP(82): z80_setadd(af.b.h,de.b.h); af.b.h+=de.b.h; cycles+=4; NEXT; /*ADD D*/
+                        OP(83): z80_setadd(af.b.h,de.b.l); af.b.h+=de.b.l; cycles+=4; NEXT; /*ADD E*/
+                        OP(84): z80_setadd(af.b.h,hl.b.h); af.b.h+=hl.b.h; cycles+=4; NEXT; /*ADD H*/
+                        OP(85): z80_setadd(af.b.h,hl.b.l); af.b.h+=hl.b.l; cycles+=4; NEXT; /*ADD L*/
+                        OP(86): cycles+=4; temp=z80_readmem(hl.w); z80_setadd(af.b.h,temp); af.b.h+=temp; cycles+=3; NEXT; /*ADD (HL)*/
+                        OP(87): z80_setadd(af.b.h,af.b.h); af.b.h+=af.b.h; cycles+=4; NEXT; /*ADD A*/
+                        OP(88): setadc(af.b.h,bc.b.h); af.b.h+=bc.b.h+tempc; cycles+=4; NEXT; /*ADC B*/
+                        OP(89): setadc(af.b.h,bc.b.l); af.b.h+=bc.b.l+tempc; cycles+=4; NEXT; /*ADC C*/
+                        OP(8A): setadc(af.b.h,de.b.h); af.b.h+=de.b.h+tempc; cycles+=4; NEXT; /*ADC D*/
+                        OP(8B): setadc(af.b.h,de.b.l); af.b.h+=de.b.l+tempc; cycles+=4; NEXT; /*ADC E*/
+                        OP(8C): setadc(af.b.h,hl.b.h); af.b.h+=hl.b.h+tempc; cycles+=4; NEXT; /*ADC H*/
+                        OP(8D): setadc(af.b.h,hl.b.l); af.b.h+=hl.b.l+tempc; cycles+=4; NEXT; /*ADC L*/
+                        OP(8E): cycles+=4; temp=z80_readmem(hl.w); setadc(af.b.h,temp); af.b.h+=temp+tempc; cycles+=3; NEXT; /*ADC (HL)*/
+                        OP(8F): setadc(af.b.h,af.b.h); af.b.h+=af.b.h+tempc; cycles+=4; NEXT; /*ADC A*/
+
+                        OP(90): z80_setsub(af.b.h,bc.b.h); af.b.h-=bc.b.h; cycles+=4; NEXT; /*SUB B*/
+                        OP(91): z80_setsub(af.b.h,bc.b.l); af.b.h-=bc.b.l; cycles+=4; NEXT; /*SUB C*/
+                        OP(92): z80_setsub(af.b.h,de.b.h); af.b.h-=de.b.h; cycles+=4; NEXT; /*SUB D*/
+                        OP(93): z80_setsub(af.b.h,de.b.l); af.b.h-=de.b.l; cycles+=4; NEXT; /*SUB E*/
+                        OP(94): z80_setsub(af.b.h,hl.b.h); af.b.h-=hl.b.h; cycles+=4; NEXT; /*SUB H*/
+                        OP(95): z80_setsub(af.b.h,hl.b.l); af.b.h-=hl.b.l; cycles+=4; NEXT; /*SUB L*/
+                        OP(96): cycles+=4; temp=z80_readmem(hl.w); z80_setsub(af.b.h,temp); af.b.h-=temp; cycles+=3; NEXT; /*SUB (HL)*/
+                        OP(97): z80_setsub(af.b.h,af.b.h); af.b.h-=af.b.h; cycles+=4; NEXT; /*SUB A*/
+                        OP(98): setsbc(af.b.h,bc.b.h); af.b.h-=(bc.b.h+tempc); cycles+=4; NEXT; /*SBC B*/
+                        OP(99): setsbc(af.b.h,bc.b.l); af.b.h-=(bc.b.l+tempc); cycles+=4; NEXT; /*SBC C*/
+                        OP(9A): setsbc(af.b.h,de.b.h); af.b.h-=(de.b.h+tempc); cycles+=4; NEXT; /*SBC D*/
+                        OP(9B): setsbc(af.b.h,de.b.l); af.b.h-=(de.b.l+tempc); cycles+=4; NEXT; /*SBC E*/
+                        OP(9C): setsbc(af.b.h,hl.b.h); af.b.h-=(hl.b.h+tempc); cycles+=4; NEXT; /*SBC H*/
+                        OP(9D): setsbc(af.b.h,hl.b.l); af.b.h-=(hl.b.l+tempc); cycles+=4; NEXT; /*SBC L*/
+                        OP(9E): cycles+=4; temp=z80_readmem(hl.w); setsbc(af.b.h,temp); af.b.h-=(temp+tempc); cycles+=3; NEXT; /*SBC (HL)*/
+                        OP(9F): setsbc(af.b.h,af.b.h); af.b.h-=(af.b.h+tempc); cycles+=4; NEXT; /*SBC A*/
+
+                        OP(A0): af.b.h&=bc.b.h;        setand(af.b.h); cycles+=4; NEXT; /*AND B*/
+                        OP(A1): af.b.h&=bc.b.l;        setand(af.b.h); cycles+=4; NEXT; /*AND C*/
+                        OP(A2): af.b.h&=de.b.h;        setand(af.b.h); cycles+=4; NEXT; /*AND D*/
+                        OP(A3): af.b.h&=de.b.l;        setand(af.b.h); cycles+=4; NEXT; /*AND E*/
+                        OP(A4): af.b.h&=hl.b.h;        setand(af.b.h); cycles+=4; NEXT; /*AND H*/
+                        OP(A5): af.b.h&=hl.b.l;        setand(af.b.h); cycles+=4; NEXT; /*AND L*/
+                        OP(A6): cycles+=4; af.b.h&=z80_readmem(hl.w); setand(af.b.h); cycles+=3; NEXT; /*AND (HL)*/
+                        OP(A7): af.b.h&=af.b.h;        setand(af.b.h); cycles+=4; NEXT; /*AND A*/
+                        OP(A8): af.b.h^=bc.b.h;        setzn(af.b.h); cycles+=4; NEXT; /*XOR B*/
+                        OP(A9): af.b.h^=bc.b.l;        setzn(af.b.h); cycles+=4; NEXT; /*XOR C*/
+                        OP(AA): af.b.h^=de.b.h;        setzn(af.b.h); cycles+=4; NEXT; /*XOR D*/
+                        OP(AB): af.b.h^=de.b.l;        setzn(af.b.h); cycles+=4; NEXT; /*XOR E*/
+                        OP(AC): af.b.h^=hl.b.h;        setzn(af.b.h); cycles+=4; NEXT; /*XOR H*/
+                        OP(AD): af.b.h^=hl.b.l;        setzn(af.b.h); cycles+=4; NEXT; /*XOR L*/
+                        OP(AE): cycles+=4; af.b.h^=z80_readmem(hl.w); setzn(af.b.h); cycles+=3; NEXT; /*XOR (HL)*/
+                        OP(AF): af.b.h^=af.b.h;        setzn(af.b.h); cycles+=4; NEXT; /*XOR A*/
+                        OP(B0): af.b.h|=bc.b.h;        setzn(af.b.h); cycles+=4; NEXT; /*OR B*/
+                        OP(B1): af.b.h|=bc.b.l;        setzn(af.b.h); cycles+=4; NEXT; /*OR C*/
+                        OP(B2): af.b.h|=de.b.h;        setzn(af.b.h); cycles+=4; NEXT; /*OR D*/
+                        OP(B3): af.b.h|=de.b.l;        setzn(af.b.h); cycles+=4; NEXT; /*OR E*/
+                        OP(B4): af.b.h|=hl.b.h;        setzn(af.b.h); cycles+=4; NEXT; /*OR H*/
+                        OP(B5): af.b.h|=hl.b.l;        setzn(af.b.h); cycles+=4; NEXT; /*OR L*/
+                        OP(B6): cycles+=4; af.b.h|=z80_readmem(hl.w); setzn(af.b.h); cycles+=3; NEXT; /*OR (HL)*/
+                        OP(B7): af.b.h|=af.b.h;        setzn(af.b.h); cycles+=4; NEXT; /*OR A*/
+                        OP(B8): setcp(af.b.h,bc.b.h); cycles+=4; NEXT; /*CP B*/
+                        OP(B9): setcp(af.b.h,bc.b.l); cycles+=4; NEXT; /*CP C*/
+                        OP(BA): setcp(af.b.h,de.b.h); cycles+=4; NEXT; /*CP D*/
+                        OP(BB): setcp(af.b.h,de.b.l); cycles+=4; NEXT; /*CP E*/
+                        OP(BC): setcp(af.b.h,hl.b.h); cycles+=4; NEXT; /*CP H*/
+                        OP(BD): setcp(af.b.h,hl.b.l); cycles+=4; NEXT; /*CP L*/
+                        OP(BE): cycles+=4; temp=z80_readmem(hl.w); setcp(af.b.h,temp); cycles+=3; NEXT; /*CP (HL)*/
+                        OP(BF): setcp(af.b.h,af.b.h); cycles+=4; NEXT; /*CP A*/
+
+                        OP(C0): /*RET NZ*/
                         cycles+=5;
                         if (!(af.b.l&Z_FLAG))
                         {
@@ -1084,26 +1129,26 @@ void z80_exec()
                                 cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                                 cycles+=3;
                         }
-                        break;
-                        case 0xC1: /*POP BC*/
+                        NEXT;
+                        OP(C1): /*POP BC*/
                         cycles+=4; bc.b.l=z80_readmem(sp); sp++;
                         cycles+=3; bc.b.h=z80_readmem(sp); sp++;
                         cycles+=3;
-                        break;
-                        case 0xC2: /*JP NZ*/
+                        NEXT;
+                        OP(C2): /*JP NZ*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (!(af.b.l&Z_FLAG))
                            pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xC3: /*JP xxxx*/
+                        NEXT;
+                        OP(C3): /*JP xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8);
                         pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xC4: /*CALL NZ,xxxx*/
+                        NEXT;
+                        OP(C4): /*CALL NZ,xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (!(af.b.l&Z_FLAG))
@@ -1115,27 +1160,27 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0xC5: /*PUSH BC*/
+                        NEXT;
+                        OP(C5): /*PUSH BC*/
                         cycles+=5; sp--; z80_writemem(sp,bc.b.h);
                         cycles+=3; sp--; z80_writemem(sp,bc.b.l);
                         cycles+=3;
-                        break;
-                        case 0xC6: /*ADD A,nn*/
+                        NEXT;
+                        OP(C6): /*ADD A,nn*/
                         cycles+=4; temp=z80_readmem(pc++);
 //                        printf("%04X : ADD %02X %02X - ",pc-1,af.b.h,temp);
                         z80_setadd(af.b.h,temp);
                         af.b.h+=temp;
                         cycles+=3;
 //                        printf("%04X\n",af.w);
-                        break;
-                        case 0xC7: /*RST 0*/
+                        NEXT;
+                        OP(C7): /*RST 0*/
                         cycles+=5; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=0x00;
                         cycles+=3;
-                        break;
-                        case 0xC8: /*RET Z*/
+                        NEXT;
+                        OP(C8): /*RET Z*/
                         cycles+=5;
                         if (af.b.l&Z_FLAG)
                         {
@@ -1143,21 +1188,21 @@ void z80_exec()
                                 cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                                 cycles+=3;
                         }
-                        break;
-                        case 0xC9: /*RET*/
+                        NEXT;
+                        OP(C9): /*RET*/
                         cycles+=4; pc=z80_readmem(sp); sp++;
                         cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                         cycles+=3;
-                        break;
-                        case 0xCA: /*JP Z*/
+                        NEXT;
+                        OP(CA): /*JP Z*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (af.b.l&Z_FLAG)
                            pc=addr;
                         cycles+=3;
-                        break;
+                        NEXT;
 
-                        case 0xCB: /*More opcodes*/
+                        OP(CB): /*More opcodes*/
                         ir.b.l=((ir.b.l+1)&0x7F)|(ir.b.l&0x80);
                         cycles+=4;
                         opcode=z80_readmem(pc++);
@@ -1509,9 +1554,9 @@ void z80_exec()
 //                                z80_dumpregs();
 //                                exit(-1);
                         }
-                        break;
+                        NEXT;
 
-                        case 0xCC: /*CALL Z,xxxx*/
+                        OP(CC): /*CALL Z,xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (af.b.l&Z_FLAG)
@@ -1523,29 +1568,29 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0xCD: /*CALL xxxx*/
+                        NEXT;
+                        OP(CD): /*CALL xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         cycles+=4; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xCE: /*ADC A,nn*/
+                        NEXT;
+                        OP(CE): /*ADC A,nn*/
                         cycles+=4; temp=z80_readmem(pc++);
                         setadc(af.b.h,temp);
                         af.b.h+=temp+tempc;
                         cycles+=3;
-                        break;
-                        case 0xCF: /*RST 8*/
+                        NEXT;
+                        OP(CF): /*RST 8*/
                         cycles+=5; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=0x08;
                         cycles+=3;
-                        break;
+                        NEXT;
 
-                        case 0xD0: /*RET NC*/
+                        OP(D0): /*RET NC*/
                         cycles+=5;
                         if (!(af.b.l&C_FLAG))
                         {
@@ -1553,25 +1598,25 @@ void z80_exec()
                                 cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                                 cycles+=3;
                         }
-                        break;
-                        case 0xD1: /*POP DE*/
+                        NEXT;
+                        OP(D1): /*POP DE*/
                         cycles+=4; de.b.l=z80_readmem(sp); sp++;
                         cycles+=3; de.b.h=z80_readmem(sp); sp++;
                         cycles+=3;
-                        break;
-                        case 0xD2: /*JP NC*/
+                        NEXT;
+                        OP(D2): /*JP NC*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (!(af.b.l&C_FLAG))
                            pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xD3: /*OUT (nn),A*/
+                        NEXT;
+                        OP(D3): /*OUT (nn),A*/
                         cycles+=4; addr=z80_readmem(pc++);
                         cycles+=3; z80out(addr,af.b.h);
                         cycles+=4;
-                        break;
-                        case 0xD4: /*CALL NC,xxxx*/
+                        NEXT;
+                        OP(D4): /*CALL NC,xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (!(af.b.l&C_FLAG))
@@ -1583,25 +1628,25 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0xD5: /*PUSH DE*/
+                        NEXT;
+                        OP(D5): /*PUSH DE*/
                         cycles+=5; sp--; z80_writemem(sp,de.b.h);
                         cycles+=3; sp--; z80_writemem(sp,de.b.l);
                         cycles+=3;
-                        break;
-                        case 0xD6: /*SUB A,nn*/
+                        NEXT;
+                        OP(D6): /*SUB A,nn*/
                         cycles+=4; temp=z80_readmem(pc++);
                         z80_setsub(af.b.h,temp);
                         af.b.h-=temp;
                         cycles+=3;
-                        break;
-                        case 0xD7: /*RST 10*/
+                        NEXT;
+                        OP(D7): /*RST 10*/
                         cycles+=5; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=0x10;
                         cycles+=3;
-                        break;
-                        case 0xD8: /*RET C*/
+                        NEXT;
+                        OP(D8): /*RET C*/
                         cycles+=5;
                         if (af.b.l&C_FLAG)
                         {
@@ -1609,26 +1654,26 @@ void z80_exec()
                                 cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                                 cycles+=3;
                         }
-                        break;
-                        case 0xD9: /*EXX*/
+                        NEXT;
+                        OP(D9): /*EXX*/
                         addr=bc.w; bc.w=sbc.w; sbc.w=addr;
                         addr=de.w; de.w=sde.w; sde.w=addr;
                         addr=hl.w; hl.w=shl.w; shl.w=addr;
                         cycles+=4;
-                        break;
-                        case 0xDA: /*JP C*/
+                        NEXT;
+                        OP(DA): /*JP C*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (af.b.l&C_FLAG)
                            pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xDB: /*IN A,(n)*/
+                        NEXT;
+                        OP(DB): /*IN A,(n)*/
                         cycles+=4; temp=z80_readmem(pc++);
                         cycles+=3; af.b.h=z80in((af.b.h<<8)|temp);
                         cycles+=4;
-                        break;
-                        case 0xDC: /*CALL C,xxxx*/
+                        NEXT;
+                        OP(DC): /*CALL C,xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (af.b.l&C_FLAG)
@@ -1640,9 +1685,9 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
+                        NEXT;
 
-                        case 0xDD: /*More opcodes*/
+                        OP(DD): /*More opcodes*/
                         ir.b.l=((ir.b.l+1)&0x7F)|(ir.b.l&0x80);
                         cycles+=4;
                         opcode=z80_readmem(pc++);
@@ -2064,22 +2109,22 @@ void z80_exec()
 //                                z80_dumpregs();
 //                                exit(-1);
                         }
-                        break;
+                        NEXT;
 
-                        case 0xDE: /*SBC A,nn*/
+                        OP(DE): /*SBC A,nn*/
                         cycles+=4; temp=z80_readmem(pc++);
                         setsbc(af.b.h,temp);
                         af.b.h-=(temp+tempc);
                         cycles+=3;
-                        break;
-                        case 0xDF: /*RST 18*/
+                        NEXT;
+                        OP(DF): /*RST 18*/
                         cycles+=5; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=0x18;
                         cycles+=3;
-                        break;
+                        NEXT;
 
-                        case 0xE0: /*RET PO*/
+                        OP(E0): /*RET PO*/
                         cycles+=5;
                         if (!(af.b.l&V_FLAG))
                         {
@@ -2087,28 +2132,28 @@ void z80_exec()
                                 cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                                 cycles+=3;
                         }
-                        break;
-                        case 0xE1: /*POP HL*/
+                        NEXT;
+                        OP(E1): /*POP HL*/
                         cycles+=4; hl.b.l=z80_readmem(sp); sp++;
                         cycles+=3; hl.b.h=z80_readmem(sp); sp++;
                         cycles+=3;
-                        break;
-                        case 0xE2: /*JP PO*/
+                        NEXT;
+                        OP(E2): /*JP PO*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (!(af.b.l&V_FLAG))
                            pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xE3: /*EX (SP),HL*/
+                        NEXT;
+                        OP(E3): /*EX (SP),HL*/
                         cycles+=4; addr=z80_readmem(sp);
                         cycles+=3; addr|=(z80_readmem(sp+1)<<8);
                         cycles+=4; z80_writemem(sp,hl.b.l);
                         cycles+=3; z80_writemem(sp+1,hl.b.h);
                         hl.w=addr;
                         cycles+=5;
-                        break;
-                        case 0xE4: /*CALL PO,xxxx*/
+                        NEXT;
+                        OP(E4): /*CALL PO,xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (!(af.b.l&V_FLAG))
@@ -2120,24 +2165,24 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0xE5: /*PUSH HL*/
+                        NEXT;
+                        OP(E5): /*PUSH HL*/
                         cycles+=5; sp--; z80_writemem(sp,hl.b.h);
                         cycles+=3; sp--; z80_writemem(sp,hl.b.l);
                         cycles+=3;
-                        break;
-                        case 0xE6: /*AND nn*/
+                        NEXT;
+                        OP(E6): /*AND nn*/
                         cycles+=4; af.b.h&=z80_readmem(pc++);
                         setand(af.b.h);
                         cycles+=3;
-                        break;
-                        case 0xE7: /*RST 20*/
+                        NEXT;
+                        OP(E7): /*RST 20*/
                         cycles+=5; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=0x20;
                         cycles+=3;
-                        break;
-                        case 0xE8: /*RET PE*/
+                        NEXT;
+                        OP(E8): /*RET PE*/
                         cycles+=5;
                         if (af.b.l&V_FLAG)
                         {
@@ -2145,23 +2190,23 @@ void z80_exec()
                                 cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                                 cycles+=3;
                         }
-                        break;
-                        case 0xE9: /*JP (HL)*/
+                        NEXT;
+                        OP(E9): /*JP (HL)*/
                         pc=hl.w;
                         cycles+=4;
-                        break;
-                        case 0xEA: /*JP PE*/
+                        NEXT;
+                        OP(EA): /*JP PE*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (af.b.l&V_FLAG)
                            pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xEB: /*EX DE,HL*/
+                        NEXT;
+                        OP(EB): /*EX DE,HL*/
                         addr=de.w; de.w=hl.w; hl.w=addr;
                         cycles+=4;
-                        break;
-                        case 0xEC: /*CALL PE,xxxx*/
+                        NEXT;
+                        OP(EC): /*CALL PE,xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (af.b.l&V_FLAG)
@@ -2173,9 +2218,9 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
+                        NEXT;
 
-                        case 0xED: /*More opcodes*/
+                        OP(ED): /*More opcodes*/
                         ir.b.l=((ir.b.l+1)&0x7F)|(ir.b.l&0x80);
                         cycles+=4;
                         opcode=z80_readmem(pc++);
@@ -2478,22 +2523,22 @@ void z80_exec()
 //                                z80_dumpregs();
 //                                exit(-1);
                         }
-                        break;
+                        NEXT;
 
-                        case 0xEE: /*XOR nn*/
+                        OP(EE): /*XOR nn*/
                         cycles+=4; af.b.h^=z80_readmem(pc++);
                         af.b.l&=~3;
                         setzn(af.b.h);
                         cycles+=3;
-                        break;
-                        case 0xEF: /*RST 28*/
+                        NEXT;
+                        OP(EF): /*RST 28*/
                         cycles+=5; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=0x28;
                         cycles+=3;
-                        break;
+                        NEXT;
 
-                        case 0xF0: /*RET P*/
+                        OP(F0): /*RET P*/
                         cycles+=5;
                         if (!(af.b.l&N_FLAG))
                         {
@@ -2501,24 +2546,24 @@ void z80_exec()
                                 cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                                 cycles+=3;
                         }
-                        break;
-                        case 0xF1: /*POP AF*/
+                        NEXT;
+                        OP(F1): /*POP AF*/
                         cycles+=4; af.b.l=z80_readmem(sp); sp++;
                         cycles+=3; af.b.h=z80_readmem(sp); sp++;
                         cycles+=3;
-                        break;
-                        case 0xF2: /*JP P*/
+                        NEXT;
+                        OP(F2): /*JP P*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (!(af.b.l&N_FLAG))
                            pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xF3: /*DI*/
+                        NEXT;
+                        OP(F3): /*DI*/
                         iff1=iff2=0;
                         cycles+=4;
-                        break;
-                        case 0xF4: /*CALL P,xxxx*/
+                        NEXT;
+                        OP(F4): /*CALL P,xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (!(af.b.l&N_FLAG))
@@ -2530,25 +2575,25 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
-                        case 0xF5: /*PUSH AF*/
+                        NEXT;
+                        OP(F5): /*PUSH AF*/
                         cycles+=5; sp--; z80_writemem(sp,af.b.h);
                         cycles+=3; sp--; z80_writemem(sp,af.b.l);
                         cycles+=3;
-                        break;
-                        case 0xF6: /*OR nn*/
+                        NEXT;
+                        OP(F6): /*OR nn*/
                         cycles+=4; af.b.h|=z80_readmem(pc++);
                         af.b.l&=~3;
                         setzn(af.b.h);
                         cycles+=3;
-                        break;
-                        case 0xF7: /*RST 30*/
+                        NEXT;
+                        OP(F7): /*RST 30*/
                         cycles+=5; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=0x30;
                         cycles+=3;
-                        break;
-                        case 0xF8: /*RET M*/
+                        NEXT;
+                        OP(F8): /*RET M*/
                         cycles+=5;
                         if (af.b.l&N_FLAG)
                         {
@@ -2556,23 +2601,23 @@ void z80_exec()
                                 cycles+=3; pc|=(z80_readmem(sp)<<8); sp++;
                                 cycles+=3;
                         }
-                        break;
-                        case 0xF9: /*LD SP,HL*/
+                        NEXT;
+                        OP(F9): /*LD SP,HL*/
                         sp=hl.w;
                         cycles+=6;
-                        break;
-                        case 0xFA: /*JP M*/
+                        NEXT;
+                        OP(FA): /*JP M*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (af.b.l&N_FLAG)
                            pc=addr;
                         cycles+=3;
-                        break;
-                        case 0xFB: /*EI*/
+                        NEXT;
+                        OP(FB): /*EI*/
                         iff1=iff2=1;
                         cycles+=4;
-                        break;
-                        case 0xFC: /*CALL M,xxxx*/
+                        NEXT;
+                        OP(FC): /*CALL M,xxxx*/
                         cycles+=4; addr=z80_readmem(pc);
                         cycles+=3; addr|=(z80_readmem(pc+1)<<8); pc+=2;
                         if (af.b.l&N_FLAG)
@@ -2584,9 +2629,9 @@ void z80_exec()
                         }
                         else
                            cycles+=3;
-                        break;
+                        NEXT;
 
-                        case 0xFD: /*More opcodes*/
+                        OP(FD): /*More opcodes*/
                         ir.b.l=((ir.b.l+1)&0x7F)|(ir.b.l&0x80);
                         cycles+=4;
                         opcode=z80_readmem(pc++);
@@ -3001,22 +3046,22 @@ void z80_exec()
 //                                z80_dumpregs();
 //                                exit(-1);
                         }
-                        break;
+                        NEXT;
 
-                        case 0xFE: /*CP nn*/
+                        OP(FE): /*CP nn*/
                         cycles+=4; temp=z80_readmem(pc++);
                         setcp(af.b.h,temp);
                         cycles+=3;
-                        break;
-                        case 0xFF: /*RST 38*/
+                        NEXT;
+                        OP(FF): /*RST 38*/
                         cycles+=5; sp--; z80_writemem(sp,pc>>8);
                         cycles+=3; sp--; z80_writemem(sp,pc&0xFF);
                         pc=0x38;
                         cycles+=3;
-                        break;
+                        NEXT;
 
                         default:
-                        break;
+                        NEXT;
 //                        printf("Bad opcode %02X at %04X\n",opcode,pc);
 //                        z80_dumpregs();
 //                        z80_mem_dump();
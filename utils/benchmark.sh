@@ -0,0 +1,78 @@
+#!/bin/sh
+#
+# benchmark.sh: boot each of the demo discs bundled for the Pico build
+#		headless on a Model B and a Master 128, for a fixed number
+#		of frames at full speed, and report the emulated clock rate,
+#		the host CPU time per frame and checksums of the last frame
+#		and of RAM.
+#
+#		Each disc is booted by replaying an input log that holds
+#		SHIFT down over a BREAK, which also starts the Master's
+#		clock from the same time on every run so the RAM checksum
+#		does not depend on when the script was run.
+#
+#		usage: benchmark.sh [-f frames] [-o options] [-r reference] [b-em]
+#
+#		The output can be saved and given back with -r to check a
+#		later build draws the same frames; any frame checksum that
+#		differs is reported and makes the script exit non-zero.
+#		Further b-em options, such as -jit, can be given with -o.
+#
+#		Run from the top of the source tree so b-em finds its ROMs.
+
+FRAMES=1500
+OPTS=""
+REF=""
+while getopts "f:o:r:" opt; do
+	case $opt in
+		f) FRAMES=$OPTARG ;;
+		o) OPTS=$OPTARG ;;
+		r) REF=$OPTARG ;;
+		*) echo "usage: $0 [-f frames] [-o options] [-r reference] [b-em]" >&2; exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+BEM=${1:-./b-em}
+DISCDIR=$(dirname "$0")/../src/pico/discs
+
+DISCS="bs-badappl.dsd bs-beeb-niccc.dsd bs-patarty.ssd bs-twisted.ssd beebstep.ssd"
+# model number from b-em.cfg and the name to report it by.
+MODELS="3:B 10:Master"
+
+[ -x "$BEM" ] || { echo "$0: $BEM is not executable" >&2; exit 2; }
+[ -z "$REF" ] || [ -r "$REF" ] || { echo "$0: cannot read $REF" >&2; exit 2; }
+
+BOOT=$(mktemp) || exit 2
+trap 'rm -f "$BOOT"' EXIT
+
+status=0
+printf '%-20s %-7s %8s %11s %9s %9s\n' disc model MHz "cpu ms/fr" checksum memory
+for disc in $DISCS; do
+	for model in $MODELS; do
+		num=${model%%:*}
+		name=${model#*:}
+		# SHIFT (Allegro key 215) held for the first second, and an
+		# end beyond the last frame so the replay does not stop the run.
+		printf 'b-em-input 1 model=%d tube=-1 time=0\n0 key 215 1\n1 break\n50 key 215 0\n%d end\n' \
+			"$num" $((FRAMES + 1)) > "$BOOT"
+		out=$("$BEM" -headless -m"$num" -frames "$FRAMES" -speed -checksum -replayinput "$BOOT" $OPTS "$DISCDIR/$disc" 2>/dev/null)
+		mhz=$(echo "$out" | sed -n 's/^speed: \([0-9.]*\)MHz.*/\1/p')
+		cpu=$(echo "$out" | sed -n 's/^speed: \([0-9.]*\)ms host CPU.*/\1/p')
+		sum=$(echo "$out" | sed -n 's/^checksum: \([0-9A-F]*\).*/\1/p')
+		ram=$(echo "$out" | sed -n 's/^memory: \([0-9A-F]*\).*/\1/p')
+		if [ -z "$mhz" ] || [ -z "$sum" ]; then
+			printf '%-20s %-7s %s\n' "$disc" "$name" "failed"
+			status=1
+			continue
+		fi
+		printf '%-20s %-7s %8s %11s %9s %9s\n' "$disc" "$name" "$mhz" "$cpu" "$sum" "$ram"
+		if [ -n "$REF" ]; then
+			want=$(awk -v d="$disc" -v m="$name" '$1 == d && $2 == m { print $5 }' "$REF")
+			if [ -n "$want" ] && [ "$want" != "$sum" ]; then
+				echo "$0: $disc on $name: checksum $sum, reference $want" >&2
+				status=1
+			fi
+		fi
+	done
+done
+exit $status
@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# core-compare.sh: run two builds of a co-processor test program, such as
+#		ns32016-test and ns32016-test-nocache which differ only in
+#		whether the core caches decoded instructions, and check
+#		they print the same hashes of the processor state.
+#
+#		usage: core-compare.sh test-a test-b [arguments]
+#
+#		The arguments are given to both.  Any case on which the two
+#		builds differ is listed and makes the script exit non-zero.
+
+USAGE="usage: $0 test-a test-b [arguments]"
+[ $# -ge 2 ] || { echo "$USAGE" >&2; exit 2; }
+TEST_A=$1
+TEST_B=$2
+shift 2
+for test in "$TEST_A" "$TEST_B"; do
+	[ -x "$test" ] || { echo "$0: $test is not executable" >&2; exit 2; }
+done
+
+A=$(mktemp) || exit 2
+B=$(mktemp) || { rm -f "$A"; exit 2; }
+trap 'rm -f "$A" "$B"' EXIT
+
+"$TEST_A" "$@" > "$A" || { echo "$0: $TEST_A failed" >&2; exit 1; }
+"$TEST_B" "$@" > "$B" || { echo "$0: $TEST_B failed" >&2; exit 1; }
+
+echo "a: $TEST_A"
+echo "b: $TEST_B"
+if cmp -s "$A" "$B"; then
+	awk 'END { print NR " cases, all the same" }' "$A"
+	exit 0
+fi
+diff "$A" "$B" | sed -n 's/^< \([^ ]*\).*/\1 DIFFERENT/p'
+exit 1
@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# cpu-compare.sh: run the demo discs of benchmark.sh through two builds
+#		of b-em, such as b-em-reduced and b-em-reduced-thumb-cpu
+#		which differ only in the 6502 core, and report the clock
+#		rate each reached and whether their final frames and RAM
+#		agree.
+#
+#		usage: cpu-compare.sh [-f frames] [-a options] [-b options]
+#				      b-em-a b-em-b
+#
+#		Any disc on which the two builds diverge is listed and makes
+#		the script exit non-zero.  Cut the frame count with -f to
+#		home in on where a divergence starts.  -a and -b give further
+#		options for each build, so one build can be compared with
+#		itself run differently, as "-b -jit b-em b-em" does.
+#
+#		Run from the top of the source tree so b-em finds its ROMs.
+
+USAGE="usage: $0 [-f frames] [-a options] [-b options] b-em-a b-em-b"
+FRAMES=1500
+OPTS_A=""
+OPTS_B=""
+while getopts "f:a:b:" opt; do
+	case $opt in
+		f) FRAMES=$OPTARG ;;
+		a) OPTS_A=$OPTARG ;;
+		b) OPTS_B=$OPTARG ;;
+		*) echo "$USAGE" >&2; exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 2 ] || { echo "$USAGE" >&2; exit 2; }
+for bem in "$1" "$2"; do
+	[ -x "$bem" ] || { echo "$0: $bem is not executable" >&2; exit 2; }
+done
+BENCH=$(dirname "$0")/benchmark.sh
+
+A=$(mktemp) || exit 2
+B=$(mktemp) || { rm -f "$A"; exit 2; }
+trap 'rm -f "$A" "$B"' EXIT
+
+# a failed run is shown as such in the table, so carry on regardless.
+"$BENCH" -f "$FRAMES" -o "$OPTS_A" "$1" > "$A"
+"$BENCH" -f "$FRAMES" -o "$OPTS_B" "$2" > "$B"
+
+echo "a: $1${OPTS_A:+ $OPTS_A}"
+echo "b: $2${OPTS_B:+ $OPTS_B}"
+awk '
+	FNR == 1 { next }
+	NR == FNR { run[$1 " " $2] = $0; next }
+	{
+		key = $1 " " $2
+		split(run[key], a)
+		if (a[3] == "failed" || $3 == "failed" || a[3] == "") {
+			printf "%-20s %-7s %s\n", $1, $2, "failed"
+			status = 1
+			next
+		}
+		same = (a[5] == $5 && a[6] == $6)
+		printf "%-20s %-7s %8s %8s %7.2fx %s\n", $1, $2, a[3], $3,
+			(a[3] > 0 ? $3 / a[3] : 0), same ? "same" : "DIFFERENT"
+		if (!same)
+			status = 1
+	}
+	BEGIN { printf "%-20s %-7s %8s %8s %8s %s\n", "disc", "model", "a MHz", "b MHz", "b/a", "result" }
+	END { exit status }
+' "$A" "$B"